@@ -113,9 +113,1787 @@ void test_tinyobj_parse_obj(void)
     }
 }
 
+typedef struct {
+    const char *obj;
+    size_t obj_len;
+} memory_file_t;
+
+void loadMemory(void *ctx, const char * filename, const int is_mtl, const char *obj_filename, char ** buffer, size_t * len)
+{
+    memory_file_t *file = (memory_file_t *)ctx;
+    if (is_mtl) {
+        loadFile(NULL, filename, is_mtl, obj_filename, buffer, len);
+        return;
+    }
+    *buffer = (char *)file->obj;
+    *len = file->obj_len;
+}
+
+// Generates a grid of quads with texcoords, normals, relative indices and
+// several groups, large enough to be split across threads.
+char *generate_grid_obj(int n, size_t *len)
+{
+    size_t cap = (size_t)n * (size_t)n * 160 + 1024;
+    char *buf = (char *)malloc(cap);
+    size_t pos = 0;
+    int x, y;
+
+    pos += sprintf(buf + pos, "mtllib fixtures/cube.mtl\n");
+    for (y = 0; y < n; y++) {
+        pos += sprintf(buf + pos, "g row%d\nusemtl %s\n", y, (y % 2) ? "CubeMaterial" : "unknown");
+        for (x = 0; x < n; x++) {
+            pos += sprintf(buf + pos, "v %d.5 %d.25 -%d.125e-1\nvt 0.%d 0.%d\nvn 0 0 1\n", x, y, x + y, x, y);
+        }
+        if (y > 0) {
+            for (x = 0; x < n - 1; x++) {
+                int a = y * n + x + 1;
+                pos += sprintf(buf + pos, "f %d/%d/%d %d/%d/%d -%d/-%d/-1 -%d/-%d/-1\n",
+                               a - n, a - n, a - n, a - n + 1, a - n + 1, a - n + 1,
+                               n - x - 1, n - x - 1, n - x, n - x);
+            }
+        }
+    }
+    *len = pos;
+    return buf;
+}
+
+// Arrays may be NULL when they are empty.
+int same_bytes(const void *a, const void *b, size_t len)
+{
+    return len == 0 || memcmp(a, b, len) == 0;
+}
+
+void check_same_attrib(const tinyobj_attrib_t *a, const tinyobj_attrib_t *b)
+{
+    TEST_CHECK(a->num_vertices == b->num_vertices);
+    TEST_CHECK(a->num_normals == b->num_normals);
+    TEST_CHECK(a->num_texcoords == b->num_texcoords);
+    TEST_CHECK(a->num_faces == b->num_faces);
+    TEST_CHECK(a->num_face_num_verts == b->num_face_num_verts);
+    TEST_CHECK(same_bytes(a->vertices, b->vertices, sizeof(float) * 3 * a->num_vertices));
+    TEST_CHECK(same_bytes(a->normals, b->normals, sizeof(float) * 3 * a->num_normals));
+    TEST_CHECK(same_bytes(a->texcoords, b->texcoords, sizeof(float) * 2 * a->num_texcoords));
+    TEST_CHECK(same_bytes(a->faces, b->faces, sizeof(tinyobj_vertex_index_t) * a->num_faces));
+    TEST_CHECK(same_bytes(a->face_num_verts, b->face_num_verts, sizeof(int) * a->num_face_num_verts));
+    TEST_CHECK(same_bytes(a->material_ids, b->material_ids, sizeof(int) * a->num_face_num_verts));
+}
+
+void test_tinyobj_parse_obj_parallel(void)
+{
+    memory_file_t file;
+    unsigned int flags[2] = { 0, TINYOBJ_FLAG_TRIANGULATE };
+    int i;
+
+    file.obj = generate_grid_obj(100, &file.obj_len);
+
+    for (i = 0; i < 2; i++) {
+        tinyobj_attrib_t serial, parallel;
+        tinyobj_shape_t *serial_shapes = NULL, *parallel_shapes = NULL;
+        tinyobj_material_t *serial_materials = NULL, *parallel_materials = NULL;
+        size_t num_serial_shapes, num_parallel_shapes;
+        size_t num_serial_materials, num_parallel_materials;
+        tinyobj_parse_option_t option;
+        size_t s;
+
+        memset(&option, 0, sizeof(option));
+        option.num_threads = 4;
+
+        TEST_CHECK(tinyobj_parse_obj(&serial, &serial_shapes, &num_serial_shapes,
+                                     &serial_materials, &num_serial_materials,
+                                     "grid.obj", loadMemory, &file, flags[i]) == TINYOBJ_SUCCESS);
+        TEST_CHECK(tinyobj_parse_obj_ex(&parallel, &parallel_shapes, &num_parallel_shapes,
+                                        &parallel_materials, &num_parallel_materials,
+                                        "grid.obj", loadMemory, &file,
+                                        flags[i] | TINYOBJ_FLAG_PARALLEL, &option) == TINYOBJ_SUCCESS);
+
+        TEST_CHECK(serial.num_vertices == 100 * 100);
+        check_same_attrib(&serial, &parallel);
+
+        // Chunks start in the middle of rows, after their `usemtl`.
+        if (flags[i] == 0) {
+            size_t f;
+            for (f = 0; f < parallel.num_face_num_verts; f++) {
+                int y = 1 + (int)(f / 99);
+                TEST_CHECK(parallel.material_ids[f] == ((y % 2) ? 0 : -1));
+            }
+        }
+
+        TEST_CHECK(num_serial_shapes == num_parallel_shapes);
+        for (s = 0; s < num_serial_shapes; s++) {
+            TEST_CHECK(strcmp(serial_shapes[s].name, parallel_shapes[s].name) == 0);
+            TEST_CHECK(serial_shapes[s].face_offset == parallel_shapes[s].face_offset);
+            TEST_CHECK(serial_shapes[s].length == parallel_shapes[s].length);
+        }
+        TEST_CHECK(num_serial_materials == 1);
+        TEST_CHECK(num_parallel_materials == 1);
+
+        tinyobj_attrib_free(&serial);
+        tinyobj_attrib_free(&parallel);
+        tinyobj_shapes_free(serial_shapes, num_serial_shapes);
+        tinyobj_shapes_free(parallel_shapes, num_parallel_shapes);
+        tinyobj_materials_free(serial_materials, num_serial_materials);
+        tinyobj_materials_free(parallel_materials, num_parallel_materials);
+    }
+
+    free((char *)file.obj);
+}
+
+// Replace "\n" with "\r\n".
+char *to_crlf(const char *text, size_t len, size_t *out_len)
+{
+    char *buf = (char *)malloc(len * 2);
+    size_t i, pos = 0;
+    for (i = 0; i < len; i++) {
+        if (text[i] == '\n') buf[pos++] = '\r';
+        buf[pos++] = text[i];
+    }
+    *out_len = pos;
+    return buf;
+}
+
+void test_tinyobj_parser_stream(void)
+{
+    static const size_t chunk_sizes[] = { 1, 2, 7, 61, 4096, 0 /* whole file */ };
+    memory_file_t files[2];
+    int f;
+
+    files[0].obj = generate_grid_obj(20, &files[0].obj_len);
+    files[1].obj = to_crlf(files[0].obj, files[0].obj_len, &files[1].obj_len);
+
+    for (f = 0; f < 2; f++) {
+        tinyobj_attrib_t expected;
+        tinyobj_shape_t *expected_shapes = NULL;
+        tinyobj_material_t *expected_materials = NULL;
+        size_t num_expected_shapes, num_expected_materials;
+        size_t c;
+
+        TEST_CHECK(tinyobj_parse_obj(&expected, &expected_shapes, &num_expected_shapes,
+                                     &expected_materials, &num_expected_materials,
+                                     "grid.obj", loadMemory, &files[f], TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+
+        for (c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++) {
+            tinyobj_attrib_t attrib;
+            tinyobj_shape_t *shapes = NULL;
+            tinyobj_material_t *materials = NULL;
+            size_t num_shapes, num_materials, pos, s;
+            size_t chunk_size = chunk_sizes[c] ? chunk_sizes[c] : files[f].obj_len;
+            tinyobj_parser_t *parser = tinyobj_parser_create("grid.obj", loadFile, NULL, TINYOBJ_FLAG_TRIANGULATE);
+
+            TEST_CHECK(parser != NULL);
+            for (pos = 0; pos < files[f].obj_len; pos += chunk_size) {
+                size_t len = files[f].obj_len - pos;
+                if (len > chunk_size) len = chunk_size;
+                TEST_CHECK(tinyobj_parser_feed(parser, files[f].obj + pos, len) == TINYOBJ_SUCCESS);
+            }
+            TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes,
+                                             &materials, &num_materials) == TINYOBJ_SUCCESS);
+            TEST_MSG("chunk size %d, crlf %d", (int)chunk_size, f);
+
+            check_same_attrib(&expected, &attrib);
+            TEST_CHECK(num_shapes == num_expected_shapes);
+            for (s = 0; s < num_shapes && s < num_expected_shapes; s++) {
+                TEST_CHECK(strcmp(shapes[s].name, expected_shapes[s].name) == 0);
+                TEST_CHECK(shapes[s].face_offset == expected_shapes[s].face_offset);
+                TEST_CHECK(shapes[s].length == expected_shapes[s].length);
+            }
+            TEST_CHECK(num_materials == num_expected_materials);
+
+            tinyobj_attrib_free(&attrib);
+            tinyobj_shapes_free(shapes, num_shapes);
+            tinyobj_materials_free(materials, num_materials);
+        }
+
+        tinyobj_attrib_free(&expected);
+        tinyobj_shapes_free(expected_shapes, num_expected_shapes);
+        tinyobj_materials_free(expected_materials, num_expected_materials);
+        free((char *)files[f].obj);
+    }
+}
+
+void test_tinyobj_parser_stream_last_line(void)
+{
+    // The last line has no line ending and ends with a lone '\r' in the
+    // middle of the file.
+    const char *text = "v 1 2 3\rv 4 5 6\r\nv 7 8 9";
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials, i;
+    tinyobj_parser_t *parser = tinyobj_parser_create(NULL, NULL, NULL, 0);
+
+    for (i = 0; text[i]; i++) {
+        TEST_CHECK(tinyobj_parser_feed(parser, &text[i], 1) == TINYOBJ_SUCCESS);
+    }
+    TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes,
+                                     &materials, &num_materials) == TINYOBJ_SUCCESS);
+    TEST_CHECK(attrib.num_vertices == 3);
+    TEST_CHECK(attrib.vertices[0] == 1.0f);
+    TEST_CHECK(attrib.vertices[3] == 4.0f);
+    TEST_CHECK(attrib.vertices[8] == 9.0f);
+    TEST_CHECK(num_shapes == 0);
+    TEST_CHECK(num_materials == 0);
+
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+}
+
+void check_same_materials(const tinyobj_material_t *a, size_t num_a,
+                          const tinyobj_material_t *b, size_t num_b)
+{
+    size_t i;
+
+    TEST_CHECK(num_a == num_b);
+    for (i = 0; i < num_a && i < num_b; i++) {
+        TEST_CHECK(strcmp(a[i].name, b[i].name) == 0);
+        TEST_CHECK(memcmp(a[i].diffuse, b[i].diffuse, sizeof(a[i].diffuse)) == 0);
+    }
+}
+
+void test_tinyobj_parse_obj_arena(void)
+{
+    const char *filename = "fixtures/cube.obj";
+    tinyobj_attrib_t heap, arena_attrib;
+    tinyobj_shape_t *heap_shapes = NULL, *arena_shapes = NULL;
+    tinyobj_material_t *heap_materials = NULL, *arena_materials = NULL;
+    size_t num_heap_shapes, num_arena_shapes;
+    size_t num_heap_materials, num_arena_materials;
+    tinyobj_parse_option_t option;
+    tinyobj_parser_t *parser;
+    tinyobj_arena_t arena;
+    char *buf = NULL;
+    size_t len = 0, i;
+
+    TEST_CHECK(tinyobj_parse_obj(&heap, &heap_shapes, &num_heap_shapes,
+                                 &heap_materials, &num_heap_materials, filename,
+                                 loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(num_heap_materials == 1);
+
+    // Small blocks, so the results span several of them.
+    tinyobj_arena_init(&arena, 256);
+    memset(&option, 0, sizeof(option));
+    option.arena = &arena;
+
+    TEST_CHECK(tinyobj_parse_obj_ex(&arena_attrib, &arena_shapes, &num_arena_shapes,
+                                    &arena_materials, &num_arena_materials, filename,
+                                    loadFile, NULL, 0, &option) == TINYOBJ_SUCCESS);
+    check_same_attrib(&heap, &arena_attrib);
+    check_same_materials(heap_materials, num_heap_materials,
+                         arena_materials, num_arena_materials);
+    TEST_CHECK(num_heap_shapes == num_arena_shapes);
+
+    // Stream into the same arena.
+    loadFile(NULL, filename, 0, NULL, &buf, &len);
+    parser = tinyobj_parser_create_ex(filename, loadFile, NULL, 0, &option);
+    for (i = 0; i < len; i += 7) {
+        TEST_CHECK(tinyobj_parser_feed(parser, buf + i, (len - i < 7) ? len - i : 7) == TINYOBJ_SUCCESS);
+    }
+    TEST_CHECK(tinyobj_parser_finish(parser, &arena_attrib, &arena_shapes, &num_arena_shapes,
+                                     &arena_materials, &num_arena_materials) == TINYOBJ_SUCCESS);
+    check_same_attrib(&heap, &arena_attrib);
+    check_same_materials(heap_materials, num_heap_materials,
+                         arena_materials, num_arena_materials);
+    TEST_CHECK(num_heap_shapes == num_arena_shapes);
+
+    tinyobj_arena_free(&arena);
+    TEST_CHECK(arena.block == NULL);
+
+    tinyobj_attrib_free(&heap);
+    tinyobj_shapes_free(heap_shapes, num_heap_shapes);
+    tinyobj_materials_free(heap_materials, num_heap_materials);
+    free(buf);
+}
+
+typedef struct {
+    char obj[8192];
+    char mtl[4096];
+} text_files_t;
+
+void loadText(void *ctx, const char * filename, const int is_mtl, const char *obj_filename, char ** buffer, size_t * len)
+{
+    text_files_t *files = (text_files_t *)ctx;
+    (void)filename;
+    (void)obj_filename;
+    *buffer = is_mtl ? files->mtl : files->obj;
+    *len = strlen(*buffer);
+}
+
+// Names point into the pool, and a name used many times is stored once. The
+// structs record it, so the free functions leave the names alone.
+void check_pooled_names(const tinyobj_string_pool_t *pool,
+                        const tinyobj_shape_t *shapes, size_t num_shapes,
+                        const tinyobj_material_t *materials, size_t num_materials)
+{
+    const char *end = pool->data + pool->size;
+    size_t i;
+
+    // part0..part9, m0..m19, textures/shared.png, textures/a0.png and a1.png.
+    TEST_CHECK(pool->size == 10 * 6 + 10 * 3 + 10 * 4 + 20 + 2 * 16);
+    TEST_CHECK(num_shapes == 100);
+    TEST_CHECK(num_materials == 20);
+    for (i = 0; i < num_shapes; i++) {
+        TEST_CHECK(shapes[i].name >= pool->data && shapes[i].name < end);
+        TEST_CHECK(shapes[i].name == shapes[i % 10].name);
+        TEST_CHECK(shapes[i].pooled_name);
+    }
+    for (i = 0; i < num_materials; i++) {
+        TEST_CHECK(materials[i].name >= pool->data && materials[i].name < end);
+        TEST_CHECK(materials[i].pooled_names);
+        TEST_CHECK(materials[i].diffuse_texname == materials[0].diffuse_texname);
+        TEST_CHECK(materials[i].ambient_texname == materials[i % 2].ambient_texname);
+        TEST_CHECK(materials[i].bump_texname == NULL);
+    }
+    TEST_CHECK(strcmp(materials[0].diffuse_texname, "textures/shared.png") == 0);
+    TEST_CHECK(strcmp(materials[1].ambient_texname, "textures/a1.png") == 0);
+}
+
+void test_tinyobj_parse_obj_string_pool(void)
+{
+    static text_files_t files;
+    unsigned int flags[3] = { 0, TINYOBJ_FLAG_PARALLEL, 0 };
+    tinyobj_attrib_t expected, attrib;
+    tinyobj_shape_t *expected_shapes = NULL, *shapes = NULL;
+    tinyobj_material_t *expected_materials = NULL, *materials = NULL;
+    size_t num_expected_shapes, num_expected_materials, num_shapes, num_materials;
+    tinyobj_parse_option_t option;
+    tinyobj_string_pool_t pool;
+    tinyobj_parser_t *parser;
+    tinyobj_arena_t arena;
+    size_t pos = 0, i;
+    int f;
+
+    pos += sprintf(files.obj + pos, "mtllib pooled.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\n");
+    for (i = 0; i < 100; i++) {
+        pos += sprintf(files.obj + pos, "g part%d\nusemtl m%d\nf 1 2 3\n", (int)(i % 10), (int)(i % 20));
+    }
+    pos = 0;
+    for (i = 0; i < 20; i++) {
+        pos += sprintf(files.mtl + pos, "newmtl m%d\nmap_Kd textures/shared.png\nmap_Ka textures/a%d.png\n",
+                       (int)i, (int)(i % 2));
+    }
+
+    TEST_CHECK(tinyobj_parse_obj(&expected, &expected_shapes, &num_expected_shapes,
+                                 &expected_materials, &num_expected_materials,
+                                 "pooled.obj", loadText, &files, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(!expected_shapes[0].pooled_name);
+    TEST_CHECK(!expected_materials[0].pooled_names);
+
+    memset(&option, 0, sizeof(option));
+    option.num_threads = 4;
+    option.string_pool = &pool;
+
+    // The last parse allocates everything else from an arena.
+    tinyobj_arena_init(&arena, 0);
+    for (f = 0; f < 3; f++) {
+        option.arena = (f == 2) ? &arena : NULL;
+        TEST_CHECK(tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                        "pooled.obj", loadText, &files, flags[f], &option) == TINYOBJ_SUCCESS);
+        check_same_attrib(&expected, &attrib);
+        check_same_materials(expected_materials, num_expected_materials, materials, num_materials);
+        for (i = 0; i < num_shapes && i < num_expected_shapes; i++) {
+            TEST_CHECK(strcmp(shapes[i].name, expected_shapes[i].name) == 0);
+        }
+        check_pooled_names(&pool, shapes, num_shapes, materials, num_materials);
+
+        if (f < 2) {
+            tinyobj_attrib_free(&attrib);
+            tinyobj_shapes_free(shapes, num_shapes);
+            tinyobj_materials_free(materials, num_materials);
+        }
+        tinyobj_string_pool_free(&pool);
+        TEST_CHECK(pool.data == NULL);
+    }
+    tinyobj_arena_free(&arena);
+    option.arena = NULL;
+
+    parser = tinyobj_parser_create_ex("pooled.obj", loadText, &files, 0, &option);
+    TEST_CHECK(tinyobj_parser_feed(parser, files.obj, strlen(files.obj)) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes,
+                                     &materials, &num_materials) == TINYOBJ_SUCCESS);
+    check_same_attrib(&expected, &attrib);
+    check_pooled_names(&pool, shapes, num_shapes, materials, num_materials);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+    tinyobj_string_pool_free(&pool);
+
+    tinyobj_attrib_free(&expected);
+    tinyobj_shapes_free(expected_shapes, num_expected_shapes);
+    tinyobj_materials_free(expected_materials, num_expected_materials);
+}
+
+// Release with tinyobj_file_release and count the calls in `ctx`.
+void countRelease(void *ctx, char *buf, size_t len)
+{
+    (*(int *)ctx)++;
+    tinyobj_file_release(NULL, buf, len);
+}
+
+void test_tinyobj_file_reader(void)
+{
+    const char *filename = "fixtures/cube.obj";
+    unsigned int flags[2] = { 0, TINYOBJ_FLAG_PARALLEL };
+    tinyobj_attrib_t expected, attrib;
+    tinyobj_shape_t *expected_shapes = NULL, *shapes = NULL;
+    tinyobj_material_t *expected_materials = NULL, *materials = NULL;
+    size_t num_expected_shapes, num_expected_materials, num_shapes, num_materials;
+    tinyobj_parse_option_t option;
+    tinyobj_parser_t *parser;
+    char *buf = NULL;
+    size_t len = 0;
+    int num_released;
+    int f;
+
+    TEST_CHECK(tinyobj_parse_obj(&expected, &expected_shapes, &num_expected_shapes,
+                                 &expected_materials, &num_expected_materials, filename,
+                                 loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+
+    memset(&option, 0, sizeof(option));
+    option.file_release = countRelease;
+
+    // The .obj and the .mtl buffers are released.
+    for (f = 0; f < 2; f++) {
+        num_released = 0;
+        TEST_CHECK(tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                        filename, tinyobj_file_reader, &num_released, flags[f],
+                                        &option) == TINYOBJ_SUCCESS);
+        TEST_CHECK(num_released == 2);
+        check_same_attrib(&expected, &attrib);
+        check_same_materials(expected_materials, num_expected_materials, materials, num_materials);
+        TEST_CHECK(num_shapes == num_expected_shapes);
+
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+    }
+
+    // The streaming parser only reads the .mtl file.
+    num_released = 0;
+    loadFile(NULL, filename, 0, NULL, &buf, &len);
+    parser = tinyobj_parser_create_ex(filename, tinyobj_file_reader, &num_released, 0, &option);
+    TEST_CHECK(tinyobj_parser_feed(parser, buf, len) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes,
+                                     &materials, &num_materials) == TINYOBJ_SUCCESS);
+    TEST_CHECK(num_released == 1);
+    check_same_attrib(&expected, &attrib);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+    free(buf);
+
+    tinyobj_file_reader(NULL, "fixtures/missing.obj", 0, NULL, &buf, &len);
+    TEST_CHECK(buf == NULL && len == 0);
+#ifdef __linux__
+    // /proc files report size 0 and are read instead of mapped.
+    tinyobj_file_reader(NULL, "/proc/self/status", 0, NULL, &buf, &len);
+    TEST_CHECK(buf != NULL && len > 0);
+    TEST_CHECK(buf != NULL && strncmp(buf, "Name:", 5) == 0);
+    tinyobj_file_release(NULL, buf, len);
+#endif
+
+    tinyobj_attrib_free(&expected);
+    tinyobj_shapes_free(expected_shapes, num_expected_shapes);
+    tinyobj_materials_free(expected_materials, num_expected_materials);
+}
+
+// `usemtl` lines before and after the `mtllib`.
+static const char usemtl_first_obj[] =
+    "usemtl blue\nv 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nmtllib first.mtl\n"
+    "usemtl red\nf 1 2 3\nusemtl missing\nf 1 2 3\nusemtl blue\nf 3 2 1\n";
+static const char usemtl_first_mtl[] = "newmtl red\nKd 1 0 0\nnewmtl blue\nKd 0 0 1\n";
+
+typedef struct {
+    const char *obj;
+    size_t obj_len;
+} usemtl_first_t;
+
+void loadUsemtlFirst(void *ctx, const char * filename, const int is_mtl, const char *obj_filename, char ** buffer, size_t * len)
+{
+    usemtl_first_t *file = (usemtl_first_t *)ctx;
+    (void)filename;
+    (void)obj_filename;
+    *buffer = (char *)(is_mtl ? usemtl_first_mtl : file->obj);
+    *len = is_mtl ? strlen(usemtl_first_mtl) : file->obj_len;
+}
+
+void check_usemtl_first_ids(const tinyobj_attrib_t *attrib, size_t num_materials)
+{
+    TEST_CHECK(num_materials == 2);
+    TEST_CHECK(attrib->num_face_num_verts == 4);
+    if (attrib->num_face_num_verts != 4) return;
+    TEST_CHECK(attrib->material_ids[0] == 1);
+    TEST_CHECK(attrib->material_ids[1] == 0);
+    TEST_CHECK(attrib->material_ids[2] == -1);
+    TEST_CHECK(attrib->material_ids[3] == 1);
+}
+
+void test_tinyobj_parser_stream_usemtl_first(void)
+{
+    usemtl_first_t file;
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials;
+    tinyobj_parser_t *parser;
+
+    file.obj = usemtl_first_obj;
+    file.obj_len = strlen(usemtl_first_obj);
+
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                 "first.obj", loadUsemtlFirst, &file, 0) == TINYOBJ_SUCCESS);
+    check_usemtl_first_ids(&attrib, num_materials);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    // Names are resolved when the parse is finished, after the `mtllib`.
+    parser = tinyobj_parser_create("first.obj", loadUsemtlFirst, &file, 0);
+    TEST_CHECK(tinyobj_parser_feed(parser, file.obj, file.obj_len) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes,
+                                     &materials, &num_materials) == TINYOBJ_SUCCESS);
+    check_usemtl_first_ids(&attrib, num_materials);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+}
+
+#ifdef TINYOBJ_USE_ZLIB
+// Two gzip members, as pigz or `cat a.gz b.gz` write them.
+char *gzip_text(const char *text, size_t len, size_t *out_len)
+{
+    size_t cap = 2 * compressBound((uLong)len) + 64;
+    char *buf = (char *)malloc(cap);
+    size_t half = len / 2;
+    int m;
+
+    *out_len = 0;
+    for (m = 0; m < 2; m++) {
+        z_stream s;
+        memset(&s, 0, sizeof(s));
+        TEST_CHECK(deflateInit2(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                                Z_DEFAULT_STRATEGY) == Z_OK);
+        s.next_in = (Bytef *)(m ? text + half : text);
+        s.avail_in = (uInt)(m ? len - half : half);
+        s.next_out = (Bytef *)buf + *out_len;
+        s.avail_out = (uInt)(cap - *out_len);
+        TEST_CHECK(deflate(&s, Z_FINISH) == Z_STREAM_END);
+        *out_len = cap - s.avail_out;
+        deflateEnd(&s);
+    }
+    return buf;
+}
+#endif
+
+void test_tinyobj_parse_obj_compressed(void)
+{
+    static const char gzip_header[] = "\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03";
+    memory_file_t text, files[2];
+    size_t num_files = 0;
+    unsigned int flags[2] = { 0, TINYOBJ_FLAG_PARALLEL };
+    tinyobj_attrib_t expected, attrib;
+    tinyobj_shape_t *expected_shapes = NULL, *shapes = NULL;
+    tinyobj_material_t *expected_materials = NULL, *materials = NULL;
+    size_t num_expected_shapes, num_expected_materials, num_shapes, num_materials;
+    tinyobj_parse_stats_t stats;
+    tinyobj_parse_option_t option;
+    size_t i, s;
+    int f;
+
+    // Larger than the chunks of the decompressor.
+    text.obj = generate_grid_obj(200, &text.obj_len);
+    TEST_CHECK(tinyobj_parse_obj(&expected, &expected_shapes, &num_expected_shapes,
+                                 &expected_materials, &num_expected_materials, "grid.obj",
+                                 loadMemory, &text, 0) == TINYOBJ_SUCCESS);
+
+#ifdef TINYOBJ_USE_ZLIB
+    files[num_files].obj = gzip_text(text.obj, text.obj_len, &files[num_files].obj_len);
+    num_files++;
+#else
+    // Compressed files are detected, but can not be parsed.
+    files[0].obj = gzip_header;
+    files[0].obj_len = sizeof(gzip_header) - 1;
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                 "grid.obj", loadMemory, &files[0], 0) == TINYOBJ_ERROR_FILE_OPERATION);
+#endif
+#ifdef TINYOBJ_USE_ZSTD
+    {
+        size_t cap = ZSTD_compressBound(text.obj_len);
+        char *buf = (char *)malloc(cap);
+        files[num_files].obj_len = ZSTD_compress(buf, cap, text.obj, text.obj_len, 3);
+        TEST_CHECK(!ZSTD_isError(files[num_files].obj_len));
+        files[num_files].obj = buf;
+        num_files++;
+    }
+#endif
+    (void)gzip_header;
+
+    memset(&option, 0, sizeof(option));
+    option.num_threads = 2;
+    option.stats = &stats;
+
+    for (i = 0; i < num_files; i++) {
+        memory_file_t truncated = files[i];
+
+        for (f = 0; f < 2; f++) {
+            TEST_CHECK(tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials,
+                                            &num_materials, "grid.obj", loadMemory, &files[i],
+                                            flags[f], &option) == TINYOBJ_SUCCESS);
+            TEST_CHECK(stats.num_bytes == text.obj_len);
+            check_same_attrib(&expected, &attrib);
+            check_same_materials(expected_materials, num_expected_materials, materials, num_materials);
+            TEST_CHECK(num_shapes == num_expected_shapes);
+            for (s = 0; s < num_shapes && s < num_expected_shapes; s++) {
+                TEST_CHECK(strcmp(shapes[s].name, expected_shapes[s].name) == 0);
+                TEST_CHECK(shapes[s].face_offset == expected_shapes[s].face_offset);
+                TEST_CHECK(shapes[s].length == expected_shapes[s].length);
+            }
+
+            tinyobj_attrib_free(&attrib);
+            tinyobj_shapes_free(shapes, num_shapes);
+            tinyobj_materials_free(materials, num_materials);
+        }
+
+        // The parse stops at the end of a truncated file.
+        truncated.obj_len -= 16;
+        for (f = 0; f < 2; f++) {
+            TEST_CHECK(tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials,
+                                            &num_materials, "grid.obj", loadMemory, &truncated,
+                                            flags[f], &option) == TINYOBJ_ERROR_FILE_OPERATION);
+        }
+
+        free((char *)files[i].obj);
+    }
+
+#ifdef TINYOBJ_USE_ZLIB
+    // Material ids are the same as for the plain text.
+    {
+        usemtl_first_t gz;
+        gz.obj = gzip_text(usemtl_first_obj, strlen(usemtl_first_obj), &gz.obj_len);
+        for (f = 0; f < 2; f++) {
+            TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                         "first.obj", loadUsemtlFirst, &gz, flags[f]) == TINYOBJ_SUCCESS);
+            check_usemtl_first_ids(&attrib, num_materials);
+            tinyobj_attrib_free(&attrib);
+            tinyobj_shapes_free(shapes, num_shapes);
+            tinyobj_materials_free(materials, num_materials);
+        }
+        free((char *)gz.obj);
+    }
+#endif
+
+    tinyobj_attrib_free(&expected);
+    tinyobj_shapes_free(expected_shapes, num_expected_shapes);
+    tinyobj_materials_free(expected_materials, num_expected_materials);
+    free((char *)text.obj);
+}
+
+void test_tinyobj_build_indexed_mesh(void)
+{
+    // Two triangles share the edge 2-3, but vertex 3 has another texcoord
+    // in the second one.
+    memory_file_t file;
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials;
+    tinyobj_indexed_mesh_t mesh;
+
+    file.obj = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 1\n"
+               "f 1/1 2/1 3/1\nf 3/1 4/2 1/1\n";
+    file.obj_len = strlen(file.obj);
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+                                 &num_materials, "quad.obj", loadMemory, &file, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_build_indexed_mesh(&mesh, &attrib, 0, NULL) == TINYOBJ_SUCCESS);
+
+    TEST_CHECK(mesh.num_indices == 6);
+    TEST_CHECK(mesh.num_vertices == 4);
+    TEST_CHECK(mesh.indices[0] == 0);
+    TEST_CHECK(mesh.indices[1] == 1);
+    TEST_CHECK(mesh.indices[2] == 2);
+    TEST_CHECK(mesh.indices[3] == 2);
+    TEST_CHECK(mesh.indices[4] == 3);
+    TEST_CHECK(mesh.indices[5] == 0);
+    TEST_CHECK(mesh.remap[3].v_idx == 3);
+    TEST_CHECK(mesh.remap[3].vt_idx == 1);
+    TEST_CHECK(mesh.remap[3].vn_idx < 0);
+
+    // position, normal(none) and texcoord of vertex 3.
+    TEST_CHECK(mesh.vertices[3 * 8 + 0] == 0.0f);
+    TEST_CHECK(mesh.vertices[3 * 8 + 1] == 1.0f);
+    TEST_CHECK(mesh.vertices[3 * 8 + 5] == 0.0f);
+    TEST_CHECK(mesh.vertices[3 * 8 + 6] == 1.0f);
+    TEST_CHECK(mesh.vertices[3 * 8 + 7] == 1.0f);
+
+    tinyobj_indexed_mesh_free(&mesh);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+}
+
+int compare_vertex_index(const void *a, const void *b)
+{
+    const tinyobj_vertex_index_t *x = (const tinyobj_vertex_index_t *)a;
+    const tinyobj_vertex_index_t *y = (const tinyobj_vertex_index_t *)b;
+    if (x->v_idx != y->v_idx) return (x->v_idx < y->v_idx) ? -1 : 1;
+    if (x->vt_idx != y->vt_idx) return (x->vt_idx < y->vt_idx) ? -1 : 1;
+    if (x->vn_idx != y->vn_idx) return (x->vn_idx < y->vn_idx) ? -1 : 1;
+    return 0;
+}
+
+void test_tinyobj_build_indexed_mesh_parallel(void)
+{
+    memory_file_t file;
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials, i;
+    tinyobj_indexed_mesh_t serial, parallel;
+    tinyobj_parse_option_t option;
+    unsigned int next_id = 0;
+
+    file.obj = generate_grid_obj(300, &file.obj_len);
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+                                 &num_materials, "grid.obj", loadMemory, &file, 0) == TINYOBJ_SUCCESS);
+
+    memset(&option, 0, sizeof(option));
+    option.num_threads = 4;
+    TEST_CHECK(tinyobj_build_indexed_mesh(&serial, &attrib, 0, NULL) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_build_indexed_mesh(&parallel, &attrib, TINYOBJ_FLAG_PARALLEL, &option) == TINYOBJ_SUCCESS);
+
+    TEST_CHECK(serial.num_vertices >= 300 * 300);
+    TEST_CHECK(serial.num_indices == attrib.num_faces);
+    for (i = 0; i < serial.num_indices; i++) {
+        uint32_t id = serial.indices[i];
+        tinyobj_vertex_index_t vi = attrib.faces[i];
+        // Ids are given in order of first use.
+        TEST_CHECK(id <= next_id);
+        if (id == next_id) next_id++;
+        TEST_CHECK(serial.remap[id].v_idx == vi.v_idx);
+        TEST_CHECK(serial.remap[id].vt_idx == vi.vt_idx);
+        TEST_CHECK(serial.remap[id].vn_idx == vi.vn_idx);
+        TEST_CHECK(serial.vertices[id * 8 + 0] == attrib.vertices[vi.v_idx * 3 + 0]);
+        TEST_CHECK(serial.vertices[id * 8 + 7] == attrib.texcoords[vi.vt_idx * 2 + 1]);
+    }
+
+    TEST_CHECK(next_id == serial.num_vertices);
+
+    // No triple is left with two vertices.
+    {
+        tinyobj_vertex_index_t *sorted = (tinyobj_vertex_index_t *)malloc(
+            sizeof(tinyobj_vertex_index_t) * serial.num_vertices);
+        memcpy(sorted, serial.remap, sizeof(tinyobj_vertex_index_t) * serial.num_vertices);
+        qsort(sorted, serial.num_vertices, sizeof(tinyobj_vertex_index_t), compare_vertex_index);
+        for (i = 1; i < serial.num_vertices; i++) {
+            TEST_CHECK(compare_vertex_index(&sorted[i - 1], &sorted[i]) != 0);
+        }
+        free(sorted);
+    }
+
+    TEST_CHECK(serial.num_vertices == parallel.num_vertices);
+    TEST_CHECK(serial.num_indices == parallel.num_indices);
+    TEST_CHECK(memcmp(serial.indices, parallel.indices, sizeof(uint32_t) * serial.num_indices) == 0);
+    TEST_CHECK(memcmp(serial.vertices, parallel.vertices,
+                      sizeof(float) * TINYOBJ_INDEXED_VERTEX_STRIDE * serial.num_vertices) == 0);
+    TEST_CHECK(memcmp(serial.remap, parallel.remap,
+                      sizeof(tinyobj_vertex_index_t) * serial.num_vertices) == 0);
+
+    tinyobj_indexed_mesh_free(&serial);
+    tinyobj_indexed_mesh_free(&parallel);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+    free((char *)file.obj);
+}
+
+void write_text_file(const char *filename, const char *text)
+{
+    FILE *fp = fopen(filename, "wb");
+    fwrite(text, 1, strlen(text), fp);
+    fclose(fp);
+}
+
+void check_same_cache(const tinyobj_cache_t *a, const tinyobj_cache_t *b)
+{
+    size_t i;
+
+    check_same_attrib(&a->attrib, &b->attrib);
+    check_same_materials(a->materials, a->num_materials, b->materials, b->num_materials);
+    TEST_CHECK(a->num_shapes == b->num_shapes);
+    for (i = 0; i < a->num_shapes && i < b->num_shapes; i++) {
+        TEST_CHECK(strcmp(a->shapes[i].name, b->shapes[i].name) == 0);
+        TEST_CHECK(a->shapes[i].face_offset == b->shapes[i].face_offset);
+        TEST_CHECK(a->shapes[i].length == b->shapes[i].length);
+    }
+}
+
+// Overwrite int `k` of a section of a cache file.
+void patch_cache_int(const char *cache_filename, int section, size_t k, int value)
+{
+    CacheHeader header;
+    FILE *fp = fopen(cache_filename, "r+b");
+
+    TEST_CHECK(fread(&header, sizeof(header), 1, fp) == 1);
+    fseek(fp, (long)(header.offsets[section] + sizeof(int) * k), SEEK_SET);
+    fwrite(&value, sizeof(int), 1, fp);
+    fclose(fp);
+}
+
+void test_tinyobj_cache(void)
+{
+    const char *obj_filename = "cache_test.obj";
+    const char *cache_filename = "cache_test.obj.cache";
+    tinyobj_cache_t parsed, cached, reparsed;
+    FILE *fp;
+
+    write_text_file(obj_filename,
+                    "mtllib fixtures/cube.mtl\n"
+                    "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0.5 0.5\nvn 0 0 1\n"
+                    "o tri\nusemtl CubeMaterial\nf 1/1/1 2/1/1 3/1/1\n");
+    remove(cache_filename);
+
+    // No cache yet: parse and write it.
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_cache(&parsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(parsed.from_cache == 0);
+    TEST_CHECK(parsed.num_materials == 1);
+
+    // Valid cache: mapped.
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(cached.from_cache == 1);
+    check_same_cache(&parsed, &cached);
+    tinyobj_cache_free(&cached);
+
+    // Other flags: reparsed.
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_ERROR_STALE_CACHE);
+
+    // Corrupted cache: reparsed and rewritten.
+    fp = fopen(cache_filename, "r+b");
+    fwrite("X", 1, 1, fp);
+    fclose(fp);
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(reparsed.from_cache == 0);
+    check_same_cache(&parsed, &reparsed);
+    tinyobj_cache_free(&reparsed);
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(cached.from_cache == 1);
+    tinyobj_cache_free(&cached);
+
+    // Modified source: stale.
+    write_text_file(obj_filename, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n");
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(reparsed.from_cache == 0);
+    TEST_CHECK(reparsed.attrib.num_vertices == 4);
+    tinyobj_cache_free(&reparsed);
+
+    // Modified, removed or created .mtl file: stale.
+    write_text_file(obj_filename, "mtllib cache_test.mtl\nv 0 0 0\nv 1 0 0\nv 1 1 0\n"
+                                  "usemtl a\nf 1 2 3\n");
+    write_text_file("cache_test.mtl", "newmtl a\n");
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    tinyobj_cache_free(&reparsed);
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(cached.num_materials == 1);
+    tinyobj_cache_free(&cached);
+
+    write_text_file("cache_test.mtl", "newmtl a\nnewmtl b\n");
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(reparsed.from_cache == 0);
+    TEST_CHECK(reparsed.num_materials == 2);
+    tinyobj_cache_free(&reparsed);
+
+    remove("cache_test.mtl");
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(reparsed.num_materials == 0);
+    tinyobj_cache_free(&reparsed);
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_SUCCESS);
+    tinyobj_cache_free(&cached);
+
+    write_text_file("cache_test.mtl", "newmtl a\n");
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_ERROR_STALE_CACHE);
+
+    // Out of range face indices or material ids: reparsed.
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    tinyobj_cache_free(&reparsed);
+    patch_cache_int(cache_filename, CACHE_FACES, 0, 3);
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_cache(&reparsed, cache_filename, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(reparsed.from_cache == 0);
+    TEST_CHECK(reparsed.attrib.faces[0].v_idx == 0);
+    tinyobj_cache_free(&reparsed);
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_SUCCESS);
+    tinyobj_cache_free(&cached);
+    patch_cache_int(cache_filename, CACHE_MATERIAL_IDS, 0, 1);
+    TEST_CHECK(tinyobj_load_cache(&cached, cache_filename, obj_filename, NULL, NULL, 0) == TINYOBJ_ERROR_STALE_CACHE);
+
+    tinyobj_cache_free(&parsed);
+    remove(obj_filename);
+    remove(cache_filename);
+    remove("cache_test.mtl");
+}
+
+void check_multi_mtllib(const tinyobj_attrib_t *attrib,
+                        const tinyobj_material_t *materials, size_t num_materials)
+{
+    // Ids follow the order the files are first referenced in.
+    TEST_CHECK(num_materials == 4);
+    if (num_materials == 4) {
+        TEST_CHECK(strcmp(materials[0].name, "red") == 0);
+        TEST_CHECK(strcmp(materials[1].name, "green") == 0);
+        TEST_CHECK(strcmp(materials[2].name, "blue") == 0);
+        TEST_CHECK(strcmp(materials[3].name, "white") == 0);
+        TEST_CHECK(materials[3].diffuse[0] == 1.0f);
+    }
+    TEST_CHECK(attrib->num_face_num_verts == 5);
+    if (attrib->num_face_num_verts == 5) {
+        TEST_CHECK(attrib->material_ids[0] == 1);
+        TEST_CHECK(attrib->material_ids[1] == 0);
+        TEST_CHECK(attrib->material_ids[2] == 3);
+        TEST_CHECK(attrib->material_ids[3] == 2);
+        TEST_CHECK(attrib->material_ids[4] == -1);
+    }
+}
+
+void test_tinyobj_parse_obj_multiple_mtllibs(void)
+{
+    const char *obj =
+        "mtllib multi_a.mtl multi_b.mtl\n"
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "usemtl green\nf 1 2 3\n"
+        "usemtl red\nf 1 2 3\n"
+        "mtllib multi_c.mtl\n"
+        "mtllib multi_a.mtl\n"
+        "usemtl white\nf 1 2 3\n"
+        "usemtl blue\nf 1 2 3\n"
+        "usemtl black\nf 1 2 3\n";
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials;
+    tinyobj_parse_option_t option;
+    tinyobj_parser_t *parser;
+    tinyobj_arena_t arena;
+    unsigned int flags;
+
+    write_text_file("multi.obj", obj);
+    write_text_file("multi_a.mtl", "newmtl red\nKd 1 0 0\nnewmtl green\nKd 0 1 0\n");
+    write_text_file("multi_b.mtl", "newmtl blue\nKd 0 0 1\n");
+    write_text_file("multi_c.mtl", "newmtl white\nKd 1 1 1\n");
+
+    for (flags = 0; flags <= TINYOBJ_FLAG_PARALLEL; flags += TINYOBJ_FLAG_PARALLEL) {
+        TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                     "multi.obj", loadFile, NULL, flags) == TINYOBJ_SUCCESS);
+        check_multi_mtllib(&attrib, materials, num_materials);
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+
+        // The materials of a .mtl loading thread end up in the arena.
+        tinyobj_arena_init(&arena, 256);
+        memset(&option, 0, sizeof(option));
+        option.arena = &arena;
+        TEST_CHECK(tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                        "multi.obj", loadFile, NULL, flags, &option) == TINYOBJ_SUCCESS);
+        check_multi_mtllib(&attrib, materials, num_materials);
+        tinyobj_arena_free(&arena);
+    }
+
+    // The streaming parser loads each file when its line is reached.
+    parser = tinyobj_parser_create("multi.obj", loadFile, NULL, 0);
+    TEST_CHECK(tinyobj_parser_feed(parser, obj, strlen(obj)) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes,
+                                     &materials, &num_materials) == TINYOBJ_SUCCESS);
+    check_multi_mtllib(&attrib, materials, num_materials);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    remove("multi.obj");
+    remove("multi_a.mtl");
+    remove("multi_b.mtl");
+    remove("multi_c.mtl");
+}
+
+void test_tinyobj_parse_obj_batch(void)
+{
+    const char *paths[] = {
+        "fixtures/cube.obj", "batch_a.obj", "batch_missing.obj",
+        "fixtures/wireframe-cube.obj", "batch_b.obj", "fixtures/negative-exponent.obj",
+        "fixtures/cube.obj",
+    };
+    const size_t num_paths = sizeof(paths) / sizeof(paths[0]);
+    tinyobj_result_t serial[7], parallel[7];
+    char *big;
+    size_t i, j;
+
+    write_text_file("batch_a.obj",
+                    "mtllib multi_b.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\no a\nusemtl blue\nf 1 2 3\n");
+    // Larger than the first read buffer of a thread.
+    big = (char *)malloc(4000 * 8 + 64);
+    big[0] = '\0';
+    for (i = 0; i < 4000; i++) strcat(big + i * 8, "v 1 2 3\n");
+    strcat(big, "g b\nf -4 -3 -2 -1\n");
+    write_text_file("batch_b.obj", big);
+    free(big);
+    write_text_file("multi_b.mtl", "newmtl blue\nKd 0 0 1\n");
+
+    // The first failed file gives the status, the others are still parsed.
+    TEST_CHECK(tinyobj_parse_obj_batch(paths, num_paths, serial, TINYOBJ_FLAG_TRIANGULATE, 1) ==
+               TINYOBJ_ERROR_FILE_OPERATION);
+    TEST_CHECK(tinyobj_parse_obj_batch(paths, num_paths, parallel, TINYOBJ_FLAG_TRIANGULATE, 4) ==
+               TINYOBJ_ERROR_FILE_OPERATION);
+    TEST_CHECK(serial[2].status == TINYOBJ_ERROR_FILE_OPERATION);
+    TEST_CHECK(parallel[2].status == TINYOBJ_ERROR_FILE_OPERATION);
+    TEST_CHECK(parallel[2].attrib.vertices == NULL && parallel[2].shapes == NULL);
+
+    // Same results as tinyobj_parse_obj, with either number of threads.
+    for (i = 0; i < num_paths; i++) {
+        tinyobj_attrib_t attrib;
+        tinyobj_shape_t *shapes = NULL;
+        tinyobj_material_t *materials = NULL;
+        size_t num_shapes, num_materials;
+
+        if (i == 2) continue;
+        TEST_CHECK_(serial[i].status == TINYOBJ_SUCCESS, "%s", paths[i]);
+        TEST_CHECK_(parallel[i].status == TINYOBJ_SUCCESS, "%s", paths[i]);
+        TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                     paths[i], loadFile, NULL, TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+        check_same_attrib(&attrib, &serial[i].attrib);
+        check_same_attrib(&attrib, &parallel[i].attrib);
+        check_same_materials(materials, num_materials, serial[i].materials, serial[i].num_materials);
+        check_same_materials(materials, num_materials, parallel[i].materials, parallel[i].num_materials);
+        TEST_CHECK(serial[i].num_shapes == num_shapes && parallel[i].num_shapes == num_shapes);
+        for (j = 0; j < num_shapes && j < serial[i].num_shapes && j < parallel[i].num_shapes; j++) {
+            TEST_CHECK(strcmp(shapes[j].name, serial[i].shapes[j].name) == 0);
+            TEST_CHECK(strcmp(shapes[j].name, parallel[i].shapes[j].name) == 0);
+            TEST_CHECK(shapes[j].face_offset == parallel[i].shapes[j].face_offset);
+            TEST_CHECK(shapes[j].length == parallel[i].shapes[j].length);
+        }
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+    }
+    TEST_CHECK(serial[1].num_materials == 1 && serial[1].attrib.material_ids[0] == 0);
+    TEST_CHECK(serial[4].attrib.num_face_num_verts == 2);
+
+    tinyobj_results_free(serial, num_paths);
+    tinyobj_results_free(parallel, num_paths);
+
+    // A NULL path is an invalid parameter, and is not read.
+    {
+        const char *null_paths[3] = { "fixtures/cube.obj", NULL, "batch_a.obj" };
+        tinyobj_result_t results[3];
+        TEST_CHECK(tinyobj_parse_obj_batch(null_paths, 3, results, 0, 2) ==
+                   TINYOBJ_ERROR_INVALID_PARAMETER);
+        TEST_CHECK(results[0].status == TINYOBJ_SUCCESS);
+        TEST_CHECK(results[1].status == TINYOBJ_ERROR_INVALID_PARAMETER);
+        TEST_CHECK(results[1].attrib.vertices == NULL && results[1].shapes == NULL);
+        TEST_CHECK(results[2].status == TINYOBJ_SUCCESS);
+        tinyobj_results_free(results, 3);
+    }
+
+    remove("batch_a.obj");
+    remove("batch_b.obj");
+    remove("multi_b.mtl");
+}
+
+void check_soa_indices(const tinyobj_attrib_t *aos, const tinyobj_attrib_t *soa)
+{
+    size_t i;
+
+    TEST_CHECK(soa->faces == NULL);
+    TEST_CHECK(soa->v_indices != NULL);
+    // The file has vn but no vt lines.
+    TEST_CHECK(soa->vt_indices == NULL);
+    TEST_CHECK(soa->vn_indices != NULL);
+    TEST_CHECK(aos->num_faces == soa->num_faces);
+    TEST_CHECK(aos->num_face_num_verts == soa->num_face_num_verts);
+    if (aos->num_faces != soa->num_faces || soa->v_indices == NULL || soa->vn_indices == NULL) return;
+    for (i = 0; i < aos->num_faces; i++) {
+        TEST_CHECK_(soa->v_indices[i] == aos->faces[i].v_idx, "v %u", (unsigned)i);
+        TEST_CHECK_(soa->vn_indices[i] == aos->faces[i].vn_idx, "vn %u", (unsigned)i);
+    }
+    TEST_CHECK(memcmp(aos->face_num_verts, soa->face_num_verts, sizeof(int) * aos->num_face_num_verts) == 0);
+    TEST_CHECK(memcmp(aos->material_ids, soa->material_ids, sizeof(int) * aos->num_face_num_verts) == 0);
+}
+
+void test_tinyobj_parse_obj_soa_indices(void)
+{
+    const char *obj =
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvn 0 0 1\nvn 0 0 -1\n"
+        "f 1//1 2//1 3//1 4//1\n"
+        "f -4//-1 -2//-1 -3//-1\n"
+        "l 1 2\n";
+    unsigned int flag_sets[] = { 0, TINYOBJ_FLAG_TRIANGULATE, TINYOBJ_FLAG_PARALLEL,
+                                 TINYOBJ_FLAG_TRIANGULATE | TINYOBJ_FLAG_PARALLEL };
+    tinyobj_attrib_t aos, soa;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials, f;
+    tinyobj_parse_option_t option;
+    tinyobj_parser_t *parser;
+    tinyobj_arena_t arena;
+    tinyobj_triangles_t triangles;
+    tinyobj_cache_t cache;
+
+    write_text_file("soa.obj", obj);
+
+    for (f = 0; f < sizeof(flag_sets) / sizeof(flag_sets[0]); f++) {
+        unsigned int flags = flag_sets[f];
+
+        TEST_CHECK(tinyobj_parse_obj(&aos, &shapes, &num_shapes, &materials, &num_materials,
+                                     "soa.obj", loadFile, NULL, flags) == TINYOBJ_SUCCESS);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+
+        TEST_CHECK(tinyobj_parse_obj(&soa, &shapes, &num_shapes, &materials, &num_materials,
+                                     "soa.obj", loadFile, NULL, flags | TINYOBJ_FLAG_SOA_INDICES) == TINYOBJ_SUCCESS);
+        check_soa_indices(&aos, &soa);
+        tinyobj_attrib_free(&soa);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+
+        tinyobj_arena_init(&arena, 0);
+        memset(&option, 0, sizeof(option));
+        option.arena = &arena;
+        TEST_CHECK(tinyobj_parse_obj_ex(&soa, &shapes, &num_shapes, &materials, &num_materials,
+                                        "soa.obj", loadFile, NULL, flags | TINYOBJ_FLAG_SOA_INDICES,
+                                        &option) == TINYOBJ_SUCCESS);
+        check_soa_indices(&aos, &soa);
+        tinyobj_arena_free(&arena);
+
+        parser = tinyobj_parser_create("soa.obj", NULL, NULL, flags | TINYOBJ_FLAG_SOA_INDICES);
+        TEST_CHECK(tinyobj_parser_feed(parser, obj, strlen(obj)) == TINYOBJ_SUCCESS);
+        TEST_CHECK(tinyobj_parser_finish(parser, &soa, &shapes, &num_shapes,
+                                         &materials, &num_materials) == TINYOBJ_SUCCESS);
+        check_soa_indices(&aos, &soa);
+        tinyobj_attrib_free(&soa);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+
+        tinyobj_attrib_free(&aos);
+    }
+
+    // The cache keeps the layout.
+    TEST_CHECK(tinyobj_parse_obj(&aos, &shapes, &num_shapes, &materials, &num_materials,
+                                 "soa.obj", loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+    remove("soa.obj.cache");
+    TEST_CHECK(tinyobj_load_cache(&cache, "soa.obj.cache", "soa.obj", loadFile, NULL,
+                                  TINYOBJ_FLAG_SOA_INDICES) == TINYOBJ_SUCCESS);
+    tinyobj_cache_free(&cache);
+    TEST_CHECK(tinyobj_load_cache(&cache, "soa.obj.cache", "soa.obj", NULL, NULL, 0) ==
+               TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_cache(&cache, "soa.obj.cache", "soa.obj", NULL, NULL,
+                                  TINYOBJ_FLAG_SOA_INDICES) == TINYOBJ_SUCCESS);
+    TEST_CHECK(cache.from_cache == 1);
+    check_soa_indices(&aos, &cache.attrib);
+
+    // Triangulation needs attrib->faces.
+    TEST_CHECK(tinyobj_triangulate(&triangles, &cache.attrib, TINYOBJ_TRIANGULATE_FAN, 0, NULL) ==
+               TINYOBJ_ERROR_INVALID_PARAMETER);
+    tinyobj_cache_free(&cache);
+    tinyobj_attrib_free(&aos);
+
+    remove("soa.obj");
+    remove("soa.obj.cache");
+}
+
+// Random v, vt and vn lines, with some normals on the axes and a zero normal.
+char *generate_random_attribs_obj(int n, size_t *len)
+{
+    char *buf = (char *)malloc((size_t)n * 160 + 1024);
+    size_t pos = 0;
+    unsigned int seed = 12345;
+    float r[8];
+    int i, k;
+
+    pos += sprintf(buf + pos, "vn 0 0 0\nvn 0 0 -1\nvn 1 0 0\nvn 0 -1 0\nvn 1 1 -1\n");
+    for (i = 0; i < n; i++) {
+        for (k = 0; k < 8; k++) {
+            seed = seed * 1103515245u + 12345u;
+            r[k] = (float)((seed >> 8) & 0xffff) / 65535.0f;
+        }
+        pos += sprintf(buf + pos, "v %f %f %f\nvt %f %f\nvn %f %f %f\n",
+                       r[0] * 2000.0f - 500.0f, r[1] * 3.0f, r[2] * -0.01f,
+                       r[3], r[4] * 2.0f - 0.5f,
+                       r[5] * 2.0f - 1.0f, r[6] * 2.0f - 1.0f, r[7] * 2.0f - 1.0f);
+    }
+    pos += sprintf(buf + pos, "f 1/1/1 2/2/2 3/3/3\n");
+    *len = pos;
+    return buf;
+}
+
+double abs_double(double v)
+{
+    return v < 0.0 ? -v : v;
+}
+
+// Dequantized values are within half a step of the parsed floats, and
+// normals within 0.005 degrees.
+void check_quantized(const tinyobj_attrib_t *ref, const tinyobj_attrib_t *q)
+{
+    // sin(0.005 degrees)
+    const double max_sin = 8.7266e-5;
+    size_t i, k;
+
+    TEST_CHECK(q->vertices == NULL && q->normals == NULL && q->texcoords == NULL);
+    TEST_CHECK(q->num_vertices == ref->num_vertices);
+    TEST_CHECK(q->num_normals == ref->num_normals);
+    TEST_CHECK(q->num_texcoords == ref->num_texcoords);
+    if (q->quantized_vertices == NULL || q->quantized_normals == NULL ||
+        q->quantized_texcoords == NULL) {
+        TEST_CHECK(0);
+        return;
+    }
+
+    for (i = 0; i < ref->num_vertices; i++) {
+        for (k = 0; k < 3; k++) {
+            double v = ref->vertices[3 * i + k];
+            double d = q->vertex_offset[k] + q->quantized_vertices[3 * i + k] * (double)q->vertex_scale[k];
+            double tol = 0.5 * q->vertex_scale[k] + 1e-6 * (abs_double(q->vertex_offset[k]) + q->vertex_scale[k] * 65535.0);
+            TEST_CHECK_(abs_double(d - v) <= tol, "vertex %d.%d: %g vs %g", (int)i, (int)k, d, v);
+        }
+    }
+    for (i = 0; i < ref->num_texcoords; i++) {
+        for (k = 0; k < 2; k++) {
+            double v = ref->texcoords[2 * i + k];
+            double d = q->texcoord_offset[k] + q->quantized_texcoords[2 * i + k] * (double)q->texcoord_scale[k];
+            double tol = 0.5 * q->texcoord_scale[k] + 1e-6 * (abs_double(q->texcoord_offset[k]) + q->texcoord_scale[k] * 65535.0);
+            TEST_CHECK_(abs_double(d - v) <= tol, "texcoord %d.%d: %g vs %g", (int)i, (int)k, d, v);
+        }
+    }
+    for (i = 0; i < ref->num_normals; i++) {
+        const float *a = &ref->normals[3 * i];
+        float b[3];
+        double cx, cy, cz, aa, bb;
+
+        tinyobj_decode_normal(&q->quantized_normals[2 * i], b);
+        bb = (double)b[0] * b[0] + (double)b[1] * b[1] + (double)b[2] * b[2];
+        TEST_CHECK(abs_double(bb - 1.0) < 1e-5);
+        aa = (double)a[0] * a[0] + (double)a[1] * a[1] + (double)a[2] * a[2];
+        if (aa == 0.0) {
+            TEST_CHECK(b[0] == 0.0f && b[1] == 0.0f && b[2] == 1.0f);
+            continue;
+        }
+        cx = (double)a[1] * b[2] - (double)a[2] * b[1];
+        cy = (double)a[2] * b[0] - (double)a[0] * b[2];
+        cz = (double)a[0] * b[1] - (double)a[1] * b[0];
+        TEST_CHECK_((double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2] > 0.0,
+                    "normal %d flipped", (int)i);
+        TEST_CHECK_(cx * cx + cy * cy + cz * cz <= max_sin * max_sin * aa * bb,
+                    "normal %d: (%g %g %g) vs (%g %g %g)", (int)i, a[0], a[1], a[2], b[0], b[1], b[2]);
+    }
+}
+
+int same_quantized(const tinyobj_attrib_t *a, const tinyobj_attrib_t *b)
+{
+    return a->num_vertices == b->num_vertices && a->num_normals == b->num_normals &&
+           a->num_texcoords == b->num_texcoords &&
+           same_bytes(a->quantized_vertices, b->quantized_vertices, sizeof(uint16_t) * 3 * a->num_vertices) &&
+           same_bytes(a->quantized_normals, b->quantized_normals, sizeof(int16_t) * 2 * a->num_normals) &&
+           same_bytes(a->quantized_texcoords, b->quantized_texcoords, sizeof(uint16_t) * 2 * a->num_texcoords) &&
+           memcmp(a->vertex_offset, b->vertex_offset, sizeof(a->vertex_offset)) == 0 &&
+           memcmp(a->vertex_scale, b->vertex_scale, sizeof(a->vertex_scale)) == 0 &&
+           memcmp(a->texcoord_offset, b->texcoord_offset, sizeof(a->texcoord_offset)) == 0 &&
+           memcmp(a->texcoord_scale, b->texcoord_scale, sizeof(a->texcoord_scale)) == 0;
+}
+
+void test_tinyobj_parse_obj_quantize(void)
+{
+    size_t len;
+    char *obj = generate_random_attribs_obj(20000, &len);
+    tinyobj_attrib_t ref, q, other;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials;
+    tinyobj_parse_option_t option;
+    tinyobj_parser_t *parser;
+    tinyobj_result_t result;
+    tinyobj_indexed_mesh_t mesh;
+    tinyobj_triangles_t triangles;
+    tinyobj_cache_t cache;
+    const char *path = "quantize.obj";
+    FILE *fp;
+
+    fp = fopen(path, "wb");
+    fwrite(obj, 1, len, fp);
+    fclose(fp);
+
+    TEST_CHECK(tinyobj_parse_obj(&ref, &shapes, &num_shapes, &materials, &num_materials,
+                                 path, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    TEST_CHECK(tinyobj_parse_obj(&q, &shapes, &num_shapes, &materials, &num_materials,
+                                 path, loadFile, NULL, TINYOBJ_FLAG_QUANTIZE) == TINYOBJ_SUCCESS);
+    check_quantized(&ref, &q);
+    TEST_CHECK(q.num_faces == ref.num_faces && q.faces != NULL);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    // Float attributes are needed to build meshes and ear clip.
+    TEST_CHECK(tinyobj_build_indexed_mesh(&mesh, &q, 0, NULL) == TINYOBJ_ERROR_INVALID_PARAMETER);
+    TEST_CHECK(tinyobj_triangulate(&triangles, &q, TINYOBJ_TRIANGULATE_EAR_CLIP, 0, NULL) ==
+               TINYOBJ_ERROR_INVALID_PARAMETER);
+
+    // Same result on threads, from the streaming parser and in a batch.
+    memset(&option, 0, sizeof(option));
+    option.num_threads = 4;
+    TEST_CHECK(tinyobj_parse_obj_ex(&other, &shapes, &num_shapes, &materials, &num_materials,
+                                    path, loadFile, NULL, TINYOBJ_FLAG_QUANTIZE | TINYOBJ_FLAG_PARALLEL,
+                                    &option) == TINYOBJ_SUCCESS);
+    TEST_CHECK(same_quantized(&q, &other));
+    tinyobj_attrib_free(&other);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    parser = tinyobj_parser_create(path, NULL, NULL, TINYOBJ_FLAG_QUANTIZE);
+    TEST_CHECK(tinyobj_parser_feed(parser, obj, len / 3) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parser_feed(parser, obj + len / 3, len - len / 3) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parser_finish(parser, &other, &shapes, &num_shapes,
+                                     &materials, &num_materials) == TINYOBJ_SUCCESS);
+    TEST_CHECK(same_quantized(&q, &other));
+    TEST_CHECK(other.vertices == NULL && other.normals == NULL && other.texcoords == NULL);
+    tinyobj_attrib_free(&other);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    TEST_CHECK(tinyobj_parse_obj_batch(&path, 1, &result, TINYOBJ_FLAG_QUANTIZE, 1) == TINYOBJ_SUCCESS);
+    TEST_CHECK(result.status == TINYOBJ_SUCCESS);
+    TEST_CHECK(same_quantized(&q, &result.attrib));
+    tinyobj_results_free(&result, 1);
+
+    // Only normals.
+    TEST_CHECK(tinyobj_parse_obj(&other, &shapes, &num_shapes, &materials, &num_materials,
+                                 path, loadFile, NULL, TINYOBJ_FLAG_QUANTIZE_NORMALS) == TINYOBJ_SUCCESS);
+    TEST_CHECK(same_bytes(other.vertices, ref.vertices, sizeof(float) * 3 * ref.num_vertices));
+    TEST_CHECK(same_bytes(other.texcoords, ref.texcoords, sizeof(float) * 2 * ref.num_texcoords));
+    TEST_CHECK(other.normals == NULL && other.quantized_vertices == NULL && other.quantized_texcoords == NULL);
+    TEST_CHECK(same_bytes(other.quantized_normals, q.quantized_normals, sizeof(int16_t) * 2 * q.num_normals));
+    tinyobj_attrib_free(&other);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    // The cache keeps the quantized arrays and their parameters.
+    remove("quantize.obj.cache");
+    TEST_CHECK(tinyobj_load_cache(&cache, "quantize.obj.cache", path, loadFile, NULL,
+                                  TINYOBJ_FLAG_QUANTIZE) == TINYOBJ_SUCCESS);
+    tinyobj_cache_free(&cache);
+    TEST_CHECK(tinyobj_load_cache(&cache, "quantize.obj.cache", path, NULL, NULL, 0) ==
+               TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_cache(&cache, "quantize.obj.cache", path, NULL, NULL,
+                                  TINYOBJ_FLAG_QUANTIZE) == TINYOBJ_SUCCESS);
+    TEST_CHECK(cache.from_cache == 1);
+    TEST_CHECK(same_quantized(&q, &cache.attrib));
+    TEST_CHECK(cache.attrib.vertices == NULL && cache.attrib.normals == NULL && cache.attrib.texcoords == NULL);
+    tinyobj_cache_free(&cache);
+
+    tinyobj_attrib_free(&q);
+    tinyobj_attrib_free(&ref);
+    free(obj);
+    remove(path);
+    remove("quantize.obj.cache");
+}
+
+// Objects with their own vertices, faces which refer to vertices of
+// earlier objects, usemtl switches across objects and objects without faces.
+char *generate_objects_obj(int num_objects, size_t *len)
+{
+    char *buf = (char *)malloc((size_t)num_objects * 1024 + 1024);
+    size_t pos = 0;
+    int num_v = 0, o, k;
+
+    pos += sprintf(buf + pos, "mtllib fixtures/cube.mtl\nv -1 -1 -1\nv -2 -2 -2\nvn 0 1 0\n");
+    num_v += 2;
+    for (o = 0; o < num_objects; o++) {
+        pos += sprintf(buf + pos, "%s part%d\n", (o % 3 == 2) ? "g" : "o", o);
+        if (o % 4 == 1) pos += sprintf(buf + pos, "usemtl %s\n", (o % 8 == 1) ? "CubeMaterial" : "unknown");
+        if (o % 5 == 4) continue; // no faces
+        for (k = 0; k < 4; k++) {
+            pos += sprintf(buf + pos, "v %d.%d %d 0.5\nvt 0.%d 0.%d\n", o, k, k, o, k);
+        }
+        num_v += 4;
+        pos += sprintf(buf + pos, "vn 0 0 %d\n", o);
+        pos += sprintf(buf + pos, "f -4/-4/-1 -3/-3/-1 -2/-2/-1 -1/-1/-1\n");
+        pos += sprintf(buf + pos, "f 1//1 %d//1 %d//1\n", num_v / 2 + 1, num_v - 5);
+        pos += sprintf(buf + pos, "l %d -1\n", num_v / 3 + 1);
+    }
+    *len = pos;
+    return buf;
+}
+
+// The faces of `sub` are those of the shapes `shape_ids` of `full`.
+void check_parsed_shapes(const tinyobj_attrib_t *full, const tinyobj_shape_t *full_shapes,
+                         const tinyobj_attrib_t *sub, const tinyobj_shape_t *sub_shapes,
+                         size_t num_sub_shapes, const size_t *shape_ids)
+{
+    size_t s, f = 0, sub_face = 0, sub_index = 0;
+
+    for (s = 0; s < num_sub_shapes; s++) {
+        const tinyobj_shape_t *a = &full_shapes[shape_ids[s]];
+        const tinyobj_shape_t *b = &sub_shapes[s];
+        size_t full_index = 0;
+
+        TEST_CHECK(strcmp(a->name, b->name) == 0);
+        TEST_CHECK(a->length == b->length);
+        TEST_CHECK(b->face_offset == sub_face);
+        for (f = 0; f < a->face_offset; f++) full_index += (size_t)full->face_num_verts[f];
+
+        for (f = 0; f < a->length; f++) {
+            int n = full->face_num_verts[a->face_offset + f];
+            int k;
+            TEST_CHECK(sub->face_num_verts[sub_face] == n);
+            TEST_CHECK(sub->material_ids[sub_face] == full->material_ids[a->face_offset + f]);
+            for (k = 0; k < n; k++) {
+                tinyobj_vertex_index_t x = full->faces[full_index++];
+                tinyobj_vertex_index_t y = sub->faces[sub_index++];
+                TEST_CHECK(memcmp(&full->vertices[3 * x.v_idx], &sub->vertices[3 * y.v_idx], sizeof(float) * 3) == 0);
+                if (x.vt_idx >= 0 && x.vt_idx < (int)full->num_texcoords) {
+                    TEST_CHECK(memcmp(&full->texcoords[2 * x.vt_idx], &sub->texcoords[2 * y.vt_idx], sizeof(float) * 2) == 0);
+                } else {
+                    TEST_CHECK(x.vt_idx == y.vt_idx);
+                }
+                if (x.vn_idx >= 0 && x.vn_idx < (int)full->num_normals) {
+                    TEST_CHECK(memcmp(&full->normals[3 * x.vn_idx], &sub->normals[3 * y.vn_idx], sizeof(float) * 3) == 0);
+                } else {
+                    TEST_CHECK(x.vn_idx == y.vn_idx);
+                }
+            }
+            sub_face++;
+        }
+    }
+    TEST_CHECK(sub->num_face_num_verts == sub_face);
+    TEST_CHECK(sub->num_faces == sub_index);
+}
+
+void test_tinyobj_parse_shapes(void)
+{
+    const char *obj_filename = "shapes.obj";
+    const char *index_filename = "shapes.obj.index";
+    size_t len;
+    char *obj = generate_objects_obj(40, &len);
+    tinyobj_attrib_t full, sub;
+    tinyobj_shape_t *full_shapes = NULL, *sub_shapes = NULL;
+    tinyobj_material_t *full_materials = NULL, *sub_materials = NULL;
+    size_t num_full_shapes, num_full_materials, num_sub_shapes, num_sub_materials;
+    tinyobj_shape_index_t built, loaded;
+    size_t range_ids[4], shape_ids[4];
+    size_t i, s;
+    FILE *fp;
+
+    fp = fopen(obj_filename, "wb");
+    fwrite(obj, 1, len, fp);
+    fclose(fp);
+    remove(index_filename);
+
+    TEST_CHECK(tinyobj_parse_obj(&full, &full_shapes, &num_full_shapes, &full_materials, &num_full_materials,
+                                 obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_build_shape_index(&built, obj_filename) == TINYOBJ_SUCCESS);
+    TEST_CHECK(built.num_ranges == 41);
+    TEST_CHECK(built.num_mtllibs == 1);
+    TEST_CHECK(built.ranges[0].name == NULL && built.ranges[0].offset == 0);
+    TEST_CHECK(built.ranges[40].offset + built.ranges[40].size == len);
+    TEST_CHECK(built.ranges[40].v_offset + built.ranges[40].num_v == full.num_vertices);
+
+    // Ranges with faces are the shapes.
+    for (i = 0, s = 0; i < built.num_ranges; i++) {
+        if (built.ranges[i].num_faces == 0) continue;
+        TEST_CHECK(s < num_full_shapes && strcmp(built.ranges[i].name, full_shapes[s].name) == 0);
+        TEST_CHECK(built.ranges[i].num_faces == full_shapes[s].length);
+        // Shapes 10, 3 and the last one refer to vertices of earlier ranges.
+        if (s == 3 || s == 10) {
+            range_ids[s == 3 ? 1 : 0] = i;
+            shape_ids[s == 3 ? 1 : 0] = s;
+        }
+        range_ids[3] = i;
+        s++;
+    }
+    TEST_CHECK(s == num_full_shapes);
+    range_ids[2] = 5; // without faces
+    shape_ids[2] = num_full_shapes - 1;
+    TEST_CHECK(built.ranges[5].num_faces == 0);
+
+    TEST_CHECK(tinyobj_parse_shapes(&sub, &sub_shapes, &num_sub_shapes, &sub_materials, &num_sub_materials,
+                                    &built, range_ids, 4, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(num_sub_shapes == 3);
+    TEST_CHECK(num_sub_materials == num_full_materials);
+    TEST_CHECK(sub.num_vertices < full.num_vertices);
+    check_parsed_shapes(&full, full_shapes, &sub, sub_shapes, num_sub_shapes, shape_ids);
+    tinyobj_attrib_free(&sub);
+    tinyobj_shapes_free(sub_shapes, num_sub_shapes);
+    tinyobj_materials_free(sub_materials, num_sub_materials);
+
+    // The index file is written once, then mapped.
+    TEST_CHECK(tinyobj_load_shape_index(&loaded, index_filename, obj_filename) == TINYOBJ_SUCCESS);
+    TEST_CHECK(loaded.from_cache == 0);
+    tinyobj_shape_index_free(&loaded);
+    TEST_CHECK(tinyobj_load_shape_index(&loaded, index_filename, obj_filename) == TINYOBJ_SUCCESS);
+    TEST_CHECK(loaded.from_cache == 1);
+    TEST_CHECK(loaded.num_ranges == built.num_ranges);
+    TEST_CHECK(loaded.num_mtllibs == built.num_mtllibs && loaded.mtllib_offsets[0] == built.mtllib_offsets[0]);
+    for (i = 0; i < loaded.num_ranges && i < built.num_ranges; i++) {
+        TEST_CHECK((loaded.ranges[i].name == NULL) == (built.ranges[i].name == NULL));
+        if (loaded.ranges[i].name && built.ranges[i].name) {
+            TEST_CHECK(strcmp(loaded.ranges[i].name, built.ranges[i].name) == 0);
+        }
+        TEST_CHECK(loaded.ranges[i].offset == built.ranges[i].offset);
+        TEST_CHECK(loaded.ranges[i].usemtl_offset == built.ranges[i].usemtl_offset);
+        TEST_CHECK(loaded.ranges[i].vn_offset == built.ranges[i].vn_offset);
+    }
+    TEST_CHECK(tinyobj_parse_shapes(&sub, &sub_shapes, &num_sub_shapes, &sub_materials, &num_sub_materials,
+                                    &loaded, range_ids, 4, obj_filename, loadFile, NULL,
+                                    TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+    TEST_CHECK(num_sub_shapes == 3);
+    for (i = 0; i < sub.num_face_num_verts; i++) TEST_CHECK(sub.face_num_verts[i] <= 3);
+    tinyobj_attrib_free(&sub);
+    tinyobj_shapes_free(sub_shapes, num_sub_shapes);
+    tinyobj_materials_free(sub_materials, num_sub_materials);
+    tinyobj_shape_index_free(&loaded);
+
+    // A changed file needs a new index.
+    fp = fopen(obj_filename, "ab");
+    fputs("v 0 0 0\n", fp);
+    fclose(fp);
+    TEST_CHECK(tinyobj_parse_shapes(&sub, &sub_shapes, &num_sub_shapes, &sub_materials, &num_sub_materials,
+                                    &built, range_ids, 4, obj_filename, loadFile, NULL, 0) ==
+               TINYOBJ_ERROR_STALE_CACHE);
+    TEST_CHECK(tinyobj_load_shape_index(&loaded, index_filename, obj_filename) == TINYOBJ_SUCCESS);
+    TEST_CHECK(loaded.from_cache == 0);
+    TEST_CHECK(loaded.ranges[40].num_v == built.ranges[40].num_v + 1);
+    tinyobj_shape_index_free(&loaded);
+
+    tinyobj_shape_index_free(&built);
+    tinyobj_attrib_free(&full);
+    tinyobj_shapes_free(full_shapes, num_full_shapes);
+    tinyobj_materials_free(full_materials, num_full_materials);
+
+    // CRLF line endings, for the `usemtl` inherited by a shape.
+    {
+        size_t crlf_len;
+        char *crlf = to_crlf(obj, len, &crlf_len);
+        fp = fopen(obj_filename, "wb");
+        fwrite(crlf, 1, crlf_len, fp);
+        fclose(fp);
+        free(crlf);
+    }
+    TEST_CHECK(tinyobj_parse_obj(&full, &full_shapes, &num_full_shapes, &full_materials, &num_full_materials,
+                                 obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_build_shape_index(&built, obj_filename) == TINYOBJ_SUCCESS);
+    TEST_CHECK(built.num_ranges == 41);
+    TEST_CHECK(tinyobj_parse_shapes(&sub, &sub_shapes, &num_sub_shapes, &sub_materials, &num_sub_materials,
+                                    &built, range_ids, 4, obj_filename, loadFile, NULL, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(num_sub_shapes == 3);
+    check_parsed_shapes(&full, full_shapes, &sub, sub_shapes, num_sub_shapes, shape_ids);
+    tinyobj_attrib_free(&sub);
+    tinyobj_shapes_free(sub_shapes, num_sub_shapes);
+    tinyobj_materials_free(sub_materials, num_sub_materials);
+    tinyobj_shape_index_free(&built);
+    tinyobj_attrib_free(&full);
+    tinyobj_shapes_free(full_shapes, num_full_shapes);
+    tinyobj_materials_free(full_materials, num_full_materials);
+
+    free(obj);
+    remove(obj_filename);
+    remove(index_filename);
+}
+
+void test_tinyobj_parse_obj_stats(void)
+{
+    const char *filename = "fixtures/cube.obj";
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials;
+    tinyobj_parse_option_t option;
+    tinyobj_parse_stats_t stats;
+    size_t attrib_bytes;
+
+    memset(&option, 0, sizeof(option));
+    option.stats = &stats;
+
+    TEST_CHECK(tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials,
+                                    &num_materials, filename, loadFile, NULL, 0,
+                                    &option) == TINYOBJ_SUCCESS);
+    TEST_CHECK(stats.num_bytes == 753);
+    TEST_CHECK(stats.num_lines == 31);
+    TEST_CHECK(stats.num_v == 8);
+    TEST_CHECK(stats.num_vn == 6);
+    TEST_CHECK(stats.num_vt == 0);
+    TEST_CHECK(stats.num_f == 6);
+    TEST_CHECK(stats.num_o == 1);
+    TEST_CHECK(stats.num_g == 0);
+    TEST_CHECK(stats.num_usemtl == 1);
+    TEST_CHECK(stats.num_mtllib == 1);
+
+    TEST_CHECK(stats.line_scan_time >= 0.0);
+    TEST_CHECK(stats.total_time >= stats.line_scan_time);
+
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+    // Everything but the results is released before returning.
+    attrib_bytes = sizeof(float) * 3 * (attrib.num_vertices + attrib.num_normals) +
+                   sizeof(tinyobj_vertex_index_t) * attrib.num_faces +
+                   sizeof(int) * 2 * attrib.num_face_num_verts;
+    TEST_CHECK(stats.num_allocs > 0);
+    TEST_CHECK(stats.live_bytes >= attrib_bytes);
+    TEST_CHECK(stats.peak_bytes > stats.live_bytes);
+#else
+    (void)attrib_bytes;
+#endif
+
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+}
+
+// Twice the signed area of a triangle in the xy plane.
+float triangle_area2(const tinyobj_attrib_t *attrib, const tinyobj_vertex_index_t *tri)
+{
+    const float *a = &attrib->vertices[3 * tri[0].v_idx];
+    const float *b = &attrib->vertices[3 * tri[1].v_idx];
+    const float *c = &attrib->vertices[3 * tri[2].v_idx];
+    return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+void check_same_triangles(const tinyobj_triangles_t *a, const tinyobj_triangles_t *b)
+{
+    TEST_CHECK(a->num_faces == b->num_faces);
+    TEST_CHECK(a->num_face_num_verts == b->num_face_num_verts);
+    if (a->num_faces != b->num_faces || a->num_face_num_verts != b->num_face_num_verts) return;
+    TEST_CHECK(same_bytes(a->faces, b->faces, sizeof(tinyobj_vertex_index_t) * a->num_faces));
+    TEST_CHECK(same_bytes(a->face_num_verts, b->face_num_verts, sizeof(int) * a->num_face_num_verts));
+    TEST_CHECK(same_bytes(a->material_ids, b->material_ids, sizeof(int) * a->num_face_num_verts));
+}
+
+void test_tinyobj_triangulate(void)
+{
+    // An L shape starting at a corner next to the reflex vertex, so a fan
+    // covers area outside the polygon.
+    const char *obj =
+        "mtllib fixtures/cube.mtl\n"
+        "v 2 1 0\nv 1 1 0\nv 1 2 0\nv 0 2 0\nv 0 0 0\nv 2 0 0\n"
+        "usemtl CubeMaterial\n"
+        "f 1 2 3 4 5 6\n"
+        "l 1 2\n"
+        "f 1 2 3\n";
+    memory_file_t file;
+    tinyobj_attrib_t attrib, triangulated;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials, i;
+    tinyobj_triangles_t fan, ear;
+    float area2 = 0.0f;
+    int num_inverted = 0;
+
+    file.obj = obj;
+    file.obj_len = strlen(obj);
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+                                 &num_materials, "l.obj", loadMemory, &file, 0) == TINYOBJ_SUCCESS);
+    TEST_CHECK(attrib.num_face_num_verts == 3);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    // Fan is what TINYOBJ_FLAG_TRIANGULATE gives.
+    TEST_CHECK(tinyobj_triangulate(&fan, &attrib, TINYOBJ_TRIANGULATE_FAN, 0, NULL) == TINYOBJ_SUCCESS);
+    TEST_CHECK(tinyobj_parse_obj(&triangulated, &shapes, &num_shapes, &materials,
+                                 &num_materials, "l.obj", loadMemory, &file,
+                                 TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+    TEST_CHECK(fan.num_face_num_verts == 4 + 1 + 1);
+    TEST_CHECK(fan.num_faces == 12 + 2 + 3);
+    TEST_CHECK(fan.num_faces == triangulated.num_faces);
+    TEST_CHECK(fan.num_face_num_verts == triangulated.num_face_num_verts);
+    TEST_CHECK(same_bytes(fan.faces, triangulated.faces, sizeof(tinyobj_vertex_index_t) * fan.num_faces));
+    TEST_CHECK(same_bytes(fan.face_num_verts, triangulated.face_num_verts, sizeof(int) * fan.num_face_num_verts));
+    TEST_CHECK(same_bytes(fan.material_ids, triangulated.material_ids, sizeof(int) * fan.num_face_num_verts));
+    tinyobj_attrib_free(&triangulated);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+
+    for (i = 0; i < 4; i++) {
+        if (triangle_area2(&attrib, &fan.faces[3 * i]) <= 0.0f) num_inverted++;
+    }
+    TEST_CHECK(num_inverted > 0);
+
+    // Ear clipping keeps every triangle inside the polygon.
+    TEST_CHECK(tinyobj_triangulate(&ear, &attrib, TINYOBJ_TRIANGULATE_EAR_CLIP, 0, NULL) == TINYOBJ_SUCCESS);
+    TEST_CHECK(ear.num_faces == fan.num_faces);
+    TEST_CHECK(ear.num_face_num_verts == fan.num_face_num_verts);
+    for (i = 0; i < 4; i++) {
+        float a = triangle_area2(&attrib, &ear.faces[3 * i]);
+        TEST_CHECK(a > 0.0f);
+        area2 += a;
+        TEST_CHECK(ear.face_num_verts[i] == 3);
+        TEST_CHECK(ear.material_ids[i] == 0);
+    }
+    TEST_CHECK(area2 == 6.0f);
+
+    // The line is kept, the triangle is copied.
+    TEST_CHECK(ear.face_num_verts[4] == 2);
+    TEST_CHECK(ear.faces[12].v_idx == 0 && ear.faces[13].v_idx == 1);
+    TEST_CHECK(ear.face_num_verts[5] == 3);
+    TEST_CHECK(ear.faces[16].v_idx == 2);
+
+    TEST_CHECK(tinyobj_triangulate(&ear, &attrib, 2, 0, NULL) == TINYOBJ_ERROR_INVALID_PARAMETER);
+
+    tinyobj_triangles_free(&fan);
+    tinyobj_triangles_free(&ear);
+    tinyobj_attrib_free(&attrib);
+}
+
+void test_tinyobj_triangulate_parallel(void)
+{
+    memory_file_t file;
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    tinyobj_material_t *materials = NULL;
+    size_t num_shapes, num_materials;
+    tinyobj_parse_option_t option;
+    int method;
+
+    file.obj = generate_grid_obj(300, &file.obj_len);
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+                                 &num_materials, "grid.obj", loadMemory, &file, 0) == TINYOBJ_SUCCESS);
+
+    memset(&option, 0, sizeof(option));
+    option.num_threads = 4;
+    for (method = TINYOBJ_TRIANGULATE_FAN; method <= TINYOBJ_TRIANGULATE_EAR_CLIP; method++) {
+        tinyobj_triangles_t serial, parallel;
+        TEST_CHECK(tinyobj_triangulate(&serial, &attrib, method, 0, NULL) == TINYOBJ_SUCCESS);
+        TEST_CHECK(tinyobj_triangulate(&parallel, &attrib, method, TINYOBJ_FLAG_PARALLEL, &option) == TINYOBJ_SUCCESS);
+        TEST_CHECK(serial.num_face_num_verts == 2 * attrib.num_face_num_verts);
+        check_same_triangles(&serial, &parallel);
+        tinyobj_triangles_free(&serial);
+        tinyobj_triangles_free(&parallel);
+    }
+
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+    free((char *)file.obj);
+}
+
 TEST_LIST = {
     { "tinyobj_attrib_init",    test_tinyobj_attrib_init },
     { "tinyobj_parse_mtl_file", test_tinyobj_parse_mtl_file },
     { "tinyobj_parse_obj",      test_tinyobj_parse_obj },
+    { "tinyobj_parse_obj_parallel", test_tinyobj_parse_obj_parallel },
+    { "tinyobj_parser_stream",  test_tinyobj_parser_stream },
+    { "tinyobj_parser_stream_last_line", test_tinyobj_parser_stream_last_line },
+    { "tinyobj_parse_obj_arena", test_tinyobj_parse_obj_arena },
+    { "tinyobj_parse_obj_string_pool", test_tinyobj_parse_obj_string_pool },
+    { "tinyobj_file_reader",    test_tinyobj_file_reader },
+    { "tinyobj_parser_stream_usemtl_first", test_tinyobj_parser_stream_usemtl_first },
+    { "tinyobj_parse_obj_compressed", test_tinyobj_parse_obj_compressed },
+    { "tinyobj_parse_obj_multiple_mtllibs", test_tinyobj_parse_obj_multiple_mtllibs },
+    { "tinyobj_parse_obj_batch", test_tinyobj_parse_obj_batch },
+    { "tinyobj_parse_obj_soa_indices", test_tinyobj_parse_obj_soa_indices },
+    { "tinyobj_parse_obj_quantize", test_tinyobj_parse_obj_quantize },
+    { "tinyobj_parse_obj_stats", test_tinyobj_parse_obj_stats },
+    { "tinyobj_build_indexed_mesh", test_tinyobj_build_indexed_mesh },
+    { "tinyobj_build_indexed_mesh_parallel", test_tinyobj_build_indexed_mesh_parallel },
+    { "tinyobj_triangulate",    test_tinyobj_triangulate },
+    { "tinyobj_triangulate_parallel", test_tinyobj_triangulate_parallel },
+    { "tinyobj_cache",          test_tinyobj_cache },
+    { "tinyobj_parse_shapes",   test_tinyobj_parse_shapes },
     { 0 } // required by acutest
 };
@@ -0,0 +1,635 @@
+// Load throughput on generated scenes.
+//
+//   tinyobj_bench                 run the default scenes
+//   tinyobj_bench -s NAME         run one of the default scenes
+//   tinyobj_bench -o FILE.obj     run an existing .obj file
+//   tinyobj_bench -w DIR          write the default scenes to DIR
+//   tinyobj_bench -p              parse with TINYOBJ_FLAG_PARALLEL
+//   tinyobj_bench -r RUNS         median of RUNS(default 3)
+//   tinyobj_bench -j FILE.json    write the median MB/s and peak RSS per scene
+//   tinyobj_bench -b FILE.json    compare with a baseline written by -j, fail
+//                                 when it is missing or lacks a scene
+//   tinyobj_bench --allow-missing only warn when the baseline is missing
+//   tinyobj_bench -T PERCENT      regression threshold for -b(default 10)
+//   tinyobj_bench -c CLASS        machine class written by -j
+#define _POSIX_C_SOURCE 200809L
+#define TINYOBJ_LOADER_C_IMPLEMENTATION
+
+#include "tinyobj_loader_c.h"
+
+#include <stdarg.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef struct {
+    const char *name;
+    size_t num_faces;
+    int verts_per_face;        // 3 = triangles, more = n-gons.
+    int has_texcoords;
+    int has_normals;
+    size_t num_materials;      // Also written to the .mtl file.
+    size_t faces_per_material; // `usemtl` every N faces. 0 = never.
+    int relative;              // Negative indices.
+    int crlf;
+} scene_t;
+
+static const scene_t scenes[] = {
+    // name              faces     n  vt vn  mats    per_mtl rel crlf
+    { "tri_v",           2000000,  3, 0, 0,  1,      0,      0,  0 },
+    { "tri_v_vt_vn",     1000000,  3, 1, 1,  1,      0,      0,  0 },
+    { "quad_v_vn",       1000000,  4, 0, 1,  1,      0,      0,  0 },
+    { "ngon8_v_vt",      500000,   8, 1, 0,  1,      0,      0,  0 },
+    { "usemtl_switches", 1000000,  3, 1, 1,  256,    4,      0,  0 },
+    { "relative",        1000000,  3, 1, 1,  1,      0,      1,  0 },
+    { "crlf",            1000000,  3, 1, 1,  1,      0,      0,  1 },
+    { "many_materials",  10000,    3, 0, 0,  100000, 1,      0,  0 },
+};
+
+#define NUM_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+// Faces of a block use vertices of that block only.
+#define FACES_PER_BLOCK (1024)
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} buffer_t;
+
+static void buffer_reserve(buffer_t *b, size_t n)
+{
+    if (b->len + n <= b->cap) return;
+    while (b->len + n > b->cap) b->cap = b->cap ? b->cap * 2 : 1 << 20;
+    b->data = (char *)realloc(b->data, b->cap);
+}
+
+static void buffer_printf(buffer_t *b, const char *fmt, ...)
+{
+    va_list ap;
+    buffer_reserve(b, 256);
+    va_start(ap, fmt);
+    b->len += (size_t)vsnprintf(b->data + b->len, 256, fmt, ap);
+    va_end(ap);
+}
+
+static void buffer_puts(buffer_t *b, const char *s)
+{
+    size_t n = strlen(s);
+    buffer_reserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void buffer_newline(buffer_t *b, int crlf)
+{
+    buffer_puts(b, crlf ? "\r\n" : "\n");
+}
+
+// Deterministic pseudo random numbers.
+static unsigned int next_random(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+static double random_coord(unsigned int *seed)
+{
+    return (double)next_random(seed) / (double)(1u << 24) * 200.0 - 100.0;
+}
+
+static void generate_obj(const scene_t *scene, buffer_t *obj)
+{
+    unsigned int seed = 1;
+    size_t pool = FACES_PER_BLOCK * (size_t)scene->verts_per_face / 4 + (size_t)scene->verts_per_face;
+    size_t num_v = 0;
+    size_t face = 0;
+    size_t material = 0;
+
+    buffer_printf(obj, "mtllib %s.mtl", scene->name);
+    buffer_newline(obj, scene->crlf);
+
+    while (face < scene->num_faces) {
+        size_t block = face / FACES_PER_BLOCK;
+        size_t i;
+
+        buffer_printf(obj, "g block%lu", (unsigned long)block);
+        buffer_newline(obj, scene->crlf);
+
+        for (i = 0; i < pool; i++) {
+            buffer_printf(obj, "v %.6f %.6f %.6f", random_coord(&seed), random_coord(&seed), random_coord(&seed));
+            buffer_newline(obj, scene->crlf);
+            if (scene->has_texcoords) {
+                buffer_printf(obj, "vt %.6f %.6f", (double)(next_random(&seed) % 1000000) / 1e6,
+                              (double)(next_random(&seed) % 1000000) / 1e6);
+                buffer_newline(obj, scene->crlf);
+            }
+            if (scene->has_normals) {
+                buffer_printf(obj, "vn %.4f %.4f %.4f", random_coord(&seed) / 100.0,
+                              random_coord(&seed) / 100.0, random_coord(&seed) / 100.0);
+                buffer_newline(obj, scene->crlf);
+            }
+        }
+        num_v += pool;
+
+        for (i = 0; i < FACES_PER_BLOCK && face < scene->num_faces; i++, face++) {
+            int k;
+
+            if (scene->faces_per_material > 0 && face % scene->faces_per_material == 0) {
+                buffer_printf(obj, "usemtl material%lu",
+                              (unsigned long)(material++ % scene->num_materials));
+                buffer_newline(obj, scene->crlf);
+            }
+
+            buffer_puts(obj, "f");
+            for (k = 0; k < scene->verts_per_face; k++) {
+                size_t j = next_random(&seed) % pool;
+                long idx = scene->relative ? -(long)(pool - j) : (long)(num_v - pool + j + 1);
+                if (scene->has_texcoords && scene->has_normals) {
+                    buffer_printf(obj, " %ld/%ld/%ld", idx, idx, idx);
+                } else if (scene->has_texcoords) {
+                    buffer_printf(obj, " %ld/%ld", idx, idx);
+                } else if (scene->has_normals) {
+                    buffer_printf(obj, " %ld//%ld", idx, idx);
+                } else {
+                    buffer_printf(obj, " %ld", idx);
+                }
+            }
+            buffer_newline(obj, scene->crlf);
+        }
+    }
+}
+
+static void generate_mtl(const scene_t *scene, buffer_t *mtl)
+{
+    unsigned int seed = 2;
+    size_t i;
+
+    for (i = 0; i < scene->num_materials; i++) {
+        double r = (double)(next_random(&seed) % 1000) / 1000.0;
+        double g = (double)(next_random(&seed) % 1000) / 1000.0;
+        double b = (double)(next_random(&seed) % 1000) / 1000.0;
+
+        buffer_printf(mtl, "newmtl material%lu", (unsigned long)i);
+        buffer_newline(mtl, scene->crlf);
+        buffer_printf(mtl, "Ka %.3f %.3f %.3f", r * 0.1, g * 0.1, b * 0.1);
+        buffer_newline(mtl, scene->crlf);
+        buffer_printf(mtl, "Kd %.3f %.3f %.3f", r, g, b);
+        buffer_newline(mtl, scene->crlf);
+        buffer_puts(mtl, "Ks 0.500 0.500 0.500");
+        buffer_newline(mtl, scene->crlf);
+        buffer_printf(mtl, "Ns %u", next_random(&seed) % 1000);
+        buffer_newline(mtl, scene->crlf);
+        buffer_puts(mtl, "d 1.0");
+        buffer_newline(mtl, scene->crlf);
+        buffer_puts(mtl, "illum 2");
+        buffer_newline(mtl, scene->crlf);
+        buffer_printf(mtl, "map_Kd textures/material%lu.png", (unsigned long)i);
+        buffer_newline(mtl, scene->crlf);
+        buffer_newline(mtl, scene->crlf);
+    }
+}
+
+typedef struct {
+    buffer_t obj;
+    buffer_t mtl;
+} scene_files_t;
+
+// Result of a scene, for -j and -b.
+typedef struct {
+    char name[32];
+    int ok;
+    double obj_mb;
+    double median_mb_per_s;
+    double median_mlines_per_s;
+    double peak_rss_mb;
+} scene_result_t;
+
+static int read_file(const char *path, buffer_t *b)
+{
+    FILE *fp = fopen(path, "rb");
+    long len;
+    if (fp == NULL) return -1;
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    rewind(fp);
+    buffer_reserve(b, (size_t)len + 1);
+    b->len = fread(b->data, 1, (size_t)len, fp);
+    fclose(fp);
+    return (b->len == (size_t)len) ? 0 : -1;
+}
+
+// The loader does not free buffers from the reader, so no copy is made.
+// A .mtl file of an existing .obj file is read from disk on first use.
+static void read_scene(void *ctx, const char *filename, int is_mtl,
+                       const char *obj_filename, char **buf, size_t *len)
+{
+    scene_files_t *files = (scene_files_t *)ctx;
+    (void)obj_filename;
+    if (is_mtl && files->mtl.data == NULL) {
+        read_file(filename, &files->mtl);
+    }
+    *buf = is_mtl ? files->mtl.data : files->obj.data;
+    *len = is_mtl ? files->mtl.len : files->obj.len;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double peak_rss_mb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (double)usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return (double)usage.ru_maxrss / 1024.0; // KB
+#endif
+}
+
+static size_t count_lines(const buffer_t *b)
+{
+    size_t i, n = 0;
+    for (i = 0; i < b->len; i++) {
+        if (b->data[i] == '\n') n++;
+    }
+    return n;
+}
+
+// Print the phase breakdown of tinyobj_parse_stats_t(-t).
+static int show_phases = 0;
+
+static void print_header(void)
+{
+    printf("%-16s %8s %9s %9s %8s %9s %9s %8s %9s\n", "scene", "obj MB", "MB/s",
+           "Mlines/s", "mtl MB", "MB/s", "Mlines/s", "free ms", "peak RSS");
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int n)
+{
+    qsort(values, (size_t)n, sizeof(double), compare_double);
+    return (n % 2) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// Index of the run with the median time(the lower one of an even count).
+static int median_run(const double *times, int n)
+{
+    int i, j;
+    for (i = 0; i < n; i++) {
+        int rank = 0;
+        for (j = 0; j < n; j++) {
+            if (times[j] < times[i] || (times[j] == times[i] && j < i)) rank++;
+        }
+        if (rank == (n - 1) / 2) return i;
+    }
+    return 0;
+}
+
+static void run_scene(const char *name, scene_files_t *files, unsigned int flags, int runs,
+                      scene_result_t *result)
+{
+    double *obj_times = (double *)malloc(sizeof(double) * (size_t)runs);
+    double *mtl_times = (double *)malloc(sizeof(double) * (size_t)runs);
+    double *free_times = (double *)malloc(sizeof(double) * (size_t)runs);
+    tinyobj_parse_stats_t *run_stats =
+        (tinyobj_parse_stats_t *)calloc((size_t)runs, sizeof(tinyobj_parse_stats_t));
+    double median_obj, median_mtl = 0.0, median_free;
+    size_t obj_lines = count_lines(&files->obj);
+    size_t mtl_lines;
+    tinyobj_parse_option_t option;
+    tinyobj_parse_stats_t phases;
+    int num_mtl = 0;
+    int r;
+
+    memset(&option, 0, sizeof(option));
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", name);
+
+    for (r = 0; r < runs; r++) {
+        tinyobj_attrib_t attrib;
+        tinyobj_shape_t *shapes = NULL;
+        tinyobj_material_t *materials = NULL;
+        size_t num_shapes = 0, num_materials = 0;
+        double t;
+
+        if (show_phases) option.stats = &run_stats[r];
+        t = now();
+        if (tinyobj_parse_obj_ex(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                                 name, read_scene, files, flags, &option) != TINYOBJ_SUCCESS) {
+            printf("%-16s failed to parse\n", name);
+            free(obj_times);
+            free(mtl_times);
+            free(free_times);
+            free(run_stats);
+            return;
+        }
+        obj_times[r] = now() - t;
+
+        t = now();
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shapes, num_shapes);
+        tinyobj_materials_free(materials, num_materials);
+        free_times[r] = now() - t;
+
+        if (files->mtl.len > 0) {
+            t = now();
+            if (tinyobj_parse_mtl_file(&materials, &num_materials, name, name, read_scene,
+                                       files) == TINYOBJ_SUCCESS) {
+                mtl_times[num_mtl++] = now() - t;
+                tinyobj_materials_free(materials, num_materials);
+            }
+        }
+    }
+
+    phases = run_stats[median_run(obj_times, runs)];
+    median_obj = median(obj_times, runs);
+    median_free = median(free_times, runs);
+    if (num_mtl > 0) median_mtl = median(mtl_times, num_mtl);
+
+    // A .mtl file of an existing .obj file is only read while parsing.
+    mtl_lines = count_lines(&files->mtl);
+    printf("%-16s %8.1f %9.1f %9.2f", name, (double)files->obj.len / 1e6,
+           (double)files->obj.len / median_obj / 1e6, (double)obj_lines / median_obj / 1e6);
+    if (num_mtl > 0) {
+        printf(" %8.2f %9.1f %9.2f", (double)files->mtl.len / 1e6,
+               (double)files->mtl.len / median_mtl / 1e6, (double)mtl_lines / median_mtl / 1e6);
+    } else {
+        printf(" %8s %9s %9s", "-", "-", "-");
+    }
+    printf(" %8.2f %6.0f MB\n", median_free * 1e3, peak_rss_mb());
+    if (show_phases) {
+        printf("%-16s scan %.2f ms, parse %.2f ms, mtl %.2f ms, attrib %.2f ms, shape %.2f ms,"
+               " %lu allocs, peak %.1f MB\n", "", phases.line_scan_time * 1e3,
+               phases.parse_time * 1e3, phases.mtl_time * 1e3,
+               phases.attrib_time * 1e3, phases.shape_time * 1e3,
+               (unsigned long)phases.num_allocs, (double)phases.peak_bytes / 1e6);
+    }
+
+    result->ok = 1;
+    result->obj_mb = (double)files->obj.len / 1e6;
+    result->median_mb_per_s = (double)files->obj.len / median_obj / 1e6;
+    result->median_mlines_per_s = (double)obj_lines / median_obj / 1e6;
+    result->peak_rss_mb = peak_rss_mb();
+
+    free(obj_times);
+    free(mtl_times);
+    free(free_times);
+    free(run_stats);
+}
+
+static int write_file(const char *dir, const char *name, const char *ext, const buffer_t *b)
+{
+    char path[1024];
+    FILE *fp;
+    snprintf(path, sizeof(path), "%s/%s.%s", dir, name, ext);
+    fp = fopen(path, "wb");
+    if (fp == NULL || fwrite(b->data, 1, b->len, fp) != b->len) {
+        fprintf(stderr, "failed to write %s\n", path);
+        if (fp) fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    printf("wrote %s\n", path);
+    return 0;
+}
+
+// Each scene runs in its own process, so peak RSS is per scene. The result
+// comes back through a pipe.
+static void run_generated_scene(const scene_t *scene, unsigned int flags, int runs,
+                                scene_result_t *result)
+{
+    int fds[2];
+    pid_t pid;
+
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", scene->name);
+    if (pipe(fds) != 0) {
+        fprintf(stderr, "pipe failed\n");
+        return;
+    }
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        scene_files_t files;
+        close(fds[0]);
+        memset(&files, 0, sizeof(files));
+        generate_obj(scene, &files.obj);
+        generate_mtl(scene, &files.mtl);
+        run_scene(scene->name, &files, flags, runs, result);
+        fflush(stdout);
+        if (write(fds[1], result, sizeof(*result)) != (ssize_t)sizeof(*result)) _exit(1);
+        _exit(0);
+    } else if (pid > 0) {
+        scene_result_t child;
+        close(fds[1]);
+        if (read(fds[0], &child, sizeof(child)) == (ssize_t)sizeof(child)) *result = child;
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+    } else {
+        fprintf(stderr, "fork failed\n");
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+static int write_json(const char *path, const char *machine_class, unsigned int flags, int runs,
+                      const scene_result_t *results, size_t num_results)
+{
+    FILE *fp = fopen(path, "w");
+    size_t i;
+    if (fp == NULL) {
+        fprintf(stderr, "failed to write %s\n", path);
+        return -1;
+    }
+    fprintf(fp, "{\n  \"class\": \"%s\",\n  \"parallel\": %d,\n  \"runs\": %d,\n  \"scenes\": [\n",
+            machine_class, (flags & TINYOBJ_FLAG_PARALLEL) ? 1 : 0, runs);
+    // One scene per line, which is what read_baseline expects.
+    for (i = 0; i < num_results; i++) {
+        const scene_result_t *r = &results[i];
+        fprintf(fp, "    { \"name\": \"%s\", \"obj_mb\": %.1f, \"median_mb_per_s\": %.1f,"
+                " \"median_mlines_per_s\": %.2f, \"peak_rss_mb\": %.0f }%s\n",
+                r->name, r->obj_mb, r->median_mb_per_s, r->median_mlines_per_s, r->peak_rss_mb,
+                (i + 1 < num_results) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
+
+// Find `"key": number` in `line`.
+static int json_number(const char *line, const char *key, double *value)
+{
+    char pattern[64];
+    const char *p;
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    p = strstr(line, pattern);
+    if (p == NULL) return -1;
+    *value = strtod(p + strlen(pattern), NULL);
+    return 0;
+}
+
+// Compare `results` with the scenes of the baseline written by write_json.
+// Returns the number of regressed, failed or missing scenes, or -1 when the
+// baseline can not be read.
+static int check_baseline(const char *path, double tolerance,
+                          const scene_result_t *results, size_t num_results)
+{
+    buffer_t baseline;
+    int regressions = 0;
+    size_t i;
+
+    memset(&baseline, 0, sizeof(baseline));
+    if (read_file(path, &baseline) != 0) {
+        free(baseline.data);
+        return -1;
+    }
+    baseline.data[baseline.len] = '\0';
+
+    printf("\n%-16s %9s %9s %7s %9s %9s %7s\n", "scene", "MB/s", "baseline", "change",
+           "RSS MB", "baseline", "change");
+    for (i = 0; i < num_results; i++) {
+        const scene_result_t *r = &results[i];
+        char pattern[sizeof(r->name) + 16];
+        const char *line;
+        double mb_per_s, rss_mb, speed_change, rss_change;
+        int failed;
+
+        snprintf(pattern, sizeof(pattern), "\"name\": \"%.*s\"", (int)sizeof(r->name) - 1,
+                 r->name);
+        line = strstr(baseline.data, pattern);
+        if (line == NULL || json_number(line, "median_mb_per_s", &mb_per_s) != 0 ||
+            json_number(line, "peak_rss_mb", &rss_mb) != 0) {
+            printf("%-16s not in the baseline  MISSING\n", r->name);
+            regressions++;
+            continue;
+        }
+        if (!r->ok) {
+            printf("%-16s failed\n", r->name);
+            regressions++;
+            continue;
+        }
+
+        speed_change = (r->median_mb_per_s / mb_per_s - 1.0) * 100.0;
+        rss_change = (r->peak_rss_mb / rss_mb - 1.0) * 100.0;
+        failed = speed_change < -tolerance || rss_change > tolerance;
+        printf("%-16s %9.1f %9.1f %+6.1f%% %9.0f %9.0f %+6.1f%%%s\n", r->name,
+               r->median_mb_per_s, mb_per_s, speed_change, r->peak_rss_mb, rss_mb, rss_change,
+               failed ? "  REGRESSION" : "");
+        regressions += failed;
+    }
+    free(baseline.data);
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    const char *only = NULL;
+    const char *obj_path = NULL;
+    const char *out_dir = NULL;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    const char *machine_class = "unknown";
+    double tolerance = 10.0;
+    int allow_missing = 0;
+    scene_result_t results[NUM_SCENES];
+    size_t num_results = 0;
+    unsigned int flags = 0;
+    int runs = 3;
+    size_t s;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0) {
+            flags |= TINYOBJ_FLAG_PARALLEL;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            show_phases = 1;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            obj_path = argv[++i];
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--allow-missing") == 0) {
+            allow_missing = 1;
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            machine_class = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-p] [-t] [-r runs] [-s scene | -o file.obj | -w dir]"
+                    " [-j out.json] [-b baseline.json] [--allow-missing] [-T percent] [-c class]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+
+    if (obj_path) {
+        scene_files_t files;
+        memset(&files, 0, sizeof(files));
+        if (read_file(obj_path, &files.obj) != 0) {
+            fprintf(stderr, "failed to read %s\n", obj_path);
+            return 1;
+        }
+        print_header();
+        run_scene(obj_path, &files, flags, runs, &results[num_results++]);
+        free(files.obj.data);
+        free(files.mtl.data);
+    }
+
+    if (!obj_path && !out_dir) print_header();
+    for (s = 0; s < NUM_SCENES && !obj_path; s++) {
+        scene_files_t files;
+        int ret;
+        if (only && strcmp(only, scenes[s].name) != 0) continue;
+
+        if (!out_dir) {
+            run_generated_scene(&scenes[s], flags, runs, &results[num_results++]);
+            continue;
+        }
+
+        memset(&files, 0, sizeof(files));
+        generate_obj(&scenes[s], &files.obj);
+        generate_mtl(&scenes[s], &files.mtl);
+        ret = write_file(out_dir, scenes[s].name, "obj", &files.obj) != 0 ||
+              write_file(out_dir, scenes[s].name, "mtl", &files.mtl) != 0;
+        free(files.obj.data);
+        free(files.mtl.data);
+        if (ret) return 1;
+    }
+
+    if (json_path) {
+        if (write_json(json_path, machine_class, flags, runs, results, num_results) != 0) return 1;
+        printf("wrote %s\n", json_path);
+    }
+    if (baseline_path) {
+        int regressions = check_baseline(baseline_path, tolerance, results, num_results);
+        if (regressions < 0) {
+            fprintf(stderr, "WARNING: no baseline %s, nothing was compared."
+                    " Record one with `make perf-baseline`.\n", baseline_path);
+            if (!allow_missing) return 1;
+        } else if (regressions > 0) {
+            printf("%d scene(s) regressed by more than %.0f%% or are missing from the baseline\n",
+                   regressions, tolerance);
+            return 1;
+        }
+    }
+    return 0;
+}
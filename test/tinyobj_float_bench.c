@@ -0,0 +1,95 @@
+// Float parsing throughput.
+// Build with -DTINYOBJ_LEGACY_FLOAT_PARSER to measure the old parser.
+#define TINYOBJ_LOADER_C_IMPLEMENTATION
+
+#include "tinyobj_loader_c.h"
+
+#include <time.h>
+
+#define NUM_VALUES (4 * 1024 * 1024)
+#define NUM_RUNS (5)
+
+// Space separated coordinates in the styles common in OBJ exports.
+static char *generate_values(size_t *len)
+{
+    static const char *formats[] = { "%.6f", "%.9g", "%g", "%.4e" };
+    size_t cap = (size_t)NUM_VALUES * 24;
+    char *buf = (char *)malloc(cap);
+    unsigned int seed = 1;
+    size_t pos = 0;
+    int i;
+
+    for (i = 0; i < NUM_VALUES; i++) {
+        double v;
+        seed = seed * 1103515245u + 12345u;
+        v = ((double)(seed >> 8) / (double)(1u << 24) - 0.5) * 200.0;
+        pos += (size_t)snprintf(buf + pos, cap - pos, formats[i % 4], v);
+        buf[pos++] = ' ';
+    }
+    *len = pos;
+    return buf;
+}
+
+static double run(const char *buf, size_t len, float *sum)
+{
+    const char *token = buf;
+    const char *end = buf + len;
+    clock_t start = clock();
+    float s = 0.0f;
+
+    while (token < end) {
+        s += parseFloat(&token, end);
+        skip_space(&token, end);
+    }
+
+    *sum = s;
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double run_strtof(const char *buf, size_t len, float *sum)
+{
+    const char *token = buf;
+    const char *end = buf + len;
+    clock_t start = clock();
+    float s = 0.0f;
+
+    while (token < end) {
+        char *next;
+        s += strtof(token, &next);
+        token = next;
+        skip_space(&token, end);
+    }
+
+    *sum = s;
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+    size_t len;
+    char *buf = generate_values(&len);
+    double best = 1e30, best_strtof = 1e30;
+    float sum = 0.0f, sum_strtof = 0.0f;
+    int i;
+
+    for (i = 0; i < NUM_RUNS; i++) {
+        double t = run(buf, len, &sum);
+        double t_strtof = run_strtof(buf, len, &sum_strtof);
+        if (t < best) best = t;
+        if (t_strtof < best_strtof) best_strtof = t_strtof;
+    }
+
+#ifdef TINYOBJ_LEGACY_FLOAT_PARSER
+    printf("parseFloat(legacy): ");
+#else
+    printf("parseFloat:         ");
+#endif
+    printf("%7.1f MB/s %6.1f ns/float (sum %g)\n", (double)len / best / 1e6,
+           best * 1e9 / NUM_VALUES, (double)sum);
+    printf("strtof:             %7.1f MB/s %6.1f ns/float (sum %g)\n",
+           (double)len / best_strtof / 1e6, best_strtof * 1e9 / NUM_VALUES,
+           (double)sum_strtof);
+
+    free(buf);
+    return 0;
+}
@@ -1,28 +1,63 @@
+#include <stdlib.h>
+
+// Allocations fail once `alloc_budget` of them succeeded(-1 = never fail).
+static long alloc_budget = -1;
+
+static int alloc_allowed(void)
+{
+    if (alloc_budget < 0) return 1;
+    if (alloc_budget == 0) return 0;
+    alloc_budget--;
+    return 1;
+}
+
+static void *budget_malloc(size_t size)
+{
+    return alloc_allowed() ? malloc(size) : NULL;
+}
+
+static void *budget_calloc(size_t num, size_t size)
+{
+    return alloc_allowed() ? calloc(num, size) : NULL;
+}
+
+static void *budget_realloc(void *p, size_t size)
+{
+    return alloc_allowed() ? realloc(p, size) : NULL;
+}
+
+#define TINYOBJ_MALLOC budget_malloc
+#define TINYOBJ_CALLOC budget_calloc
+#define TINYOBJ_REALLOC budget_realloc
+#define TINYOBJ_FREE free
+
 #define TINYOBJ_LOADER_C_IMPLEMENTATION
 
 #include "tinyobj_loader_c.h"
 #include "acutest.h"
 
+#include <math.h>
+
 void test_skip_space(void)
 {
     {
         // Regular string should remain unchanged.
         const char * test_string = "foo bar";
-        skip_space(&test_string);
+        skip_space(&test_string, test_string + strlen(test_string));
         TEST_CHECK(strcmp(test_string, "foo bar") == 0);
     }
 
     {
         // String with leading spaces & tabs should have its prefix trimmed.
         const char * test_string = "\t \t foo bar";
-        skip_space(&test_string);
+        skip_space(&test_string, test_string + strlen(test_string));
         TEST_CHECK(strcmp(test_string, "foo bar") == 0);
     }
 
     {
         // String with trailing spaces & tabs should remain unchanged.
         const char * test_string = "foo bar \t \t";
-        skip_space(&test_string);
+        skip_space(&test_string, test_string + strlen(test_string));
         TEST_CHECK(strcmp(test_string, "foo bar \t \t") == 0);
     }
 }
@@ -32,7 +67,7 @@ void test_skip_space_and_cr(void)
     {
         // Regular string should remain unchanged.
         const char * test_string = "foo bar";
-        skip_space_and_cr(&test_string);
+        skip_space_and_cr(&test_string, test_string + strlen(test_string));
         TEST_CHECK(strcmp(test_string, "foo bar") == 0);
     }
 
@@ -40,7 +75,7 @@ void test_skip_space_and_cr(void)
         // String with leading spaces, tabs, & carriage returns should have its
         // prefix trimmed.
         const char * test_string = "\r \t \t \rfoo bar";
-        skip_space_and_cr(&test_string);
+        skip_space_and_cr(&test_string, test_string + strlen(test_string));
         TEST_CHECK(strcmp(test_string, "foo bar") == 0);
     }
 
@@ -48,7 +83,7 @@ void test_skip_space_and_cr(void)
         // String with trailing spaces, tabs, & carriage returns should remain
         // unchanged.
         const char * test_string = "foo bar\r \t \t\r";
-        skip_space_and_cr(&test_string);
+        skip_space_and_cr(&test_string, test_string + strlen(test_string));
         TEST_CHECK(strcmp(test_string, "foo bar\r \t \t\r") == 0);
     }
 }
@@ -58,35 +93,42 @@ void test_until_space()
     {
         // Return value for regular string should be the number of non-null chars.
         char test_string[] = "potato";
-        TEST_CHECK(until_space(test_string) == 6);
+        TEST_CHECK(until_space(test_string, test_string + sizeof(test_string) - 1) == 6);
     }
 
     {
         // Return value for string with spaces should be number of chars to the
         // first space.
         char test_string[] = "foo bar baz";
-        TEST_CHECK(until_space(test_string) == 3);
+        TEST_CHECK(until_space(test_string, test_string + sizeof(test_string) - 1) == 3);
     }
 
     {
         // Return value for string with tabs should be number of chars to the
         // first tab.
         char test_string[] = "foo\tbar\tbaz";
-        TEST_CHECK(until_space(test_string) == 3);
+        TEST_CHECK(until_space(test_string, test_string + sizeof(test_string) - 1) == 3);
     }
 
     {
         // Return value for string with carriage returns should be number of
         // chars to the first carriage return.
         char test_string[] = "foo\rbar\rbaz";
-        TEST_CHECK(until_space(test_string) == 3);
+        TEST_CHECK(until_space(test_string, test_string + sizeof(test_string) - 1) == 3);
     }
 
     {
         // Return value for string with null characters should be number of
         // chars to the first null character.
         char test_string[] = "foo\0bar\0baz";
-        TEST_CHECK(until_space(test_string) == 3);
+        TEST_CHECK(until_space(test_string, test_string + sizeof(test_string) - 1) == 3);
+    }
+
+    {
+        // Return value for a string which is not null terminated should stop
+        // at the end pointer.
+        char test_string[] = "potato";
+        TEST_CHECK(until_space(test_string, test_string + 3) == 3);
     }
 }
 
@@ -138,12 +180,22 @@ void test_length_until_newline(void)
     }
 }
 
+// Returns the line table of `buf`, to be released with free().
+static void scan_buffer(const char *buf, size_t len, LineInfo **line_infos, size_t *num_lines)
+{
+    LineScanner scanner;
+    memset(&scanner, 0, sizeof(scanner));
+    scan_lines(buf, len, &scanner);
+    *line_infos = scanner.infos;
+    *num_lines = scanner.num_lines;
+}
+
 void test_num_lines(void) {
 	{
 		char buf[] = "";
 		LineInfo *line_infos = NULL;
 		size_t num_lines = 0;
-		get_line_infos(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+		scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
 		TEST_CHECK(num_lines == 0);
 	}
 
@@ -151,7 +203,7 @@ void test_num_lines(void) {
 		char buf[] = "hello";
 		LineInfo *line_infos = NULL;
 		size_t num_lines = 0;
-		get_line_infos(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+		scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
 		TEST_CHECK(num_lines == 1);
 	}
 
@@ -159,7 +211,7 @@ void test_num_lines(void) {
 		char buf[] = "\n\n";
 		LineInfo *line_infos = NULL;
 		size_t num_lines = 0;
-		get_line_infos(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+		scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
 		TEST_CHECK(num_lines == 2);
 	}
 
@@ -167,7 +219,7 @@ void test_num_lines(void) {
 		char buf[] = "a\r\na\na\0";
 		LineInfo *line_infos = NULL;
 		size_t num_lines = 0;
-		get_line_infos(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+		scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
 		TEST_CHECK(num_lines == 3);
 	}
 
@@ -175,7 +227,7 @@ void test_num_lines(void) {
 		char buf[] = "hello\nworld\n";
 		LineInfo *line_infos = NULL;
 		size_t num_lines = 0;
-		get_line_infos(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+		scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
 		TEST_CHECK(num_lines == 2);
 	}
 
@@ -183,20 +235,121 @@ void test_num_lines(void) {
 		char buf[] = "hello\nworld\n!";
 		LineInfo *line_infos = NULL;
 		size_t num_lines = 0;
-		get_line_infos(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+		scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
 		TEST_CHECK(num_lines == 3);
 	}
 }
 
+void test_line_infos(void)
+{
+    {
+        // CR, CRLF and LF line endings, and a last line without a line ending.
+        char buf[] = "v 1\r\nvn 2\rvt 3\nf 1";
+        LineInfo *line_infos = NULL;
+        size_t num_lines = 0;
+        scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+        TEST_CHECK(num_lines == 4);
+        TEST_CHECK(line_infos[0].pos == 0 && line_infos[0].len == 4); // "v 1\r"
+        TEST_CHECK(line_infos[1].pos == 5 && line_infos[1].len == 4);
+        TEST_CHECK(line_infos[2].pos == 10 && line_infos[2].len == 4);
+        TEST_CHECK(line_infos[3].pos == 15 && line_infos[3].len == 3);
+        free(line_infos);
+    }
+
+    {
+        // A single line without a line ending keeps all of its characters.
+        char buf[] = "v 1 2 3";
+        LineInfo *line_infos = NULL;
+        size_t num_lines = 0;
+        scan_buffer(buf, sizeof(buf) - 1, &line_infos, &num_lines);
+        TEST_CHECK(num_lines == 1);
+        TEST_CHECK(line_infos[0].pos == 0 && line_infos[0].len == 7);
+        free(line_infos);
+    }
+
+    {
+        // Random buffers(crossing SIMD block boundaries) should match a byte
+        // by byte scan.
+        const char chars[] = "ab \r\n\r\n";
+        char buf[300];
+        size_t expected_pos[300], expected_len[300];
+        int iter;
+        srand(1234);
+        for (iter = 0; iter < 2000; iter++) {
+            size_t len = (size_t)(rand() % 300);
+            size_t i, n = 0, prev = 0;
+            LineInfo *line_infos = NULL;
+            size_t num_lines = 0;
+            int ok = 1;
+
+            for (i = 0; i < len; i++) {
+                buf[i] = (rand() % 50 == 0) ? '\0' : chars[rand() % (sizeof(chars) - 1)];
+            }
+            for (i = 0; i < len; i++) {
+                int ending = (buf[i] == '\n' || buf[i] == '\0');
+                if (buf[i] == '\r' && i + 1 < len && buf[i + 1] != '\n') ending = 1;
+                if (ending) {
+                    expected_pos[n] = prev;
+                    expected_len[n] = i - prev;
+                    n++;
+                    prev = i + 1;
+                }
+            }
+            if (prev < len) {
+                expected_pos[n] = prev;
+                expected_len[n] = len - prev;
+                n++;
+            }
+
+            scan_buffer(buf, len, &line_infos, &num_lines);
+            ok = (num_lines == n);
+            for (i = 0; ok && i < n; i++) {
+                ok = (line_infos[i].pos == expected_pos[i] && line_infos[i].len == expected_len[i]);
+            }
+            TEST_CHECK_(ok, "buffer %d of length %u", iter, (unsigned)len);
+            free(line_infos);
+        }
+    }
+    {
+        // A scanner is reused for the next buffer, and grows when needed.
+        LineScanner scanner;
+        char big[2000];
+        size_t i;
+        memset(&scanner, 0, sizeof(scanner));
+        TEST_CHECK(scan_lines("a\nb\nc", 5, &scanner) == 0);
+        TEST_CHECK(scanner.num_lines == 3);
+        for (i = 0; i < sizeof(big); i++) big[i] = '\n';
+        TEST_CHECK(scan_lines(big, sizeof(big), &scanner) == 0);
+        TEST_CHECK(scanner.num_lines == sizeof(big));
+        TEST_CHECK(scan_lines("v 1", 3, &scanner) == 0);
+        TEST_CHECK(scanner.num_lines == 1);
+        TEST_CHECK(scanner.infos[0].pos == 0 && scanner.infos[0].len == 3);
+        TEST_CHECK(scan_lines("", 0, &scanner) == TINYOBJ_ERROR_EMPTY);
+        line_scanner_free(&scanner);
+        TEST_CHECK(scanner.infos == NULL);
+    }
+}
+
+static int my_atoi_str(const char *s)
+{
+    return my_atoi(s, s + strlen(s));
+}
+
 void test_my_atoi(void)
 {
     // Results for input strings should become corresponding ints.
-    TEST_CHECK(my_atoi("1") == 1);
-    TEST_CHECK(my_atoi("-1") == -1);
-    TEST_CHECK(my_atoi("+1") == 1);
-    TEST_CHECK(my_atoi("0") == 0);
-    TEST_CHECK(my_atoi("-0") == 0);
-    TEST_CHECK(my_atoi("+0") == 0);
+    TEST_CHECK(my_atoi_str("1") == 1);
+    TEST_CHECK(my_atoi_str("-1") == -1);
+    TEST_CHECK(my_atoi_str("+1") == 1);
+    TEST_CHECK(my_atoi_str("0") == 0);
+    TEST_CHECK(my_atoi_str("-0") == 0);
+    TEST_CHECK(my_atoi_str("+0") == 0);
+
+    // Digits past the end pointer should be ignored.
+    {
+        const char * test_string = "1234";
+        TEST_CHECK(my_atoi(test_string, test_string + 2) == 12);
+    }
 }
 
 void test_fix_index(void)
@@ -223,7 +376,7 @@ void test_parseRawTriple()
         // Return value for empty string should give an index value of 0, and
         // uninitialised normal and texture coordinates.
         const char * test_string = "";
-        tinyobj_vertex_index_t result = parseRawTriple(&test_string);
+        tinyobj_vertex_index_t result = parseRawTriple(&test_string, test_string + strlen(test_string));
         TEST_CHECK(result.v_idx == 0);
         TEST_CHECK(result.vn_idx == 0x80000000);
         TEST_CHECK(result.vt_idx == 0x80000000);
@@ -233,7 +386,7 @@ void test_parseRawTriple()
         // Return value for a single number should return a vertex index value
         // of that number.
         const char * test_string = "3";
-        tinyobj_vertex_index_t result = parseRawTriple(&test_string);
+        tinyobj_vertex_index_t result = parseRawTriple(&test_string, test_string + strlen(test_string));
         TEST_CHECK(result.v_idx == 3);
         TEST_CHECK(result.vn_idx == 0x80000000);
         TEST_CHECK(result.vt_idx == 0x80000000);
@@ -243,7 +396,7 @@ void test_parseRawTriple()
         // Return value for two sequential numbers should return a vertex and
         // texture index value of those numbers.
         const char * test_string = "1/2";
-        tinyobj_vertex_index_t result = parseRawTriple(&test_string);
+        tinyobj_vertex_index_t result = parseRawTriple(&test_string, test_string + strlen(test_string));
         TEST_CHECK(result.v_idx == 1);
         TEST_CHECK(result.vt_idx == 2);
     }
@@ -252,7 +405,7 @@ void test_parseRawTriple()
         // Return value for three numbers should return an index value, texture
         // coordinate and a normal value of those numbers.
         const char * test_string = "1/2/3";
-        tinyobj_vertex_index_t result = parseRawTriple(&test_string);
+        tinyobj_vertex_index_t result = parseRawTriple(&test_string, test_string + strlen(test_string));
         TEST_CHECK(result.v_idx == 1);
         TEST_CHECK(result.vt_idx == 2);
         TEST_CHECK(result.vn_idx == 3);
@@ -263,7 +416,7 @@ void test_parseRawTriple()
         // Return value for two split numbers should return a vertex and normal index
         // value of those numbers.
         const char * test_string = "1//3";
-        tinyobj_vertex_index_t result = parseRawTriple(&test_string);
+        tinyobj_vertex_index_t result = parseRawTriple(&test_string, test_string + strlen(test_string));
         TEST_CHECK(result.v_idx == 1);
         TEST_CHECK(result.vt_idx == 0x80000000);
         TEST_CHECK(result.vn_idx == 3);
@@ -278,48 +431,49 @@ void test_parseInt()
         // TODO: Should this error on empty string?
         // Return value for empty string should be integer 0.
         const char * test_string = "";
-        TEST_CHECK(parseInt(&test_string) == 0);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == 0);
     }
 
     {
         // Return value for string 0 should be integer 0.
         const char * test_string = "0";
-        TEST_CHECK(parseInt(&test_string) == 0);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == 0);
     }
 
 
     {
         // Return value for string +0 should be integer 0.
         const char * test_string = "+0";
-        TEST_CHECK(parseInt(&test_string) == 0);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == 0);
     }
 
     {
         // Return value for string -0 should be integer 0.
         const char * test_string = "-0";
-        TEST_CHECK(parseInt(&test_string) == 0);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == 0);
     }
 
     {
         // Return value for string 1 should be integer 1.
         const char * test_string = "1";
-        TEST_CHECK(parseInt(&test_string) == 1);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == 1);
     }
 
 
     {
         // Return value for string +1 should be integer 1.
         const char * test_string = "+1";
-        TEST_CHECK(parseInt(&test_string) == 1);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == 1);
     }
 
     {
         // Return value for string -1 should be integer -1.
         const char * test_string = "-1";
-        TEST_CHECK(parseInt(&test_string) == -1);
+        TEST_CHECK(parseInt(&test_string, test_string + strlen(test_string)) == -1);
     }
 }
 
+#ifdef TINYOBJ_LEGACY_FLOAT_PARSER
 void test_tryParseDouble(void)
 {
     // Empty string
@@ -518,6 +672,206 @@ void test_tryParseDouble(void)
         TEST_CHECK(result == 12.0);
     }
 }
+#endif
+
+static int parse_float_str(const char *s, float *result)
+{
+    return tinyobj_parse_float(s, s + strlen(s), result) != NULL;
+}
+
+static int same_float(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+void test_tinyobj_parse_float(void)
+{
+    float result = 0.0f;
+
+    // Invalid input should fail.
+    TEST_CHECK(!parse_float_str("", &result));
+    TEST_CHECK(!parse_float_str("-", &result));
+    TEST_CHECK(!parse_float_str(".", &result));
+    TEST_CHECK(!parse_float_str("e5", &result));
+    TEST_CHECK(!parse_float_str("1e", &result));
+    TEST_CHECK(!parse_float_str("1e+", &result));
+
+    TEST_CHECK(parse_float_str("0", &result) && same_float(result, 0.0f));
+    TEST_CHECK(parse_float_str("-0", &result) && same_float(result, -0.0f));
+    TEST_CHECK(parse_float_str("+1.25", &result) && result == 1.25f);
+    TEST_CHECK(parse_float_str("-1.25", &result) && result == -1.25f);
+    TEST_CHECK(parse_float_str("1.", &result) && result == 1.0f);
+    TEST_CHECK(parse_float_str(".5", &result) && result == 0.5f);
+    TEST_CHECK(parse_float_str("1.024E3", &result) && result == 1024.0f);
+    TEST_CHECK(parse_float_str("1e-03", &result) && result == 0.001f);
+    TEST_CHECK(parse_float_str("0.1", &result) && result == 0.1f);
+    TEST_CHECK(parse_float_str("3.14159265358979", &result) && result == 3.14159265358979f);
+
+    // Ties round to even.
+    TEST_CHECK(parse_float_str("16777217", &result) && result == 16777216.0f);
+    TEST_CHECK(parse_float_str("16777219", &result) && result == 16777220.0f);
+
+    // Limits: subnormals, underflow and overflow.
+    TEST_CHECK(parse_float_str("1.4e-45", &result) && result == 1.4e-45f);
+    TEST_CHECK(parse_float_str("7e-46", &result) && result == 0.0f);
+    TEST_CHECK(parse_float_str("7.1e-46", &result) && result == 1.4e-45f);
+    TEST_CHECK(parse_float_str("1.17549435e-38", &result) && result == 1.17549435e-38f);
+    TEST_CHECK(parse_float_str("3.4028235e38", &result) && result == 3.4028235e38f);
+    TEST_CHECK(parse_float_str("3.5e38", &result) && result == HUGE_VALF);
+    TEST_CHECK(parse_float_str("-1e99999", &result) && result == -HUGE_VALF);
+    TEST_CHECK(parse_float_str("1e-99999", &result) && result == 0.0f);
+
+    // More than 19 significant digits.
+    TEST_CHECK(parse_float_str("0.000000000000000000000000000001234567890123456789012345", &result) && result == 1.234567890123456789012345e-30f);
+    TEST_CHECK(parse_float_str("16777217.000000000000000000000000001", &result) && result == 16777218.0f);
+    TEST_CHECK(parse_float_str("16777216.999999999999999999999999999", &result) && result == 16777216.0f);
+
+    // Parsing should stop at s_end.
+    {
+        const char * test_string = "1.25e3";
+        TEST_CHECK(tinyobj_parse_float(test_string, test_string + 4, &result) == test_string + 4 && result == 1.25f);
+    }
+}
+
+static int check_against_strtof(const char *s)
+{
+    float expected = strtof(s, NULL);
+    float result = 0.0f;
+    if (!parse_float_str(s, &result) || !same_float(result, expected)) {
+        TEST_CHECK_(0, "tinyobj_parse_float(\"%s\") == strtof", s);
+        TEST_MSG("expected %.9g, got %.9g", expected, result);
+        return 0;
+    }
+    return 1;
+}
+
+// Compares with strtof over float bit patterns printed in several formats,
+// halfway points between neighbouring floats, and random digit strings.
+// Every float is checked when TINYOBJ_FLOAT_TEST_STRIDE=1 is set in the
+// environment(this takes hours).
+void test_tinyobj_parse_float_accuracy(void)
+{
+    static const char *formats[] = { "%.9g", "%.6g", "%.8e", "%.1f" };
+    const char *stride_env = getenv("TINYOBJ_FLOAT_TEST_STRIDE");
+    unsigned long long stride = stride_env ? strtoull(stride_env, NULL, 10) : 9973;
+    unsigned long long bits;
+    unsigned int seed = 12345;
+    char buf[512];
+    int i, failures = 0;
+
+    if (stride == 0) stride = 1;
+
+    for (bits = 0; bits < 0x7F800000ull && failures < 10; bits += stride) {
+        uint32_t b = (uint32_t)bits;
+        float f, next;
+        size_t k;
+        memcpy(&f, &b, sizeof(float));
+        b++;
+        memcpy(&next, &b, sizeof(float));
+
+        for (k = 0; k < sizeof(formats) / sizeof(formats[0]); k++) {
+            if (k == 3 && f > 1e30f) continue;
+            snprintf(buf, sizeof(buf), formats[k], (double)f);
+            failures += !check_against_strtof(buf);
+        }
+
+        // The exact halfway point needs many digits and hits the slow path.
+        snprintf(buf, sizeof(buf), "%.80e", ((double)f + (double)next) / 2.0);
+        failures += !check_against_strtof(buf);
+        snprintf(buf, sizeof(buf), "-%.80e1", ((double)f + (double)next) / 2.0);
+        failures += !check_against_strtof(buf);
+    }
+
+    for (i = 0; i < 200000 && failures < 10; i++) {
+        int num_digits = 1 + (int)((seed = seed * 1103515245u + 12345u) >> 16) % 40;
+        int dot = (int)((seed = seed * 1103515245u + 12345u) >> 16) % (num_digits + 1);
+        int exponent = (int)((seed = seed * 1103515245u + 12345u) >> 16) % 100 - 50;
+        int pos = 0, d;
+        for (d = 0; d < num_digits; d++) {
+            if (d == dot) buf[pos++] = '.';
+            buf[pos++] = (char)('0' + ((seed = seed * 1103515245u + 12345u) >> 16) % 10);
+        }
+        snprintf(buf + pos, sizeof(buf) - (size_t)pos, "e%d", exponent);
+        failures += !check_against_strtof(buf);
+    }
+}
+
+#ifdef TINYOBJ_LEGACY_FLOAT_PARSER
+// Distance in floats between a and b(of the same sign).
+static uint32_t float_ulps(float a, float b)
+{
+    uint32_t x, y;
+    memcpy(&x, &a, sizeof(float));
+    memcpy(&y, &b, sizeof(float));
+    x &= 0x7FFFFFFFu;
+    y &= 0x7FFFFFFFu;
+    return (x > y) ? x - y : y - x;
+}
+
+// The legacy parser and tinyobj_parse_float must accept and reject the same
+// inputs and agree to within one float, as the legacy parser rounds twice.
+static int check_float_parsers_agree(const char *s)
+{
+    const char *s_end = s + strlen(s);
+    double legacy = 0.0;
+    float result = 0.0f;
+    int legacy_ok = tryParseDouble(s, s_end, &legacy);
+    const char *end = tinyobj_parse_float(s, s_end, &result);
+
+    if (legacy_ok != (end == s_end)) {
+        TEST_CHECK_(0, "both parsers accept \"%s\"", s);
+        TEST_MSG("legacy %d, tinyobj_parse_float %d", legacy_ok, end == s_end);
+        return 0;
+    }
+    if (legacy_ok && (signbit((float)legacy) != signbit(result) ||
+                      float_ulps((float)legacy, result) > 1)) {
+        TEST_CHECK_(0, "both parsers agree on \"%s\"", s);
+        TEST_MSG("legacy %.9g, tinyobj_parse_float %.9g", (double)(float)legacy,
+                 (double)result);
+        return 0;
+    }
+    return 1;
+}
+
+void test_float_parsers_agree(void)
+{
+    static const char *inputs[] = {
+        "0", "-0", "+0.0", "1", "-1", "0.1", "0.2", "0.3", "3.14159", "-2.5E-3",
+        "+7.0e+2", "1e10", "1e-10", "1e38", "3.4028234e38", "1.17549435e-38",
+        "16777216", "16777217", "123456789", "0.000001", "1.", "11e2", "-0.0E-3",
+        "", "-", "+", "e5", "1e", "1e+", "abc"
+    };
+    unsigned int seed = 4242;
+    char buf[64];
+    size_t i;
+    int failures = 0;
+
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        failures += !check_float_parsers_agree(inputs[i]);
+    }
+
+    // Numbers as they appear in .obj files: a few integer and fraction
+    // digits, sometimes with an exponent.
+    for (i = 0; i < 100000 && failures < 10; i++) {
+        int int_digits = 1 + (int)((seed = seed * 1103515245u + 12345u) >> 16) % 6;
+        int frac_digits = (int)((seed = seed * 1103515245u + 12345u) >> 16) % 8;
+        int exponent = (int)((seed = seed * 1103515245u + 12345u) >> 16) % 41 - 20;
+        int with_exponent = ((seed = seed * 1103515245u + 12345u) >> 16) % 4 == 0;
+        int pos = 0, d;
+
+        if (((seed = seed * 1103515245u + 12345u) >> 16) % 2) buf[pos++] = '-';
+        for (d = 0; d < int_digits + frac_digits; d++) {
+            if (d == int_digits) buf[pos++] = '.';
+            buf[pos++] = (char)('0' + ((seed = seed * 1103515245u + 12345u) >> 16) % 10);
+        }
+        buf[pos] = '\0';
+        if (with_exponent) {
+            snprintf(buf + pos, sizeof(buf) - (size_t)pos, "e%d", exponent);
+        }
+        failures += !check_float_parsers_agree(buf);
+    }
+}
+#endif
 
 void test_parseFloat(void)
 {
@@ -525,7 +879,7 @@ void test_parseFloat(void)
     {
         // Return value for empty string should be float 0.
         const char * test_string = "";
-        TEST_CHECK(parseFloat(&test_string) == 0.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 0.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
@@ -533,28 +887,28 @@ void test_parseFloat(void)
     {
         // Return value for string 0 should be float 0.
         const char * test_string = "0";
-        TEST_CHECK(parseFloat(&test_string) == 0.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 0.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string +0 should be float 0.
         const char * test_string = "+0";
-        TEST_CHECK(parseFloat(&test_string) == 0.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 0.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string -0 should be float 0.
         const char * test_string = "-0";
-        TEST_CHECK(parseFloat(&test_string) == 0.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 0.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string 0.0 should be float 0.
         const char * test_string = "0.0";
-        TEST_CHECK(parseFloat(&test_string) == 0.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 0.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
@@ -562,28 +916,28 @@ void test_parseFloat(void)
     {
         // Return value for string 1 should be float 1.
         const char * test_string = "1";
-        TEST_CHECK(parseFloat(&test_string) == 1.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string +1 should be float 1.
         const char * test_string = "+1";
-        TEST_CHECK(parseFloat(&test_string) == 1.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string -1 should be float -1.
         const char * test_string = "-1";
-        TEST_CHECK(parseFloat(&test_string) == -1.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == -1.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string 1.0 should be float 1.
         const char * test_string = "1.0";
-        TEST_CHECK(parseFloat(&test_string) == 1.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
@@ -592,21 +946,21 @@ void test_parseFloat(void)
     {
         // Return value for string 1.25 should be float 1.25.
         const char * test_string = "1.25";
-        TEST_CHECK(parseFloat(&test_string) == 1.25);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1.25);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string +1.25 should be float 1.25.
         const char * test_string = "+1.25";
-        TEST_CHECK(parseFloat(&test_string) == 1.25);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1.25);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string -1.25 should be float -1.25.
         const char * test_string = "-1.25";
-        TEST_CHECK(parseFloat(&test_string) == -1.25);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == -1.25);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
@@ -614,28 +968,28 @@ void test_parseFloat(void)
     {
         // Return value for string 1e6 should be float 1_000_000.
         const char * test_string = "1e6";
-        TEST_CHECK(parseFloat(&test_string) == 1000000.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1000000.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string 1E6 should be float 1_000_000.
         const char * test_string = "1E6";
-        TEST_CHECK(parseFloat(&test_string) == 1000000.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1000000.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string 1.024e3 should be float 1_024.
         const char * test_string = "1.024e3";
-        TEST_CHECK(parseFloat(&test_string) == 1024.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1024.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
     {
         // Return value for string 1.024E3 should be float 1_024.
         const char * test_string = "1.024E3";
-        TEST_CHECK(parseFloat(&test_string) == 1024.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 1024.0);
         TEST_CHECK(strlen(test_string) == 0);
     }
 
@@ -643,7 +997,7 @@ void test_parseFloat(void)
         // TODO: Negative exponents do not work.
         // Return value for string 1e-3 should be float 0.001.
         // const char * test_string = "1e-3";
-        // TEST_CHECK(parseFloat(&test_string) == 0.001);
+        // TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 0.001);
         // TEST_CHECK(strlen(test_string) == 0);
     }
 
@@ -651,9 +1005,17 @@ void test_parseFloat(void)
     {
         // Return value for string 12 3 should be float 12.
         const char * test_string = "12 3";
-        TEST_CHECK(parseFloat(&test_string) == 12.0);
+        TEST_CHECK(parseFloat(&test_string, test_string + strlen(test_string)) == 12.0);
         TEST_CHECK(strcmp(test_string, " 3") == 0);
     }
+
+    {
+        // Parsing should stop at the end pointer when the string is not
+        // terminated there. Return value for "1.25" limited to "1.2" is 1.2.
+        const char * test_string = "1.25 3";
+        TEST_CHECK(parseFloat(&test_string, test_string + 3) == 1.2f);
+        TEST_CHECK(strcmp(test_string, "5 3") == 0);
+    }
 }
 
 void test_parseFloat2(void)
@@ -661,7 +1023,7 @@ void test_parseFloat2(void)
     // Simple test - this only calls parseFloat.
     float x, y;
     const char * test_string = "3.0 -2e3";
-    parseFloat2(&x, &y, &test_string);
+    parseFloat2(&x, &y, &test_string, test_string + strlen(test_string));
     TEST_CHECK(x == 3.0);
     TEST_CHECK(y == -2000.0);
     TEST_CHECK(strlen(test_string) == 0);
@@ -672,7 +1034,7 @@ void test_parseFloat3(void)
     // Simple test - this only calls parseFloat.
     float x, y, z;
     const char * test_string = "3.0 -2e3 1";
-    parseFloat3(&x, &y, &z, &test_string);
+    parseFloat3(&x, &y, &z, &test_string, test_string + strlen(test_string));
     TEST_CHECK(x == 3.0);
     TEST_CHECK(y == -2000.0);
     TEST_CHECK(z == 1.0);
@@ -685,7 +1047,7 @@ void test_my_strdup(void)
         // Return value for a regular string should be a new string whose
         // contents are equal to the original.
         char * test_string = "potato";
-        char * result = my_strdup(test_string, strlen(test_string));
+        char * result = my_strdup(test_string, strlen(test_string), NULL);
         TEST_CHECK(test_string != result);
         TEST_CHECK(strcmp(test_string, result) == 0);
         free(result);
@@ -694,7 +1056,7 @@ void test_my_strdup(void)
     {
         // Return value for empty string should be a new empty string.
         char * test_string = "";
-        char * result = my_strdup(test_string, strlen(test_string));
+        char * result = my_strdup(test_string, strlen(test_string), NULL);
         TEST_CHECK(test_string != result);
         TEST_CHECK(strcmp(test_string, result) == 0);
         free(result);
@@ -707,7 +1069,7 @@ void test_my_strndup(void)
         // Return value for a regular string and the length of that string should be a new
         // string whose contents are equal to the original.
         char * test_string = "potato";
-        char * result = my_strndup(test_string, 6);
+        char * result = my_strndup(test_string, 6, NULL);
         TEST_CHECK(test_string != result);
         TEST_CHECK(strcmp(test_string, result) == 0);
         free(result);
@@ -716,11 +1078,55 @@ void test_my_strndup(void)
     {
         // Return value for a regular string and zero should be a new empty string.
         char * test_string = "potato";
-        char * result = my_strndup(test_string, 0);
+        char * result = my_strndup(test_string, 0, NULL);
         TEST_CHECK(result == 0);
     }
 }
 
+void test_arena(void)
+{
+    tinyobj_arena_t arena;
+    tinyobj_arena_init(&arena, 64);
+
+    {
+        // Allocations are aligned and do not overlap.
+        char *a = (char *)tinyobj_alloc(&arena, 3);
+        char *b = (char *)tinyobj_alloc(&arena, 5);
+        TEST_CHECK(((size_t)a % 16) == 0);
+        TEST_CHECK(((size_t)b % 16) == 0);
+        TEST_CHECK(b >= a + 3);
+    }
+
+    {
+        // The latest allocation grows in place while the block has room,
+        // and is copied to a new block when it does not.
+        char *a = (char *)tinyobj_alloc(&arena, 4);
+        char *b;
+        memcpy(a, "abc", 4);
+        b = (char *)tinyobj_realloc(&arena, a, 4, 16);
+        TEST_CHECK(a == b);
+        b = (char *)tinyobj_realloc(&arena, b, 16, 200);
+        TEST_CHECK(b != a);
+        TEST_CHECK(strcmp(b, "abc") == 0);
+    }
+
+    {
+        // Popping the latest allocation makes its space reusable.
+        char *a = (char *)tinyobj_alloc(&arena, 8);
+        tinyobj_free(&arena, a, 8);
+        TEST_CHECK(tinyobj_alloc(&arena, 8) == a);
+    }
+
+    {
+        // Strings can be duplicated into the arena.
+        char *s = my_strndup("potato", 6, &arena);
+        TEST_CHECK(strcmp(s, "potato") == 0);
+    }
+
+    tinyobj_arena_free(&arena);
+    TEST_CHECK(arena.block == NULL);
+}
+
 void test_initMaterial(void)
 {
     // Initialised material should have expected defaults.
@@ -754,8 +1160,7 @@ void test_create_hash_table(void)
         // Initialised hash table should be initialised with a default capacity.
         hash_table_t table;
         create_hash_table(0, &table);
-        TEST_CHECK(table.hashes != NULL);
-        TEST_CHECK(table.entries != NULL);
+        TEST_CHECK(table.slots != NULL);
         TEST_CHECK(table.capacity == HASH_TABLE_DEFAULT_SIZE);
         TEST_CHECK(table.n == 0);
         destroy_hash_table(&table);
@@ -765,14 +1170,29 @@ void test_create_hash_table(void)
         // Initialised hash table should be initialised with supplied capacity.
         hash_table_t table;
         create_hash_table(20, &table);
-        TEST_CHECK(table.hashes != NULL);
-        TEST_CHECK(table.entries != NULL);
+        TEST_CHECK(table.slots != NULL);
         TEST_CHECK(table.capacity == 20);
         TEST_CHECK(table.n == 0);
         destroy_hash_table(&table);
     }
 }
 
+static int set(hash_table_t *table, const char *name, size_t val)
+{
+    return hash_table_set(name, strlen(name), val, table);
+}
+
+static long get_n(hash_table_t *table, const char *name, size_t len)
+{
+    hash_table_entry_t *entry = hash_table_find(name, len, hash_djb2(name, len), table);
+    return entry ? entry->value : -1;
+}
+
+static long get(hash_table_t *table, const char *name)
+{
+    return get_n(table, name, strlen(name));
+}
+
 void test_hash_table_set(void)
 {
     {
@@ -785,24 +1205,22 @@ void test_hash_table_set(void)
 
         create_hash_table(20, &table);
 
-        TEST_CHECK(table.hashes != NULL);
-        TEST_CHECK(table.entries != NULL);
+        TEST_CHECK(table.slots != NULL);
         TEST_CHECK(table.capacity == 20);
         TEST_CHECK(table.n == 0);
 
-        hash_table_set("potato", 3, &table);
-        hash_table_set("monkey", 8, &table);
+        TEST_CHECK(set(&table, "potato", 3) == HASH_TABLE_SUCCESS);
+        TEST_CHECK(set(&table, "monkey", 8) == HASH_TABLE_SUCCESS);
 
         TEST_CHECK(table.n == 2);
 
         for (i = 0; i < table.capacity; ++i) {
-            hash_table_entry_t n = table.entries[i];
-            if (n.value == 3) {
+            if (table.slots[i] == 0) {
+                foundOther++;
+            } else if (table.entries[table.slots[i] - 1].value == 3) {
                 foundFirst++;
-            } else if (n.value == 8) {
+            } else if (table.entries[table.slots[i] - 1].value == 8) {
                 foundSecond++;
-            } else {
-                foundOther++;
             }
         }
 
@@ -817,120 +1235,87 @@ void test_hash_table_set(void)
         // Values with different hashes but same % capacity value should exist in the
         // the same hash table.
         hash_table_t table;
-        int foundFirst = 0;
-        int foundSecond = 0;
-        int foundOther = 0;
-        int i;
 
         create_hash_table(20, &table);
 
-        TEST_CHECK(table.hashes != NULL);
-        TEST_CHECK(table.entries != NULL);
-        TEST_CHECK(table.capacity == 20);
-        TEST_CHECK(table.n == 0);
-
         // hashes are different but % 20 value is the same - they will end up in the same bucket
-        hash_table_set("potato", 3, &table); // hash 356168476
-        hash_table_set("potat[", 3, &table); // hash 356168456
+        set(&table, "potato", 3); // hash 356168476
+        set(&table, "potat[", 4); // hash 356168456
 
         // hashes are different but % 20 value is the same - they will end up in the same bucket
-        hash_table_set("monkey", 8, &table); // hash 238557080
-        hash_table_set("monkee", 8, &table); // hash 238557060
+        set(&table, "monkey", 8); // hash 238557080
+        set(&table, "monkee", 9); // hash 238557060
 
         TEST_CHECK(table.n == 4);
-
-        for (i = 0; i < table.capacity; ++i) {
-            if ((table.entries + i)->value == 3) {
-                foundFirst++;
-            } else if ((table.entries + i)->value == 8) {
-                foundSecond++;
-            } else {
-                foundOther++;
-            }
-        }
-
-        TEST_CHECK(foundFirst == 2);
-        TEST_CHECK(foundSecond == 2);
-        TEST_CHECK(foundOther == 16);
+        TEST_CHECK(get(&table, "potato") == 3);
+        TEST_CHECK(get(&table, "potat[") == 4);
+        TEST_CHECK(get(&table, "monkey") == 8);
+        TEST_CHECK(get(&table, "monkee") == 9);
 
         destroy_hash_table(&table);
     }
 
     {
-        // TODO: This fails. Should the key also be stored in the entry so it can be compared
-        // with the key being inserted?
         // Values with identical hashes but different keys should exist in the same hash table.
         hash_table_t table;
-        int foundFirst = 0;
-        int foundSecond = 0;
-        int foundOther = 0;
-        int i;
 
         create_hash_table(20, &table);
 
-        TEST_CHECK(table.hashes != NULL);
-        TEST_CHECK(table.entries != NULL);
-        TEST_CHECK(table.capacity == 20);
-        TEST_CHECK(table.n == 0);
-
-        hash_table_set("potato", 3, &table); // hash 356168476
-        hash_table_set("potbSo", 3, &table); // hash 356168476 (identical)
+        TEST_CHECK(hash_djb2("potato", 6) == hash_djb2("potbSo", 6));
+        TEST_CHECK(hash_djb2("monkey", 6) == hash_djb2("monkfX", 6));
 
-        hash_table_set("monkey", 8, &table); // hash 238557080
-        hash_table_set("monkfX", 8, &table); // hash 238557080 (identical)
+        set(&table, "potato", 3);
+        set(&table, "potbSo", 4);
 
-        // TEST_CHECK(table.n == 4);
-
-        for (i = 0; i < table.capacity; ++i) {
-            hash_table_entry_t n = table.entries[i];
-            if (n.value == 3) {
-                foundFirst++;
-            } else if (n.value == 8) {
-                foundSecond++;
-            } else {
-                foundOther++;
-            }
-        }
+        set(&table, "monkey", 8);
+        set(&table, "monkfX", 9);
 
-        // TEST_CHECK(foundFirst == 2);
-        // TEST_CHECK(foundSecond == 2);
-        // TEST_CHECK(foundOther == 16);
+        TEST_CHECK(table.n == 4);
+        TEST_CHECK(get(&table, "potato") == 3);
+        TEST_CHECK(get(&table, "potbSo") == 4);
+        TEST_CHECK(get(&table, "monkey") == 8);
+        TEST_CHECK(get(&table, "monkfX") == 9);
 
         destroy_hash_table(&table);
     }
-}
 
-void test_hash_table_exists(void)
-{
-    // It should be possible to test for the presence of items in the hash table.
-    hash_table_t table;
-    create_hash_table(20, &table);
+    {
+        // Setting an existing key should replace its value.
+        hash_table_t table;
 
-    hash_table_set("potato", 3, &table);
-    hash_table_set("monkey", 8, &table);
+        create_hash_table(20, &table);
 
-    TEST_CHECK(hash_table_exists("potato", &table));
-    TEST_CHECK(hash_table_exists("monkey", &table));
-    TEST_CHECK(!hash_table_exists("radio", &table));
+        set(&table, "potato", 3);
+        set(&table, "potato", 5);
 
-    destroy_hash_table(&table);
+        TEST_CHECK(table.n == 1);
+        TEST_CHECK(get(&table, "potato") == 5);
+
+        destroy_hash_table(&table);
+    }
 }
 
-void test_hash_table_get(void)
+void test_hash_table_find(void)
 {
     // It should be possible to retrieve item values from the hash table.
     hash_table_t table;
+    const char *line = "usemtl potato \n";
     create_hash_table(20, &table);
 
-    hash_table_set("potato", 3, &table);
-    hash_table_set("monkey", 8, &table);
+    set(&table, "potato", 3);
+    set(&table, "monkey", 8);
+
+    TEST_CHECK(get(&table, "potato") == 3);
+    TEST_CHECK(get(&table, "monkey") == 8);
 
-    TEST_CHECK(hash_table_get("potato", &table) == 3);
-    TEST_CHECK(hash_table_get("monkey", &table) == 8);
+    // Missing keys, including prefixes and extensions of stored keys, give -1.
+    TEST_CHECK(get(&table, "radio") == -1);
+    TEST_CHECK(get(&table, "potat") == -1);
+    TEST_CHECK(get(&table, "potatoes") == -1);
+    TEST_CHECK(get(&table, "") == -1);
 
-    // TODO: the value returned by hash_table_get can be from a null pointer.
-    // A default sentinel value could be returned instead e.g. -(2^30)
-    // TEST_CHECK(hash_table_get("radio", &table) == -(2 << 30));
+    // Keys need not be null terminated.
+    TEST_CHECK(get_n(&table, line + 7, 6) == 3);
 
     destroy_hash_table(&table);
 }
@@ -941,57 +1326,164 @@ void test_hash_table_grow(void)
     hash_table_t table;
     create_hash_table(10, &table);
 
-    hash_table_set("Pottery_clay0", 0, &table);
-    hash_table_set("Dark_smoked_gla0", 1, &table);
-    hash_table_set("Pottery_clay1", 2, &table);
-    hash_table_set("Dark_smoked_gla1", 3, &table);
-    hash_table_set("Metallic_Varni0", 4, &table);
-    hash_table_set("Body0", 5, &table);
-    hash_table_set("Pottery_clay2", 6, &table);
-    hash_table_set("850matri0", 7, &table);
-    hash_table_set("850matri1", 8, &table);
-    hash_table_set("Pottery_clay3", 9, &table);
-    hash_table_set("Pottery_clay4", 10, &table);
+    set(&table, "Pottery_clay0", 0);
+    set(&table, "Dark_smoked_gla0", 1);
+    set(&table, "Pottery_clay1", 2);
+    set(&table, "Dark_smoked_gla1", 3);
+    set(&table, "Metallic_Varni0", 4);
+    set(&table, "Body0", 5);
+    set(&table, "Pottery_clay2", 6);
+    set(&table, "850matri0", 7);
+    set(&table, "850matri1", 8);
+    set(&table, "Pottery_clay3", 9);
+    set(&table, "Pottery_clay4", 10);
 
     TEST_CHECK(table.capacity > 10);
     TEST_CHECK(table.n == 11);
 
-    TEST_CHECK(hash_table_get("Pottery_clay0", &table) == 0);
-    TEST_CHECK(hash_table_get("Dark_smoked_gla0", &table) == 1);
-    TEST_CHECK(hash_table_get("Pottery_clay1", &table) == 2);
-    TEST_CHECK(hash_table_get("Dark_smoked_gla1", &table) == 3);
-    TEST_CHECK(hash_table_get("Metallic_Varni0", &table) == 4);
-    TEST_CHECK(hash_table_get("Body0", &table) == 5);
-    TEST_CHECK(hash_table_get("Pottery_clay2", &table) == 6);
-    TEST_CHECK(hash_table_get("850matri0", &table) == 7);
-    TEST_CHECK(hash_table_get("850matri1", &table) == 8);
-    TEST_CHECK(hash_table_get("Pottery_clay3", &table) == 9);
-    TEST_CHECK(hash_table_get("Pottery_clay4", &table) == 10);
+    TEST_CHECK(get(&table, "Pottery_clay0") == 0);
+    TEST_CHECK(get(&table, "Dark_smoked_gla0") == 1);
+    TEST_CHECK(get(&table, "Pottery_clay1") == 2);
+    TEST_CHECK(get(&table, "Dark_smoked_gla1") == 3);
+    TEST_CHECK(get(&table, "Metallic_Varni0") == 4);
+    TEST_CHECK(get(&table, "Body0") == 5);
+    TEST_CHECK(get(&table, "Pottery_clay2") == 6);
+    TEST_CHECK(get(&table, "850matri0") == 7);
+    TEST_CHECK(get(&table, "850matri1") == 8);
+    TEST_CHECK(get(&table, "Pottery_clay3") == 9);
+    TEST_CHECK(get(&table, "Pottery_clay4") == 10);
+
+    destroy_hash_table(&table);
+}
+
+void test_find_material_id(void)
+{
+    // Repeated lookups should hit the memo, and a different name should not.
+    hash_table_t table;
+    size_t last_hit = 0;
+    create_hash_table(0, &table);
+
+    set(&table, "potato", 3);
+    set(&table, "potbSo", 4); // same hash as "potato"
+
+    TEST_CHECK(find_material_id(&table, "potato", 6, &last_hit) == 3);
+    TEST_CHECK(last_hit != 0);
+    TEST_CHECK(find_material_id(&table, "potato", 6, &last_hit) == 3);
+    TEST_CHECK(find_material_id(&table, "potbSo", 6, &last_hit) == 4);
+    TEST_CHECK(find_material_id(&table, "pot", 3, &last_hit) == -1);
+    TEST_CHECK(find_material_id(&table, "potbSo", 6, &last_hit) == 4);
+    TEST_CHECK(find_material_id(&table, "potato", 6, &last_hit) == 3);
 
     destroy_hash_table(&table);
 }
 
+static const char *oom_obj =
+    "mtllib oom.mtl\n"
+    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+    "vt 0 0\nvt 1 1\nvn 0 0 1\n"
+    "o first\n"
+    "usemtl red\n"
+    "f 1/1/1 2/2/1 3/1/1 4/2/1\n"
+    "g second\n"
+    "usemtl green\n"
+    "f 1 2 3\n";
+
+static const char *oom_mtl =
+    "newmtl red\nKd 1 0 0\nmap_Kd red.png\n"
+    "newmtl green\nKd 0 1 0\nmap_Kd green.png\nmap_Ks green.png\n";
+
+static void oom_reader(void *ctx, const char *filename, int is_mtl,
+                       const char *obj_filename, char **buf, size_t *len)
+{
+    const char *text = is_mtl ? oom_mtl : oom_obj;
+    (void)ctx;
+    (void)filename;
+    (void)obj_filename;
+    *buf = (char *)text;
+    *len = strlen(text);
+}
+
+void test_parse_obj_out_of_memory(void)
+{
+    // Fail each allocation of tinyobj_parse_obj in turn. Every failure must
+    // return TINYOBJ_ERROR_MEMORY with empty outputs(and leak nothing under
+    // a leak checker), until the budget is large enough to succeed.
+    static const unsigned int flag_sets[] = {
+        0,
+        TINYOBJ_FLAG_TRIANGULATE,
+        TINYOBJ_FLAG_SOA_INDICES,
+        TINYOBJ_FLAG_QUANTIZE_POSITIONS | TINYOBJ_FLAG_QUANTIZE_NORMALS |
+            TINYOBJ_FLAG_QUANTIZE_TEXCOORDS
+    };
+    size_t f;
+
+    for (f = 0; f < sizeof(flag_sets) / sizeof(flag_sets[0]); f++) {
+        long budget;
+        int ret = TINYOBJ_ERROR_MEMORY;
+
+        for (budget = 0; budget < 1000 && ret == TINYOBJ_ERROR_MEMORY; budget++) {
+            tinyobj_attrib_t attrib;
+            tinyobj_shape_t *shapes = NULL;
+            size_t num_shapes = 0;
+            tinyobj_material_t *materials = NULL;
+            size_t num_materials = 0;
+
+            alloc_budget = budget;
+            ret = tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+                                    &num_materials, "oom.obj", oom_reader, NULL,
+                                    flag_sets[f]);
+            alloc_budget = -1;
+
+            if (ret == TINYOBJ_ERROR_MEMORY) {
+                TEST_CHECK(shapes == NULL && num_shapes == 0);
+                TEST_CHECK(materials == NULL && num_materials == 0);
+                TEST_CHECK(attrib.num_vertices == 0 && attrib.num_faces == 0);
+                continue;
+            }
+            TEST_CHECK(ret == TINYOBJ_SUCCESS);
+            TEST_MSG("flags %u, budget %ld: %d", flag_sets[f], budget, ret);
+            if (ret != TINYOBJ_SUCCESS) break;
+            TEST_CHECK(num_shapes == 2);
+            TEST_CHECK(num_materials == 2);
+            TEST_CHECK(attrib.num_vertices == 4);
+            tinyobj_attrib_free(&attrib);
+            tinyobj_shapes_free(shapes, num_shapes);
+            tinyobj_materials_free(materials, num_materials);
+        }
+        TEST_CHECK(budget > 1);
+        TEST_CHECK(ret == TINYOBJ_SUCCESS);
+    }
+}
+
 TEST_LIST = {
     { "skip_space",             test_skip_space },
     { "skip_space_and_cr",      test_skip_space_and_cr },
     { "until_space",            test_until_space },
     { "length_until_newline",   test_length_until_newline },
     { "num_lines",              test_num_lines },
+    { "line_infos",             test_line_infos },
     { "my_atoi",                test_my_atoi },
     { "fix_index",              test_fix_index },
     { "parseRawTriple",         test_parseRawTriple },
     { "parseInt",               test_parseInt },
+#ifdef TINYOBJ_LEGACY_FLOAT_PARSER
     { "tryParseDouble",         test_tryParseDouble },
+    { "float_parsers_agree",    test_float_parsers_agree },
+#endif
+    { "tinyobj_parse_float",    test_tinyobj_parse_float },
+    { "tinyobj_parse_float_accuracy", test_tinyobj_parse_float_accuracy },
     { "parseFloat",             test_parseFloat },
     { "parseFloat2",            test_parseFloat2 },
     { "parseFloat3",            test_parseFloat3 },
     { "my_strdup",              test_my_strdup },
     { "my_strndup",             test_my_strndup },
+    { "arena",                  test_arena },
     { "initMaterial",           test_initMaterial },
     { "create_hash_table",      test_create_hash_table },
     { "hash_table_set",         test_hash_table_set },
-    { "hash_table_exists",      test_hash_table_exists },
-    { "hash_table_get",         test_hash_table_get },
+    { "hash_table_find",        test_hash_table_find },
     { "hash_table_grow",        test_hash_table_grow },
+    { "find_material_id",       test_find_material_id },
+    { "parse_obj_out_of_memory", test_parse_obj_out_of_memory },
     { 0 } // required by acutest
 };
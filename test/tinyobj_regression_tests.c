@@ -88,21 +88,194 @@ void test_hash_table_infinity_loop(void)
     hash_table_t table;
     create_hash_table(10, &table);
 
-    hash_table_set("bch-beach-01_png", 0, &table);
-    hash_table_set("bch-grassfringe_png", 0, &table);
-    hash_table_set("bch-leafyground-hang-2x1_png", 0, &table);
-    hash_table_set("bch-plankwood_png", 0, &table);
-    hash_table_set("bluelight_png", 0, &table);
-    hash_table_set("cmn-precursor-blue_png", 0, &table);
-    hash_table_set("cmn-precursor-circuitpattern-01_png", 0, &table);
-    hash_table_set("cmn-precursor-metal-edge-01_png", 0, &table);
+    hash_table_set("bch-beach-01_png", 16, 0, &table);
+    hash_table_set("bch-grassfringe_png", 19, 0, &table);
+    hash_table_set("bch-leafyground-hang-2x1_png", 28, 0, &table);
+    hash_table_set("bch-plankwood_png", 17, 0, &table);
+    hash_table_set("bluelight_png", 13, 0, &table);
+    hash_table_set("cmn-precursor-blue_png", 22, 0, &table);
+    hash_table_set("cmn-precursor-circuitpattern-01_png", 35, 0, &table);
+    hash_table_set("cmn-precursor-metal-edge-01_png", 31, 0, &table);
 
     destroy_hash_table(&table);
 }
 
+typedef struct {
+    const char *obj;
+    const char *mtl;
+} memory_files_t;
+
+void loadMemory(void *ctx, const char * filename, const int is_mtl, const char *obj_filename, char ** buffer, size_t * len)
+{
+    memory_files_t *files = (memory_files_t *)ctx;
+    *buffer = (char *)(is_mtl ? files->mtl : files->obj);
+    *len = strlen(*buffer);
+}
+
+void test_tinyobj_long_lines(void)
+{
+    // Lines longer than 4 KB used to trip an assert on the line buffer.
+    const size_t long_len = 10000;
+    char *obj = (char *)malloc(4 * long_len);
+    char *mtl = (char *)malloc(2 * long_len);
+    char *p;
+    size_t i;
+    memory_files_t files;
+
+    tinyobj_shape_t * shape = NULL;
+    tinyobj_material_t * material = NULL;
+    tinyobj_attrib_t attrib;
+    size_t num_shapes;
+    size_t num_materials;
+
+    p = obj;
+    p += sprintf(p, "mtllib long.mtl\n#");
+    memset(p, 'c', long_len); p += long_len;
+    p += sprintf(p, "\nv");
+    memset(p, ' ', long_len); p += long_len;
+    p += sprintf(p, "1 2 3\nv 4 5 6\nv 7 8 9\nusemtl long\nf 1");
+    memset(p, ' ', long_len); p += long_len;
+    p += sprintf(p, "2 3\n");
+
+    p = mtl;
+    p += sprintf(p, "newmtl long\nmap_Kd ");
+    for (i = 0; i < long_len; i++) *p++ = (char)('a' + (i % 26));
+    p += sprintf(p, "\n");
+
+    files.obj = obj;
+    files.mtl = mtl;
+
+    tinyobj_attrib_init(&attrib);
+
+    TEST_CHECK(tinyobj_parse_obj(&attrib, &shape, &num_shapes, &material, &num_materials, "long.obj", loadMemory, &files, 0) == TINYOBJ_SUCCESS);
+
+    TEST_CHECK(attrib.num_vertices == 3);
+    TEST_CHECK(float_equals(attrib.vertices[0], 1.0f));
+    TEST_CHECK(float_equals(attrib.vertices[2], 3.0f));
+    TEST_CHECK(attrib.num_faces == 3);
+    TEST_CHECK(attrib.faces[1].v_idx == 1);
+    TEST_CHECK(attrib.material_ids[0] == 0);
+
+    TEST_CHECK(num_materials == 1);
+    TEST_CHECK(strcmp(material[0].name, "long") == 0);
+    TEST_CHECK(strlen(material[0].diffuse_texname) == long_len);
+
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shape, num_shapes);
+    tinyobj_materials_free(material, num_materials);
+    free(obj);
+    free(mtl);
+}
+
+void test_tinyobj_large_polygons(void)
+{
+    // Faces with more than 16 vertices used to overflow fixed size buffers.
+    const size_t n = 120;
+    char *obj = (char *)malloc(32 * n);
+    char *p = obj;
+    size_t i;
+    memory_files_t files;
+    unsigned int flags;
+
+    for (i = 0; i < n; i++) p += sprintf(p, "v %lu 0 0\n", (unsigned long)i);
+    p += sprintf(p, "f");
+    for (i = 0; i < n; i++) p += sprintf(p, " %lu", (unsigned long)(i + 1));
+    p += sprintf(p, "\nf 1 2 3\n");
+
+    files.obj = obj;
+    files.mtl = "";
+
+    for (flags = 0; flags < 2; flags++) {
+        tinyobj_shape_t * shape = NULL;
+        tinyobj_material_t * material = NULL;
+        tinyobj_attrib_t attrib;
+        size_t num_shapes;
+        size_t num_materials;
+        tinyobj_parser_t *parser;
+        int triangulate = (flags == TINYOBJ_FLAG_TRIANGULATE);
+
+        TEST_CHECK(tinyobj_parse_obj(&attrib, &shape, &num_shapes, &material, &num_materials, "poly.obj", loadMemory, &files, flags) == TINYOBJ_SUCCESS);
+        if (triangulate) {
+            TEST_CHECK(attrib.num_face_num_verts == n - 2 + 1);
+            TEST_CHECK(attrib.num_faces == 3 * (n - 2) + 3);
+            TEST_CHECK(attrib.face_num_verts[n - 3] == 3);
+            TEST_CHECK(attrib.faces[3 * (n - 3) + 0].v_idx == 0);
+            TEST_CHECK(attrib.faces[3 * (n - 3) + 1].v_idx == (int)n - 2);
+            TEST_CHECK(attrib.faces[3 * (n - 3) + 2].v_idx == (int)n - 1);
+        } else {
+            TEST_CHECK(attrib.num_face_num_verts == 2);
+            TEST_CHECK(attrib.num_faces == n + 3);
+            TEST_CHECK(attrib.face_num_verts[0] == (int)n);
+            TEST_CHECK(attrib.faces[n - 1].v_idx == (int)n - 1);
+        }
+        TEST_CHECK(attrib.faces[attrib.num_faces - 1].v_idx == 2);
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shape, num_shapes);
+        tinyobj_materials_free(material, num_materials);
+
+        // The streaming parser grows its buffer while parsing.
+        parser = tinyobj_parser_create("poly.obj", NULL, NULL, flags);
+        TEST_CHECK(tinyobj_parser_feed(parser, obj, strlen(obj)) == TINYOBJ_SUCCESS);
+        TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shape, &num_shapes, &material, &num_materials) == TINYOBJ_SUCCESS);
+        TEST_CHECK(attrib.num_faces == (triangulate ? 3 * (n - 2) + 3 : n + 3));
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shape, num_shapes);
+        tinyobj_materials_free(material, num_materials);
+    }
+
+    free(obj);
+}
+
+void test_tinyobj_colliding_material_names(void)
+{
+    // "potato" and "potbSo" have the same hash and used to share a material.
+    memory_files_t files;
+    int streaming;
+
+    files.obj =
+        "mtllib m.mtl\n"
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "usemtl potbSo\nf 1 2 3\n"
+        "usemtl potato\nf 1 2 3\nf 1 2 3\n"
+        "usemtl potbSo\nf 1 2 3\n"
+        "usemtl potat\nf 1 2 3\n";
+    files.mtl = "newmtl potato\nKd 1 0 0\nnewmtl potbSo\nKd 0 1 0\n";
+
+    for (streaming = 0; streaming < 2; streaming++) {
+        tinyobj_shape_t * shape = NULL;
+        tinyobj_material_t * material = NULL;
+        tinyobj_attrib_t attrib;
+        size_t num_shapes;
+        size_t num_materials;
+
+        if (streaming) {
+            tinyobj_parser_t *parser = tinyobj_parser_create("m.obj", loadMemory, &files, 0);
+            TEST_CHECK(tinyobj_parser_feed(parser, files.obj, strlen(files.obj)) == TINYOBJ_SUCCESS);
+            TEST_CHECK(tinyobj_parser_finish(parser, &attrib, &shape, &num_shapes, &material, &num_materials) == TINYOBJ_SUCCESS);
+        } else {
+            TEST_CHECK(tinyobj_parse_obj(&attrib, &shape, &num_shapes, &material, &num_materials, "m.obj", loadMemory, &files, 0) == TINYOBJ_SUCCESS);
+        }
+
+        TEST_CHECK(num_materials == 2);
+        TEST_CHECK(attrib.num_face_num_verts == 5);
+        TEST_CHECK(attrib.material_ids[0] == 1);
+        TEST_CHECK(attrib.material_ids[1] == 0);
+        TEST_CHECK(attrib.material_ids[2] == 0);
+        TEST_CHECK(attrib.material_ids[3] == 1);
+        TEST_CHECK(attrib.material_ids[4] == -1);
+
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shape, num_shapes);
+        tinyobj_materials_free(material, num_materials);
+    }
+}
+
 TEST_LIST = {
     { "crlf_string",                test_tinyobj_crlf_string },
     { "negative_exponent_issue26",  test_tinyobj_negative_exponent },
     { "hash_table_infinity_loop",   test_hash_table_infinity_loop },
+    { "long_lines",                 test_tinyobj_long_lines },
+    { "large_polygons",             test_tinyobj_large_polygons },
+    { "colliding_material_names",   test_tinyobj_colliding_material_names },
     { 0 } // required by acutest
 };
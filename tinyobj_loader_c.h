@@ -26,6 +26,7 @@
 
 /* @todo { Remove stddef dependency. size_t? } */
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,7 +46,7 @@ typedef struct {
   /* illumination model (see http://www.fileformat.info/format/material/) */
   int illum;
 
-  int pad0;
+  int pooled_names; /* The names belong to a tinyobj_string_pool_t. */
 
   char *ambient_texname;            /* map_Ka */
   char *diffuse_texname;            /* map_Kd */
@@ -60,6 +61,8 @@ typedef struct {
   char *name; /* group name or object name. */
   unsigned int face_offset;
   unsigned int length;
+  int pooled_name; /* `name` belongs to a tinyobj_string_pool_t. */
+  int pad0;
 } tinyobj_shape_t;
 
 typedef struct { int v_idx, vt_idx, vn_idx; } tinyobj_vertex_index_t;
@@ -79,10 +82,47 @@ typedef struct {
   tinyobj_vertex_index_t *faces;
   int *face_num_verts;
   int *material_ids;
+
+  /* With TINYOBJ_FLAG_SOA_INDICES, `faces` is NULL and the indices are in
+   * separate arrays of `num_faces` elements instead. `vt_indices` and
+   * `vn_indices` are NULL when the file has no `vt` or `vn` lines. */
+  int *v_indices;
+  int *vt_indices;
+  int *vn_indices;
+
+  /* With TINYOBJ_FLAG_QUANTIZE_*, these replace `vertices`, `normals` and
+   * `texcoords`, which are NULL then. Counts are the same.
+   * vertices[3 * i + k] ~ vertex_offset[k] + quantized_vertices[3 * i + k] * vertex_scale[k]
+   * texcoords[2 * i + k] ~ texcoord_offset[k] + quantized_texcoords[2 * i + k] * texcoord_scale[k]
+   * The error is at most half a step(`scale` / 2) per component. Normals are
+   * octahedral encoded, see tinyobj_decode_normal. */
+  uint16_t *quantized_vertices;  /* 3 per vertex */
+  int16_t *quantized_normals;    /* 2 per normal */
+  uint16_t *quantized_texcoords; /* 2 per texcoord */
+  float vertex_offset[3];        /* Minimum of the bounding box. */
+  float vertex_scale[3];         /* Bounding box size / 65535. */
+  float texcoord_offset[2];
+  float texcoord_scale[2];
 } tinyobj_attrib_t;
 
 
 #define TINYOBJ_FLAG_TRIANGULATE (1 << 0)
+/* Parse lines on multiple threads. Requires TINYOBJ_USE_THREADS, otherwise
+ * the flag is ignored and parsing runs on the calling thread. */
+#define TINYOBJ_FLAG_PARALLEL (1 << 1)
+/* Output face indices as separate v, vt and vn arrays(structure of arrays)
+ * instead of `attrib->faces`. tinyobj_build_indexed_mesh and
+ * tinyobj_triangulate need `attrib->faces`. */
+#define TINYOBJ_FLAG_SOA_INDICES (1 << 2)
+/* Store positions as 16 bit integers relative to their bounding box. */
+#define TINYOBJ_FLAG_QUANTIZE_POSITIONS (1 << 3)
+/* Store normals as two 16 bit octahedral coordinates. */
+#define TINYOBJ_FLAG_QUANTIZE_NORMALS (1 << 4)
+/* Store texcoords as 16 bit integers relative to their bounding box. */
+#define TINYOBJ_FLAG_QUANTIZE_TEXCOORDS (1 << 5)
+#define TINYOBJ_FLAG_QUANTIZE                                          \
+  (TINYOBJ_FLAG_QUANTIZE_POSITIONS | TINYOBJ_FLAG_QUANTIZE_NORMALS | \
+   TINYOBJ_FLAG_QUANTIZE_TEXCOORDS)
 
 #define TINYOBJ_INVALID_INDEX (0x80000000)
 
@@ -90,6 +130,8 @@ typedef struct {
 #define TINYOBJ_ERROR_EMPTY (-1)
 #define TINYOBJ_ERROR_INVALID_PARAMETER (-2)
 #define TINYOBJ_ERROR_FILE_OPERATION (-3)
+#define TINYOBJ_ERROR_MEMORY (-4)
+#define TINYOBJ_ERROR_STALE_CACHE (-5)
 
 /* Provide a callback that can read text file without any parsing or modification.
  * The obj and mtl parser is going to read all the necessary data:
@@ -105,6 +147,127 @@ typedef struct {
  */
 typedef void (*file_reader_callback)(void *ctx, const char *filename, int is_mtl, const char *obj_filename, char **buf, size_t *len);
 
+/* Called with a buffer from the file_reader_callback once the parser is done
+ * with it, so it can be unmapped or reused right away. See
+ * tinyobj_parse_option_t.file_release.
+ *
+ * @param[in] ctx User provided context, the same as for the reader.
+ * @param[in] buf Content of the file, as returned by the reader.
+ * @param[in] len Size of content, as returned by the reader.
+ */
+typedef void (*file_release_callback)(void *ctx, char *buf, size_t len);
+
+/* Default file reader. Regular files are mapped read-only with read-ahead
+ * hints where mmap is available, other files(pipes, /proc) and platforms
+ * without mmap are read. `ctx` is not used. An unreadable file gives a NULL
+ * buffer. Release the buffer with tinyobj_file_release, which can be passed
+ * as tinyobj_parse_option_t.file_release. */
+extern void tinyobj_file_reader(void *ctx, const char *filename, int is_mtl,
+                                const char *obj_filename, char **buf,
+                                size_t *len);
+extern void tinyobj_file_release(void *ctx, char *buf, size_t len);
+
+/* Bump allocator for the results of a parse. Strings and arrays are taken
+ * from large blocks and all of them are released at once with
+ * tinyobj_arena_free. Results allocated from an arena must not be passed to
+ * tinyobj_attrib_free, tinyobj_shapes_free or tinyobj_materials_free.
+ * An arena can be used for several parses, but not from several threads at
+ * the same time. Members are private. */
+typedef struct tinyobj_arena_block_t tinyobj_arena_block_t;
+
+typedef struct {
+  tinyobj_arena_block_t *block;      /* Current block, linked to older ones. */
+  tinyobj_arena_block_t *last_block; /* Block of `last`. */
+  void *last;                        /* Latest allocation, can grow in place. */
+  size_t block_size;
+} tinyobj_arena_t;
+
+/* Initialize an empty arena. `block_size` = 0 uses the default(64 KB).
+ * Allocations larger than `block_size` get a block of their own. */
+extern void tinyobj_arena_init(tinyobj_arena_t *arena, size_t block_size);
+
+/* Release all memory allocated from `arena`. The arena can be reused. */
+extern void tinyobj_arena_free(tinyobj_arena_t *arena);
+
+/* Names stored back to back, each distinct name once. Filled by a parse
+ * with tinyobj_parse_option_t.string_pool. */
+typedef struct {
+  char *data;  /* Null terminated names. */
+  size_t size; /* in bytes */
+} tinyobj_string_pool_t;
+
+/* Release the names of `pool`. */
+extern void tinyobj_string_pool_free(tinyobj_string_pool_t *pool);
+
+/* Statistics of a tinyobj_parse_obj_ex call. Times are in seconds.
+ * Compressed files are parsed in one pass, so only parse_time, total_time,
+ * num_bytes(decompressed) and the allocations are filled for them. */
+typedef struct {
+  double line_scan_time; /* Finding line endings. */
+  double parse_time;     /* Parsing and counting lines. */
+  double mtl_time;       /* Loading .mtl files. With TINYOBJ_FLAG_PARALLEL, they
+                          * are loaded while vertices are parsed and this is
+                          * the time spent waiting for them. */
+  double attrib_time;    /* Allocating attrib and filling v, vn and vt. */
+  double shape_time;     /* Faces, materials and shapes. */
+  double triangulate_time; /* TINYOBJ_FLAG_TRIANGULATE */
+  double total_time;
+
+  size_t num_bytes; /* Size of the .obj file. */
+  size_t num_lines;
+
+  /* # of lines of each command. */
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_o;
+  size_t num_g;
+  size_t num_usemtl;
+  size_t num_mtllib;
+
+  /* Calls to TINYOBJ_MALLOC, TINYOBJ_CALLOC and TINYOBJ_REALLOC(including
+   * arena blocks), the largest number of bytes allocated at once, and the
+   * bytes still allocated at the end(the results). Only collected when the
+   * compiler supports thread local storage, zero otherwise. When .mtl files
+   * are loaded on another thread, the peaks of both threads are added. */
+  size_t num_allocs;
+  size_t peak_bytes;
+  size_t live_bytes;
+} tinyobj_parse_stats_t;
+
+/* Additional options for tinyobj_parse_obj_ex. */
+typedef struct {
+  /* Number of threads used when TINYOBJ_FLAG_PARALLEL is set.
+   * 0 = use the number of online processors. */
+  unsigned int num_threads;
+
+  int pad0;
+
+  /* Allocate attrib, shapes, materials and their strings from this arena.
+   * NULL = use TINYOBJ_MALLOC. Temporary tables used while parsing still
+   * use TINYOBJ_MALLOC. */
+  tinyobj_arena_t *arena;
+
+  /* Filled with statistics of the parse when not NULL. */
+  tinyobj_parse_stats_t *stats;
+
+  /* Store the shape, material and texture names in this pool instead of one
+   * allocation per name, so a name used many times is stored once. Shapes
+   * and materials point into `string_pool->data`, which is allocated with
+   * TINYOBJ_MALLOC(also with an arena) and released with
+   * tinyobj_string_pool_free. Their `pooled_name(s)` member is set, so
+   * tinyobj_shapes_free and tinyobj_materials_free leave the names to the
+   * pool. NULL = allocate every name. */
+  tinyobj_string_pool_t *string_pool;
+
+  /* Called with each buffer from `file_reader` as soon as the parse no
+   * longer needs it. With TINYOBJ_FLAG_PARALLEL, .mtl buffers are released
+   * on the thread which read them. NULL = the buffers are left to the
+   * reader. */
+  file_release_callback file_release;
+} tinyobj_parse_option_t;
+
 /* Parse wavefront .obj
  * @param[out] attrib Attibutes
  * @param[out] shapes Array of parsed shapes
@@ -116,6 +279,11 @@ typedef void (*file_reader_callback)(void *ctx, const char *filename, int is_mtl
  * @param[in] ctx Context pointer passed to the file_reader_callback.
  * @param[in] flags combination of TINYOBJ_FLAG_***
  *
+ * gzip and zstd compressed .obj files are parsed with the streaming parser
+ * while they are decompressed(on another thread with TINYOBJ_FLAG_PARALLEL).
+ * They need TINYOBJ_USE_ZLIB or TINYOBJ_USE_ZSTD, and give
+ * TINYOBJ_ERROR_FILE_OPERATION without it or when they are corrupt.
+ *
  * Returns TINYOBJ_SUCCESS if things goes well.
  * Returns TINYOBJ_ERROR_*** when there is an error.
  */
@@ -124,6 +292,108 @@ extern int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
                              size_t *num_materials, const char *file_name, file_reader_callback file_reader,
                              void *ctx, unsigned int flags);
 
+/* Same as tinyobj_parse_obj, with additional options.
+ * @param[in] option Parse options. Can be NULL to use defaults.
+ */
+extern int tinyobj_parse_obj_ex(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                                size_t *num_shapes, tinyobj_material_t **materials,
+                                size_t *num_materials, const char *file_name, file_reader_callback file_reader,
+                                void *ctx, unsigned int flags,
+                                const tinyobj_parse_option_t *option);
+
+/* Result of one file of tinyobj_parse_obj_batch. */
+typedef struct {
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes;
+  size_t num_shapes;
+  tinyobj_material_t *materials;
+  size_t num_materials;
+
+  tinyobj_arena_t arena; /* Owns all of the above. */
+
+  int status; /* TINYOBJ_SUCCESS or TINYOBJ_ERROR_*** of this file. */
+  int pad0;
+} tinyobj_result_t;
+
+/* Parse many .obj files(and their .mtl files) on a pool of threads. Files
+ * are read with fopen, and each thread reuses its read buffers and parse
+ * tables for all of its files, so this is faster than a tinyobj_parse_obj
+ * call per file when the files are small.
+ *
+ * @param[in] paths File names of .obj
+ * @param[in] num_paths Array length of `paths`
+ * @param[out] results Array of `num_paths` results, in the order of `paths`.
+ *             Release them with tinyobj_results_free, also on error.
+ * @param[in] flags combination of TINYOBJ_FLAG_***. TINYOBJ_FLAG_PARALLEL is ignored,
+ *            files are parsed in parallel instead.
+ * @param[in] num_threads 0 = use the number of online processors. Files are
+ *            parsed on the calling thread without TINYOBJ_USE_THREADS.
+ *
+ * Returns TINYOBJ_SUCCESS if all files were parsed.
+ * Returns the status of the first file which failed otherwise.
+ */
+extern int tinyobj_parse_obj_batch(const char *const *paths, size_t num_paths,
+                                   tinyobj_result_t *results,
+                                   unsigned int flags, unsigned int num_threads);
+
+extern void tinyobj_results_free(tinyobj_result_t *results, size_t num_results);
+
+/* Streaming .obj parser. The .obj text is passed in chunks of any size,
+ * so the whole file never needs to be in memory. Lines split across chunks
+ * are carried over to the next chunk.
+ *
+ * tinyobj_parser_t *parser = tinyobj_parser_create(filename, file_reader, ctx, flags);
+ * while ((len = read(fd, chunk, sizeof(chunk))) > 0) {
+ *   if (tinyobj_parser_feed(parser, chunk, len) != TINYOBJ_SUCCESS) break;
+ * }
+ * ret = tinyobj_parser_finish(parser, &attrib, &shapes, &num_shapes, &materials, &num_materials);
+ *
+ * A `mtllib` is loaded(with `file_reader`) when its line is parsed. `usemtl`
+ * names are resolved in finish, so material ids are the same as with
+ * tinyobj_parse_obj, also for `usemtl` lines before the `mtllib`.
+ */
+typedef struct tinyobj_parser_t tinyobj_parser_t;
+
+/* Create a streaming .obj parser.
+ * @param[in] obj_filename File name of .obj. Used to locate .mtl files. Can be NULL.
+ * @param[in] file_reader File reader callback function to read .mtl files. Can be NULL to skip materials.
+ * @param[in] ctx Context pointer passed to the file_reader_callback.
+ * @param[in] flags combination of TINYOBJ_FLAG_***. TINYOBJ_FLAG_PARALLEL is ignored.
+ *
+ * Returns NULL when out of memory.
+ */
+extern tinyobj_parser_t *tinyobj_parser_create(const char *obj_filename,
+                                               file_reader_callback file_reader,
+                                               void *ctx, unsigned int flags);
+
+/* Same as tinyobj_parser_create, with additional options.
+ * @param[in] option Parse options. Can be NULL to use defaults. `num_threads` is ignored.
+ */
+extern tinyobj_parser_t *tinyobj_parser_create_ex(const char *obj_filename,
+                                                  file_reader_callback file_reader,
+                                                  void *ctx, unsigned int flags,
+                                                  const tinyobj_parse_option_t *option);
+
+/* Parse the next `len` bytes of .obj text.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error. Later calls return the same error.
+ */
+extern int tinyobj_parser_feed(tinyobj_parser_t *parser, const char *chunk,
+                               size_t len);
+
+/* Parse the last line and return the results. `parser` is freed, even on
+ * error. Outputs are the same as tinyobj_parse_obj.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_parser_finish(tinyobj_parser_t *parser,
+                                 tinyobj_attrib_t *attrib,
+                                 tinyobj_shape_t **shapes, size_t *num_shapes,
+                                 tinyobj_material_t **materials,
+                                 size_t *num_materials);
+
 /* Parse wavefront .mtl
  *
  * @param[out] materials_out
@@ -141,9 +411,221 @@ extern int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
                                   const char *filename, const char *obj_filename, file_reader_callback file_reader,
 				  void *ctx);
 
+/* Number of floats per vertex of tinyobj_indexed_mesh_t: position(3),
+ * normal(3) and texcoord(2). Missing attributes are 0. */
+#define TINYOBJ_INDEXED_VERTEX_STRIDE (8)
+
+typedef struct {
+  float *vertices;               /* num_vertices * TINYOBJ_INDEXED_VERTEX_STRIDE */
+  uint32_t *indices;             /* One per attrib->faces entry. */
+  tinyobj_vertex_index_t *remap; /* (v, vt, vn) each vertex was made from. */
+  unsigned int num_vertices;
+  unsigned int num_indices;
+} tinyobj_indexed_mesh_t;
+
+/* Build an indexed mesh from parsed attributes. Identical (v, vt, vn)
+ * triples share one vertex, numbered in the order of first use, so the
+ * result does not depend on the number of threads. `indices[i]` replaces
+ * `attrib->faces[i]`; attrib->face_num_verts still describes the faces.
+ *
+ * @param[out] mesh Indexed mesh. Free with tinyobj_indexed_mesh_free.
+ * @param[in] attrib Attributes parsed without TINYOBJ_FLAG_QUANTIZE_*.
+ * @param[in] flags TINYOBJ_FLAG_PARALLEL to use multiple threads.
+ * @param[in] option Can be NULL. `num_threads` and `arena` are used.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_build_indexed_mesh(tinyobj_indexed_mesh_t *mesh,
+                                      const tinyobj_attrib_t *attrib,
+                                      unsigned int flags,
+                                      const tinyobj_parse_option_t *option);
+
+/* Methods of tinyobj_triangulate. */
+#define TINYOBJ_TRIANGULATE_FAN (0)      /* Fan around the first vertex. */
+#define TINYOBJ_TRIANGULATE_EAR_CLIP (1) /* Ear clipping, for concave polygons. */
+
+/* Faces of tinyobj_attrib_t after triangulation. */
+typedef struct {
+  tinyobj_vertex_index_t *faces; /* num_faces vertex indices */
+  int *face_num_verts;           /* 3, or less for faces kept as they are */
+  int *material_ids;             /* Material id of the source face. */
+  unsigned int num_faces;
+  unsigned int num_face_num_verts;
+} tinyobj_triangles_t;
+
+/* Split the faces of `attrib` into triangles. A face of n vertices gives
+ * n - 2 triangles, in the order of the faces. Faces with less than 3
+ * vertices(`l` lines) are kept as they are. Ear clipping works on the plane
+ * of each polygon and falls back to a fan for polygons without area or with
+ * missing vertices. The result does not depend on the number of threads.
+ *
+ * @param[out] triangles Free with tinyobj_triangles_free.
+ * @param[in] attrib Attributes parsed without TINYOBJ_FLAG_TRIANGULATE.
+ * @param[in] method TINYOBJ_TRIANGULATE_FAN or TINYOBJ_TRIANGULATE_EAR_CLIP.
+ *   Ear clipping needs float positions(no TINYOBJ_FLAG_QUANTIZE_POSITIONS).
+ * @param[in] flags TINYOBJ_FLAG_PARALLEL to use multiple threads.
+ * @param[in] option Can be NULL. `num_threads` and `arena` are used.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_triangulate(tinyobj_triangles_t *triangles,
+                               const tinyobj_attrib_t *attrib, int method,
+                               unsigned int flags,
+                               const tinyobj_parse_option_t *option);
+
+/* Parse result loaded by tinyobj_load_cache. */
+typedef struct {
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes;
+  size_t num_shapes;
+  tinyobj_material_t *materials;
+  size_t num_materials;
+
+  int from_cache; /* 1 = arrays point into the mapped cache file. */
+  int pad0;
+
+  void *mapping;  /* private */
+  size_t mapping_size;
+} tinyobj_cache_t;
+
+/* Write a parse result to a binary cache file. Arrays are stored as is in
+ * 64 byte aligned sections, so the file can be mapped and used without
+ * parsing. The cache is tied to the size and modification time of
+ * `obj_filename` and of the .mtl files of its `mtllib` lines(which are
+ * found by scanning `obj_filename` again), and to `flags`. Times have
+ * sub-second precision where the platform provides it. The cache is only
+ * valid on the same platform.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_save_cache(const char *cache_filename, const char *obj_filename,
+                              unsigned int flags, const tinyobj_attrib_t *attrib,
+                              const tinyobj_shape_t *shapes, size_t num_shapes,
+                              const tinyobj_material_t *materials,
+                              size_t num_materials);
+
+/* Map `cache_filename` when it is valid for the current `obj_filename` and
+ * `flags`. Otherwise parse `obj_filename` with `file_reader` and rewrite
+ * the cache. Release the result with tinyobj_cache_free.
+ *
+ * @param[in] file_reader Can be NULL to only load a valid cache.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_STALE_CACHE when the cache is not valid and
+ * `file_reader` is NULL.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_load_cache(tinyobj_cache_t *cache, const char *cache_filename,
+                              const char *obj_filename,
+                              file_reader_callback file_reader, void *ctx,
+                              unsigned int flags);
+
+extern void tinyobj_cache_free(tinyobj_cache_t *cache);
+
+/* Lines of a .obj file from an `o` or `g` line up to the next one. The
+ * lines before the first `o` or `g` line are range 0. Ranges with faces
+ * are the shapes of tinyobj_parse_obj, in the same order. */
+typedef struct {
+  char *name;             /* Name of the `o` or `g` line(may be NULL). */
+  uint64_t offset;        /* Byte offset of the first line. */
+  uint64_t size;          /* # of bytes. */
+  uint64_t usemtl_offset; /* `usemtl` line in effect at `offset`. UINT64_MAX = none. */
+  unsigned int v_offset;  /* # of `v` lines before the range. */
+  unsigned int vt_offset;
+  unsigned int vn_offset;
+  unsigned int num_v;     /* # of `v` lines in the range. */
+  unsigned int num_vt;
+  unsigned int num_vn;
+  unsigned int num_faces; /* # of `f` and `l` lines in the range. */
+  int pad0;
+} tinyobj_shape_range_t;
+
+typedef struct {
+  tinyobj_shape_range_t *ranges; /* In file order. */
+  size_t num_ranges;
+  uint64_t *mtllib_offsets; /* Byte offsets of the `mtllib` lines. */
+  size_t num_mtllibs;
+  uint64_t source_size;     /* Size of the .obj file. */
+
+  int from_cache; /* 1 = arrays point into the mapped index file. */
+  int pad0;
+
+  void *mapping;  /* private */
+  size_t mapping_size;
+} tinyobj_shape_index_t;
+
+/* Scan `obj_filename` for the byte ranges of its shapes, without parsing
+ * vertices or faces. Release the index with tinyobj_shape_index_free.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_build_shape_index(tinyobj_shape_index_t *index,
+                                     const char *obj_filename);
+
+/* Write `index` to a file which tinyobj_load_shape_index maps. Like the
+ * cache, the file is tied to the size and modification time of
+ * `obj_filename` and only valid on the same platform.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_save_shape_index(const char *index_filename,
+                                    const char *obj_filename,
+                                    const tinyobj_shape_index_t *index);
+
+/* Map `index_filename` when it is valid for the current `obj_filename`.
+ * Otherwise build the index and rewrite the file.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_load_shape_index(tinyobj_shape_index_t *index,
+                                    const char *index_filename,
+                                    const char *obj_filename);
+
+extern void tinyobj_shape_index_free(tinyobj_shape_index_t *index);
+
+/* Parse only the ranges `range_ids` of `obj_filename`. The file is mapped,
+ * so other ranges are not read, except for the `v`, `vt` and `vn` lines
+ * the faces refer to. The attribute arrays only hold the referenced
+ * vertices, and face indices point into them. Out of range indices are
+ * kept as they are. Shapes, material ids and the face arrays are the same
+ * as those of the ranges in a tinyobj_parse_obj result.
+ *
+ * @param[in] index Index of the current `obj_filename`.
+ * @param[in] file_reader Reads .mtl files. Can be NULL to skip materials.
+ * @param[in] flags TINYOBJ_FLAG_TRIANGULATE, TINYOBJ_FLAG_SOA_INDICES and
+ *   TINYOBJ_FLAG_QUANTIZE_*. Quantization uses the bounds of the loaded
+ *   vertices.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_STALE_CACHE when the size of `obj_filename` is not
+ * the size in `index`.
+ * Returns TINYOBJ_ERROR_*** when there is an error.
+ */
+extern int tinyobj_parse_shapes(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                                size_t *num_shapes, tinyobj_material_t **materials,
+                                size_t *num_materials,
+                                const tinyobj_shape_index_t *index,
+                                const size_t *range_ids, size_t num_range_ids,
+                                const char *obj_filename,
+                                file_reader_callback file_reader, void *ctx,
+                                unsigned int flags);
+
+/* Decode a normal of `attrib->quantized_normals` to a unit vector. The
+ * angle to the normalized input is below 0.005 degrees. A zero normal
+ * decodes to (0, 0, 1). */
+extern void tinyobj_decode_normal(const int16_t oct[2], float normal[3]);
+
 extern void tinyobj_attrib_init(tinyobj_attrib_t *attrib);
 extern void tinyobj_attrib_free(tinyobj_attrib_t *attrib);
 extern void tinyobj_shapes_free(tinyobj_shape_t *shapes, size_t num_shapes);
+extern void tinyobj_indexed_mesh_free(tinyobj_indexed_mesh_t *mesh);
+extern void tinyobj_triangles_free(tinyobj_triangles_t *triangles);
 extern void tinyobj_materials_free(tinyobj_material_t *materials,
                                    size_t num_materials);
 
@@ -155,8 +637,58 @@ extern void tinyobj_materials_free(tinyobj_material_t *materials,
 #ifdef TINYOBJ_LOADER_C_IMPLEMENTATION
 #include <stdio.h>
 #include <assert.h>
+#include <float.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/time.h>
+#endif
+
+/* SIMD is used for scanning line endings. Define TINYOBJ_NO_SIMD to disable. */
+#ifndef TINYOBJ_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TINYOBJ_HAS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define TINYOBJ_HAS_SSE2
+#endif
+#if defined(_MSC_VER) && (defined(TINYOBJ_HAS_AVX2) || defined(TINYOBJ_HAS_SSE2))
+#include <intrin.h>
+#endif
+#endif
+
+#if !defined(TINYOBJ_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define TINYOBJ_HAS_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Compressed .obj files(gzip, zstd) are detected by their magic bytes.
+ * Define TINYOBJ_USE_ZLIB(link with -lz) and/or TINYOBJ_USE_ZSTD(-lzstd) to
+ * load them. */
+#ifdef TINYOBJ_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TINYOBJ_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef TINYOBJ_USE_THREADS
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#endif
 
 #if defined(TINYOBJ_MALLOC) && defined(TINYOBJ_CALLOC) && defined(TINYOBJ_FREE) && (defined(TINYOBJ_REALLOC) || defined(TINYOBJ_REALLOC_SIZED))
 /* ok */
@@ -178,144 +710,514 @@ extern void tinyobj_materials_free(tinyobj_material_t *materials,
 #define TINYOBJ_REALLOC_SIZED(p,oldsz,newsz) TINYOBJ_REALLOC(p,newsz)
 #endif
 
-#define TINYOBJ_MAX_FACES_PER_F_LINE (16)
+/* Allocation statistics of the running tinyobj_parse_obj_ex call. Only the
+ * calling thread allocates while parsing, so the stats pointer is thread
+ * local. Internal allocations go through tracked_*, which need the size of
+ * the block being freed. */
+#if defined(_MSC_VER)
+#define TINYOBJ_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define TINYOBJ_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) || defined(__clang__)
+#define TINYOBJ_THREAD_LOCAL __thread
+#endif
+
+#ifdef TINYOBJ_THREAD_LOCAL
+static TINYOBJ_THREAD_LOCAL tinyobj_parse_stats_t *tinyobj_alloc_stats;
+#endif
+
+/* Returns the previous stats pointer. */
+static tinyobj_parse_stats_t *tinyobj_track_allocs(tinyobj_parse_stats_t *stats) {
+#ifdef TINYOBJ_THREAD_LOCAL
+  tinyobj_parse_stats_t *prev = tinyobj_alloc_stats;
+  tinyobj_alloc_stats = stats;
+  return prev;
+#else
+  (void)stats;
+  return NULL;
+#endif
+}
+
+static void track_alloc(size_t old_size, size_t new_size) {
+#ifdef TINYOBJ_THREAD_LOCAL
+  tinyobj_parse_stats_t *stats = tinyobj_alloc_stats;
+  if (stats == NULL) return;
+  if (new_size > 0) stats->num_allocs++;
+  stats->live_bytes = stats->live_bytes - old_size + new_size;
+  if (stats->live_bytes > stats->peak_bytes) {
+    stats->peak_bytes = stats->live_bytes;
+  }
+#else
+  (void)old_size;
+  (void)new_size;
+#endif
+}
+
+static void *tracked_malloc(size_t size) {
+  void *p = TINYOBJ_MALLOC(size);
+  if (p) track_alloc(0, size);
+  return p;
+}
+
+static void *tracked_calloc(size_t num, size_t size) {
+  void *p = TINYOBJ_CALLOC(num, size);
+  if (p) track_alloc(0, num * size);
+  return p;
+}
+
+static void *tracked_realloc(void *p, size_t old_size, size_t new_size) {
+  void *q = TINYOBJ_REALLOC_SIZED(p, old_size, new_size);
+  if (q) track_alloc(p ? old_size : 0, new_size);
+  return q;
+}
+
+static void tracked_free(void *p, size_t size) {
+  if (p == NULL) return;
+  TINYOBJ_FREE(p);
+  track_alloc(size, 0);
+}
+
+/* Wall clock time in seconds, for tinyobj_parse_stats_t. */
+static double tinyobj_time(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+#else
+  return (double)clock() / (double)CLOCKS_PER_SEC;
+#endif
+}
+
+/* Seconds since `*t`, and restart from now. */
+static double tinyobj_lap(double *t) {
+  double now = tinyobj_time();
+  double elapsed = now - *t;
+  *t = now;
+  return elapsed;
+}
+
 #define TINYOBJ_MAX_FILEPATH (8192)
+#define TINYOBJ_MAX_THREADS (256)
 
 #define IS_SPACE(x) (((x) == ' ') || ((x) == '\t'))
 #define IS_DIGIT(x) ((unsigned int)((x) - '0') < (unsigned int)(10))
 #define IS_NEW_LINE(x) (((x) == '\r') || ((x) == '\n') || ((x) == '\0'))
 
-static void skip_space(const char **token) {
-  while ((*token)[0] == ' ' || (*token)[0] == '\t') {
-    (*token)++;
+#if defined(TINYOBJ_HAS_AVX2) || defined(TINYOBJ_HAS_SSE2)
+/* Index of the lowest set bit. `x` must not be 0. */
+static unsigned int tinyobj_ctz(unsigned int x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctz(x);
+#elif defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward(&idx, x);
+  return (unsigned int)idx;
+#else
+  unsigned int n = 0;
+  while (!(x & 1u)) {
+    x >>= 1;
+    n++;
   }
+  return n;
+#endif
 }
+#endif
 
-static void skip_space_and_cr(const char **token) {
-  while ((*token)[0] == ' ' || (*token)[0] == '\t' || (*token)[0] == '\r') {
-    (*token)++;
+/* Minimum number of lines given to each thread in parallel mode. Smaller
+ * inputs are parsed with fewer threads. */
+#ifndef TINYOBJ_MIN_LINES_PER_THREAD
+#define TINYOBJ_MIN_LINES_PER_THREAD (4096)
+#endif
+
+/* Minimum number of face indices given to each thread by
+ * tinyobj_build_indexed_mesh. */
+#ifndef TINYOBJ_MIN_INDICES_PER_THREAD
+#define TINYOBJ_MIN_INDICES_PER_THREAD (65536)
+#endif
+
+/* Minimum number of faces given to each thread by triangulation. */
+#ifndef TINYOBJ_MIN_FACES_PER_THREAD
+#define TINYOBJ_MIN_FACES_PER_THREAD (16384)
+#endif
+
+/* Implementation of a minimal parallel for */
+
+typedef void (*tinyobj_task_func)(void *arg, size_t task_id);
+
+typedef struct {
+  tinyobj_task_func func;
+  void *arg;
+  size_t num_tasks;
+  size_t num_threads;
+  size_t thread_id;
+} tinyobj_worker_t;
+
+static void tinyobj_run_worker(tinyobj_worker_t *worker) {
+  size_t t;
+  for (t = worker->thread_id; t < worker->num_tasks; t += worker->num_threads) {
+    worker->func(worker->arg, t);
   }
 }
 
-static int until_space(const char *token) {
-  const char *p = token;
-  while (p[0] != '\0' && p[0] != ' ' && p[0] != '\t' && p[0] != '\r') {
-    p++;
-  }
+#ifdef TINYOBJ_USE_THREADS
+#ifdef _WIN32
+typedef HANDLE tinyobj_thread_t;
 
-  return (int)(p - token);
+static DWORD WINAPI tinyobj_thread_entry(LPVOID arg) {
+  tinyobj_run_worker((tinyobj_worker_t *)arg);
+  return 0;
 }
 
-static size_t length_until_newline(const char *token, size_t n) {
-  size_t len = 0;
+static int tinyobj_thread_create(tinyobj_thread_t *thread, tinyobj_worker_t *worker) {
+  *thread = CreateThread(NULL, 0, tinyobj_thread_entry, worker, 0, NULL);
+  return (*thread != NULL) ? 0 : -1;
+}
 
-  /* Assume token[n-1] = '\0' */
-  for (len = 0; len < n - 1; len++) {
-    if (token[len] == '\n') {
-      break;
-    }
-    if ((token[len] == '\r') && ((len < (n - 2)) && (token[len + 1] != '\n'))) {
-      break;
-    }
-  }
+static void tinyobj_thread_join(tinyobj_thread_t thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
 
-  return len;
+static size_t tinyobj_num_cpus(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (info.dwNumberOfProcessors > 0) ? (size_t)info.dwNumberOfProcessors : 1;
 }
+#else
+typedef pthread_t tinyobj_thread_t;
 
-static size_t length_until_line_feed(const char *token, size_t n) {
-  size_t len = 0;
+static void *tinyobj_thread_entry(void *arg) {
+  tinyobj_run_worker((tinyobj_worker_t *)arg);
+  return NULL;
+}
 
-  /* Assume token[n-1] = '\0' */
-  for (len = 0; len < n; len++) {
-    if ((token[len] == '\n') || (token[len] == '\r')) {
-      break;
-    }
-  }
+static int tinyobj_thread_create(tinyobj_thread_t *thread, tinyobj_worker_t *worker) {
+  return pthread_create(thread, NULL, tinyobj_thread_entry, worker);
+}
 
-  return len;
+static void tinyobj_thread_join(tinyobj_thread_t thread) {
+  pthread_join(thread, NULL);
 }
 
-/* http://stackoverflow.com/questions/5710091/how-does-atoi-function-in-c-work
-*/
-static int my_atoi(const char *c) {
-  int value = 0;
-  int sign = 1;
-  if (*c == '+' || *c == '-') {
-    if (*c == '-') sign = -1;
-    c++;
-  }
-  while (((*c) >= '0') && ((*c) <= '9')) { /* isdigit(*c) */
-    value *= 10;
-    value += (int)(*c - '0');
-    c++;
-  }
-  return value * sign;
+static size_t tinyobj_num_cpus(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (size_t)n : 1;
 }
+#endif
+#endif
 
-/* Make index zero-base, and also support relative index. */
-static int fixIndex(int idx, size_t n) {
-  if (idx > 0) return idx - 1;
-  if (idx == 0) return 0;
-  return (int)n + idx; /* negative value = relative */
+/* Number of threads to use for `num_items` work items. */
+static size_t tinyobj_num_threads(unsigned int flags, unsigned int requested,
+                                  size_t num_items, size_t min_items_per_thread) {
+#ifdef TINYOBJ_USE_THREADS
+  size_t n;
+  if (!(flags & TINYOBJ_FLAG_PARALLEL)) return 1;
+  n = (requested > 0) ? (size_t)requested : tinyobj_num_cpus();
+  if (n > TINYOBJ_MAX_THREADS) n = TINYOBJ_MAX_THREADS;
+  if (min_items_per_thread > 0 && n > num_items / min_items_per_thread) {
+    n = num_items / min_items_per_thread;
+  }
+  return (n > 0) ? n : 1;
+#else
+  (void)flags;
+  (void)requested;
+  (void)num_items;
+  (void)min_items_per_thread;
+  return 1;
+#endif
 }
 
-/* Parse raw triples: i, i/j/k, i//k, i/j */
-static tinyobj_vertex_index_t parseRawTriple(const char **token) {
-  tinyobj_vertex_index_t vi;
-  /* 0x80000000 = -2147483648 = invalid */
-  vi.v_idx = (int)(0x80000000);
-  vi.vn_idx = (int)(0x80000000);
-  vi.vt_idx = (int)(0x80000000);
+/* Run func(arg, 0) ... func(arg, num_tasks - 1) on up to `num_threads`
+ * threads. The calling thread also runs tasks. Tasks are run inline when
+ * threading is disabled or thread creation fails. */
+static void tinyobj_parallel_for(size_t num_tasks, size_t num_threads,
+                                 tinyobj_task_func func, void *arg) {
+  tinyobj_worker_t workers[TINYOBJ_MAX_THREADS];
+#ifdef TINYOBJ_USE_THREADS
+  tinyobj_thread_t threads[TINYOBJ_MAX_THREADS];
+  int started[TINYOBJ_MAX_THREADS];
+#endif
+  size_t i;
 
-  vi.v_idx = my_atoi((*token));
-  while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
-         (*token)[0] != '\t' && (*token)[0] != '\r') {
-    (*token)++;
-  }
-  if ((*token)[0] != '/') {
-    return vi;
-  }
-  (*token)++;
+  if (num_threads > TINYOBJ_MAX_THREADS) num_threads = TINYOBJ_MAX_THREADS;
+  if (num_threads > num_tasks) num_threads = num_tasks;
+  if (num_threads < 1) num_threads = 1;
+#ifndef TINYOBJ_USE_THREADS
+  num_threads = 1;
+#endif
 
-  /* i//k */
-  if ((*token)[0] == '/') {
-    (*token)++;
-    vi.vn_idx = my_atoi((*token));
-    while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
-           (*token)[0] != '\t' && (*token)[0] != '\r') {
-      (*token)++;
-    }
-    return vi;
+  for (i = 0; i < num_threads; i++) {
+    workers[i].func = func;
+    workers[i].arg = arg;
+    workers[i].num_tasks = num_tasks;
+    workers[i].num_threads = num_threads;
+    workers[i].thread_id = i;
   }
 
-  /* i/j/k or i/j */
-  vi.vt_idx = my_atoi((*token));
-  while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
-         (*token)[0] != '\t' && (*token)[0] != '\r') {
-    (*token)++;
+#ifdef TINYOBJ_USE_THREADS
+  for (i = 1; i < num_threads; i++) {
+    started[i] = (tinyobj_thread_create(&threads[i], &workers[i]) == 0);
   }
-  if ((*token)[0] != '/') {
-    return vi;
+#endif
+  tinyobj_run_worker(&workers[0]);
+#ifdef TINYOBJ_USE_THREADS
+  for (i = 1; i < num_threads; i++) {
+    if (started[i]) {
+      tinyobj_thread_join(threads[i]);
+    } else {
+      tinyobj_run_worker(&workers[i]);
+    }
   }
+#endif
+}
 
-  /* i/j/k */
-  (*token)++; /* skip '/' */
-  vi.vn_idx = my_atoi((*token));
-  while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
-         (*token)[0] != '\t' && (*token)[0] != '\r') {
+/* Run func(arg, 0) on another thread while the calling thread continues,
+ * until tinyobj_async_join. It is run inline by tinyobj_async_start when
+ * `use_thread` is 0, threading is disabled or thread creation fails. */
+typedef struct {
+  tinyobj_worker_t worker;
+#ifdef TINYOBJ_USE_THREADS
+  tinyobj_thread_t thread;
+  int started;
+  int pad0;
+#endif
+} tinyobj_async_t;
+
+static void tinyobj_async_start(tinyobj_async_t *async, tinyobj_task_func func,
+                                void *arg, int use_thread) {
+  async->worker.func = func;
+  async->worker.arg = arg;
+  async->worker.num_tasks = 1;
+  async->worker.num_threads = 1;
+  async->worker.thread_id = 0;
+#ifdef TINYOBJ_USE_THREADS
+  async->started =
+      use_thread && (tinyobj_thread_create(&async->thread, &async->worker) == 0);
+  if (async->started) return;
+#else
+  (void)use_thread;
+#endif
+  tinyobj_run_worker(&async->worker);
+}
+
+static void tinyobj_async_join(tinyobj_async_t *async) {
+#ifdef TINYOBJ_USE_THREADS
+  if (async->started) {
+    tinyobj_thread_join(async->thread);
+    async->started = 0;
+  }
+#else
+  (void)async;
+#endif
+}
+
+#ifdef TINYOBJ_USE_THREADS
+/* Mutex and condition variable, for the decompressor thread. */
+#ifdef _WIN32
+typedef CRITICAL_SECTION tinyobj_mutex_t;
+typedef CONDITION_VARIABLE tinyobj_cond_t;
+
+static int tinyobj_mutex_init(tinyobj_mutex_t *mutex) {
+  InitializeCriticalSection(mutex);
+  return 0;
+}
+
+static void tinyobj_mutex_destroy(tinyobj_mutex_t *mutex) {
+  DeleteCriticalSection(mutex);
+}
+
+static void tinyobj_mutex_lock(tinyobj_mutex_t *mutex) {
+  EnterCriticalSection(mutex);
+}
+
+static void tinyobj_mutex_unlock(tinyobj_mutex_t *mutex) {
+  LeaveCriticalSection(mutex);
+}
+
+static int tinyobj_cond_init(tinyobj_cond_t *cond) {
+  InitializeConditionVariable(cond);
+  return 0;
+}
+
+static void tinyobj_cond_destroy(tinyobj_cond_t *cond) { (void)cond; }
+
+static void tinyobj_cond_wait(tinyobj_cond_t *cond, tinyobj_mutex_t *mutex) {
+  SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+static void tinyobj_cond_signal(tinyobj_cond_t *cond) {
+  WakeConditionVariable(cond);
+}
+#else
+typedef pthread_mutex_t tinyobj_mutex_t;
+typedef pthread_cond_t tinyobj_cond_t;
+
+static int tinyobj_mutex_init(tinyobj_mutex_t *mutex) {
+  return pthread_mutex_init(mutex, NULL);
+}
+
+static void tinyobj_mutex_destroy(tinyobj_mutex_t *mutex) {
+  pthread_mutex_destroy(mutex);
+}
+
+static void tinyobj_mutex_lock(tinyobj_mutex_t *mutex) {
+  pthread_mutex_lock(mutex);
+}
+
+static void tinyobj_mutex_unlock(tinyobj_mutex_t *mutex) {
+  pthread_mutex_unlock(mutex);
+}
+
+static int tinyobj_cond_init(tinyobj_cond_t *cond) {
+  return pthread_cond_init(cond, NULL);
+}
+
+static void tinyobj_cond_destroy(tinyobj_cond_t *cond) {
+  pthread_cond_destroy(cond);
+}
+
+static void tinyobj_cond_wait(tinyobj_cond_t *cond, tinyobj_mutex_t *mutex) {
+  pthread_cond_wait(cond, mutex);
+}
+
+static void tinyobj_cond_signal(tinyobj_cond_t *cond) {
+  pthread_cond_signal(cond);
+}
+#endif
+#endif
+
+/* Tokenizers work in place on the file buffer. `end` is the end of the
+ * line, which is not NUL terminated. */
+
+static void skip_space(const char **token, const char *end) {
+  while ((*token) < end && ((*token)[0] == ' ' || (*token)[0] == '\t')) {
+    (*token)++;
+  }
+}
+
+static void skip_space_and_cr(const char **token, const char *end) {
+  while ((*token) < end &&
+         ((*token)[0] == ' ' || (*token)[0] == '\t' || (*token)[0] == '\r')) {
+    (*token)++;
+  }
+}
+
+static int until_space(const char *token, const char *end) {
+  const char *p = token;
+  while (p < end && p[0] != '\0' && p[0] != ' ' && p[0] != '\t' && p[0] != '\r') {
+    p++;
+  }
+
+  return (int)(p - token);
+}
+
+static size_t length_until_newline(const char *token, size_t n) {
+  size_t len = 0;
+
+  /* Assume token[n-1] = '\0' */
+  for (len = 0; len < n - 1; len++) {
+    if (token[len] == '\n') {
+      break;
+    }
+    if ((token[len] == '\r') && ((len < (n - 2)) && (token[len + 1] != '\n'))) {
+      break;
+    }
+  }
+
+  return len;
+}
+
+static size_t length_until_line_feed(const char *token, size_t n) {
+  size_t len = 0;
+
+  /* Assume token[n-1] = '\0' */
+  for (len = 0; len < n; len++) {
+    if ((token[len] == '\n') || (token[len] == '\r')) {
+      break;
+    }
+  }
+
+  return len;
+}
+
+/* http://stackoverflow.com/questions/5710091/how-does-atoi-function-in-c-work
+*/
+static int my_atoi(const char *c, const char *end) {
+  int value = 0;
+  int sign = 1;
+  if (c < end && (*c == '+' || *c == '-')) {
+    if (*c == '-') sign = -1;
+    c++;
+  }
+  while (c < end && ((*c) >= '0') && ((*c) <= '9')) { /* isdigit(*c) */
+    value *= 10;
+    value += (int)(*c - '0');
+    c++;
+  }
+  return value * sign;
+}
+
+/* Make index zero-base, and also support relative index. */
+static int fixIndex(int idx, size_t n) {
+  if (idx > 0) return idx - 1;
+  if (idx == 0) return 0;
+  return (int)n + idx; /* negative value = relative */
+}
+
+/* Advance to the next '/', space or end of the index. */
+static void skip_index(const char **token, const char *end) {
+  while ((*token) < end && (*token)[0] != '\0' && (*token)[0] != '/' &&
+         (*token)[0] != ' ' && (*token)[0] != '\t' && (*token)[0] != '\r') {
+    (*token)++;
+  }
+}
+
+/* Parse raw triples: i, i/j/k, i//k, i/j */
+static tinyobj_vertex_index_t parseRawTriple(const char **token, const char *end) {
+  tinyobj_vertex_index_t vi;
+  /* 0x80000000 = -2147483648 = invalid */
+  vi.v_idx = (int)(0x80000000);
+  vi.vn_idx = (int)(0x80000000);
+  vi.vt_idx = (int)(0x80000000);
+
+  vi.v_idx = my_atoi((*token), end);
+  skip_index(token, end);
+  if ((*token) >= end || (*token)[0] != '/') {
+    return vi;
+  }
+  (*token)++;
+
+  /* i//k */
+  if ((*token) < end && (*token)[0] == '/') {
     (*token)++;
+    vi.vn_idx = my_atoi((*token), end);
+    skip_index(token, end);
+    return vi;
+  }
+
+  /* i/j/k or i/j */
+  vi.vt_idx = my_atoi((*token), end);
+  skip_index(token, end);
+  if ((*token) >= end || (*token)[0] != '/') {
+    return vi;
   }
+
+  /* i/j/k */
+  (*token)++; /* skip '/' */
+  vi.vn_idx = my_atoi((*token), end);
+  skip_index(token, end);
   return vi;
 }
 
-static int parseInt(const char **token) {
+static int parseInt(const char **token, const char *end) {
   int i = 0;
-  skip_space(token);
-  i = my_atoi((*token));
-  (*token) += until_space((*token));
+  skip_space(token, end);
+  i = my_atoi((*token), end);
+  (*token) += until_space((*token), end);
   return i;
 }
 
+#ifdef TINYOBJ_LEGACY_FLOAT_PARSER
 /*
  * Tries to parse a floating point number located at s.
  *
@@ -432,7 +1334,7 @@ static int tryParseDouble(const char *s, const char *s_end, double *result) {
     if (end_not_reached && (*curr == '+' || *curr == '-')) {
       exp_sign = *curr;
       curr++;
-    } else if (IS_DIGIT(*curr)) { /* Pass through. */
+    } else if (end_not_reached && IS_DIGIT(*curr)) { /* Pass through. */
     } else {
       /* Empty E is not allowed. */
       goto fail;
@@ -479,113 +1381,799 @@ assemble :
 fail:
   return 0;
 }
+#endif /* TINYOBJ_LEGACY_FLOAT_PARSER */
 
-static float parseFloat(const char **token) {
-  const char *end;
-  double val = 0.0;
-  float f = 0.0f;
-  skip_space(token);
-  end = (*token) + until_space((*token));
-  val = 0.0;
-  tryParseDouble((*token), end, &val);
-  f = (float)(val);
-  (*token) = end;
-  return f;
-}
+/*
+ * Correctly rounded string to float conversion(Eisel-Lemire algorithm, as in
+ * the fast_float library).
+ *
+ * Up to 19 significant digits are read into a 64-bit integer `w` with a
+ * decimal exponent `q`. Small values are converted exactly with one double
+ * multiply or divide. Otherwise `w` is multiplied by a 128-bit truncated
+ * power of five, which gives enough bits to round to float directly.
+ * Numbers with more than 19 digits fall back to an exact big integer
+ * comparison when the truncated digits could change the rounding.
+ *
+ * Define TINYOBJ_LEGACY_FLOAT_PARSER to use tryParseDouble instead. This
+ * parser is then still compiled, for the tests which compare both.
+ */
 
-static void parseFloat2(float *x, float *y, const char **token) {
-  (*x) = parseFloat(token);
-  (*y) = parseFloat(token);
+#define TINYOBJ_FLOAT_SMALLEST_POWER_OF_TEN (-64)
+#define TINYOBJ_FLOAT_LARGEST_POWER_OF_TEN (38)
+#define TINYOBJ_FLOAT_MANTISSA_BITS (23)
+#define TINYOBJ_FLOAT_INFINITE_POWER (0xFF)
+#define TINYOBJ_FLOAT_MAX_DIGITS (114) /* Max significant digits of a halfway point. */
+
+/* 5^q normalized to 128 bits, for q in [-64, 38]. */
+static const uint64_t tinyobj_power_of_five_128[][2] = {
+  {0xa87fea27a539e9a5, 0x3f2398d747b36224}, /* 5^-64 */
+  {0xd29fe4b18e88640e, 0x8eec7f0d19a03aad}, /* 5^-63 */
+  {0x83a3eeeef9153e89, 0x1953cf68300424ac}, /* 5^-62 */
+  {0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7}, /* 5^-61 */
+  {0xcdb02555653131b6, 0x3792f412cb06794d}, /* 5^-60 */
+  {0x808e17555f3ebf11, 0xe2bbd88bbee40bd0}, /* 5^-59 */
+  {0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4}, /* 5^-58 */
+  {0xc8de047564d20a8b, 0xf245825a5a445275}, /* 5^-57 */
+  {0xfb158592be068d2e, 0xeed6e2f0f0d56712}, /* 5^-56 */
+  {0x9ced737bb6c4183d, 0x55464dd69685606b}, /* 5^-55 */
+  {0xc428d05aa4751e4c, 0xaa97e14c3c26b886}, /* 5^-54 */
+  {0xf53304714d9265df, 0xd53dd99f4b3066a8}, /* 5^-53 */
+  {0x993fe2c6d07b7fab, 0xe546a8038efe4029}, /* 5^-52 */
+  {0xbf8fdb78849a5f96, 0xde98520472bdd033}, /* 5^-51 */
+  {0xef73d256a5c0f77c, 0x963e66858f6d4440}, /* 5^-50 */
+  {0x95a8637627989aad, 0xdde7001379a44aa8}, /* 5^-49 */
+  {0xbb127c53b17ec159, 0x5560c018580d5d52}, /* 5^-48 */
+  {0xe9d71b689dde71af, 0xaab8f01e6e10b4a6}, /* 5^-47 */
+  {0x9226712162ab070d, 0xcab3961304ca70e8}, /* 5^-46 */
+  {0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22}, /* 5^-45 */
+  {0xe45c10c42a2b3b05, 0x8cb89a7db77c506a}, /* 5^-44 */
+  {0x8eb98a7a9a5b04e3, 0x77f3608e92adb242}, /* 5^-43 */
+  {0xb267ed1940f1c61c, 0x55f038b237591ed3}, /* 5^-42 */
+  {0xdf01e85f912e37a3, 0x6b6c46dec52f6688}, /* 5^-41 */
+  {0x8b61313bbabce2c6, 0x2323ac4b3b3da015}, /* 5^-40 */
+  {0xae397d8aa96c1b77, 0xabec975e0a0d081a}, /* 5^-39 */
+  {0xd9c7dced53c72255, 0x96e7bd358c904a21}, /* 5^-38 */
+  {0x881cea14545c7575, 0x7e50d64177da2e54}, /* 5^-37 */
+  {0xaa242499697392d2, 0xdde50bd1d5d0b9e9}, /* 5^-36 */
+  {0xd4ad2dbfc3d07787, 0x955e4ec64b44e864}, /* 5^-35 */
+  {0x84ec3c97da624ab4, 0xbd5af13bef0b113e}, /* 5^-34 */
+  {0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e}, /* 5^-33 */
+  {0xcfb11ead453994ba, 0x67de18eda5814af2}, /* 5^-32 */
+  {0x81ceb32c4b43fcf4, 0x80eacf948770ced7}, /* 5^-31 */
+  {0xa2425ff75e14fc31, 0xa1258379a94d028d}, /* 5^-30 */
+  {0xcad2f7f5359a3b3e, 0x096ee45813a04330}, /* 5^-29 */
+  {0xfd87b5f28300ca0d, 0x8bca9d6e188853fc}, /* 5^-28 */
+  {0x9e74d1b791e07e48, 0x775ea264cf55347e}, /* 5^-27 */
+  {0xc612062576589dda, 0x95364afe032a819e}, /* 5^-26 */
+  {0xf79687aed3eec551, 0x3a83ddbd83f52205}, /* 5^-25 */
+  {0x9abe14cd44753b52, 0xc4926a9672793543}, /* 5^-24 */
+  {0xc16d9a0095928a27, 0x75b7053c0f178294}, /* 5^-23 */
+  {0xf1c90080baf72cb1, 0x5324c68b12dd6339}, /* 5^-22 */
+  {0x971da05074da7bee, 0xd3f6fc16ebca5e04}, /* 5^-21 */
+  {0xbce5086492111aea, 0x88f4bb1ca6bcf585}, /* 5^-20 */
+  {0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6}, /* 5^-19 */
+  {0x9392ee8e921d5d07, 0x3aff322e62439fd0}, /* 5^-18 */
+  {0xb877aa3236a4b449, 0x09befeb9fad487c3}, /* 5^-17 */
+  {0xe69594bec44de15b, 0x4c2ebe687989a9b4}, /* 5^-16 */
+  {0x901d7cf73ab0acd9, 0x0f9d37014bf60a11}, /* 5^-15 */
+  {0xb424dc35095cd80f, 0x538484c19ef38c95}, /* 5^-14 */
+  {0xe12e13424bb40e13, 0x2865a5f206b06fba}, /* 5^-13 */
+  {0x8cbccc096f5088cb, 0xf93f87b7442e45d4}, /* 5^-12 */
+  {0xafebff0bcb24aafe, 0xf78f69a51539d749}, /* 5^-11 */
+  {0xdbe6fecebdedd5be, 0xb573440e5a884d1c}, /* 5^-10 */
+  {0x89705f4136b4a597, 0x31680a88f8953031}, /* 5^-9 */
+  {0xabcc77118461cefc, 0xfdc20d2b36ba7c3e}, /* 5^-8 */
+  {0xd6bf94d5e57a42bc, 0x3d32907604691b4d}, /* 5^-7 */
+  {0x8637bd05af6c69b5, 0xa63f9a49c2c1b110}, /* 5^-6 */
+  {0xa7c5ac471b478423, 0x0fcf80dc33721d54}, /* 5^-5 */
+  {0xd1b71758e219652b, 0xd3c36113404ea4a9}, /* 5^-4 */
+  {0x83126e978d4fdf3b, 0x645a1cac083126ea}, /* 5^-3 */
+  {0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4}, /* 5^-2 */
+  {0xcccccccccccccccc, 0xcccccccccccccccd}, /* 5^-1 */
+  {0x8000000000000000, 0x0000000000000000}, /* 5^0 */
+  {0xa000000000000000, 0x0000000000000000}, /* 5^1 */
+  {0xc800000000000000, 0x0000000000000000}, /* 5^2 */
+  {0xfa00000000000000, 0x0000000000000000}, /* 5^3 */
+  {0x9c40000000000000, 0x0000000000000000}, /* 5^4 */
+  {0xc350000000000000, 0x0000000000000000}, /* 5^5 */
+  {0xf424000000000000, 0x0000000000000000}, /* 5^6 */
+  {0x9896800000000000, 0x0000000000000000}, /* 5^7 */
+  {0xbebc200000000000, 0x0000000000000000}, /* 5^8 */
+  {0xee6b280000000000, 0x0000000000000000}, /* 5^9 */
+  {0x9502f90000000000, 0x0000000000000000}, /* 5^10 */
+  {0xba43b74000000000, 0x0000000000000000}, /* 5^11 */
+  {0xe8d4a51000000000, 0x0000000000000000}, /* 5^12 */
+  {0x9184e72a00000000, 0x0000000000000000}, /* 5^13 */
+  {0xb5e620f480000000, 0x0000000000000000}, /* 5^14 */
+  {0xe35fa931a0000000, 0x0000000000000000}, /* 5^15 */
+  {0x8e1bc9bf04000000, 0x0000000000000000}, /* 5^16 */
+  {0xb1a2bc2ec5000000, 0x0000000000000000}, /* 5^17 */
+  {0xde0b6b3a76400000, 0x0000000000000000}, /* 5^18 */
+  {0x8ac7230489e80000, 0x0000000000000000}, /* 5^19 */
+  {0xad78ebc5ac620000, 0x0000000000000000}, /* 5^20 */
+  {0xd8d726b7177a8000, 0x0000000000000000}, /* 5^21 */
+  {0x878678326eac9000, 0x0000000000000000}, /* 5^22 */
+  {0xa968163f0a57b400, 0x0000000000000000}, /* 5^23 */
+  {0xd3c21bcecceda100, 0x0000000000000000}, /* 5^24 */
+  {0x84595161401484a0, 0x0000000000000000}, /* 5^25 */
+  {0xa56fa5b99019a5c8, 0x0000000000000000}, /* 5^26 */
+  {0xcecb8f27f4200f3a, 0x0000000000000000}, /* 5^27 */
+  {0x813f3978f8940984, 0x4000000000000000}, /* 5^28 */
+  {0xa18f07d736b90be5, 0x5000000000000000}, /* 5^29 */
+  {0xc9f2c9cd04674ede, 0xa400000000000000}, /* 5^30 */
+  {0xfc6f7c4045812296, 0x4d00000000000000}, /* 5^31 */
+  {0x9dc5ada82b70b59d, 0xf020000000000000}, /* 5^32 */
+  {0xc5371912364ce305, 0x6c28000000000000}, /* 5^33 */
+  {0xf684df56c3e01bc6, 0xc732000000000000}, /* 5^34 */
+  {0x9a130b963a6c115c, 0x3c7f400000000000}, /* 5^35 */
+  {0xc097ce7bc90715b3, 0x4b9f100000000000}, /* 5^36 */
+  {0xf0bdc21abb48db20, 0x1e86d40000000000}, /* 5^37 */
+  {0x96769950b50d88f4, 0x1314448000000000}, /* 5^38 */
+};
+
+static const double tinyobj_exact_powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10
+};
+
+/* Mantissa(with the rounding bit removed) and biased exponent of a float. */
+typedef struct {
+  uint64_t mantissa;
+  int power2;
+  int pad0;
+} tinyobj_adjusted_mantissa_t;
+
+static void tinyobj_mul_64x64(uint64_t a, uint64_t b, uint64_t *hi,
+                              uint64_t *lo) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 tinyobj_uint128_t;
+  tinyobj_uint128_t r = (tinyobj_uint128_t)a * b;
+  *hi = (uint64_t)(r >> 64);
+  *lo = (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+  *lo = _umul128(a, b, hi);
+#else
+  uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+  uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+  uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi;
+  uint64_t hl = a_hi * b_lo, hh = a_hi * b_hi;
+  uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFu) + (hl & 0xFFFFFFFFu);
+  *lo = (mid << 32) | (ll & 0xFFFFFFFFu);
+  *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
 }
 
-static void parseFloat3(float *x, float *y, float *z, const char **token) {
-  (*x) = parseFloat(token);
-  (*y) = parseFloat(token);
-  (*z) = parseFloat(token);
+static int tinyobj_leading_zeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  while (!(x & ((uint64_t)1 << 63))) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
 }
 
-static size_t my_strnlen(const char *s, size_t n) {
-    const char *p = (char *)memchr(s, 0, n);
-    return p ? (size_t)(p - s) : n;
+/* floor(q * log2(10)) + 63 */
+static int tinyobj_power2_of_ten(int q) {
+  if (q >= 0) return ((217706 * q) >> 16) + 63;
+  return 63 - ((217706 * -q + 65535) >> 16);
 }
 
-static char *my_strdup(const char *s, size_t max_length) {
-  char *d;
-  size_t len;
+/* Round w * 10^q to float. `w` must not be 0. */
+static tinyobj_adjusted_mantissa_t tinyobj_compute_float(int q, uint64_t w) {
+  tinyobj_adjusted_mantissa_t am;
+  const uint64_t *pow5;
+  const uint64_t precision_mask = ~(uint64_t)0 >> (TINYOBJ_FLOAT_MANTISSA_BITS + 3);
+  uint64_t hi, lo;
+  int lz, upperbit, shift;
+
+  am.pad0 = 0;
+  if (w == 0 || q < TINYOBJ_FLOAT_SMALLEST_POWER_OF_TEN) {
+    am.mantissa = 0;
+    am.power2 = 0;
+    return am;
+  }
+  if (q > TINYOBJ_FLOAT_LARGEST_POWER_OF_TEN) {
+    am.mantissa = 0;
+    am.power2 = TINYOBJ_FLOAT_INFINITE_POWER;
+    return am;
+  }
 
-  if (s == NULL) return NULL;
+  lz = tinyobj_leading_zeros64(w);
+  w <<= lz;
+
+  pow5 = tinyobj_power_of_five_128[q - TINYOBJ_FLOAT_SMALLEST_POWER_OF_TEN];
+  tinyobj_mul_64x64(w, pow5[0], &hi, &lo);
+  if ((hi & precision_mask) == precision_mask) {
+    /* The low bits may carry into the bits we keep. */
+    uint64_t hi2, lo2;
+    tinyobj_mul_64x64(w, pow5[1], &hi2, &lo2);
+    lo += hi2;
+    if (hi2 > lo) hi++;
+  }
 
-  /* Do not consider CRLF line ending(#19) */
-  len = length_until_line_feed(s, max_length);
-  /* len = strlen(s); */
+  upperbit = (int)(hi >> 63);
+  shift = upperbit + 64 - TINYOBJ_FLOAT_MANTISSA_BITS - 3;
+  am.mantissa = hi >> shift;
+  am.power2 = tinyobj_power2_of_ten(q) + upperbit - lz + 127;
 
-  /* trim line ending and append '\0' */
-  d = (char *)TINYOBJ_MALLOC(len + 1); /* + '\0' */
-  memcpy(d, s, (size_t)(len));
-  d[len] = '\0';
+  if (am.power2 <= 0) { /* subnormal */
+    if (-am.power2 + 1 >= 64) {
+      am.mantissa = 0;
+      am.power2 = 0;
+      return am;
+    }
+    am.mantissa >>= -am.power2 + 1;
+    am.mantissa += (am.mantissa & 1);
+    am.mantissa >>= 1;
+    am.power2 = (am.mantissa < ((uint64_t)1 << TINYOBJ_FLOAT_MANTISSA_BITS)) ? 0 : 1;
+    return am;
+  }
 
-  return d;
+  /* Exactly halfway between two floats: round to even. This can only
+   * happen when 5^q fits in 64 bits. */
+  if (lo <= 1 && q >= -17 && q <= 10 && (am.mantissa & 3) == 1) {
+    if ((am.mantissa << shift) == hi) {
+      am.mantissa &= ~(uint64_t)1;
+    }
+  }
+
+  am.mantissa += (am.mantissa & 1);
+  am.mantissa >>= 1;
+  if (am.mantissa >= ((uint64_t)2 << TINYOBJ_FLOAT_MANTISSA_BITS)) {
+    am.mantissa = (uint64_t)1 << TINYOBJ_FLOAT_MANTISSA_BITS;
+    am.power2++;
+  }
+  am.mantissa &= ~((uint64_t)1 << TINYOBJ_FLOAT_MANTISSA_BITS);
+  if (am.power2 >= TINYOBJ_FLOAT_INFINITE_POWER) {
+    am.mantissa = 0;
+    am.power2 = TINYOBJ_FLOAT_INFINITE_POWER;
+  }
+  return am;
 }
 
-static char *my_strndup(const char *s, size_t len) {
-  char *d;
-  size_t slen;
+/* Fixed size unsigned big integer, least significant limb first. Large
+ * enough for 10^(TINYOBJ_FLOAT_MAX_DIGITS + 64) scaled by float exponents. */
+#define TINYOBJ_BIGINT_LIMBS (64)
 
-  if (s == NULL) return NULL;
-  if (len == 0) return NULL;
+typedef struct {
+  uint32_t limbs[TINYOBJ_BIGINT_LIMBS];
+  int num_limbs;
+  int pad0;
+} tinyobj_bigint_t;
 
-  slen = my_strnlen(s, len);
-  d = (char *)TINYOBJ_MALLOC(slen + 1); /* + '\0' */
-  if (!d) {
-    return NULL;
+static void bigint_set(tinyobj_bigint_t *a, uint32_t v) {
+  a->limbs[0] = v;
+  a->num_limbs = 1;
+  a->pad0 = 0;
+}
+
+static void bigint_mul_add(tinyobj_bigint_t *a, uint32_t mul, uint32_t add) {
+  uint64_t carry = add;
+  int i;
+  for (i = 0; i < a->num_limbs; i++) {
+    uint64_t v = (uint64_t)a->limbs[i] * mul + carry;
+    a->limbs[i] = (uint32_t)v;
+    carry = v >> 32;
   }
-  memcpy(d, s, slen);
-  d[slen] = '\0';
+  if (carry && a->num_limbs < TINYOBJ_BIGINT_LIMBS) {
+    a->limbs[a->num_limbs++] = (uint32_t)carry;
+  }
+}
 
-  return d;
+static void bigint_mul_pow5(tinyobj_bigint_t *a, int e) {
+  while (e >= 13) {
+    bigint_mul_add(a, 1220703125u, 0); /* 5^13 */
+    e -= 13;
+  }
+  if (e > 0) {
+    uint32_t m = 1;
+    while (e-- > 0) m *= 5;
+    bigint_mul_add(a, m, 0);
+  }
 }
 
-char *dynamic_fgets(char **buf, size_t *size, FILE *file) {
-  char *offset;
-  char *ret;
-  size_t old_size;
+static void bigint_shl(tinyobj_bigint_t *a, int bits) {
+  int limbs = bits / 32, rem = bits % 32, i;
+  if (rem) {
+    uint32_t carry = 0;
+    for (i = 0; i < a->num_limbs; i++) {
+      uint32_t v = a->limbs[i];
+      a->limbs[i] = (v << rem) | carry;
+      carry = v >> (32 - rem);
+    }
+    if (carry && a->num_limbs < TINYOBJ_BIGINT_LIMBS) {
+      a->limbs[a->num_limbs++] = carry;
+    }
+  }
+  if (limbs) {
+    if (a->num_limbs + limbs > TINYOBJ_BIGINT_LIMBS) {
+      limbs = TINYOBJ_BIGINT_LIMBS - a->num_limbs;
+    }
+    for (i = a->num_limbs - 1; i >= 0; i--) a->limbs[i + limbs] = a->limbs[i];
+    for (i = 0; i < limbs; i++) a->limbs[i] = 0;
+    a->num_limbs += limbs;
+  }
+}
 
-  if (!(ret = fgets(*buf, (int)*size, file))) {
-    return ret;
+static int bigint_compare(const tinyobj_bigint_t *a, const tinyobj_bigint_t *b) {
+  int na = a->num_limbs, nb = b->num_limbs, i;
+  while (na > 1 && a->limbs[na - 1] == 0) na--;
+  while (nb > 1 && b->limbs[nb - 1] == 0) nb--;
+  if (na != nb) return (na > nb) ? 1 : -1;
+  for (i = na - 1; i >= 0; i--) {
+    if (a->limbs[i] != b->limbs[i]) return (a->limbs[i] > b->limbs[i]) ? 1 : -1;
   }
+  return 0;
+}
 
-  if (NULL != strchr(*buf, '\n')) {
-    return ret;
+/* Decimal number split into its digit runs. */
+typedef struct {
+  const char *int_begin;
+  const char *int_end;
+  const char *frac_begin;
+  const char *frac_end;
+  int exponent; /* Explicit exponent after 'e'. */
+  int pad0;
+} tinyobj_decimal_t;
+
+/* Round the decimal to float exactly. `lower` is the correctly rounded value
+ * of the truncated digits, the answer is `lower` or the next float. */
+static uint32_t tinyobj_digit_compare(const tinyobj_decimal_t *dec,
+                                      tinyobj_adjusted_mantissa_t lower) {
+  tinyobj_bigint_t digits, halfway;
+  uint32_t lower_bits = (uint32_t)lower.mantissa |
+                        ((uint32_t)lower.power2 << TINYOBJ_FLOAT_MANTISSA_BITS);
+  uint64_t m = lower.mantissa;
+  int p, e, num_digits = 0, chunk_digits = 0, truncated = 0, cmp, shift;
+  uint32_t chunk = 0;
+  const char *c;
+
+  /* digits * 10^e, with up to TINYOBJ_FLOAT_MAX_DIGITS significant digits. */
+  bigint_set(&digits, 0);
+  e = dec->exponent - (int)(dec->frac_end - dec->frac_begin);
+  for (c = dec->int_begin; c != dec->frac_end; c++) {
+    if (c == dec->int_end) {
+      c = dec->frac_begin;
+      if (c == dec->frac_end) break;
+    }
+    if (num_digits == 0 && *c == '0') continue;
+    if (num_digits >= TINYOBJ_FLOAT_MAX_DIGITS) {
+      if (*c != '0') truncated = 1;
+      e++;
+      continue;
+    }
+    chunk = chunk * 10 + (uint32_t)(*c - '0');
+    chunk_digits++;
+    num_digits++;
+    if (chunk_digits == 9) {
+      bigint_mul_add(&digits, 1000000000u, chunk);
+      chunk = 0;
+      chunk_digits = 0;
+    }
+  }
+  if (chunk_digits) {
+    uint32_t scale = 1;
+    while (chunk_digits-- > 0) scale *= 10;
+    bigint_mul_add(&digits, scale, chunk);
   }
 
-  do {
-    old_size = *size;
-    *size *= 2;
-    *buf = (char*)TINYOBJ_REALLOC_SIZED(*buf, old_size, *size);
-    offset = &((*buf)[old_size - 1]);
+  /* Halfway point (2m + 1) * 2^(p - 1) between `lower` and the next float. */
+  if (lower.power2 == 0) {
+    p = 1 - 127 - TINYOBJ_FLOAT_MANTISSA_BITS;
+  } else {
+    m |= (uint64_t)1 << TINYOBJ_FLOAT_MANTISSA_BITS;
+    p = lower.power2 - 127 - TINYOBJ_FLOAT_MANTISSA_BITS;
+  }
+  bigint_set(&halfway, (uint32_t)(2 * m + 1));
 
-    ret = fgets(offset, (int)(old_size + 1), file);
-  } while(ret && (NULL == strchr(*buf, '\n')));
+  /* Compare digits * 5^e * 2^e with halfway * 2^(p - 1). */
+  if (e >= 0) {
+    bigint_mul_pow5(&digits, e);
+  } else {
+    bigint_mul_pow5(&halfway, -e);
+  }
+  shift = (p - 1) - e;
+  if (shift >= 0) {
+    bigint_shl(&halfway, shift);
+  } else {
+    bigint_shl(&digits, -shift);
+  }
 
-  return ret;
+  cmp = bigint_compare(&digits, &halfway);
+  if (cmp == 0 && truncated) cmp = 1;
+  if (cmp > 0 || (cmp == 0 && (m & 1))) {
+    return lower_bits + 1;
+  }
+  return lower_bits;
 }
 
-static void initMaterial(tinyobj_material_t *material) {
-  int i;
-  material->name = NULL;
-  material->ambient_texname = NULL;
-  material->diffuse_texname = NULL;
-  material->specular_texname = NULL;
-  material->specular_highlight_texname = NULL;
-  material->bump_texname = NULL;
-  material->displacement_texname = NULL;
-  material->alpha_texname = NULL;
-  for (i = 0; i < 3; i++) {
-    material->ambient[i] = 0.f;
-    material->diffuse[i] = 0.f;
-    material->specular[i] = 0.f;
-    material->transmittance[i] = 0.f;
-    material->emission[i] = 0.f;
+/*
+ * Parses [sign] digits [. digits] [(e|E) [sign] digits] into a correctly
+ * rounded float. Leading digits may be omitted when a fraction follows(".5").
+ * Parsing stops at the first character which does not fit or at s_end.
+ * Returns the end of the number, or NULL on failure.
+ */
+static const char *tinyobj_parse_float(const char *s, const char *s_end,
+                                       float *result) {
+  tinyobj_decimal_t dec;
+  const char *curr = s;
+  const char *first_digit = NULL;
+  uint64_t w = 0;
+  int q, num_digits = 0, negative = 0;
+  uint32_t bits;
+  tinyobj_adjusted_mantissa_t am, upper;
+
+  if (curr >= s_end) return NULL;
+  if (*curr == '+' || *curr == '-') {
+    negative = (*curr == '-');
+    curr++;
+  }
+
+  dec.int_begin = curr;
+  while (curr < s_end && IS_DIGIT(*curr)) {
+    w = w * 10 + (uint64_t)(*curr - '0');
+    curr++;
+  }
+  dec.int_end = curr;
+  dec.frac_begin = dec.frac_end = curr;
+  if (curr < s_end && *curr == '.') {
+    curr++;
+    dec.frac_begin = curr;
+    while (curr < s_end && IS_DIGIT(*curr)) {
+      w = w * 10 + (uint64_t)(*curr - '0');
+      curr++;
+    }
+    dec.frac_end = curr;
+  }
+  num_digits = (int)(dec.int_end - dec.int_begin) +
+               (int)(dec.frac_end - dec.frac_begin);
+  if (num_digits == 0) return NULL;
+
+  dec.exponent = 0;
+  dec.pad0 = 0;
+  if (curr < s_end && (*curr == 'e' || *curr == 'E')) {
+    int exp_negative = 0, exp_digits = 0;
+    curr++;
+    if (curr < s_end && (*curr == '+' || *curr == '-')) {
+      exp_negative = (*curr == '-');
+      curr++;
+    }
+    while (curr < s_end && IS_DIGIT(*curr)) {
+      if (dec.exponent < 0x10000) {
+        dec.exponent = dec.exponent * 10 + (*curr - '0');
+      }
+      curr++;
+      exp_digits++;
+    }
+    /* Empty E is not allowed. */
+    if (exp_digits == 0) return NULL;
+    if (exp_negative) dec.exponent = -dec.exponent;
+  }
+  q = dec.exponent - (int)(dec.frac_end - dec.frac_begin);
+
+  if (num_digits > 19) {
+    /* Leading zeros are not significant. */
+    const char *c;
+    for (c = dec.int_begin; c != dec.int_end && (*c == '0'); c++) num_digits--;
+    if (c == dec.int_end) {
+      for (c = dec.frac_begin; c != dec.frac_end && (*c == '0'); c++) num_digits--;
+    }
+    first_digit = c;
+  }
+
+  if (num_digits > 19) {
+    /* Keep the first 19 significant digits in `w`. */
+    const char *c = first_digit;
+    int n = 0;
+    w = 0;
+    while (n < 19) {
+      if (c == dec.int_end) c = dec.frac_begin;
+      w = w * 10 + (uint64_t)(*c - '0');
+      c++;
+      n++;
+    }
+    if (c <= dec.int_end) {
+      q = dec.exponent + (int)(dec.int_end - c);
+    } else {
+      q = dec.exponent - (int)(c - dec.frac_begin);
+    }
+
+    /* The exact value lies in [w, w + 1) * 10^q. */
+    am = tinyobj_compute_float(q, w);
+    upper = tinyobj_compute_float(q, w + 1);
+    if (upper.mantissa != am.mantissa || upper.power2 != am.power2) {
+      bits = tinyobj_digit_compare(&dec, am);
+    } else {
+      bits = (uint32_t)am.mantissa |
+             ((uint32_t)am.power2 << TINYOBJ_FLOAT_MANTISSA_BITS);
+    }
+  } else if (q >= -10 && q <= 10 && w <= ((uint64_t)1 << 24)) {
+    /* Both w and 10^|q| are exact floats, so one double operation rounded
+     * to float is correctly rounded. */
+    double d = (double)w;
+    float f;
+    if (q < 0) {
+      d = d / tinyobj_exact_powers_of_ten[-q];
+    } else {
+      d = d * tinyobj_exact_powers_of_ten[q];
+    }
+    f = (float)d;
+    *result = negative ? -f : f;
+    return curr;
+  } else {
+    am = tinyobj_compute_float(q, w);
+    bits = (uint32_t)am.mantissa |
+           ((uint32_t)am.power2 << TINYOBJ_FLOAT_MANTISSA_BITS);
+  }
+
+  if (negative) bits |= (uint32_t)1 << 31;
+  memcpy(result, &bits, sizeof(float));
+  return curr;
+}
+
+static float parseFloat(const char **token, const char *end) {
+  const char *s_end;
+  float f = 0.0f;
+  skip_space(token, end);
+#ifdef TINYOBJ_LEGACY_FLOAT_PARSER
+  (void)tinyobj_parse_float; /* Only used by the tests. */
+  s_end = (*token) + until_space((*token), end);
+  {
+    double val = 0.0;
+    tryParseDouble((*token), s_end, &val);
+    f = (float)(val);
+  }
+#else
+  /* Parse up to the line end and skip any junk after the number. */
+  s_end = tinyobj_parse_float((*token), end, &f);
+  if (s_end == NULL) {
+    f = 0.0f;
+    s_end = (*token);
+  }
+  s_end += until_space(s_end, end);
+#endif
+  (*token) = s_end;
+  return f;
+}
+
+static void parseFloat2(float *x, float *y, const char **token, const char *end) {
+  (*x) = parseFloat(token, end);
+  (*y) = parseFloat(token, end);
+}
+
+static void parseFloat3(float *x, float *y, float *z, const char **token, const char *end) {
+  (*x) = parseFloat(token, end);
+  (*y) = parseFloat(token, end);
+  (*z) = parseFloat(token, end);
+}
+
+/* An arena block is this header followed by the data. */
+struct tinyobj_arena_block_t {
+  tinyobj_arena_block_t *prev;
+  size_t size; /* bytes of data */
+  size_t used;
+};
+
+#define TINYOBJ_ARENA_ALIGN (16)
+#define TINYOBJ_ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define TINYOBJ_ARENA_ROUND(x) \
+  (((x) + TINYOBJ_ARENA_ALIGN - 1) & ~(size_t)(TINYOBJ_ARENA_ALIGN - 1))
+#define TINYOBJ_ARENA_HEADER_SIZE TINYOBJ_ARENA_ROUND(sizeof(tinyobj_arena_block_t))
+
+static char *arena_block_data(tinyobj_arena_block_t *block) {
+  return (char *)block + TINYOBJ_ARENA_HEADER_SIZE;
+}
+
+void tinyobj_arena_init(tinyobj_arena_t *arena, size_t block_size) {
+  arena->block = NULL;
+  arena->last_block = NULL;
+  arena->last = NULL;
+  arena->block_size = block_size ? block_size : TINYOBJ_ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+void tinyobj_arena_free(tinyobj_arena_t *arena) {
+  tinyobj_arena_block_t *block = arena->block;
+  while (block) {
+    tinyobj_arena_block_t *prev = block->prev;
+    TINYOBJ_FREE(block);
+    block = prev;
+  }
+  arena->block = NULL;
+  arena->last_block = NULL;
+  arena->last = NULL;
+}
+
+static void *arena_alloc(tinyobj_arena_t *arena, size_t size) {
+  tinyobj_arena_block_t *block = arena->block;
+  void *p;
+
+  size = TINYOBJ_ARENA_ROUND(size ? size : 1);
+  if (block == NULL || block->size - block->used < size) {
+    size_t data_size = (size > arena->block_size) ? size : arena->block_size;
+    tinyobj_arena_block_t *new_block = (tinyobj_arena_block_t *)tracked_malloc(
+        TINYOBJ_ARENA_HEADER_SIZE + data_size);
+    if (new_block == NULL) return NULL;
+    new_block->size = data_size;
+    new_block->used = 0;
+
+    if (block && size > arena->block_size) {
+      /* Keep filling the current block after a large allocation. */
+      new_block->prev = block->prev;
+      block->prev = new_block;
+    } else {
+      new_block->prev = block;
+      arena->block = new_block;
+    }
+    block = new_block;
+  }
+
+  p = arena_block_data(block) + block->used;
+  block->used += size;
+  arena->last = p;
+  arena->last_block = block;
+  return p;
+}
+
+/* The latest allocation grows in place when its block has room. */
+static void *arena_realloc(tinyobj_arena_t *arena, void *p, size_t old_size,
+                           size_t new_size) {
+  void *q;
+
+  if (p && p == arena->last) {
+    tinyobj_arena_block_t *block = arena->last_block;
+    size_t offset = (size_t)((char *)p - arena_block_data(block));
+    if (offset + TINYOBJ_ARENA_ROUND(new_size) <= block->size) {
+      block->used = offset + TINYOBJ_ARENA_ROUND(new_size);
+      return p;
+    }
+  }
+
+  q = arena_alloc(arena, new_size);
+  if (q && p) memcpy(q, p, (old_size < new_size) ? old_size : new_size);
+  return q;
+}
+
+/* Only the latest allocation can be given back. */
+static void arena_pop(tinyobj_arena_t *arena, void *p) {
+  if (p && p == arena->last) {
+    arena->last_block->used = (size_t)((char *)p - arena_block_data(arena->last_block));
+    arena->last = NULL;
+  }
+}
+
+/* Move the blocks of `other` into `arena`, which frees them from then on.
+ * `other` is left empty. The current block of `arena` stays current. */
+static void arena_adopt(tinyobj_arena_t *arena, tinyobj_arena_t *other) {
+  tinyobj_arena_block_t *oldest = other->block;
+
+  if (oldest == NULL) return;
+  while (oldest->prev) oldest = oldest->prev;
+
+  if (arena->block) {
+    oldest->prev = arena->block->prev;
+    arena->block->prev = other->block;
+  } else {
+    arena->block = other->block;
+  }
+  other->block = NULL;
+  other->last_block = NULL;
+  other->last = NULL;
+}
+
+/* Allocation of parse results. `arena` = NULL uses TINYOBJ_MALLOC. */
+static void *tinyobj_alloc(tinyobj_arena_t *arena, size_t size) {
+  return arena ? arena_alloc(arena, size) : tracked_malloc(size);
+}
+
+static void *tinyobj_realloc(tinyobj_arena_t *arena, void *p, size_t old_size,
+                             size_t new_size) {
+  return arena ? arena_realloc(arena, p, old_size, new_size)
+               : tracked_realloc(p, old_size, new_size);
+}
+
+static void tinyobj_free(tinyobj_arena_t *arena, void *p, size_t size) {
+  if (arena) {
+    arena_pop(arena, p);
+  } else {
+    tracked_free(p, size);
+  }
+}
+
+/* Allocated size of a string from my_strdup or my_strndup. */
+static size_t my_strsize(const char *s) {
+  return s ? strlen(s) + 1 : 0;
+}
+
+static size_t my_strnlen(const char *s, size_t n) {
+    const char *p = (char *)memchr(s, 0, n);
+    return p ? (size_t)(p - s) : n;
+}
+
+static char *my_strdup(const char *s, size_t max_length,
+                       tinyobj_arena_t *arena) {
+  char *d;
+  size_t len;
+
+  if (s == NULL) return NULL;
+
+  /* Do not consider CRLF line ending(#19) */
+  len = length_until_line_feed(s, max_length);
+  /* len = strlen(s); */
+
+  /* trim line ending and append '\0' */
+  d = (char *)tinyobj_alloc(arena, len + 1); /* + '\0' */
+  if (!d) {
+    return NULL;
+  }
+  memcpy(d, s, (size_t)(len));
+  d[len] = '\0';
+
+  return d;
+}
+
+static char *my_strndup(const char *s, size_t len, tinyobj_arena_t *arena) {
+  char *d;
+  size_t slen;
+
+  if (s == NULL) return NULL;
+  if (len == 0) return NULL;
+
+  slen = my_strnlen(s, len);
+  d = (char *)tinyobj_alloc(arena, slen + 1); /* + '\0' */
+  if (!d) {
+    return NULL;
+  }
+  memcpy(d, s, slen);
+  d[slen] = '\0';
+
+  return d;
+}
+
+char *dynamic_fgets(char **buf, size_t *size, FILE *file) {
+  char *offset;
+  char *ret;
+  size_t old_size;
+
+  if (!(ret = fgets(*buf, (int)*size, file))) {
+    return ret;
+  }
+
+  if (NULL != strchr(*buf, '\n')) {
+    return ret;
+  }
+
+  do {
+    old_size = *size;
+    *size *= 2;
+    *buf = (char*)TINYOBJ_REALLOC_SIZED(*buf, old_size, *size);
+    offset = &((*buf)[old_size - 1]);
+
+    ret = fgets(offset, (int)(old_size + 1), file);
+  } while(ret && (NULL == strchr(*buf, '\n')));
+
+  return ret;
+}
+
+static void initMaterial(tinyobj_material_t *material) {
+  int i;
+  material->name = NULL;
+  material->ambient_texname = NULL;
+  material->diffuse_texname = NULL;
+  material->specular_texname = NULL;
+  material->specular_highlight_texname = NULL;
+  material->bump_texname = NULL;
+  material->displacement_texname = NULL;
+  material->alpha_texname = NULL;
+  material->pooled_names = 0;
+  for (i = 0; i < 3; i++) {
+    material->ambient[i] = 0.f;
+    material->diffuse[i] = 0.f;
+    material->specular[i] = 0.f;
+    material->transmittance[i] = 0.f;
+    material->emission[i] = 0.f;
   }
   material->illum = 0;
   material->dissolve = 1.f;
@@ -600,187 +2188,231 @@ static void initMaterial(tinyobj_material_t *material) {
 
 #define HASH_TABLE_DEFAULT_SIZE 10
 
+/* Entries are kept in insertion order and keys are copied into `keys`, so a
+ * lookup only hashes and compares the name, it never allocates. */
 typedef struct hash_table_entry_t
 {
   unsigned long hash;
-  int filled;
-  int pad0;
+  size_t key;     /* Offset in `keys`. */
+  size_t key_len;
   long value;
-
-  struct hash_table_entry_t* next;
 } hash_table_entry_t;
 
 typedef struct
 {
-  unsigned long* hashes;
+  size_t* slots;    /* Entry index + 1, 0 = empty. */
+  size_t capacity;  /* in slots */
   hash_table_entry_t* entries;
-  size_t capacity;
   size_t n;
+  size_t entries_capacity;
+  char* keys;
+  size_t keys_len;
+  size_t keys_capacity;
 } hash_table_t;
 
-static unsigned long hash_djb2(const unsigned char* str)
+static unsigned long hash_djb2(const char* str, size_t len)
 {
   unsigned long hash = 5381;
-  int c;
+  size_t i;
 
-  while ((c = *str++)) {
-    hash = ((hash << 5) + hash) + (unsigned long)(c);
+  for (i = 0; i < len; i++) {
+    hash = ((hash << 5) + hash) + (unsigned long)((unsigned char)str[i]);
   }
 
   return hash;
 }
 
+/* Names such as "material0".."material99" have nearly consecutive hashes,
+ * which would form long runs of filled slots, so the bits are mixed first. */
+static size_t hash_table_index(unsigned long hash, size_t capacity)
+{
+  hash ^= hash >> 16;
+  hash *= 0x45d9f3bUL;
+  hash ^= hash >> 16;
+  return (size_t)(hash % capacity);
+}
+
 static void create_hash_table(size_t start_capacity, hash_table_t* hash_table)
 {
   if (start_capacity < 1)
     start_capacity = HASH_TABLE_DEFAULT_SIZE;
-  hash_table->hashes = (unsigned long*) TINYOBJ_MALLOC(start_capacity * sizeof(unsigned long));
-  hash_table->entries = (hash_table_entry_t*) TINYOBJ_CALLOC(start_capacity, sizeof(hash_table_entry_t));
-  hash_table->capacity = start_capacity;
+  hash_table->slots = (size_t*) tracked_calloc(start_capacity, sizeof(size_t));
+  hash_table->capacity = hash_table->slots ? start_capacity : 0;
+  hash_table->entries = NULL;
   hash_table->n = 0;
+  hash_table->entries_capacity = 0;
+  hash_table->keys = NULL;
+  hash_table->keys_len = 0;
+  hash_table->keys_capacity = 0;
 }
 
-static void destroy_hash_table(hash_table_t* hash_table)
+/* Remove all entries, keeping the allocations. */
+static void hash_table_clear(hash_table_t* hash_table)
 {
-  TINYOBJ_FREE(hash_table->entries);
-  TINYOBJ_FREE(hash_table->hashes);
+  if (hash_table->slots)
+    memset(hash_table->slots, 0, hash_table->capacity * sizeof(size_t));
+  hash_table->n = 0;
+  hash_table->keys_len = 0;
 }
 
-/* Insert with quadratic probing */
-static int hash_table_insert_value(unsigned long hash, long value, hash_table_t* hash_table)
+static void destroy_hash_table(hash_table_t* hash_table)
 {
-  /* Insert value */
-  size_t start_index = hash % hash_table->capacity;
-  size_t index = start_index;
-  hash_table_entry_t* start_entry = hash_table->entries + start_index;
-  size_t i;
-  hash_table_entry_t* entry;
-
-  for (i = 1; hash_table->entries[index].filled; i++)
-  {
-    if (i >= hash_table->capacity)
-      return HASH_TABLE_ERROR;
-    index = (start_index + (i * i)) % hash_table->capacity;
-  }
-
-  entry = hash_table->entries + index;
-  entry->hash = hash;
-  entry->filled = 1;
-  entry->value = value;
-
-  if (index != start_index) {
-    /* This is a new entry, but not the start entry, hence we need to add a next pointer to our entry */
-    entry->next = start_entry->next;
-    start_entry->next = entry;
-  }
-
-  return HASH_TABLE_SUCCESS;
+  tracked_free(hash_table->slots, hash_table->capacity * sizeof(size_t));
+  tracked_free(hash_table->entries, hash_table->entries_capacity * sizeof(hash_table_entry_t));
+  tracked_free(hash_table->keys, hash_table->keys_capacity);
+  hash_table->slots = NULL;
+  hash_table->capacity = 0;
+  hash_table->entries = NULL;
+  hash_table->n = 0;
+  hash_table->entries_capacity = 0;
+  hash_table->keys = NULL;
+  hash_table->keys_len = 0;
+  hash_table->keys_capacity = 0;
 }
 
-static int hash_table_insert(unsigned long hash, long value, hash_table_t* hash_table)
+/* Linear probing. At least half of the slots are empty, so an empty slot
+ * ends every probe sequence. */
+static hash_table_entry_t* hash_table_find(const char* name, size_t len,
+                                           unsigned long hash,
+                                           const hash_table_t* hash_table)
 {
-  int ret = hash_table_insert_value(hash, value, hash_table);
-  if (ret == HASH_TABLE_SUCCESS)
-  {
-    hash_table->hashes[hash_table->n] = hash;
-    hash_table->n++;
-  }
-  return ret;
-}
+  size_t index;
 
-static hash_table_entry_t* hash_table_find(unsigned long hash, hash_table_t* hash_table)
-{
-  hash_table_entry_t* entry = hash_table->entries + (hash % hash_table->capacity);
-  while (entry)
+  if (hash_table->capacity == 0) return NULL;
+
+  index = hash_table_index(hash, hash_table->capacity);
+  while (hash_table->slots[index])
   {
-    if (entry->hash == hash && entry->filled)
-    {
+    hash_table_entry_t* entry = hash_table->entries + (hash_table->slots[index] - 1);
+    if (entry->hash == hash && entry->key_len == len &&
+        (len == 0 || memcmp(hash_table->keys + entry->key, name, len) == 0))
       return entry;
-    }
-    entry = entry->next;
+    index = (index + 1) % hash_table->capacity;
   }
   return NULL;
 }
 
-static void hash_table_grow(hash_table_t* hash_table)
+static void hash_table_insert_slot(size_t* slots, size_t capacity,
+                                   unsigned long hash, size_t entry_index)
 {
-  size_t new_capacity;
-  hash_table_t new_hash_table;
-  size_t i;
+  size_t index = hash_table_index(hash, capacity);
+  while (slots[index])
+    index = (index + 1) % capacity;
+  slots[index] = entry_index + 1;
+}
 
-  new_capacity = 2 * hash_table->capacity;
-  /* Create a new hash table. We're not calling create_hash_table because we want to realloc the hash array */
-  new_hash_table.hashes = hash_table->hashes = (unsigned long*) TINYOBJ_REALLOC_SIZED(
-      (void*) hash_table->hashes, sizeof(unsigned long) * hash_table->capacity, sizeof(unsigned long) * new_capacity);
-  new_hash_table.entries = (hash_table_entry_t*) TINYOBJ_CALLOC(new_capacity, sizeof(hash_table_entry_t));
-  new_hash_table.capacity = new_capacity;
-  new_hash_table.n = hash_table->n;
+static int hash_table_grow(hash_table_t* hash_table)
+{
+  size_t new_capacity = 2 * hash_table->capacity;
+  size_t* new_slots;
+  size_t i;
 
-  /* Rehash */
-  for (i = 0; i < hash_table->capacity; i++)
-  {
-    hash_table_entry_t* entry = &hash_table->entries[i];
-    if (entry->filled) {
-            hash_table_insert_value(entry->hash, entry->value, &new_hash_table);
-    }
-  }
+  if (new_capacity < HASH_TABLE_DEFAULT_SIZE)
+    new_capacity = HASH_TABLE_DEFAULT_SIZE;
+  new_slots = (size_t*) tracked_calloc(new_capacity, sizeof(size_t));
+  if (new_slots == NULL) return HASH_TABLE_ERROR;
 
-  TINYOBJ_FREE(hash_table->entries);
-  (*hash_table) = new_hash_table;
-}
+  /* Rehash. Entries do not move. */
+  for (i = 0; i < hash_table->n; i++)
+    hash_table_insert_slot(new_slots, new_capacity, hash_table->entries[i].hash, i);
 
-static int hash_table_exists(const char* name, hash_table_t* hash_table)
-{
-  return hash_table_find(hash_djb2((const unsigned char*)name), hash_table) != NULL;
+  tracked_free(hash_table->slots, hash_table->capacity * sizeof(size_t));
+  hash_table->slots = new_slots;
+  hash_table->capacity = new_capacity;
+  return HASH_TABLE_SUCCESS;
 }
 
-static void hash_table_set(const char* name, size_t val, hash_table_t* hash_table)
+/* Set the value of `name`(`len` bytes, need not be null terminated). */
+static int hash_table_set(const char* name, size_t len, size_t val, hash_table_t* hash_table)
 {
-  /* Hash name */
-  unsigned long hash = hash_djb2((const unsigned char *)name);
+  unsigned long hash = hash_djb2(name, len);
+  hash_table_entry_t* entry = hash_table_find(name, len, hash, hash_table);
 
-  hash_table_entry_t* entry = hash_table_find(hash, hash_table);
   if (entry)
   {
     entry->value = (long)val;
-    return;
+    return HASH_TABLE_SUCCESS;
   }
 
-  /* Expand if necessary
-   * Grow until the element has been added
-   */
-  while (hash_table_insert(hash, (long)val, hash_table) != HASH_TABLE_SUCCESS) {
-    hash_table_grow(hash_table);
+  /* Keep at least half of the slots empty. */
+  if (2 * (hash_table->n + 1) > hash_table->capacity) {
+    if (hash_table_grow(hash_table) != HASH_TABLE_SUCCESS)
+      return HASH_TABLE_ERROR;
   }
-}
 
-static long hash_table_get(const char* name, hash_table_t* hash_table)
-{
-  hash_table_entry_t* ret = hash_table_find(hash_djb2((const unsigned char*)(name)), hash_table);
-  return ret->value;
+  if (hash_table->n == hash_table->entries_capacity) {
+    size_t new_capacity = hash_table->entries_capacity ? 2 * hash_table->entries_capacity : 16;
+    hash_table_entry_t* entries = (hash_table_entry_t*) tracked_realloc(
+        hash_table->entries, hash_table->entries_capacity * sizeof(hash_table_entry_t),
+        new_capacity * sizeof(hash_table_entry_t));
+    if (entries == NULL) return HASH_TABLE_ERROR;
+    hash_table->entries = entries;
+    hash_table->entries_capacity = new_capacity;
+  }
+
+  if (hash_table->keys_len + len > hash_table->keys_capacity) {
+    size_t new_capacity = hash_table->keys_capacity ? hash_table->keys_capacity : 256;
+    char* keys;
+    while (hash_table->keys_len + len > new_capacity) new_capacity *= 2;
+    keys = (char*) tracked_realloc(hash_table->keys, hash_table->keys_capacity, new_capacity);
+    if (keys == NULL) return HASH_TABLE_ERROR;
+    hash_table->keys = keys;
+    hash_table->keys_capacity = new_capacity;
+  }
+  if (len > 0) memcpy(hash_table->keys + hash_table->keys_len, name, len);
+
+  entry = hash_table->entries + hash_table->n;
+  entry->hash = hash;
+  entry->key = hash_table->keys_len;
+  entry->key_len = len;
+  entry->value = (long)val;
+  hash_table_insert_slot(hash_table->slots, hash_table->capacity, hash, hash_table->n);
+
+  hash_table->keys_len += len;
+  hash_table->n++;
+  return HASH_TABLE_SUCCESS;
 }
 
+/* The capacity doubles, so an arena does not keep a copy per material.
+ * Returns NULL when the array can not grow; `prev` is then unchanged. */
 static tinyobj_material_t *tinyobj_material_add(tinyobj_material_t *prev,
                                                 size_t num_materials,
-                                                tinyobj_material_t *new_mat) {
-  tinyobj_material_t *dst;
-  size_t num_bytes = sizeof(tinyobj_material_t) * num_materials;
-  dst = (tinyobj_material_t *)TINYOBJ_REALLOC_SIZED(
-                                      prev, num_bytes, num_bytes + sizeof(tinyobj_material_t));
+                                                size_t *capacity,
+                                                tinyobj_material_t *new_mat,
+                                                tinyobj_arena_t *arena) {
+  tinyobj_material_t *dst = prev;
+
+  if (num_materials == *capacity) {
+    size_t new_capacity = (*capacity) ? (*capacity) * 2 : 8;
+    dst = (tinyobj_material_t *)tinyobj_realloc(
+        arena, prev, sizeof(tinyobj_material_t) * (*capacity),
+        sizeof(tinyobj_material_t) * new_capacity);
+    if (dst == NULL) return NULL;
+    *capacity = new_capacity;
+  }
 
   dst[num_materials] = (*new_mat); /* Just copy pointer for char* members */
   return dst;
 }
 
-static int is_line_ending(const char *p, size_t i, size_t end_i) {
-  if (p[i] == '\0') return 1;
-  if (p[i] == '\n') return 1; /* this includes \r\n */
-  if (p[i] == '\r') {
-    if (((i + 1) < end_i) && (p[i + 1] != '\n')) { /* detect only \r case */
-      return 1;
-    }
-  }
-  return 0;
+/* Release the strings of a material which was not added. */
+static void material_free_strings(tinyobj_material_t *material,
+                                  tinyobj_arena_t *arena) {
+  tinyobj_free(arena, material->name, my_strsize(material->name));
+  tinyobj_free(arena, material->ambient_texname,
+               my_strsize(material->ambient_texname));
+  tinyobj_free(arena, material->diffuse_texname,
+               my_strsize(material->diffuse_texname));
+  tinyobj_free(arena, material->specular_texname,
+               my_strsize(material->specular_texname));
+  tinyobj_free(arena, material->specular_highlight_texname,
+               my_strsize(material->specular_highlight_texname));
+  tinyobj_free(arena, material->bump_texname,
+               my_strsize(material->bump_texname));
+  tinyobj_free(arena, material->displacement_texname,
+               my_strsize(material->displacement_texname));
+  tinyobj_free(arena, material->alpha_texname,
+               my_strsize(material->alpha_texname));
 }
 
 typedef struct {
@@ -788,309 +2420,411 @@ typedef struct {
   size_t len;
 } LineInfo;
 
-/* Find '\n' and create line data. */
-static int get_line_infos(const char *buf, size_t buf_len, LineInfo **line_infos, size_t *num_lines)
-{
-  size_t i = 0;
-  size_t end_idx = buf_len;
-  size_t prev_pos = 0;
-  size_t line_no = 0;
-  size_t last_line_ending = 0;
+/* Capacity of the table of scan_lines for `num_lines` lines. */
+static size_t line_infos_capacity(size_t buf_len, size_t num_lines) {
+  size_t capacity = buf_len / 32 + 16;
+  while (capacity < num_lines) capacity *= 2;
+  return capacity;
+}
 
-  /* Count # of lines. */
-  for (i = 0; i < end_idx; i++) {
-    if (is_line_ending(buf, i, end_idx)) {
-      (*num_lines)++;
-      last_line_ending = i;
-    }
-  }
-  /* The last char from the input may not be a line
-    * ending character so add an extra line if there
-    * are more characters after the last line ending
-    * that was found. */
-  if (end_idx - last_line_ending > 1) {
-      (*num_lines)++;
+/* Growable line table filled by scan_lines. */
+typedef struct {
+  LineInfo *infos;
+  size_t num_lines;
+  size_t capacity;
+  size_t prev_pos; /* Start of the current line. */
+} LineScanner;
+
+/* Append the line ending at `end`(exclusive). */
+static int line_scanner_push(LineScanner *scanner, size_t end) {
+  if (scanner->num_lines == scanner->capacity) {
+    size_t new_capacity = scanner->capacity * 2;
+    LineInfo *infos = (LineInfo *)tracked_realloc(
+        scanner->infos, sizeof(LineInfo) * scanner->capacity,
+        sizeof(LineInfo) * new_capacity);
+    if (infos == NULL) return -1;
+    scanner->infos = infos;
+    scanner->capacity = new_capacity;
   }
 
-  if (*num_lines == 0) return TINYOBJ_ERROR_EMPTY;
-
-  *line_infos = (LineInfo *)TINYOBJ_MALLOC(sizeof(LineInfo) * (*num_lines));
+  scanner->infos[scanner->num_lines].pos = scanner->prev_pos;
+  scanner->infos[scanner->num_lines].len = end - scanner->prev_pos;
+  scanner->num_lines++;
+  scanner->prev_pos = end + 1;
+  return 0;
+}
 
-  /* Fill line infos. */
-  for (i = 0; i < end_idx; i++) {
-    if (is_line_ending(buf, i, end_idx)) {
-      (*line_infos)[line_no].pos = prev_pos;
-      (*line_infos)[line_no].len = i - prev_pos;
-      prev_pos = i + 1;
-      line_no++;
+/* Handle a '\n', '\r' or '\0' found at buf[i].
+ * '\r' ends a line only when it is not followed by '\n'(the '\n' of "\r\n"
+ * ends the line) and is not the last character of the buffer. */
+static int line_scanner_add(LineScanner *scanner, const char *buf,
+                            size_t buf_len, size_t i) {
+  if (buf[i] == '\r') {
+    if (((i + 1) >= buf_len) || (buf[i + 1] == '\n')) {
+      return 0;
     }
   }
-  if (end_idx - last_line_ending > 1) {
-    (*line_infos)[line_no].pos = prev_pos;
-    (*line_infos)[line_no].len = end_idx - 1 - last_line_ending;
+  return line_scanner_push(scanner, i);
+}
+
+/* End of the line starting at `pos`, by the rule of line_scanner_add. The
+ * '\r' of "\r\n" is part of the line. */
+static size_t line_end(const char *buf, size_t buf_len, size_t pos) {
+  for (; pos < buf_len; pos++) {
+    if (buf[pos] == '\n' || buf[pos] == '\0') break;
+    if (buf[pos] == '\r' && (pos + 1) < buf_len && buf[pos + 1] != '\n') break;
   }
+  return pos;
+}
 
-  return 0;
+static void line_scanner_free(LineScanner *scanner) {
+  tracked_free(scanner->infos, sizeof(LineInfo) * scanner->capacity);
+  scanner->infos = NULL;
+  scanner->num_lines = 0;
+  scanner->capacity = 0;
 }
 
-static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
-                                            size_t *num_materials_out,
-                                            const char *mtl_filename, const char *obj_filename, file_reader_callback file_reader, void *ctx,
-                                            hash_table_t* material_table) {
-  tinyobj_material_t material;
-  size_t num_materials = 0;
-  tinyobj_material_t *materials = NULL;
-  int has_previous_material = 0;
-  const char *line_end = NULL;
-  size_t num_lines = 0;
-  LineInfo *line_infos = NULL;
+/* Find line endings('\n', '\r' or '\0') and create line data in a single
+ * pass. Blocks of 32(AVX2) or 16(SSE2) bytes are tested at once, the rest
+ * is scanned byte by byte. The table of `scanner` is reused when it is large
+ * enough, and is kept on failure. Returns TINYOBJ_ERROR_EMPTY when there is
+ * no line and TINYOBJ_ERROR_MEMORY when the table can not grow. */
+static int scan_lines(const char *buf, size_t buf_len, LineScanner *scanner_out)
+{
+  LineScanner scanner = *scanner_out;
   size_t i = 0;
-  char *buf = NULL;
-  size_t len = 0;
-
-  if (materials_out == NULL) {
-    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  size_t guess;
+
+  if (buf_len == 0) return TINYOBJ_ERROR_EMPTY;
+
+  /* Guess ~32 bytes per line. The table grows when the guess is short. */
+  guess = line_infos_capacity(buf_len, 0);
+  if (scanner.capacity < guess) {
+    line_scanner_free(&scanner);
+    scanner.infos = (LineInfo *)tracked_malloc(sizeof(LineInfo) * guess);
+    if (scanner.infos == NULL) {
+      *scanner_out = scanner;
+      return TINYOBJ_ERROR_MEMORY;
+    }
+    scanner.capacity = guess;
   }
+  scanner.num_lines = 0;
+  scanner.prev_pos = 0;
 
-  if (num_materials_out == NULL) {
-    return TINYOBJ_ERROR_INVALID_PARAMETER;
+#if defined(TINYOBJ_HAS_AVX2)
+  {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i nul = _mm256_setzero_si256();
+    for (; i + 32 <= buf_len; i += 32) {
+      __m256i c = _mm256_loadu_si256((const __m256i *)(const void *)(buf + i));
+      __m256i m = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(c, lf), _mm256_cmpeq_epi8(c, cr)),
+          _mm256_cmpeq_epi8(c, nul));
+      unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+      while (mask) {
+        if (line_scanner_add(&scanner, buf, buf_len, i + tinyobj_ctz(mask)) != 0) {
+          goto fail;
+        }
+        mask &= mask - 1;
+      }
+    }
   }
+#endif
 
-  (*materials_out) = NULL;
-  (*num_materials_out) = 0;
+#if defined(TINYOBJ_HAS_SSE2)
+  {
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i nul = _mm_setzero_si128();
+    for (; i + 16 <= buf_len; i += 16) {
+      __m128i c = _mm_loadu_si128((const __m128i *)(const void *)(buf + i));
+      __m128i m = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(c, lf), _mm_cmpeq_epi8(c, cr)),
+          _mm_cmpeq_epi8(c, nul));
+      unsigned int mask = (unsigned int)_mm_movemask_epi8(m);
+      while (mask) {
+        if (line_scanner_add(&scanner, buf, buf_len, i + tinyobj_ctz(mask)) != 0) {
+          goto fail;
+        }
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+
+  for (; i < buf_len; i++) {
+    if (buf[i] == '\n' || buf[i] == '\r' || buf[i] == '\0') {
+      if (line_scanner_add(&scanner, buf, buf_len, i) != 0) {
+        goto fail;
+      }
+    }
+  }
+
+  /* The last char from the input may not be a line
+   * ending character so add an extra line if there
+   * are more characters after the last line ending
+   * that was found. */
+  if (scanner.prev_pos < buf_len) {
+    if (line_scanner_push(&scanner, buf_len) != 0) {
+      goto fail;
+    }
+  }
+
+  *scanner_out = scanner;
+  return (scanner.num_lines > 0) ? 0 : TINYOBJ_ERROR_EMPTY;
+
+fail:
+  *scanner_out = scanner;
+  return TINYOBJ_ERROR_MEMORY;
+}
+
+/* Materials are appended to `*materials_out`(`*capacity_out` elements
+ * allocated), so several files can share one array and `material_table`.
+ * `lines` is a line table to reuse(NULL = use a temporary one). */
+static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
+                                            size_t *num_materials_out,
+                                            size_t *capacity_out,
+                                            const char *mtl_filename, const char *obj_filename, file_reader_callback file_reader, void *ctx,
+                                            file_release_callback file_release,
+                                            hash_table_t* material_table,
+                                            LineScanner *lines,
+                                            tinyobj_arena_t *arena,
+                                            tinyobj_arena_t *name_arena) {
+  tinyobj_material_t material;
+  size_t num_materials;
+  size_t capacity;
+  tinyobj_material_t *materials;
+  int has_previous_material = 0;
+  const char *line_end = NULL;
+  size_t num_lines = 0;
+  LineInfo *line_infos = NULL;
+  LineScanner temp_lines;
+  size_t i = 0;
+  char *buf = NULL;
+  size_t len = 0;
+  tinyobj_material_t *added;
+  int ret;
+
+  if (materials_out == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+
+  if (num_materials_out == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+
+  materials = (*materials_out);
+  num_materials = (*num_materials_out);
+  capacity = (*capacity_out);
 
   file_reader(ctx, mtl_filename, 1, obj_filename, &buf, &len);
-  if (len < 1) return TINYOBJ_ERROR_INVALID_PARAMETER;
   if (buf == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (len < 1) {
+    if (file_release) file_release(ctx, buf, len);
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
 
-  if (get_line_infos(buf, len, &line_infos, &num_lines) != 0) {
-		TINYOBJ_FREE(line_infos);
-    return TINYOBJ_ERROR_EMPTY;
+  if (lines == NULL) {
+    memset(&temp_lines, 0, sizeof(LineScanner));
+    lines = &temp_lines;
+  }
+  ret = scan_lines(buf, len, lines);
+  if (ret != TINYOBJ_SUCCESS) {
+    if (lines == &temp_lines) line_scanner_free(&temp_lines);
+    if (file_release) file_release(ctx, buf, len);
+    return ret;
   }
+  ret = TINYOBJ_ERROR_MEMORY; /* Until the last material is added. */
+  line_infos = lines->infos;
+  num_lines = lines->num_lines;
 
   /* Create a default material */
   initMaterial(&material);
+  material.pooled_names = (name_arena != arena);
 
   for (i = 0; i < num_lines; i++) {
     const char *p = &buf[line_infos[i].pos];
     size_t p_len = line_infos[i].len;
 
-    char linebuf[4096];
-    const char *token;
-    assert(p_len < 4095);
-
-    memcpy(linebuf, p, p_len);
-    linebuf[p_len] = '\0';
-
-    token = linebuf;
-    line_end = token + p_len;
+    const char *token = p;
+    const char *value;
+    size_t keyword_len;
+    float *color;
+    char **texname;
+    line_end = p + p_len;
 
     /* Skip leading space. */
-    token += strspn(token, " \t");
+    skip_space(&token, line_end);
 
     assert(token);
-    if (token[0] == '\0') continue; /* empty line */
+    if (token >= line_end || token[0] == '\0') continue; /* empty line */
 
     if (token[0] == '#') continue; /* comment line */
 
-    /* new mtl */
-    if ((0 == strncmp(token, "newmtl", 6)) && IS_SPACE((token[6]))) {
-      char namebuf[4096];
-
-      /* flush previous material. */
-      if (has_previous_material) {
-        materials = tinyobj_material_add(materials, num_materials, &material);
-        num_materials++;
-      } else {
-        has_previous_material = 1;
-      }
-
-      /* initial temporary material */
-      initMaterial(&material);
-
-      /* set new mtl name */
-      token += 7;
-#ifdef _MSC_VER
-      sscanf_s(token, "%s", namebuf, (unsigned)_countof(namebuf));
-#else
-      sscanf(token, "%s", namebuf);
-#endif
-      material.name = my_strdup(namebuf, (size_t) (line_end - token));
-
-      /* Add material to material table */
-      if (material_table)
-        hash_table_set(material.name, num_materials, material_table);
-
-      continue;
-    }
-
-    /* ambient */
-    if (token[0] == 'K' && token[1] == 'a' && IS_SPACE((token[2]))) {
-      float r, g, b;
-      token += 2;
-      parseFloat3(&r, &g, &b, &token);
-      material.ambient[0] = r;
-      material.ambient[1] = g;
-      material.ambient[2] = b;
-      continue;
-    }
-
-    /* diffuse */
-    if (token[0] == 'K' && token[1] == 'd' && IS_SPACE((token[2]))) {
-      float r, g, b;
-      token += 2;
-      parseFloat3(&r, &g, &b, &token);
-      material.diffuse[0] = r;
-      material.diffuse[1] = g;
-      material.diffuse[2] = b;
-      continue;
-    }
-
-    /* specular */
-    if (token[0] == 'K' && token[1] == 's' && IS_SPACE((token[2]))) {
-      float r, g, b;
-      token += 2;
-      parseFloat3(&r, &g, &b, &token);
-      material.specular[0] = r;
-      material.specular[1] = g;
-      material.specular[2] = b;
-      continue;
-    }
-
-    /* transmittance */
-    if (token[0] == 'K' && token[1] == 't' && IS_SPACE((token[2]))) {
-      float r, g, b;
-      token += 2;
-      parseFloat3(&r, &g, &b, &token);
-      material.transmittance[0] = r;
-      material.transmittance[1] = g;
-      material.transmittance[2] = b;
-      continue;
-    }
-
-    /* ior(index of refraction) */
-    if (token[0] == 'N' && token[1] == 'i' && IS_SPACE((token[2]))) {
-      token += 2;
-      material.ior = parseFloat(&token);
-      continue;
-    }
-
-    /* emission */
-    if (token[0] == 'K' && token[1] == 'e' && IS_SPACE(token[2])) {
-      float r, g, b;
-      token += 2;
-      parseFloat3(&r, &g, &b, &token);
-      material.emission[0] = r;
-      material.emission[1] = g;
-      material.emission[2] = b;
-      continue;
-    }
-
-    /* shininess */
-    if (token[0] == 'N' && token[1] == 's' && IS_SPACE(token[2])) {
-      token += 2;
-      material.shininess = parseFloat(&token);
-      continue;
-    }
-
-    /* illum model */
-    if (0 == strncmp(token, "illum", 5) && IS_SPACE(token[5])) {
-      token += 6;
-      material.illum = parseInt(&token);
-      continue;
-    }
-
-    /* dissolve */
-    if ((token[0] == 'd' && IS_SPACE(token[1]))) {
-      token += 1;
-      material.dissolve = parseFloat(&token);
-      continue;
-    }
-    if (token[0] == 'T' && token[1] == 'r' && IS_SPACE(token[2])) {
-      token += 2;
-      /* Invert value of Tr(assume Tr is in range [0, 1]) */
-      material.dissolve = 1.0f - parseFloat(&token);
+    /* Keywords must be followed by a space. Dispatch on the first char and
+     * the keyword length, so each line costs at most a few compares. */
+    keyword_len = (size_t)until_space(token, line_end);
+    if (keyword_len >= (size_t)(line_end - token) ||
+        !IS_SPACE(token[keyword_len])) {
       continue;
     }
+    value = token + keyword_len + 1;
+    color = NULL;
+    texname = NULL;
+
+    switch (token[0]) {
+      case 'n':
+        /* new mtl */
+        if (keyword_len == 6 && memcmp(token, "newmtl", 6) == 0) {
+          /* flush previous material. */
+          if (has_previous_material) {
+            added = tinyobj_material_add(materials, num_materials, &capacity,
+                                         &material, arena);
+            if (added == NULL) goto cleanup;
+            materials = added;
+            num_materials++;
+          } else {
+            has_previous_material = 1;
+          }
 
-    /* ambient texture */
-    if ((0 == strncmp(token, "map_Ka", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      material.ambient_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
-    }
+          /* initial temporary material */
+          initMaterial(&material);
+          material.pooled_names = (name_arena != arena);
 
-    /* diffuse texture */
-    if ((0 == strncmp(token, "map_Kd", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      material.diffuse_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
-    }
+          /* set new mtl name */
+          skip_space(&value, line_end);
+          material.name =
+              my_strdup(value, (size_t)until_space(value, line_end), name_arena);
 
-    /* specular texture */
-    if ((0 == strncmp(token, "map_Ks", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      material.specular_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
-    }
+          /* Add material to material table */
+          if (material_table && material.name &&
+              hash_table_set(material.name, strlen(material.name),
+                             num_materials, material_table) != HASH_TABLE_SUCCESS) {
+            goto cleanup;
+          }
+        }
+        break;
+
+      case 'K':
+        if (keyword_len == 2) {
+          if (token[1] == 'a') color = material.ambient;
+          else if (token[1] == 'd') color = material.diffuse;
+          else if (token[1] == 's') color = material.specular;
+          else if (token[1] == 't') color = material.transmittance;
+          else if (token[1] == 'e') color = material.emission;
+        }
+        break;
+
+      case 'N':
+        if (keyword_len == 2 && token[1] == 'i') {
+          /* ior(index of refraction) */
+          material.ior = parseFloat(&value, line_end);
+        } else if (keyword_len == 2 && token[1] == 's') {
+          /* shininess */
+          material.shininess = parseFloat(&value, line_end);
+        }
+        break;
 
-    /* specular highlight texture */
-    if ((0 == strncmp(token, "map_Ns", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      material.specular_highlight_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
-    }
+      case 'i':
+        /* illum model */
+        if (keyword_len == 5 && memcmp(token, "illum", 5) == 0) {
+          material.illum = parseInt(&value, line_end);
+        }
+        break;
+
+      case 'd':
+        if (keyword_len == 1) {
+          /* dissolve */
+          material.dissolve = parseFloat(&value, line_end);
+        } else if (keyword_len == 4 && memcmp(token, "disp", 4) == 0) {
+          /* displacement texture */
+          texname = &material.displacement_texname;
+        }
+        break;
 
-    /* bump texture */
-    if ((0 == strncmp(token, "map_bump", 8)) && IS_SPACE(token[8])) {
-      token += 9;
-      material.bump_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
-    }
+      case 'T':
+        if (keyword_len == 2 && token[1] == 'r') {
+          /* Invert value of Tr(assume Tr is in range [0, 1]) */
+          material.dissolve = 1.0f - parseFloat(&value, line_end);
+        }
+        break;
 
-    /* alpha texture */
-    if ((0 == strncmp(token, "map_d", 5)) && IS_SPACE(token[5])) {
-      token += 6;
-      material.alpha_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
-    }
+      case 'b':
+        /* bump texture */
+        if (keyword_len == 4 && memcmp(token, "bump", 4) == 0) {
+          texname = &material.bump_texname;
+        }
+        break;
+
+      case 'm':
+        if (keyword_len > 4 && memcmp(token, "map_", 4) == 0) {
+          const char *map = token + 4;
+          size_t map_len = keyword_len - 4;
+          if (map_len == 2 && map[0] == 'K') {
+            if (map[1] == 'a') texname = &material.ambient_texname;
+            else if (map[1] == 'd') texname = &material.diffuse_texname;
+            else if (map[1] == 's') texname = &material.specular_texname;
+          } else if (map_len == 2 && map[0] == 'N' && map[1] == 's') {
+            texname = &material.specular_highlight_texname;
+          } else if (map_len == 4 && memcmp(map, "bump", 4) == 0) {
+            texname = &material.bump_texname;
+          } else if (map_len == 1 && map[0] == 'd') {
+            texname = &material.alpha_texname;
+          }
+        }
+        break;
 
-    /* bump texture */
-    if ((0 == strncmp(token, "bump", 4)) && IS_SPACE(token[4])) {
-      token += 5;
-      material.bump_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
+      default:
+        /* @todo { unknown parameter } */
+        break;
     }
 
-    /* displacement texture */
-    if ((0 == strncmp(token, "disp", 4)) && IS_SPACE(token[4])) {
-      token += 5;
-      material.displacement_texname = my_strdup(token, (size_t) (line_end - token));
-      continue;
+    if (color) {
+      parseFloat3(&color[0], &color[1], &color[2], &value, line_end);
+    } else if (texname) {
+      /* A repeated map keeps the last one. */
+      tinyobj_free(name_arena, *texname, my_strsize(*texname));
+      *texname = my_strdup(value, (size_t)(line_end - value), name_arena);
     }
-
-    /* @todo { unknown parameter } */
   }
 
-	TINYOBJ_FREE(line_infos);
-
   if (material.name) {
     /* Flush last material element */
-    materials = tinyobj_material_add(materials, num_materials, &material);
+    added = tinyobj_material_add(materials, num_materials, &capacity,
+                                 &material, arena);
+    if (added == NULL) goto cleanup;
+    materials = added;
     num_materials++;
   }
+  ret = TINYOBJ_SUCCESS;
+
+cleanup:
+  /* On failure, the materials added so far are still returned. */
+  if (ret != TINYOBJ_SUCCESS) material_free_strings(&material, name_arena);
+  if (lines == &temp_lines) line_scanner_free(&temp_lines);
+  if (file_release) file_release(ctx, buf, len);
 
   (*num_materials_out) = num_materials;
   (*materials_out) = materials;
+  (*capacity_out) = capacity;
 
-  return TINYOBJ_SUCCESS;
+  return ret;
 }
 
 int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
                            size_t *num_materials_out,
                            const char *mtl_filename, const char *obj_filename, file_reader_callback file_reader,
                            void *ctx) {
-  return tinyobj_parse_and_index_mtl_file(materials_out, num_materials_out, mtl_filename, obj_filename, file_reader, ctx, NULL);
+  size_t capacity = 0;
+
+  if (materials_out == NULL || num_materials_out == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  (*materials_out) = NULL;
+  (*num_materials_out) = 0;
+
+  return tinyobj_parse_and_index_mtl_file(materials_out, num_materials_out, &capacity, mtl_filename, obj_filename, file_reader, ctx, NULL, NULL, NULL, NULL, NULL);
 }
 
 
@@ -1112,12 +2846,12 @@ typedef struct {
   float nx, ny, nz;
   float tx, ty;
 
-  /* @todo { Use dynamic array } */
-  tinyobj_vertex_index_t f[TINYOBJ_MAX_FACES_PER_F_LINE];
+  /* `f` and `l` lines: one face of `f_num_verts` vertices. `f` points into
+   * the FaceBuffer given to parseLine(NULL when faces are only counted). */
+  const tinyobj_vertex_index_t *f;
   size_t num_f;
-
-  int f_num_verts[TINYOBJ_MAX_FACES_PER_F_LINE];
-  size_t num_f_num_verts;
+  int f_num_verts;
+  int pad3;
 
   const char *group_name;
   unsigned int group_name_len;
@@ -1137,24 +2871,54 @@ typedef struct {
   CommandType type;
 } Command;
 
-static int parseLine(Command *command, const char *p, size_t p_len,
-                     int triangulate) {
-  char linebuf[4096];
-  const char *token;
-  assert(p_len < 4095);
+/* What parseLine should parse besides the command type. */
+#define PARSE_VERTEX_DATA (1 << 0) /* v, vn and vt values */
+#define PARSE_FACE_DATA (1 << 1)   /* f and l indices */
+
+/* Indices of the current `f` or `l` line. It is reused for every line and
+ * grows to the largest polygon, so polygons have no size limit. */
+typedef struct {
+  tinyobj_vertex_index_t *data;
+  size_t capacity;
+} FaceBuffer;
+
+static int face_buffer_reserve(FaceBuffer *faces, size_t size) {
+  size_t new_capacity = faces->capacity ? faces->capacity : 64;
+  tinyobj_vertex_index_t *data;
+
+  if (size <= faces->capacity) return TINYOBJ_SUCCESS;
+  while (new_capacity < size) new_capacity *= 2;
+  data = (tinyobj_vertex_index_t *)tracked_realloc(
+      faces->data, sizeof(tinyobj_vertex_index_t) * faces->capacity,
+      sizeof(tinyobj_vertex_index_t) * new_capacity);
+  if (data == NULL) return TINYOBJ_ERROR_MEMORY;
+  faces->data = data;
+  faces->capacity = new_capacity;
+  return TINYOBJ_SUCCESS;
+}
 
-  memcpy(linebuf, p, p_len);
-  linebuf[p_len] = '\0';
+static void face_buffer_free(FaceBuffer *faces) {
+  tracked_free(faces->data, sizeof(tinyobj_vertex_index_t) * faces->capacity);
+  faces->data = NULL;
+  faces->capacity = 0;
+}
 
-  token = linebuf;
+/* Returns 1 when `command` was filled, 0 for empty and unknown lines, and -1
+ * when `faces` could not grow. With PARSE_FACE_DATA and `faces` = NULL, face
+ * indices are only counted. */
+static int parseLine(Command *command, const char *p, size_t p_len,
+                     unsigned int parse_mask, FaceBuffer *faces) {
+  const char *token = p;
+  const char *end = p + p_len;
+  size_t left;
 
   command->type = COMMAND_EMPTY;
 
   /* Skip leading space. */
-  skip_space(&token);
+  skip_space(&token, end);
 
   assert(token);
-  if (token[0] == '\0') { /* empty line */
+  if (token >= end || token[0] == '\0') { /* empty line */
     return 0;
   }
 
@@ -1162,64 +2926,75 @@ static int parseLine(Command *command, const char *p, size_t p_len,
     return 0;
   }
 
+  /* Keywords must be followed by a space, so at least 2 chars are left. */
+  left = (size_t)(end - token);
+  if (left < 2) {
+    return 0;
+  }
+
   /* vertex */
   if (token[0] == 'v' && IS_SPACE((token[1]))) {
     float x, y, z;
+    command->type = COMMAND_V;
+    if (!(parse_mask & PARSE_VERTEX_DATA)) return 1;
     token += 2;
-    parseFloat3(&x, &y, &z, &token);
+    parseFloat3(&x, &y, &z, &token, end);
     command->vx = x;
     command->vy = y;
     command->vz = z;
-    command->type = COMMAND_V;
     return 1;
   }
 
   /* normal */
-  if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+  if (left > 2 && token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
     float x, y, z;
+    command->type = COMMAND_VN;
+    if (!(parse_mask & PARSE_VERTEX_DATA)) return 1;
     token += 3;
-    parseFloat3(&x, &y, &z, &token);
+    parseFloat3(&x, &y, &z, &token, end);
     command->nx = x;
     command->ny = y;
     command->nz = z;
-    command->type = COMMAND_VN;
     return 1;
   }
 
   /* texcoord */
-  if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+  if (left > 2 && token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
     float x, y;
+    command->type = COMMAND_VT;
+    if (!(parse_mask & PARSE_VERTEX_DATA)) return 1;
     token += 3;
-    parseFloat2(&x, &y, &token);
+    parseFloat2(&x, &y, &token, end);
     command->tx = x;
     command->ty = y;
-    command->type = COMMAND_VT;
     return 1;
   }
 
   /* line */
   if (token[0] == 'l' && IS_SPACE((token[1]))) {
     size_t num_f = 0;
-    
-    tinyobj_vertex_index_t f[2];
+
+    command->type = COMMAND_F;
+    if (!(parse_mask & PARSE_FACE_DATA)) return 1;
     token += 2;
-    skip_space(&token);
+    skip_space(&token, end);
+
+    if (faces && face_buffer_reserve(faces, 2) != TINYOBJ_SUCCESS) return -1;
 
-    while (!IS_NEW_LINE(token[0])) {
-      tinyobj_vertex_index_t vi = parseRawTriple(&token);
-      skip_space_and_cr(&token);
+    while (token < end && !IS_NEW_LINE(token[0])) {
+      tinyobj_vertex_index_t vi = parseRawTriple(&token, end);
+      skip_space_and_cr(&token, end);
 
-      f[num_f] = vi;
+      if (faces && num_f < 2) {
+        faces->data[num_f] = vi;
+      }
       num_f++;
     }
 
     assert(num_f == 2);
-    command->type = COMMAND_F;
-    command->f[0] = f[0];
-    command->f[1] = f[1];
+    command->f = faces ? faces->data : NULL;
     command->num_f = 2;
-    command->f_num_verts[0] = (int)num_f;
-    command->num_f_num_verts = 1;
+    command->f_num_verts = (int)num_f;
 
     return 1;
   }
@@ -1228,481 +3003,4648 @@ static int parseLine(Command *command, const char *p, size_t p_len,
   if (token[0] == 'f' && IS_SPACE((token[1]))) {
     size_t num_f = 0;
 
-    tinyobj_vertex_index_t f[TINYOBJ_MAX_FACES_PER_F_LINE];
-    token += 2;
-    skip_space(&token);
+    command->type = COMMAND_F;
+    if (!(parse_mask & PARSE_FACE_DATA)) return 1;
+    token += 2;
+    skip_space(&token, end);
+
+    while (token < end && !IS_NEW_LINE(token[0])) {
+      tinyobj_vertex_index_t vi = parseRawTriple(&token, end);
+      skip_space_and_cr(&token, end);
+
+      if (faces) {
+        if (num_f == faces->capacity &&
+            face_buffer_reserve(faces, num_f + 1) != TINYOBJ_SUCCESS) {
+          return -1;
+        }
+        faces->data[num_f] = vi;
+      }
+      num_f++;
+    }
+
+    command->f = faces ? faces->data : NULL;
+    command->num_f = num_f;
+    command->f_num_verts = (int)num_f;
+
+    return 1;
+  }
+
+  /* use mtl */
+  if (left > 6 && (0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
+    token += 7;
+
+    skip_space(&token, end);
+    command->material_name = token;
+    command->material_name_len = (unsigned int)length_until_newline(
+                                                                    token, (size_t)(end - token) + 1);
+    command->type = COMMAND_USEMTL;
+
+    return 1;
+  }
+
+  /* load mtl */
+  if (left > 6 && (0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+    /* All file names of the line, see mtl_loader_add. */
+    token += 7;
+
+    skip_space(&token, end);
+    command->mtllib_name = token;
+    command->mtllib_name_len = (unsigned int)length_until_newline(
+        token, (size_t)(end - token) + 1);
+    command->type = COMMAND_MTLLIB;
+
+    return 1;
+  }
+
+  /* group name */
+  if (token[0] == 'g' && IS_SPACE((token[1]))) {
+    /* @todo { multiple group name. } */
+    token += 2;
+
+    command->group_name = token;
+    command->group_name_len = (unsigned int)length_until_newline(
+        token, (size_t)(end - token) + 1);
+    command->type = COMMAND_G;
+
+    return 1;
+  }
+
+  /* object name */
+  if (token[0] == 'o' && IS_SPACE((token[1]))) {
+    /* @todo { multiple object name? } */
+    token += 2;
+
+    command->object_name = token;
+    command->object_name_len = (unsigned int)length_until_newline(
+        token, (size_t)(end - token) + 1);
+    command->type = COMMAND_O;
+
+    return 1;
+  }
+
+  return 0;
+}
+
+static size_t basename_len(const char *filename, size_t filename_length) {
+  /* Count includes NUL terminator. */
+  const char *p = &filename[filename_length - 1];
+  size_t count = 1;
+
+  /* On Windows, the directory delimiter is '\' and both it and '/' is
+   * reserved by the filesystem. On *nix platforms, only the '/' character 
+   * is reserved, so account for the two cases separately. */
+  #if _WIN32
+    while (p[-1] != '/' && p[-1] != '\\') {
+      if (p == filename) {
+        count = filename_length;
+        return count;
+      }
+      count++;
+      p--;
+    }
+    p++;
+    return count;
+  #else
+    while (*(--p) != '/') {
+      if (p == filename) {
+        count = filename_length;
+        return count;
+      }
+      count++;
+    }
+    return count;
+  #endif
+}
+
+static char *generate_mtl_filename(const char *obj_filename,
+                                   size_t obj_filename_length,
+                                   const char *mtllib_name,
+                                   size_t mtllib_name_length) {
+  /* Create a dynamically-allocated material filename. This allows the material
+   * and obj files to be separated, however the mtllib name in the OBJ file
+   * must be a relative path to the material file from the OBJ's directory.
+   * This does not support the matllib name as an absolute address. */
+  char *mtl_filename;
+  char *p;
+  size_t mtl_filename_length;
+  size_t obj_basename_length;
+
+  /* Calculate required size of mtl_filename and allocate */
+  obj_basename_length = basename_len(obj_filename, obj_filename_length);
+  mtl_filename_length = (obj_filename_length - obj_basename_length) + mtllib_name_length;
+  mtl_filename = (char *)tracked_malloc(mtl_filename_length);
+  if (mtl_filename == NULL) return NULL;
+
+  /* Copy over the obj's path */
+  memcpy(mtl_filename, obj_filename, (obj_filename_length - obj_basename_length));
+
+  /* Overwrite the obj basename with the mtllib name, filling the string */
+  p = &mtl_filename[mtl_filename_length - mtllib_name_length];
+  strcpy(p, mtllib_name);
+  return mtl_filename;
+}
+
+/* Groups faces into shapes at `o` and `g` lines. Shape lengths and offsets
+ * count `f` lines. A shape without faces is dropped. */
+typedef struct {
+  tinyobj_shape_t *shapes;
+  size_t num_shapes;
+  size_t capacity;
+  char *name;               /* Name of the current shape(may be NULL). */
+  unsigned int face_count;  /* # of `f` lines so far. */
+  unsigned int face_offset; /* First `f` line of the current shape. */
+  tinyobj_arena_t *arena;   /* Shapes are allocated here(may be NULL). */
+  tinyobj_arena_t *name_arena; /* Names are allocated here(may be NULL).
+                                * Other than `arena`, until they are pooled. */
+} ShapeBuilder;
+
+static int shape_builder_init(ShapeBuilder *builder, size_t capacity,
+                              tinyobj_arena_t *arena) {
+  if (capacity == 0) capacity = 1;
+  builder->arena = arena;
+  builder->name_arena = arena;
+  builder->shapes = (tinyobj_shape_t *)tinyobj_alloc(arena, sizeof(tinyobj_shape_t) * capacity);
+  builder->num_shapes = 0;
+  builder->capacity = capacity;
+  builder->name = NULL;
+  builder->face_count = 0;
+  builder->face_offset = 0;
+  return (builder->shapes == NULL) ? TINYOBJ_ERROR_MEMORY : TINYOBJ_SUCCESS;
+}
+
+/* Emit the current shape if it has faces. */
+static int shape_builder_flush(ShapeBuilder *builder) {
+  tinyobj_shape_t *shape;
+
+  if (builder->face_count == builder->face_offset) return TINYOBJ_SUCCESS;
+
+  if (builder->num_shapes == builder->capacity) {
+    size_t new_capacity = builder->capacity * 2;
+    tinyobj_shape_t *shapes = (tinyobj_shape_t *)tinyobj_realloc(
+        builder->arena, builder->shapes, sizeof(tinyobj_shape_t) * builder->capacity,
+        sizeof(tinyobj_shape_t) * new_capacity);
+    if (shapes == NULL) return TINYOBJ_ERROR_MEMORY;
+    builder->shapes = shapes;
+    builder->capacity = new_capacity;
+  }
+
+  shape = &builder->shapes[builder->num_shapes++];
+  shape->name = builder->name;
+  shape->face_offset = builder->face_offset;
+  shape->length = builder->face_count - builder->face_offset;
+  shape->pooled_name = (builder->name_arena != builder->arena);
+  shape->pad0 = 0;
+  builder->name = NULL;
+  builder->face_offset = builder->face_count;
+  return TINYOBJ_SUCCESS;
+}
+
+/* Start a new shape at an `o` or `g` line. */
+static int shape_builder_begin(ShapeBuilder *builder, const char *name,
+                               unsigned int name_len) {
+  int ret = shape_builder_flush(builder);
+  tinyobj_free(builder->name_arena, builder->name, my_strsize(builder->name));
+  builder->name = my_strndup(name, name_len, builder->name_arena); /* may be NULL */
+  return ret;
+}
+
+static void shape_builder_free(ShapeBuilder *builder) {
+  if (builder->arena == NULL) {
+    tinyobj_shapes_free(builder->shapes, builder->num_shapes);
+  }
+  tinyobj_free(builder->name_arena, builder->name, my_strsize(builder->name));
+  builder->shapes = NULL;
+  builder->num_shapes = 0;
+  builder->name = NULL;
+}
+
+/* Members of tinyobj_material_t holding a string. */
+static const size_t material_string_offsets[] = {
+  offsetof(tinyobj_material_t, name),
+  offsetof(tinyobj_material_t, ambient_texname),
+  offsetof(tinyobj_material_t, diffuse_texname),
+  offsetof(tinyobj_material_t, specular_texname),
+  offsetof(tinyobj_material_t, specular_highlight_texname),
+  offsetof(tinyobj_material_t, bump_texname),
+  offsetof(tinyobj_material_t, displacement_texname),
+  offsetof(tinyobj_material_t, alpha_texname)
+};
+
+#define NUM_MATERIAL_STRINGS \
+  (sizeof(material_string_offsets) / sizeof(material_string_offsets[0]))
+
+/* The `i`th string of the shapes followed by the strings of the materials. */
+static char **pooled_string(tinyobj_shape_t *shapes, size_t num_shapes,
+                            tinyobj_material_t *materials, size_t i) {
+  if (i < num_shapes) return &shapes[i].name;
+  i -= num_shapes;
+  return (char **)((char *)&materials[i / NUM_MATERIAL_STRINGS] +
+                   material_string_offsets[i % NUM_MATERIAL_STRINGS]);
+}
+
+/* Slot of the table of distinct names in string_pool_build. The hash is
+ * kept next to the offset, so a probe touches one cache line. */
+typedef struct {
+  uint32_t offset; /* Offset of the name in the pool + 1. 0 = empty. */
+  uint32_t hash;
+} StringPoolSlot;
+
+/* Copy the names of `shapes` and `materials` into `pool`, each distinct name
+ * once, and point them at the copies. The previous names are in a temporary
+ * arena of the caller. Nothing changes on error. */
+static int string_pool_build(tinyobj_string_pool_t *pool,
+                             tinyobj_shape_t *shapes, size_t num_shapes,
+                             tinyobj_material_t *materials,
+                             size_t num_materials) {
+  size_t num_strings = num_shapes + num_materials * NUM_MATERIAL_STRINGS;
+  size_t *offsets; /* Offset of each string in the pool. */
+  StringPoolSlot *slots;
+  size_t capacity = 16; /* in slots, power of two */
+  char *data = NULL;
+  size_t size = 0;
+  size_t data_capacity = 0;
+  size_t i;
+
+  while (capacity < 2 * num_strings) capacity *= 2;
+  offsets = (size_t *)tracked_malloc(sizeof(size_t) * (num_strings + 1));
+  slots = (StringPoolSlot *)tracked_calloc(capacity, sizeof(StringPoolSlot));
+  if (offsets == NULL || slots == NULL) goto fail;
+
+  /* 1. Append the first occurrence of each name. */
+  for (i = 0; i < num_strings; i++) {
+    const char *name = *pooled_string(shapes, num_shapes, materials, i);
+    StringPoolSlot *slot;
+    uint32_t hash;
+    size_t len;
+
+    if (name == NULL) continue;
+    len = strlen(name) + 1;
+    hash = (uint32_t)hash_djb2(name, len);
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bu;
+    hash ^= hash >> 16;
+
+    slot = &slots[hash & (capacity - 1)];
+    while (slot->offset != 0 &&
+           (slot->hash != hash || strcmp(data + slot->offset - 1, name) != 0)) {
+      slot = (slot == &slots[capacity - 1]) ? slots : slot + 1;
+    }
+    if (slot->offset == 0) {
+      if (size + len >= UINT32_MAX) goto fail; /* Offsets are 32 bit. */
+      if (size + len > data_capacity) {
+        size_t new_capacity = data_capacity ? 2 * data_capacity : 256;
+        char *p;
+        while (size + len > new_capacity) new_capacity *= 2;
+        p = (char *)tracked_realloc(data, data_capacity, new_capacity);
+        if (p == NULL) goto fail;
+        data = p;
+        data_capacity = new_capacity;
+      }
+      memcpy(data + size, name, len);
+      slot->offset = (uint32_t)(size + 1);
+      slot->hash = hash;
+      size += len;
+    }
+    offsets[i] = slot->offset - 1;
+  }
+  tracked_free(slots, sizeof(StringPoolSlot) * capacity);
+
+  if (size < data_capacity) {
+    char *p = (char *)tracked_realloc(data, data_capacity, size);
+    if (p != NULL) {
+      data = p;
+      data_capacity = size;
+    }
+  }
+
+  /* 2. Point the structs into the pool. */
+  for (i = 0; i < num_strings; i++) {
+    char **name = pooled_string(shapes, num_shapes, materials, i);
+
+    if (*name == NULL) continue;
+    *name = data + offsets[i];
+  }
+  tracked_free(offsets, sizeof(size_t) * (num_strings + 1));
+
+  pool->data = data;
+  pool->size = data_capacity;
+  return TINYOBJ_SUCCESS;
+
+fail:
+  tracked_free(data, data_capacity);
+  tracked_free(slots, sizeof(StringPoolSlot) * capacity);
+  tracked_free(offsets, sizeof(size_t) * (num_strings + 1));
+  return TINYOBJ_ERROR_MEMORY;
+}
+
+/* Material id for a `usemtl` name. -1 = default unknown material.
+ * `last_hit` remembers the entry(+ 1, 0 = none) of the previous lookup, as
+ * the same few names are usually switched between. */
+static int find_material_id(const hash_table_t *material_table,
+                            const char *name, size_t name_len,
+                            size_t *last_hit) {
+  hash_table_entry_t *entry;
+
+  if (*last_hit > 0 && *last_hit <= material_table->n) {
+    entry = material_table->entries + (*last_hit - 1);
+    if (entry->key_len == name_len &&
+        memcmp(material_table->keys + entry->key, name, name_len) == 0) {
+      return (int)entry->value;
+    }
+  }
+
+  entry = hash_table_find(name, name_len, hash_djb2(name, name_len),
+                          material_table);
+  if (entry == NULL) return -1;
+
+  *last_hit = (size_t)(entry - material_table->entries) + 1;
+  return (int)entry->value;
+}
+
+/* .mtl files of the `mtllib` lines. Every file is loaded, in the order it is
+ * first referenced, into one materials array and `material_table`, so the
+ * material ids do not depend on how materials are split into files. A name
+ * defined in several files refers to the last definition. */
+typedef struct {
+  char **filenames; /* Looked up next to `obj_filename`. */
+  size_t num_filenames;
+  size_t filenames_capacity;
+  size_t num_loaded;
+
+  tinyobj_material_t *materials;
+  size_t num_materials;
+  size_t materials_capacity;
+  hash_table_t *material_table;
+
+  const char *obj_filename;
+  file_reader_callback file_reader;
+  void *ctx;
+  file_release_callback file_release; /* May be NULL. */
+  tinyobj_arena_t *arena; /* For the materials(may be NULL). */
+  tinyobj_arena_t *name_arena; /* For their names, `arena` unless pooled. */
+  tinyobj_parse_stats_t *stats; /* Allocations of mtl_loader_task. */
+  LineScanner *lines; /* Line table to reuse(may be NULL). */
+  int status; /* TINYOBJ_ERROR_MEMORY once an allocation failed. */
+} MtlLoader;
+
+static void mtl_loader_init(MtlLoader *loader, const char *obj_filename,
+                            file_reader_callback file_reader, void *ctx,
+                            hash_table_t *material_table,
+                            tinyobj_arena_t *arena) {
+  memset(loader, 0, sizeof(MtlLoader));
+  loader->material_table = material_table;
+  loader->obj_filename = obj_filename;
+  loader->file_reader = file_reader;
+  loader->ctx = ctx;
+  loader->arena = arena;
+  loader->name_arena = arena;
+}
+
+/* Frees the file names. The materials are the caller's. */
+static void mtl_loader_free(MtlLoader *loader) {
+  size_t i;
+  for (i = 0; i < loader->num_filenames; i++) {
+    tracked_free(loader->filenames[i], strlen(loader->filenames[i]) + 1);
+  }
+  tracked_free(loader->filenames, sizeof(char *) * loader->filenames_capacity);
+  loader->filenames = NULL;
+  loader->num_filenames = 0;
+  loader->filenames_capacity = 0;
+}
+
+static void mtl_loader_add_file(MtlLoader *loader, const char *name,
+                                size_t name_len) {
+  char *mtl_filename;
+  size_t i;
+
+  if (loader->obj_filename) {
+    /* Maximum length allowed by Linux - higher than Windows and macOS */
+    size_t obj_filename_len = my_strnlen(loader->obj_filename, 4096 + 255) + 1;
+    char *mtllib_name = my_strndup(name, name_len, NULL);
+    if (mtllib_name == NULL) {
+      loader->status = TINYOBJ_ERROR_MEMORY;
+      return;
+    }
+
+    /* allow for NUL terminator */
+    mtl_filename = generate_mtl_filename(loader->obj_filename, obj_filename_len,
+                                         mtllib_name, name_len + 1);
+    tracked_free(mtllib_name, name_len + 1);
+  } else {
+    mtl_filename = my_strndup(name, name_len, NULL);
+  }
+  if (mtl_filename == NULL) {
+    loader->status = TINYOBJ_ERROR_MEMORY;
+    return;
+  }
+
+  for (i = 0; i < loader->num_filenames; i++) {
+    if (strcmp(loader->filenames[i], mtl_filename) == 0) {
+      tracked_free(mtl_filename, strlen(mtl_filename) + 1);
+      return;
+    }
+  }
+
+  if (loader->num_filenames == loader->filenames_capacity) {
+    size_t new_capacity =
+        loader->filenames_capacity ? 2 * loader->filenames_capacity : 4;
+    char **filenames = (char **)tracked_realloc(
+        loader->filenames, sizeof(char *) * loader->filenames_capacity,
+        sizeof(char *) * new_capacity);
+    if (filenames == NULL) {
+      tracked_free(mtl_filename, strlen(mtl_filename) + 1);
+      loader->status = TINYOBJ_ERROR_MEMORY;
+      return;
+    }
+    loader->filenames = filenames;
+    loader->filenames_capacity = new_capacity;
+  }
+  loader->filenames[loader->num_filenames++] = mtl_filename;
+}
+
+/* Add the files of a `mtllib` command(`mtllib a.mtl b.mtl`). */
+static void mtl_loader_add(MtlLoader *loader, const Command *command) {
+  const char *token = command->mtllib_name;
+  const char *end;
+
+  if (!token || command->mtllib_name_len == 0) return;
+  end = token + length_until_line_feed(token, command->mtllib_name_len);
+
+  for (;;) {
+    size_t name_len;
+    skip_space_and_cr(&token, end);
+    name_len = (size_t)until_space(token, end);
+    if (name_len == 0) break;
+    mtl_loader_add_file(loader, token, name_len);
+    token += name_len;
+  }
+}
+
+/* Load the files added since the previous call. */
+static void mtl_loader_load(MtlLoader *loader) {
+  for (; loader->num_loaded < loader->num_filenames; loader->num_loaded++) {
+    const char *mtl_filename = loader->filenames[loader->num_loaded];
+    int ret = tinyobj_parse_and_index_mtl_file(
+        &loader->materials, &loader->num_materials,
+        &loader->materials_capacity, mtl_filename, loader->obj_filename,
+        loader->file_reader, loader->ctx, loader->file_release,
+        loader->material_table,
+        loader->lines, loader->arena, loader->name_arena);
+
+    if (ret == TINYOBJ_ERROR_MEMORY) {
+      loader->status = ret;
+    } else if (ret != TINYOBJ_SUCCESS) {
+      /* warning. */
+      fprintf(stderr, "TINYOBJ: Failed to parse material file '%s': %d\n", mtl_filename, ret);
+    }
+  }
+}
+
+static void mtl_loader_task(void *arg, size_t task_id) {
+  MtlLoader *loader = (MtlLoader *)arg;
+  tinyobj_parse_stats_t *prev_stats = tinyobj_track_allocs(loader->stats);
+  (void)task_id;
+  mtl_loader_load(loader);
+  tinyobj_track_allocs(prev_stats);
+}
+
+/* Triangulation of parsed faces. A face of n vertices gives n - 2 triangles.
+ * Faces with less than 3 vertices(`l` lines) are kept as they are. */
+static size_t triangulated_num_faces(size_t n) {
+  return (n < 3) ? 1 : n - 2;
+}
+
+static size_t triangulated_num_indices(size_t n) {
+  return (n < 3) ? n : 3 * (n - 2);
+}
+
+/* Fan around the first vertex: (0, 1, 2), (0, 2, 3), ... */
+static void triangulate_fan(const tinyobj_vertex_index_t *poly, size_t n,
+                            tinyobj_vertex_index_t *out) {
+  size_t k;
+  for (k = 0; k + 2 < n; k++) {
+    out[3 * k + 0] = poly[0];
+    out[3 * k + 1] = poly[k + 1];
+    out[3 * k + 2] = poly[k + 2];
+  }
+}
+
+/* Scratch space of triangulate_ear_clip for polygons of up to `n` vertices. */
+static size_t ear_clip_scratch_size(size_t n) {
+  return n * (2 * sizeof(double) + sizeof(size_t));
+}
+
+/* > 0 when a, b, c turn counter-clockwise. */
+static double cross2(const double *a, const double *b, const double *c) {
+  return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+static int same_point2(const double *a, const double *b) {
+  return a[0] == b[0] && a[1] == b[1];
+}
+
+/* Corner `cur` can be cut off when it is convex and no other remaining
+ * vertex lies in the triangle. */
+static int is_ear(const double *uv, const size_t *remain, size_t m,
+                  size_t prev, size_t cur, size_t next) {
+  const double *a = &uv[2 * prev];
+  const double *b = &uv[2 * cur];
+  const double *c = &uv[2 * next];
+  size_t k;
+
+  if (cross2(a, b, c) <= 0.0) return 0;
+
+  for (k = 0; k < m; k++) {
+    size_t j = remain[k];
+    const double *p = &uv[2 * j];
+    if (j == prev || j == cur || j == next) continue;
+    if (same_point2(p, a) || same_point2(p, b) || same_point2(p, c)) continue;
+    if (cross2(a, b, p) >= 0.0 && cross2(b, c, p) >= 0.0 &&
+        cross2(c, a, p) >= 0.0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Ear clipping of a polygon(n > 3) projected on its plane. Falls back to a
+ * fan when the polygon refers to missing vertices or has no area. When no
+ * ear is found(self-intersecting polygons), the current corner is cut off
+ * anyway, so the result always has n - 2 triangles. */
+static void triangulate_ear_clip(const tinyobj_vertex_index_t *poly, size_t n,
+                                 const float *vertices, size_t num_vertices,
+                                 void *scratch, tinyobj_vertex_index_t *out) {
+  double *uv = (double *)scratch;
+  size_t *remain = (size_t *)(void *)(uv + 2 * n);
+  double normal[3] = {0.0, 0.0, 0.0};
+  double ax, ay, az, orient;
+  int u_axis, v_axis;
+  size_t m = n;
+  size_t i = 0;
+  size_t tries = 0;
+  size_t k;
+
+  for (k = 0; k < n; k++) {
+    if (poly[k].v_idx < 0 || (size_t)poly[k].v_idx >= num_vertices) {
+      triangulate_fan(poly, n, out);
+      return;
+    }
+  }
+
+  /* Newell's method. Each component is twice the area projected on the
+   * plane orthogonal to that axis. */
+  for (k = 0; k < n; k++) {
+    const float *a = &vertices[3 * poly[k].v_idx];
+    const float *b = &vertices[3 * poly[(k + 1) % n].v_idx];
+    normal[0] += ((double)a[1] - b[1]) * ((double)a[2] + b[2]);
+    normal[1] += ((double)a[2] - b[2]) * ((double)a[0] + b[0]);
+    normal[2] += ((double)a[0] - b[0]) * ((double)a[1] + b[1]);
+  }
+
+  /* Drop the largest axis. (x, y), (y, z) and (z, x) keep the winding of
+   * the normal component they are orthogonal to. */
+  ax = normal[0] < 0.0 ? -normal[0] : normal[0];
+  ay = normal[1] < 0.0 ? -normal[1] : normal[1];
+  az = normal[2] < 0.0 ? -normal[2] : normal[2];
+  if (az >= ax && az >= ay) {
+    u_axis = 0;
+    v_axis = 1;
+    orient = normal[2];
+  } else if (ax >= ay) {
+    u_axis = 1;
+    v_axis = 2;
+    orient = normal[0];
+  } else {
+    u_axis = 2;
+    v_axis = 0;
+    orient = normal[1];
+  }
+  if (orient == 0.0) {
+    triangulate_fan(poly, n, out);
+    return;
+  }
+
+  /* Mirror clockwise polygons so that ears turn counter-clockwise. */
+  for (k = 0; k < n; k++) {
+    const float *a = &vertices[3 * poly[k].v_idx];
+    uv[2 * k + 0] = a[u_axis];
+    uv[2 * k + 1] = (orient > 0.0) ? a[v_axis] : -(double)a[v_axis];
+    remain[k] = k;
+  }
+
+  while (m > 3) {
+    size_t prev = remain[(i + m - 1) % m];
+    size_t cur = remain[i];
+    size_t next = remain[(i + 1) % m];
+
+    if (tries >= m || is_ear(uv, remain, m, prev, cur, next)) {
+      out[0] = poly[prev];
+      out[1] = poly[cur];
+      out[2] = poly[next];
+      out += 3;
+      memmove(&remain[i], &remain[i + 1], sizeof(size_t) * (m - i - 1));
+      m--;
+      if (i == m) i = 0;
+      tries = 0;
+    } else {
+      i = (i + 1) % m;
+      tries++;
+    }
+  }
+  out[0] = poly[remain[0]];
+  out[1] = poly[remain[1]];
+  out[2] = poly[remain[2]];
+}
+
+/* Faces of one task. Counts are turned into offsets(exclusive prefix sum)
+ * before triangles are written. */
+typedef struct {
+  size_t face_begin;
+  size_t face_end;
+  size_t index_begin; /* First index of face_begin in attrib->faces. */
+  size_t num_faces;   /* Output faces. */
+  size_t num_indices; /* Output indices. */
+  size_t max_verts;   /* Largest face. */
+  void *scratch;      /* For ear clipping. */
+} TriangulateChunk;
+
+typedef struct {
+  const tinyobj_attrib_t *attrib;
+  tinyobj_triangles_t *out;
+  TriangulateChunk *chunks;
+  int method;
+  int pad0;
+} TriangulateTask;
+
+static size_t face_size(const tinyobj_attrib_t *attrib, size_t f) {
+  return (attrib->face_num_verts[f] > 0) ? (size_t)attrib->face_num_verts[f] : 0;
+}
+
+static void triangulate_count_task(void *arg, size_t task_id) {
+  TriangulateTask *task = (TriangulateTask *)arg;
+  TriangulateChunk *chunk = &task->chunks[task_id];
+  size_t f;
+
+  for (f = chunk->face_begin; f < chunk->face_end; f++) {
+    size_t n = face_size(task->attrib, f);
+    chunk->index_begin += n;
+    chunk->num_faces += triangulated_num_faces(n);
+    chunk->num_indices += triangulated_num_indices(n);
+    if (n > chunk->max_verts) chunk->max_verts = n;
+  }
+}
+
+static void triangulate_emit_task(void *arg, size_t task_id) {
+  TriangulateTask *task = (TriangulateTask *)arg;
+  const TriangulateChunk *chunk = &task->chunks[task_id];
+  const tinyobj_attrib_t *attrib = task->attrib;
+  tinyobj_triangles_t *out = task->out;
+  size_t index = chunk->index_begin;
+  size_t out_face = chunk->num_faces;
+  size_t out_index = chunk->num_indices;
+  size_t f, k;
+
+  for (f = chunk->face_begin; f < chunk->face_end; f++) {
+    size_t n = face_size(attrib, f);
+    size_t num_faces = triangulated_num_faces(n);
+    const tinyobj_vertex_index_t *poly = &attrib->faces[index];
+    tinyobj_vertex_index_t *dst = &out->faces[out_index];
+    int material_id = attrib->material_ids ? attrib->material_ids[f] : -1;
+
+    if (n < 3) {
+      for (k = 0; k < n; k++) dst[k] = poly[k];
+    } else if (task->method == TINYOBJ_TRIANGULATE_EAR_CLIP && n > 3) {
+      triangulate_ear_clip(poly, n, attrib->vertices, attrib->num_vertices,
+                           chunk->scratch, dst);
+    } else {
+      triangulate_fan(poly, n, dst);
+    }
+
+    for (k = 0; k < num_faces; k++) {
+      out->face_num_verts[out_face + k] = (n < 3) ? (int)n : 3;
+      out->material_ids[out_face + k] = material_id;
+    }
+
+    index += n;
+    out_face += num_faces;
+    out_index += triangulated_num_indices(n);
+  }
+}
+
+/* Triangulate the faces of `attrib` into `triangles` with `num_threads`
+ * tasks. Outputs are allocated from `arena`(may be NULL). */
+static int triangulate_faces(tinyobj_triangles_t *triangles,
+                             const tinyobj_attrib_t *attrib, int method,
+                             size_t num_threads, tinyobj_arena_t *arena) {
+  size_t num_faces = attrib->num_face_num_verts;
+  size_t num_indices = 0;
+  size_t num_out_faces = 0;
+  size_t num_out_indices = 0;
+  TriangulateChunk *chunks;
+  TriangulateTask task;
+  size_t t;
+  int ret = TINYOBJ_SUCCESS;
+
+  memset(triangles, 0, sizeof(tinyobj_triangles_t));
+  if (num_faces == 0) {
+    return (attrib->num_faces == 0) ? TINYOBJ_SUCCESS : TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  if (num_threads < 1) num_threads = 1;
+
+  chunks = (TriangulateChunk *)tracked_calloc(num_threads, sizeof(TriangulateChunk));
+  if (chunks == NULL) return TINYOBJ_ERROR_MEMORY;
+  for (t = 0; t < num_threads; t++) {
+    chunks[t].face_begin = (num_faces * t) / num_threads;
+    chunks[t].face_end = (num_faces * (t + 1)) / num_threads;
+  }
+
+  task.attrib = attrib;
+  task.out = triangles;
+  task.chunks = chunks;
+  task.method = method;
+
+  /* 1. Exact output sizes. */
+  tinyobj_parallel_for(num_threads, num_threads, triangulate_count_task, &task);
+  for (t = 0; t < num_threads; t++) {
+    size_t n;
+
+    n = chunks[t].index_begin;
+    chunks[t].index_begin = num_indices;
+    num_indices += n;
+
+    n = chunks[t].num_faces;
+    chunks[t].num_faces = num_out_faces;
+    num_out_faces += n;
+
+    n = chunks[t].num_indices;
+    chunks[t].num_indices = num_out_indices;
+    num_out_indices += n;
+  }
+  if (num_indices != attrib->num_faces) {
+    ret = TINYOBJ_ERROR_INVALID_PARAMETER;
+    goto cleanup;
+  }
+
+  triangles->faces = (tinyobj_vertex_index_t *)tinyobj_alloc(
+      arena, sizeof(tinyobj_vertex_index_t) * num_out_indices);
+  triangles->face_num_verts = (int *)tinyobj_alloc(arena, sizeof(int) * num_out_faces);
+  triangles->material_ids = (int *)tinyobj_alloc(arena, sizeof(int) * num_out_faces);
+  if (triangles->faces == NULL || triangles->face_num_verts == NULL ||
+      triangles->material_ids == NULL) {
+    ret = TINYOBJ_ERROR_MEMORY;
+    goto cleanup;
+  }
+  triangles->num_faces = (unsigned int)num_out_indices;
+  triangles->num_face_num_verts = (unsigned int)num_out_faces;
+
+  if (method == TINYOBJ_TRIANGULATE_EAR_CLIP) {
+    for (t = 0; t < num_threads; t++) {
+      if (chunks[t].max_verts <= 3) continue;
+      chunks[t].scratch = tracked_malloc(ear_clip_scratch_size(chunks[t].max_verts));
+      if (chunks[t].scratch == NULL) {
+        ret = TINYOBJ_ERROR_MEMORY;
+        goto cleanup;
+      }
+    }
+  }
+
+  /* 2. Each task writes at its own offsets. */
+  tinyobj_parallel_for(num_threads, num_threads, triangulate_emit_task, &task);
+
+cleanup:
+  if (ret != TINYOBJ_SUCCESS) {
+    if (arena == NULL) {
+      tracked_free(triangles->faces, sizeof(tinyobj_vertex_index_t) * num_out_indices);
+      tracked_free(triangles->face_num_verts, sizeof(int) * num_out_faces);
+      tracked_free(triangles->material_ids, sizeof(int) * num_out_faces);
+    }
+    memset(triangles, 0, sizeof(tinyobj_triangles_t));
+  }
+  for (t = 0; t < num_threads; t++) {
+    tracked_free(chunks[t].scratch, ear_clip_scratch_size(chunks[t].max_verts));
+  }
+  tracked_free(chunks, num_threads * sizeof(TriangulateChunk));
+  return ret;
+}
+
+/* Quantization of attributes(TINYOBJ_FLAG_QUANTIZE_*). Positions and
+ * texcoords are mapped linearly from their bounding box to 0..65535. */
+
+typedef struct {
+  float min[3];
+  float max[3];
+} QuantBounds;
+
+static void quant_bounds_init(QuantBounds *bounds) {
+  size_t k;
+  for (k = 0; k < 3; k++) {
+    bounds->min[k] = FLT_MAX;
+    bounds->max[k] = -FLT_MAX;
+  }
+}
+
+/* NaN values are ignored. */
+static void quant_bounds_add(QuantBounds *bounds, const float *v, size_t n) {
+  size_t k;
+  for (k = 0; k < n; k++) {
+    if (v[k] < bounds->min[k]) bounds->min[k] = v[k];
+    if (v[k] > bounds->max[k]) bounds->max[k] = v[k];
+  }
+}
+
+static void quant_bounds_merge(QuantBounds *bounds, const QuantBounds *other) {
+  size_t k;
+  for (k = 0; k < 3; k++) {
+    if (other->min[k] < bounds->min[k]) bounds->min[k] = other->min[k];
+    if (other->max[k] > bounds->max[k]) bounds->max[k] = other->max[k];
+  }
+}
+
+/* Dequantization parameters of `n` components, and the inverse of `scale`
+ * used to quantize. An empty or flat range gives scale 0 and all values 0. */
+static void quant_params(const QuantBounds *bounds, size_t n, float *offset,
+                         float *scale, float *inv_scale) {
+  size_t k;
+  for (k = 0; k < n; k++) {
+    float extent = bounds->max[k] - bounds->min[k];
+    if (!(bounds->min[k] <= bounds->max[k])) {
+      offset[k] = 0.0f;
+      scale[k] = 0.0f;
+      inv_scale[k] = 0.0f;
+      continue;
+    }
+    offset[k] = bounds->min[k];
+    scale[k] = extent / 65535.0f;
+    inv_scale[k] = (extent > 0.0f) ? 65535.0f / extent : 0.0f;
+  }
+}
+
+static uint16_t quantize_unorm16(float v, float offset, float inv_scale) {
+  float q = (v - offset) * inv_scale + 0.5f;
+  if (!(q > 0.0f)) return 0; /* Also NaN. */
+  if (q >= 65535.0f) return 65535;
+  return (uint16_t)q;
+}
+
+static int16_t quantize_snorm16(float v) {
+  float q = v * 32767.0f;
+  if (!(q > -32767.0f)) return -32767; /* Also NaN. */
+  if (q >= 32767.0f) return 32767;
+  return (int16_t)(q + ((q < 0.0f) ? -0.5f : 0.5f));
+}
+
+static float tinyobj_absf(float v) { return (v < 0.0f) ? -v : v; }
+
+static float tinyobj_signf(float v) { return (v < 0.0f) ? -1.0f : 1.0f; }
+
+/* Square root without libm: Newton's method from an estimate made of the
+ * exponent bits. */
+static float tinyobj_sqrtf(float x) {
+  uint32_t bits;
+  float y;
+  int i;
+
+  if (!(x > 0.0f)) return 0.0f;
+  memcpy(&bits, &x, sizeof(bits));
+  bits = (bits >> 1) + 0x1fbd1df5u;
+  memcpy(&y, &bits, sizeof(y));
+  for (i = 0; i < 3; i++) y = 0.5f * (y + x / y);
+  return y;
+}
+
+/* Project the normal on the octahedron |x| + |y| + |z| = 1 and unfold the
+ * lower half, so two coordinates in [-1, 1] remain. */
+static void oct_encode_normal(float x, float y, float z, int16_t oct[2]) {
+  float l1 = tinyobj_absf(x) + tinyobj_absf(y) + tinyobj_absf(z);
+  float u, v;
+
+  if (!(l1 > 0.0f)) {
+    oct[0] = 0;
+    oct[1] = 0;
+    return;
+  }
+  u = x / l1;
+  v = y / l1;
+  if (z < 0.0f) {
+    float folded_u = (1.0f - tinyobj_absf(v)) * tinyobj_signf(u);
+    v = (1.0f - tinyobj_absf(u)) * tinyobj_signf(v);
+    u = folded_u;
+  }
+  oct[0] = quantize_snorm16(u);
+  oct[1] = quantize_snorm16(v);
+}
+
+/* An `o` or `g` line, and the number of faces before it. */
+typedef struct {
+  size_t line;
+  size_t face_count;
+} ShapeStart;
+
+/* Range of lines handled by one task, and what was found in it. */
+typedef struct {
+  size_t line_begin;
+  size_t line_end;
+
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_faces; /* # of `f` and `l` lines */
+  size_t num_o;
+  size_t num_g;
+  size_t num_usemtl;
+  size_t num_mtllib;
+  size_t max_face_size; /* # of indices of the largest face */
+
+  /* Lines from the first to the last `mtllib` line of the chunk. */
+  size_t mtllib_line_begin;
+  size_t mtllib_line_end;
+
+  size_t usemtl_line; /* Last `usemtl` line with a name + 1. 0 = none. */
+
+  /* Bounding boxes of v and vt for quantization. */
+  QuantBounds v_bounds;
+  QuantBounds vt_bounds;
+
+  /* Face pass: offsets of the first face, the material in effect at the
+   * first line, the indices of the current face and the shape starts. */
+  size_t f_offset;
+  size_t face_offset;
+  int material_id;
+  int pad0;
+  FaceBuffer faces;
+  ShapeStart *shape_starts;
+  size_t num_shape_starts;
+} LineChunk;
+
+typedef struct {
+  const LineInfo *line_infos;
+  const char *buf;
+  LineChunk *chunks;
+  tinyobj_attrib_t *attrib;
+  const hash_table_t *material_table;
+  float vertex_inv_scale[3];   /* See quant_params. */
+  float texcoord_inv_scale[2];
+} ParseLinesTask;
+
+/* Pass 1: count elements in a chunk so outputs can be allocated once. */
+static void count_line_chunk(void *arg, size_t task_id) {
+  ParseLinesTask *task = (ParseLinesTask *)arg;
+  LineChunk *chunk = &task->chunks[task_id];
+  Command command;
+  size_t i;
+
+  for (i = chunk->line_begin; i < chunk->line_end; i++) {
+    int ret = parseLine(&command, &task->buf[task->line_infos[i].pos],
+                        task->line_infos[i].len, PARSE_FACE_DATA, NULL);
+    if (ret) {
+      if (command.type == COMMAND_V) {
+        chunk->num_v++;
+      } else if (command.type == COMMAND_VN) {
+        chunk->num_vn++;
+      } else if (command.type == COMMAND_VT) {
+        chunk->num_vt++;
+      } else if (command.type == COMMAND_F) {
+        chunk->num_f += command.num_f;
+        chunk->num_faces++;
+        if (command.num_f > chunk->max_face_size) {
+          chunk->max_face_size = command.num_f;
+        }
+      } else if (command.type == COMMAND_O) {
+        chunk->num_o++;
+      } else if (command.type == COMMAND_G) {
+        chunk->num_g++;
+      } else if (command.type == COMMAND_USEMTL) {
+        if (command.material_name && command.material_name_len > 0) {
+          chunk->usemtl_line = i + 1;
+        }
+        chunk->num_usemtl++;
+      } else if (command.type == COMMAND_MTLLIB) {
+        if (chunk->num_mtllib == 0) chunk->mtllib_line_begin = i;
+        chunk->mtllib_line_end = i + 1;
+        chunk->num_mtllib++;
+      }
+    }
+  }
+}
+
+/* Bounding boxes of the v and vt values of a chunk, before they are
+ * quantized by parse_vertex_chunk. */
+static void bound_vertex_chunk(void *arg, size_t task_id) {
+  ParseLinesTask *task = (ParseLinesTask *)arg;
+  LineChunk *chunk = &task->chunks[task_id];
+  Command command;
+  size_t i;
+
+  quant_bounds_init(&chunk->v_bounds);
+  quant_bounds_init(&chunk->vt_bounds);
+  for (i = chunk->line_begin; i < chunk->line_end; i++) {
+    int ret = parseLine(&command, &task->buf[task->line_infos[i].pos],
+                        task->line_infos[i].len, PARSE_VERTEX_DATA, NULL);
+    if (!ret) continue;
+
+    if (command.type == COMMAND_V) {
+      float v[3];
+      v[0] = command.vx;
+      v[1] = command.vy;
+      v[2] = command.vz;
+      quant_bounds_add(&chunk->v_bounds, v, 3);
+    } else if (command.type == COMMAND_VT) {
+      float t[2];
+      t[0] = command.tx;
+      t[1] = command.ty;
+      quant_bounds_add(&chunk->vt_bounds, t, 2);
+    }
+  }
+}
+
+/* Pass 2: parse v, vn and vt lines of a chunk straight into the output
+ * arrays. Chunk counts have been turned into offsets(exclusive prefix sum)
+ * before this runs. Quantized arrays are written instead of the float
+ * arrays when they are allocated. */
+static void parse_vertex_chunk(void *arg, size_t task_id) {
+  ParseLinesTask *task = (ParseLinesTask *)arg;
+  const LineChunk *chunk = &task->chunks[task_id];
+  tinyobj_attrib_t *attrib = task->attrib;
+  size_t v_count = chunk->num_v;
+  size_t n_count = chunk->num_vn;
+  size_t t_count = chunk->num_vt;
+  Command command;
+  size_t i;
+
+  for (i = chunk->line_begin; i < chunk->line_end; i++) {
+    int ret = parseLine(&command, &task->buf[task->line_infos[i].pos],
+                        task->line_infos[i].len, PARSE_VERTEX_DATA, NULL);
+    if (!ret) continue;
+
+    if (command.type == COMMAND_V) {
+      if (attrib->quantized_vertices) {
+        uint16_t *q = &attrib->quantized_vertices[3 * v_count];
+        q[0] = quantize_unorm16(command.vx, attrib->vertex_offset[0],
+                                task->vertex_inv_scale[0]);
+        q[1] = quantize_unorm16(command.vy, attrib->vertex_offset[1],
+                                task->vertex_inv_scale[1]);
+        q[2] = quantize_unorm16(command.vz, attrib->vertex_offset[2],
+                                task->vertex_inv_scale[2]);
+      } else {
+        attrib->vertices[3 * v_count + 0] = command.vx;
+        attrib->vertices[3 * v_count + 1] = command.vy;
+        attrib->vertices[3 * v_count + 2] = command.vz;
+      }
+      v_count++;
+    } else if (command.type == COMMAND_VN) {
+      if (attrib->quantized_normals) {
+        oct_encode_normal(command.nx, command.ny, command.nz,
+                          &attrib->quantized_normals[2 * n_count]);
+      } else {
+        attrib->normals[3 * n_count + 0] = command.nx;
+        attrib->normals[3 * n_count + 1] = command.ny;
+        attrib->normals[3 * n_count + 2] = command.nz;
+      }
+      n_count++;
+    } else if (command.type == COMMAND_VT) {
+      if (attrib->quantized_texcoords) {
+        uint16_t *q = &attrib->quantized_texcoords[2 * t_count];
+        q[0] = quantize_unorm16(command.tx, attrib->texcoord_offset[0],
+                                task->texcoord_inv_scale[0]);
+        q[1] = quantize_unorm16(command.ty, attrib->texcoord_offset[1],
+                                task->texcoord_inv_scale[1]);
+      } else {
+        attrib->texcoords[2 * t_count + 0] = command.tx;
+        attrib->texcoords[2 * t_count + 1] = command.ty;
+      }
+      t_count++;
+    }
+  }
+}
+
+/* Pass 3: faces of a chunk, written at the chunk's face offsets. Relative
+ * indices are resolved with the v/vn/vt offsets of the chunk, and
+ * `material_id` carries the `usemtl` state of the previous chunks. `o` and
+ * `g` lines are only recorded, shapes are built in line order afterwards. */
+static void parse_face_chunk(void *arg, size_t task_id) {
+  ParseLinesTask *task = (ParseLinesTask *)arg;
+  LineChunk *chunk = &task->chunks[task_id];
+  tinyobj_attrib_t *attrib = task->attrib;
+  size_t v_count = chunk->num_v;
+  size_t n_count = chunk->num_vn;
+  size_t t_count = chunk->num_vt;
+  size_t f_count = chunk->f_offset;
+  size_t face_count = chunk->face_offset;
+  int material_id = chunk->material_id;
+  size_t material_hit = 0;
+  Command command;
+  size_t i;
+
+  for (i = chunk->line_begin; i < chunk->line_end; i++) {
+    if (parseLine(&command, &task->buf[task->line_infos[i].pos],
+                  task->line_infos[i].len, PARSE_FACE_DATA, &chunk->faces) <= 0) {
+      continue; /* `faces` never grows here. */
+    }
+
+    if (command.type == COMMAND_USEMTL) {
+      if (command.material_name && command.material_name_len > 0) {
+        material_id = find_material_id(task->material_table, command.material_name,
+                                       command.material_name_len, &material_hit);
+      }
+    } else if (command.type == COMMAND_V) {
+      v_count++;
+    } else if (command.type == COMMAND_VN) {
+      n_count++;
+    } else if (command.type == COMMAND_VT) {
+      t_count++;
+    } else if (command.type == COMMAND_F) {
+      size_t k = 0;
+      if (attrib->faces) {
+        for (k = 0; k < command.num_f; k++) {
+          tinyobj_vertex_index_t vi = command.f[k];
+          attrib->faces[f_count + k].v_idx = fixIndex(vi.v_idx, v_count);
+          attrib->faces[f_count + k].vn_idx = fixIndex(vi.vn_idx, n_count);
+          attrib->faces[f_count + k].vt_idx = fixIndex(vi.vt_idx, t_count);
+        }
+      } else {
+        for (k = 0; k < command.num_f; k++) {
+          tinyobj_vertex_index_t vi = command.f[k];
+          attrib->v_indices[f_count + k] = fixIndex(vi.v_idx, v_count);
+          if (attrib->vt_indices) {
+            attrib->vt_indices[f_count + k] = fixIndex(vi.vt_idx, t_count);
+          }
+          if (attrib->vn_indices) {
+            attrib->vn_indices[f_count + k] = fixIndex(vi.vn_idx, n_count);
+          }
+        }
+      }
+
+      attrib->material_ids[face_count] = material_id;
+      attrib->face_num_verts[face_count] = command.f_num_verts;
+
+      f_count += command.num_f;
+      face_count++;
+    } else if (command.type == COMMAND_O || command.type == COMMAND_G) {
+      ShapeStart *start = &chunk->shape_starts[chunk->num_shape_starts++];
+      start->line = i;
+      start->face_count = face_count;
+    }
+  }
+}
+
+int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                      size_t *num_shapes, tinyobj_material_t **materials_out,
+                      size_t *num_materials_out, const char *obj_filename,
+                      file_reader_callback file_reader, void *ctx,
+                      unsigned int flags) {
+  return tinyobj_parse_obj_ex(attrib, shapes, num_shapes, materials_out,
+                              num_materials_out, obj_filename, file_reader, ctx,
+                              flags, NULL);
+}
+
+/* Copy the indices of `attrib->faces` into separate arrays from `arena`
+ * (TINYOBJ_FLAG_SOA_INDICES). Releasing `attrib->faces` is up to the caller. */
+static int split_face_indices(tinyobj_attrib_t *attrib, int has_vt, int has_vn,
+                              tinyobj_arena_t *arena) {
+  const tinyobj_vertex_index_t *faces = attrib->faces;
+  size_t n = attrib->num_faces;
+  size_t size = sizeof(int) * n;
+  int *v = (int *)tinyobj_alloc(arena, size);
+  int *vt = has_vt ? (int *)tinyobj_alloc(arena, size) : NULL;
+  int *vn = has_vn ? (int *)tinyobj_alloc(arena, size) : NULL;
+  size_t i;
+
+  if (n > 0 && (v == NULL || (has_vt && vt == NULL) || (has_vn && vn == NULL))) {
+    if (vn) tinyobj_free(arena, vn, size);
+    if (vt) tinyobj_free(arena, vt, size);
+    if (v) tinyobj_free(arena, v, size);
+    return TINYOBJ_ERROR_MEMORY;
+  }
+
+  for (i = 0; i < n; i++) v[i] = faces[i].v_idx;
+  if (vt) {
+    for (i = 0; i < n; i++) vt[i] = faces[i].vt_idx;
+  }
+  if (vn) {
+    for (i = 0; i < n; i++) vn[i] = faces[i].vn_idx;
+  }
+  attrib->v_indices = v;
+  attrib->vt_indices = vt;
+  attrib->vn_indices = vn;
+  return TINYOBJ_SUCCESS;
+}
+
+/* Quantize the float arrays of `attrib` selected by `flags` into arrays from
+ * `arena`, for the streaming parser which does not know the bounds until
+ * the end. Releasing the float arrays is up to the caller. */
+static int quantize_attrib(tinyobj_attrib_t *attrib, unsigned int flags,
+                           tinyobj_arena_t *arena) {
+  size_t num_v = attrib->num_vertices;
+  size_t num_vn = attrib->num_normals;
+  size_t num_vt = attrib->num_texcoords;
+  uint16_t *qv = NULL;
+  int16_t *qn = NULL;
+  uint16_t *qt = NULL;
+  QuantBounds bounds;
+  float inv_scale[3];
+  size_t i, k;
+
+  if (flags & TINYOBJ_FLAG_QUANTIZE_POSITIONS) {
+    qv = (uint16_t *)tinyobj_alloc(arena, sizeof(uint16_t) * num_v * 3);
+    if (num_v > 0 && qv == NULL) goto fail;
+  }
+  if (flags & TINYOBJ_FLAG_QUANTIZE_NORMALS) {
+    qn = (int16_t *)tinyobj_alloc(arena, sizeof(int16_t) * num_vn * 2);
+    if (num_vn > 0 && qn == NULL) goto fail;
+  }
+  if (flags & TINYOBJ_FLAG_QUANTIZE_TEXCOORDS) {
+    qt = (uint16_t *)tinyobj_alloc(arena, sizeof(uint16_t) * num_vt * 2);
+    if (num_vt > 0 && qt == NULL) goto fail;
+  }
+
+  if (qv) {
+    quant_bounds_init(&bounds);
+    for (i = 0; i < num_v; i++) {
+      quant_bounds_add(&bounds, &attrib->vertices[3 * i], 3);
+    }
+    quant_params(&bounds, 3, attrib->vertex_offset, attrib->vertex_scale,
+                 inv_scale);
+    for (i = 0; i < 3 * num_v; i += 3) {
+      for (k = 0; k < 3; k++) {
+        qv[i + k] = quantize_unorm16(attrib->vertices[i + k],
+                                     attrib->vertex_offset[k], inv_scale[k]);
+      }
+    }
+  }
+  if (qn) {
+    for (i = 0; i < num_vn; i++) {
+      const float *n = &attrib->normals[3 * i];
+      oct_encode_normal(n[0], n[1], n[2], &qn[2 * i]);
+    }
+  }
+  if (qt) {
+    quant_bounds_init(&bounds);
+    for (i = 0; i < num_vt; i++) {
+      quant_bounds_add(&bounds, &attrib->texcoords[2 * i], 2);
+    }
+    quant_params(&bounds, 2, attrib->texcoord_offset, attrib->texcoord_scale,
+                 inv_scale);
+    for (i = 0; i < 2 * num_vt; i += 2) {
+      for (k = 0; k < 2; k++) {
+        qt[i + k] = quantize_unorm16(attrib->texcoords[i + k],
+                                     attrib->texcoord_offset[k], inv_scale[k]);
+      }
+    }
+  }
+
+  attrib->quantized_vertices = qv;
+  attrib->quantized_normals = qn;
+  attrib->quantized_texcoords = qt;
+  return TINYOBJ_SUCCESS;
+
+fail:
+  if (qt) tinyobj_free(arena, qt, sizeof(uint16_t) * num_vt * 2);
+  if (qn) tinyobj_free(arena, qn, sizeof(int16_t) * num_vn * 2);
+  if (qv) tinyobj_free(arena, qv, sizeof(uint16_t) * num_v * 3);
+  return TINYOBJ_ERROR_MEMORY;
+}
+
+/* Compression of a .obj file, from its magic bytes. */
+typedef enum {
+  COMPRESSION_NONE,
+  COMPRESSION_GZIP,
+  COMPRESSION_ZSTD
+} CompressionType;
+
+static CompressionType detect_compression(const char *buf, size_t len) {
+  const unsigned char *p = (const unsigned char *)buf;
+  if (len >= 2 && p[0] == 0x1f && p[1] == 0x8b) return COMPRESSION_GZIP;
+  if (len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f &&
+      p[3] == 0xfd) {
+    return COMPRESSION_ZSTD;
+  }
+  return COMPRESSION_NONE;
+}
+
+/* Defined after the streaming parser, which it uses. */
+static int parse_compressed_obj(tinyobj_attrib_t *attrib,
+                                tinyobj_shape_t **shapes, size_t *num_shapes,
+                                tinyobj_material_t **materials_out,
+                                size_t *num_materials_out,
+                                const char *obj_filename,
+                                file_reader_callback file_reader, void *ctx,
+                                unsigned int flags,
+                                const tinyobj_parse_option_t *option,
+                                tinyobj_parse_stats_t *stats,
+                                const char *buf, size_t len);
+
+/* Buffers of parse_obj which can be kept for the next file. */
+typedef struct {
+  LineScanner obj_lines;
+  LineScanner mtl_lines;
+  FaceBuffer faces;
+  hash_table_t material_table;
+} ParseScratch;
+
+static void parse_scratch_free(ParseScratch *scratch) {
+  line_scanner_free(&scratch->obj_lines);
+  line_scanner_free(&scratch->mtl_lines);
+  face_buffer_free(&scratch->faces);
+  destroy_hash_table(&scratch->material_table);
+}
+
+static int parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                     size_t *num_shapes, tinyobj_material_t **materials_out,
+                     size_t *num_materials_out, const char *obj_filename,
+                     file_reader_callback file_reader, void *ctx,
+                     unsigned int flags, const tinyobj_parse_option_t *option,
+                     tinyobj_parse_stats_t *stats, ParseScratch *scratch) {
+  LineScanner own_lines;
+  LineScanner *lines = scratch ? &scratch->obj_lines : &own_lines;
+  LineInfo *line_infos = NULL;
+  size_t num_lines = 0;
+
+  size_t num_v = 0;
+  size_t num_vn = 0;
+  size_t num_vt = 0;
+  size_t num_f = 0;
+  size_t num_faces = 0;
+  size_t num_shape_lines = 0;
+
+  tinyobj_material_t *materials = NULL;
+  size_t num_materials = 0;
+
+  hash_table_t own_table;
+  hash_table_t *material_table = scratch ? &scratch->material_table : &own_table;
+  MtlLoader mtl_loader;
+  tinyobj_async_t mtl_async;
+  int mtl_on_thread = 0;
+  tinyobj_arena_t mtl_arena;
+  tinyobj_parse_stats_t mtl_stats;
+
+  LineChunk *chunks = NULL;
+  size_t num_threads = 1;
+  ParseLinesTask task;
+  FaceBuffer own_faces;
+  FaceBuffer *faces = scratch ? &scratch->faces : &own_faces;
+  size_t max_face_size = 0;
+  int triangulate = (flags & TINYOBJ_FLAG_TRIANGULATE) ? 1 : 0;
+  int soa = (flags & TINYOBJ_FLAG_SOA_INDICES) ? 1 : 0;
+  tinyobj_arena_t *arena = option ? option->arena : NULL;
+  /* Polygons are temporary when they are triangulated afterwards. */
+  tinyobj_arena_t *face_arena = triangulate ? NULL : arena;
+  tinyobj_string_pool_t *string_pool = option ? option->string_pool : NULL;
+  tinyobj_arena_t name_arena; /* Names until they are pooled. */
+  file_release_callback file_release = option ? option->file_release : NULL;
+  int ret = TINYOBJ_SUCCESS;
+  double phase_start = stats ? tinyobj_time() : 0.0;
+
+  char *buf = NULL;
+  size_t len = 0;
+
+  if (attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  file_reader(ctx, obj_filename, /* is_mtl */0, obj_filename, &buf, &len);
+  if (buf == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (len < 1) {
+    if (file_release) file_release(ctx, buf, len);
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  if (detect_compression(buf, len) != COMPRESSION_NONE) {
+    ret = parse_compressed_obj(attrib, shapes, num_shapes, materials_out,
+                               num_materials_out, obj_filename, file_reader,
+                               ctx, flags, option, stats, buf, len);
+    if (file_release) file_release(ctx, buf, len);
+    return ret;
+  }
+
+  tinyobj_attrib_init(attrib);
+  tinyobj_arena_init(&name_arena, 0);
+  if (string_pool) memset(string_pool, 0, sizeof(tinyobj_string_pool_t));
+
+  /* 1. create line data */
+  if (scratch == NULL) memset(&own_lines, 0, sizeof(LineScanner));
+  ret = scan_lines(buf, len, lines);
+  if (ret != TINYOBJ_SUCCESS) {
+    if (scratch == NULL) line_scanner_free(&own_lines);
+    if (file_release) file_release(ctx, buf, len);
+    return ret;
+  }
+  line_infos = lines->infos;
+  num_lines = lines->num_lines;
+  if (stats) {
+    stats->line_scan_time = tinyobj_lap(&phase_start);
+    stats->num_bytes = len;
+    stats->num_lines = num_lines;
+  }
+
+  if (scratch && material_table->capacity > 0) {
+    hash_table_clear(material_table);
+  } else {
+    create_hash_table(HASH_TABLE_DEFAULT_SIZE, material_table);
+  }
+
+  /* 2. count elements. In parallel mode, lines are split into contiguous
+   * chunks(one per thread) and the per-chunk counts are merged in order. */
+  {
+    size_t t;
+
+    num_threads = tinyobj_num_threads(flags, option ? option->num_threads : 0,
+                                      num_lines, TINYOBJ_MIN_LINES_PER_THREAD);
+    chunks = (LineChunk *)tracked_calloc(num_threads, sizeof(LineChunk));
+    if (chunks == NULL) {
+      if (scratch == NULL) {
+        destroy_hash_table(&own_table);
+        line_scanner_free(&own_lines);
+      }
+      if (file_release) file_release(ctx, buf, len);
+      return TINYOBJ_ERROR_MEMORY;
+    }
+
+    for (t = 0; t < num_threads; t++) {
+      chunks[t].line_begin = (num_lines * t) / num_threads;
+      chunks[t].line_end = (num_lines * (t + 1)) / num_threads;
+    }
+
+    task.line_infos = line_infos;
+    task.buf = buf;
+    task.chunks = chunks;
+    task.attrib = attrib;
+
+    tinyobj_parallel_for(num_threads, num_threads, count_line_chunk, &task);
+
+    /* Turn counts into offsets for the next pass. */
+    for (t = 0; t < num_threads; t++) {
+      size_t n;
+
+      n = chunks[t].num_v;
+      chunks[t].num_v = num_v;
+      num_v += n;
+
+      n = chunks[t].num_vn;
+      chunks[t].num_vn = num_vn;
+      num_vn += n;
+
+      n = chunks[t].num_vt;
+      chunks[t].num_vt = num_vt;
+      num_vt += n;
+
+      chunks[t].f_offset = num_f;
+      chunks[t].face_offset = num_faces;
+      num_f += chunks[t].num_f;
+      num_faces += chunks[t].num_faces;
+      num_shape_lines += chunks[t].num_o + chunks[t].num_g;
+      if (chunks[t].max_face_size > max_face_size) {
+        max_face_size = chunks[t].max_face_size;
+      }
+
+      if (stats) {
+        stats->num_f += chunks[t].num_faces;
+        stats->num_o += chunks[t].num_o;
+        stats->num_g += chunks[t].num_g;
+        stats->num_usemtl += chunks[t].num_usemtl;
+        stats->num_mtllib += chunks[t].num_mtllib;
+      }
+    }
+
+    if (stats) {
+      stats->parse_time = tinyobj_lap(&phase_start);
+      stats->num_v = num_v;
+      stats->num_vn = num_vn;
+      stats->num_vt = num_vt;
+    }
+  }
+
+  /* Face indices of one line at a time, sized for the largest polygon. */
+  if (scratch == NULL) memset(&own_faces, 0, sizeof(FaceBuffer));
+  if (face_buffer_reserve(faces, max_face_size) != TINYOBJ_SUCCESS) {
+    tracked_free(chunks, num_threads * sizeof(LineChunk));
+    if (scratch == NULL) {
+      destroy_hash_table(&own_table);
+      line_scanner_free(&own_lines);
+    }
+    if (file_release) file_release(ctx, buf, len);
+    return TINYOBJ_ERROR_MEMORY;
+  }
+
+  /* Load materials. With TINYOBJ_FLAG_PARALLEL, the .mtl files are loaded on
+   * another thread while vertices are parsed, into their own arena and
+   * statistics which are merged when the thread is joined. */
+  mtl_loader_init(&mtl_loader, obj_filename, file_reader, ctx, material_table,
+                  arena);
+  mtl_loader.file_release = file_release;
+  mtl_loader.stats = stats;
+  if (scratch) mtl_loader.lines = &scratch->mtl_lines;
+  {
+    size_t t;
+    for (t = 0; t < num_threads; t++) {
+      size_t i;
+      if (chunks[t].num_mtllib == 0) continue;
+      for (i = chunks[t].mtllib_line_begin; i < chunks[t].mtllib_line_end; i++) {
+        Command command;
+        if (parseLine(&command, &buf[line_infos[i].pos], line_infos[i].len, 0,
+                      NULL) > 0 &&
+            command.type == COMMAND_MTLLIB) {
+          mtl_loader_add(&mtl_loader, &command);
+        }
+      }
+    }
+  }
+#ifdef TINYOBJ_USE_THREADS
+  mtl_on_thread = (flags & TINYOBJ_FLAG_PARALLEL) && mtl_loader.num_filenames > 0;
+#endif
+  if (mtl_on_thread) {
+    if (arena) {
+      tinyobj_arena_init(&mtl_arena, arena->block_size);
+      mtl_loader.arena = &mtl_arena;
+    }
+    if (stats) {
+      memset(&mtl_stats, 0, sizeof(tinyobj_parse_stats_t));
+      mtl_loader.stats = &mtl_stats;
+    }
+  }
+  /* The shapes take names from `name_arena` only after the thread is joined. */
+  mtl_loader.name_arena = string_pool ? &name_arena : mtl_loader.arena;
+  tinyobj_async_start(&mtl_async, mtl_loader_task, &mtl_loader, mtl_on_thread);
+  if (stats) stats->mtl_time = tinyobj_lap(&phase_start);
+
+  /* 3. Construct attributes. Outputs are allocated once with the counts from
+   * pass 2 and filled directly from the text. */
+
+  /* Quantized positions and texcoords need their bounding boxes first,
+   * which costs another parse of the v and vt lines. */
+  if (flags & (TINYOBJ_FLAG_QUANTIZE_POSITIONS | TINYOBJ_FLAG_QUANTIZE_TEXCOORDS)) {
+    QuantBounds v_bounds, vt_bounds;
+    size_t t;
+
+    tinyobj_parallel_for(num_threads, num_threads, bound_vertex_chunk, &task);
+    quant_bounds_init(&v_bounds);
+    quant_bounds_init(&vt_bounds);
+    for (t = 0; t < num_threads; t++) {
+      quant_bounds_merge(&v_bounds, &chunks[t].v_bounds);
+      quant_bounds_merge(&vt_bounds, &chunks[t].vt_bounds);
+    }
+    quant_params(&v_bounds, 3, attrib->vertex_offset, attrib->vertex_scale,
+                 task.vertex_inv_scale);
+    quant_params(&vt_bounds, 2, attrib->texcoord_offset,
+                 attrib->texcoord_scale, task.texcoord_inv_scale);
+  }
+
+  /* On failure, the arrays allocated so far are freed with the attributes
+   * at the end, after the .mtl thread is joined. */
+  if (flags & TINYOBJ_FLAG_QUANTIZE_POSITIONS) {
+    attrib->quantized_vertices =
+        (uint16_t *)tinyobj_alloc(arena, sizeof(uint16_t) * num_v * 3);
+    if (num_v && attrib->quantized_vertices == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  } else {
+    attrib->vertices = (float *)tinyobj_alloc(arena, sizeof(float) * num_v * 3);
+    if (num_v && attrib->vertices == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  }
+  attrib->num_vertices = (unsigned int)num_v;
+  if (flags & TINYOBJ_FLAG_QUANTIZE_NORMALS) {
+    attrib->quantized_normals =
+        (int16_t *)tinyobj_alloc(arena, sizeof(int16_t) * num_vn * 2);
+    if (num_vn && attrib->quantized_normals == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  } else {
+    attrib->normals = (float *)tinyobj_alloc(arena, sizeof(float) * num_vn * 3);
+    if (num_vn && attrib->normals == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  }
+  attrib->num_normals = (unsigned int)num_vn;
+  if (flags & TINYOBJ_FLAG_QUANTIZE_TEXCOORDS) {
+    attrib->quantized_texcoords =
+        (uint16_t *)tinyobj_alloc(arena, sizeof(uint16_t) * num_vt * 2);
+    if (num_vt && attrib->quantized_texcoords == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  } else {
+    attrib->texcoords = (float *)tinyobj_alloc(arena, sizeof(float) * num_vt * 2);
+    if (num_vt && attrib->texcoords == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  }
+  attrib->num_texcoords = (unsigned int)num_vt;
+  if (soa && !triangulate) {
+    /* Indices are written to separate arrays directly. */
+    attrib->v_indices = (int *)tinyobj_alloc(arena, sizeof(int) * num_f);
+    if (num_vt > 0) {
+      attrib->vt_indices = (int *)tinyobj_alloc(arena, sizeof(int) * num_f);
+    }
+    if (num_vn > 0) {
+      attrib->vn_indices = (int *)tinyobj_alloc(arena, sizeof(int) * num_f);
+    }
+    if (num_f && (attrib->v_indices == NULL ||
+                  (num_vt && attrib->vt_indices == NULL) ||
+                  (num_vn && attrib->vn_indices == NULL))) {
+      ret = TINYOBJ_ERROR_MEMORY;
+    }
+  } else {
+    attrib->faces = (tinyobj_vertex_index_t *)tinyobj_alloc(
+        face_arena, sizeof(tinyobj_vertex_index_t) * num_f);
+    if (num_f && attrib->faces == NULL) ret = TINYOBJ_ERROR_MEMORY;
+  }
+  attrib->num_faces = (unsigned int)num_f;
+  attrib->face_num_verts = (int *)tinyobj_alloc(face_arena, sizeof(int) * num_faces);
+  attrib->material_ids = (int *)tinyobj_alloc(face_arena, sizeof(int) * num_faces);
+  if (num_faces && (attrib->face_num_verts == NULL || attrib->material_ids == NULL)) {
+    ret = TINYOBJ_ERROR_MEMORY;
+  }
+  attrib->num_face_num_verts = (unsigned int)num_faces;
+
+  /* 3-1. vertex data. Each chunk writes at its own offsets. */
+  if (ret == TINYOBJ_SUCCESS) {
+    tinyobj_parallel_for(num_threads, num_threads, parse_vertex_chunk, &task);
+  }
+  if (stats) stats->attrib_time = tinyobj_lap(&phase_start);
+
+  tinyobj_async_join(&mtl_async);
+  if (ret == TINYOBJ_SUCCESS) ret = mtl_loader.status;
+  if (mtl_on_thread) {
+    if (arena) arena_adopt(arena, &mtl_arena);
+    if (stats) {
+      /* The peaks of both threads may not have been at the same time. */
+      stats->num_allocs += mtl_stats.num_allocs;
+      stats->peak_bytes += mtl_stats.peak_bytes;
+      stats->live_bytes += mtl_stats.live_bytes;
+    }
+  }
+  materials = mtl_loader.materials;
+  num_materials = mtl_loader.num_materials;
+  mtl_loader_free(&mtl_loader);
+  if (stats) stats->mtl_time += tinyobj_lap(&phase_start);
+
+  /* 3-2. Faces, materials and shapes. Each chunk resolves relative indices
+   * from its v/vn/vt offsets and starts with the material of the last
+   * `usemtl` line before it, so chunks run in parallel. */
+  {
+    int material_id = -1; /* -1 = default unknown material. */
+    size_t material_hit = 0;
+    ShapeBuilder shape_builder;
+    size_t t, k;
+
+    task.material_table = material_table;
+    for (t = 0; t < num_threads; t++) {
+      LineChunk *chunk = &chunks[t];
+
+      chunk->material_id = material_id;
+      if (chunk->usemtl_line > 0) {
+        const LineInfo *info = &line_infos[chunk->usemtl_line - 1];
+        Command command;
+        parseLine(&command, &buf[info->pos], info->len, 0, NULL);
+        material_id = find_material_id(material_table, command.material_name,
+                                       command.material_name_len, &material_hit);
+      }
+
+      /* The first chunk uses the shared buffer, the others their own. */
+      if (t == 0) {
+        chunk->faces = *faces;
+      } else if (face_buffer_reserve(&chunk->faces, max_face_size) != TINYOBJ_SUCCESS) {
+        ret = TINYOBJ_ERROR_MEMORY;
+      }
+      chunk->shape_starts = (ShapeStart *)tracked_malloc(
+          sizeof(ShapeStart) * (chunk->num_o + chunk->num_g + 1));
+      if (chunk->shape_starts == NULL) ret = TINYOBJ_ERROR_MEMORY;
+    }
+
+    if (ret == TINYOBJ_SUCCESS) {
+      tinyobj_parallel_for(num_threads, num_threads, parse_face_chunk, &task);
+
+      /* Shapes with maximum possible size(+1 for unnamed group/object).
+       * Actual # of shapes found in .obj is determined in the later */
+      ret = shape_builder_init(&shape_builder, num_shape_lines + 1, arena);
+      if (string_pool) shape_builder.name_arena = &name_arena;
+      for (t = 0; t < num_threads && ret == TINYOBJ_SUCCESS; t++) {
+        for (k = 0; k < chunks[t].num_shape_starts && ret == TINYOBJ_SUCCESS; k++) {
+          const ShapeStart *start = &chunks[t].shape_starts[k];
+          const LineInfo *info = &line_infos[start->line];
+          Command command;
+
+          parseLine(&command, &buf[info->pos], info->len, 0, NULL);
+          shape_builder.face_count = (unsigned int)start->face_count;
+          if (command.type == COMMAND_O) {
+            ret = shape_builder_begin(&shape_builder, command.object_name,
+                                      command.object_name_len);
+          } else {
+            ret = shape_builder_begin(&shape_builder, command.group_name,
+                                      command.group_name_len);
+          }
+        }
+      }
+      if (ret == TINYOBJ_SUCCESS) {
+        shape_builder.face_count = (unsigned int)num_faces;
+        ret = shape_builder_flush(&shape_builder);
+      }
+      tinyobj_free(shape_builder.name_arena, shape_builder.name,
+                   my_strsize(shape_builder.name));
+
+      (*shapes) = shape_builder.shapes;
+      (*num_shapes) = shape_builder.num_shapes;
+    } else {
+      (*shapes) = NULL;
+      (*num_shapes) = 0;
+    }
+
+    for (t = 0; t < num_threads; t++) {
+      tracked_free(chunks[t].shape_starts,
+                   sizeof(ShapeStart) * (chunks[t].num_o + chunks[t].num_g + 1));
+      if (t > 0) face_buffer_free(&chunks[t].faces);
+    }
+  }
+  tracked_free(chunks, num_threads * sizeof(LineChunk));
+
+  /* line_infos and the text are not used anymore. Release memory. */
+  if (scratch == NULL) {
+    line_scanner_free(&own_lines);
+    face_buffer_free(&own_faces);
+    destroy_hash_table(&own_table);
+  }
+  if (file_release) file_release(ctx, buf, len);
+  if (stats) stats->shape_time = tinyobj_lap(&phase_start);
+
+  /* 4. Replace the polygons with triangles. */
+  if (triangulate) {
+    tinyobj_triangles_t triangles;
+
+    if (ret == TINYOBJ_SUCCESS) {
+      ret = triangulate_faces(
+          &triangles, attrib, TINYOBJ_TRIANGULATE_FAN,
+          tinyobj_num_threads(flags, option ? option->num_threads : 0, num_faces,
+                              TINYOBJ_MIN_FACES_PER_THREAD),
+          arena);
+    } else {
+      memset(&triangles, 0, sizeof(tinyobj_triangles_t));
+    }
+    tracked_free(attrib->faces, sizeof(tinyobj_vertex_index_t) * num_f);
+    tracked_free(attrib->face_num_verts, sizeof(int) * num_faces);
+    tracked_free(attrib->material_ids, sizeof(int) * num_faces);
+    attrib->faces = triangles.faces;
+    attrib->num_faces = triangles.num_faces;
+    attrib->face_num_verts = triangles.face_num_verts;
+    attrib->material_ids = triangles.material_ids;
+    attrib->num_face_num_verts = triangles.num_face_num_verts;
+
+    /* With an arena, the triangles stay in it until it is freed. */
+    if (soa && ret == TINYOBJ_SUCCESS) {
+      ret = split_face_indices(attrib, num_vt > 0, num_vn > 0, arena);
+      if (ret == TINYOBJ_SUCCESS) {
+        tinyobj_free(arena, attrib->faces,
+                     sizeof(tinyobj_vertex_index_t) * attrib->num_faces);
+        attrib->faces = NULL;
+      }
+    }
+    if (stats) stats->triangulate_time = tinyobj_lap(&phase_start);
+  }
+
+  /* 5. Move the names into the pool. */
+  if (string_pool) {
+    if (ret == TINYOBJ_SUCCESS) {
+      ret = string_pool_build(string_pool, *shapes, *num_shapes, materials,
+                              num_materials);
+    }
+    tinyobj_arena_free(&name_arena);
+  }
+
+  if (ret != TINYOBJ_SUCCESS) {
+    if (arena == NULL) {
+      tinyobj_attrib_free(attrib);
+      tinyobj_shapes_free(*shapes, *num_shapes);
+      tinyobj_materials_free(materials, num_materials);
+    }
+    tinyobj_attrib_init(attrib);
+    (*shapes) = NULL;
+    (*num_shapes) = 0;
+    materials = NULL;
+    num_materials = 0;
+  }
+
+  (*materials_out) = materials;
+  (*num_materials_out) = num_materials;
+
+  return ret;
+}
+
+int tinyobj_parse_obj_ex(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                         size_t *num_shapes, tinyobj_material_t **materials_out,
+                         size_t *num_materials_out, const char *obj_filename,
+                         file_reader_callback file_reader, void *ctx,
+                         unsigned int flags,
+                         const tinyobj_parse_option_t *option) {
+  tinyobj_parse_stats_t *stats = option ? option->stats : NULL;
+  tinyobj_parse_stats_t *prev_stats;
+  double start;
+  int ret;
+
+  if (stats == NULL) {
+    return parse_obj(attrib, shapes, num_shapes, materials_out,
+                     num_materials_out, obj_filename, file_reader, ctx, flags,
+                     option, NULL, NULL);
+  }
+
+  memset(stats, 0, sizeof(tinyobj_parse_stats_t));
+  start = tinyobj_time();
+  prev_stats = tinyobj_track_allocs(stats);
+  ret = parse_obj(attrib, shapes, num_shapes, materials_out, num_materials_out,
+                  obj_filename, file_reader, ctx, flags, option, stats, NULL);
+  tinyobj_track_allocs(prev_stats);
+  stats->total_time = tinyobj_time() - start;
+  return ret;
+}
+
+/* Read buffers of a tinyobj_parse_obj_batch thread. The .obj file is read
+ * before parsing, .mtl files when the parser asks for them. Files of a batch
+ * often share their .mtl file, so the last one is kept. */
+typedef struct {
+  char *obj_buf;
+  size_t obj_len;
+  size_t obj_capacity;
+  char *mtl_buf;
+  size_t mtl_len;
+  size_t mtl_capacity;
+  char *mtl_filename; /* File in mtl_buf, NULL = none. */
+} BatchReader;
+
+/* Read a whole file into `*buf`, which grows as needed. The size is not
+ * queried first, small files take a single read. */
+static int batch_read_file(const char *filename, char **buf, size_t *capacity,
+                           size_t *len) {
+  FILE *fp = fopen(filename, "rb");
+  int ret = TINYOBJ_SUCCESS;
+
+  *len = 0;
+  if (fp == NULL) return TINYOBJ_ERROR_FILE_OPERATION;
+
+  for (;;) {
+    if (*len == *capacity) {
+      size_t new_capacity = *capacity ? 2 * *capacity : 16384;
+      char *p = (char *)tracked_realloc(*buf, *capacity, new_capacity);
+      if (p == NULL) {
+        ret = TINYOBJ_ERROR_MEMORY;
+        break;
+      }
+      *buf = p;
+      *capacity = new_capacity;
+    }
+    *len += fread(*buf + *len, 1, *capacity - *len, fp);
+    if (*len < *capacity) {
+      if (ferror(fp)) ret = TINYOBJ_ERROR_FILE_OPERATION;
+      break;
+    }
+  }
+  fclose(fp);
+  return ret;
+}
+
+static void batch_file_reader(void *ctx, const char *filename, int is_mtl,
+                              const char *obj_filename, char **buf,
+                              size_t *len) {
+  BatchReader *reader = (BatchReader *)ctx;
+  (void)obj_filename;
+
+  if (!is_mtl) {
+    *buf = reader->obj_buf;
+    *len = reader->obj_len;
+    return;
+  }
+  if (reader->mtl_filename == NULL ||
+      strcmp(reader->mtl_filename, filename) != 0) {
+    if (reader->mtl_filename) {
+      tracked_free(reader->mtl_filename, strlen(reader->mtl_filename) + 1);
+      reader->mtl_filename = NULL;
+    }
+    if (batch_read_file(filename, &reader->mtl_buf, &reader->mtl_capacity,
+                        &reader->mtl_len) == TINYOBJ_SUCCESS) {
+      reader->mtl_filename = my_strndup(filename, strlen(filename), NULL);
+    } else {
+      reader->mtl_len = 0;
+    }
+  }
+  *buf = reader->mtl_buf;
+  *len = reader->mtl_len;
+}
+
+typedef struct {
+  const char *const *paths;
+  size_t num_paths;
+  tinyobj_result_t *results;
+  size_t num_threads;
+  unsigned int flags;
+  int pad0;
+} BatchTask;
+
+/* Thread `thread_id` parses files thread_id, thread_id + num_threads, ... */
+static void parse_batch_thread(void *arg, size_t thread_id) {
+  BatchTask *task = (BatchTask *)arg;
+  ParseScratch scratch;
+  BatchReader reader;
+  size_t i;
+
+  memset(&scratch, 0, sizeof(ParseScratch));
+  memset(&reader, 0, sizeof(BatchReader));
+
+  for (i = thread_id; i < task->num_paths; i += task->num_threads) {
+    tinyobj_result_t *result = &task->results[i];
+    tinyobj_parse_option_t option;
+    size_t block_size;
+
+    if (result->status != TINYOBJ_SUCCESS) continue; /* NULL path */
+    result->status = batch_read_file(task->paths[i], &reader.obj_buf,
+                                     &reader.obj_capacity, &reader.obj_len);
+    if (result->status != TINYOBJ_SUCCESS) continue;
+
+    /* Results are about as large as the text, so small files get small
+     * blocks. */
+    block_size = 2 * reader.obj_len + 1024;
+    if (block_size > TINYOBJ_ARENA_DEFAULT_BLOCK_SIZE) {
+      block_size = TINYOBJ_ARENA_DEFAULT_BLOCK_SIZE;
+    }
+    tinyobj_arena_init(&result->arena, block_size);
+    memset(&option, 0, sizeof(option));
+    option.arena = &result->arena;
+
+    result->status = parse_obj(
+        &result->attrib, &result->shapes, &result->num_shapes,
+        &result->materials, &result->num_materials, task->paths[i],
+        batch_file_reader, &reader, task->flags, &option, NULL, &scratch);
+    if (result->status != TINYOBJ_SUCCESS) {
+      tinyobj_arena_free(&result->arena);
+      tinyobj_attrib_init(&result->attrib);
+      result->shapes = NULL;
+      result->num_shapes = 0;
+      result->materials = NULL;
+      result->num_materials = 0;
+    }
+  }
+
+  parse_scratch_free(&scratch);
+  tracked_free(reader.obj_buf, reader.obj_capacity);
+  tracked_free(reader.mtl_buf, reader.mtl_capacity);
+  if (reader.mtl_filename) {
+    tracked_free(reader.mtl_filename, strlen(reader.mtl_filename) + 1);
+  }
+}
+
+int tinyobj_parse_obj_batch(const char *const *paths, size_t num_paths,
+                            tinyobj_result_t *results, unsigned int flags,
+                            unsigned int num_threads) {
+  BatchTask task;
+  size_t i;
+
+  if (num_paths == 0) return TINYOBJ_SUCCESS;
+  if (paths == NULL || results == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  memset(results, 0, sizeof(tinyobj_result_t) * num_paths);
+  for (i = 0; i < num_paths; i++) {
+    tinyobj_attrib_init(&results[i].attrib);
+    tinyobj_arena_init(&results[i].arena, 0);
+    results[i].status =
+        paths[i] ? TINYOBJ_SUCCESS : TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+
+  task.paths = paths;
+  task.num_paths = num_paths;
+  task.results = results;
+  task.num_threads = tinyobj_num_threads(TINYOBJ_FLAG_PARALLEL, num_threads,
+                                         num_paths, 1);
+  task.flags = flags & ~(unsigned int)TINYOBJ_FLAG_PARALLEL;
+  tinyobj_parallel_for(task.num_threads, task.num_threads, parse_batch_thread,
+                       &task);
+
+  for (i = 0; i < num_paths; i++) {
+    if (results[i].status != TINYOBJ_SUCCESS) return results[i].status;
+  }
+  return TINYOBJ_SUCCESS;
+}
+
+void tinyobj_results_free(tinyobj_result_t *results, size_t num_results) {
+  size_t i;
+  if (results == NULL) return;
+  for (i = 0; i < num_results; i++) {
+    tinyobj_arena_free(&results[i].arena);
+    tinyobj_attrib_init(&results[i].attrib);
+    results[i].shapes = NULL;
+    results[i].num_shapes = 0;
+    results[i].materials = NULL;
+    results[i].num_materials = 0;
+  }
+}
+
+struct tinyobj_parser_t {
+  tinyobj_attrib_t attrib;
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_faces;
+  size_t v_capacity;     /* in vertices */
+  size_t vn_capacity;    /* in normals */
+  size_t vt_capacity;    /* in texcoords */
+  size_t f_capacity;     /* in vertex indices */
+  size_t faces_capacity; /* in faces */
+
+  ShapeBuilder shape_builder;
+
+  MtlLoader mtl_loader; /* Owns the materials until finish. */
+  hash_table_t material_table;
+  /* `usemtl` names in order of appearance. Until finish, material_ids are
+   * indices of this table, since a later `mtllib` may define the name. */
+  hash_table_t usemtl_table;
+  size_t usemtl_hit; /* See find_material_id. */
+  int material_id;
+
+  int triangulate;
+  int error; /* Sticky error from feed. */
+  int soa;   /* TINYOBJ_FLAG_SOA_INDICES: split `faces` in finish. */
+  unsigned int quantize; /* TINYOBJ_FLAG_QUANTIZE_* bits, applied in finish. */
+
+  FaceBuffer faces;
+  LineScanner lines; /* Lines of the current chunk. */
+
+  /* Partial line carried over from the previous chunk. */
+  char *carry;
+  size_t carry_len;
+  size_t carry_capacity;
+
+  char *obj_filename;
+  file_reader_callback file_reader;
+  void *ctx;
+  tinyobj_arena_t *arena; /* For the outputs(may be NULL). */
+  tinyobj_string_pool_t *string_pool; /* Filled in finish(may be NULL). */
+  tinyobj_arena_t name_arena; /* Names until they are pooled. */
+};
+
+/* Grow `*array` to hold at least `count` elements of `elem_size` bytes. */
+static int grow_array(void **array, size_t *capacity, size_t count,
+                      size_t elem_size, tinyobj_arena_t *arena) {
+  size_t new_capacity;
+  void *p;
+
+  if (count <= *capacity) return TINYOBJ_SUCCESS;
+
+  new_capacity = (*capacity) ? (*capacity) : 256;
+  while (new_capacity < count) new_capacity *= 2;
+
+  p = tinyobj_realloc(arena, *array, (*capacity) * elem_size,
+                      new_capacity * elem_size);
+  if (p == NULL) return TINYOBJ_ERROR_MEMORY;
+  *array = p;
+  *capacity = new_capacity;
+  return TINYOBJ_SUCCESS;
+}
+
+tinyobj_parser_t *tinyobj_parser_create(const char *obj_filename,
+                                        file_reader_callback file_reader,
+                                        void *ctx, unsigned int flags) {
+  return tinyobj_parser_create_ex(obj_filename, file_reader, ctx, flags, NULL);
+}
+
+tinyobj_parser_t *tinyobj_parser_create_ex(const char *obj_filename,
+                                           file_reader_callback file_reader,
+                                           void *ctx, unsigned int flags,
+                                           const tinyobj_parse_option_t *option) {
+  tinyobj_parser_t *parser =
+      (tinyobj_parser_t *)TINYOBJ_CALLOC(1, sizeof(tinyobj_parser_t));
+  if (parser == NULL) return NULL;
+
+  parser->arena = option ? option->arena : NULL;
+  tinyobj_attrib_init(&parser->attrib);
+  if (shape_builder_init(&parser->shape_builder, 16, parser->arena) !=
+      TINYOBJ_SUCCESS) {
+    TINYOBJ_FREE(parser);
+    return NULL;
+  }
+  tinyobj_arena_init(&parser->name_arena, 0);
+  parser->string_pool = option ? option->string_pool : NULL;
+  if (parser->string_pool) {
+    memset(parser->string_pool, 0, sizeof(tinyobj_string_pool_t));
+    parser->shape_builder.name_arena = &parser->name_arena;
+  }
+  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &parser->material_table);
+  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &parser->usemtl_table);
+  parser->material_id = -1;
+  parser->triangulate = (flags & TINYOBJ_FLAG_TRIANGULATE) ? 1 : 0;
+  parser->soa = (flags & TINYOBJ_FLAG_SOA_INDICES) ? 1 : 0;
+  parser->quantize = flags & TINYOBJ_FLAG_QUANTIZE;
+  parser->error = TINYOBJ_SUCCESS;
+  if (obj_filename) {
+    parser->obj_filename = my_strndup(obj_filename, strlen(obj_filename), NULL);
+  }
+  parser->file_reader = file_reader;
+  parser->ctx = ctx;
+  mtl_loader_init(&parser->mtl_loader, parser->obj_filename, file_reader, ctx,
+                  &parser->material_table, parser->arena);
+  parser->mtl_loader.file_release = option ? option->file_release : NULL;
+  if (parser->string_pool) parser->mtl_loader.name_arena = &parser->name_arena;
+  return parser;
+}
+
+static int parser_process_line(tinyobj_parser_t *parser, const char *p,
+                               size_t p_len) {
+  tinyobj_attrib_t *attrib = &parser->attrib;
+  Command command;
+  int ret = parseLine(&command, p, p_len, PARSE_VERTEX_DATA | PARSE_FACE_DATA,
+                      &parser->faces);
+
+  if (ret < 0) return TINYOBJ_ERROR_MEMORY;
+  if (ret == 0) return TINYOBJ_SUCCESS;
+
+  if (command.type == COMMAND_V) {
+    if (grow_array((void **)&attrib->vertices, &parser->v_capacity,
+                   parser->num_v + 1, sizeof(float) * 3,
+                   parser->arena) != TINYOBJ_SUCCESS) {
+      return TINYOBJ_ERROR_MEMORY;
+    }
+    attrib->vertices[3 * parser->num_v + 0] = command.vx;
+    attrib->vertices[3 * parser->num_v + 1] = command.vy;
+    attrib->vertices[3 * parser->num_v + 2] = command.vz;
+    parser->num_v++;
+  } else if (command.type == COMMAND_VN) {
+    if (grow_array((void **)&attrib->normals, &parser->vn_capacity,
+                   parser->num_vn + 1, sizeof(float) * 3,
+                   parser->arena) != TINYOBJ_SUCCESS) {
+      return TINYOBJ_ERROR_MEMORY;
+    }
+    attrib->normals[3 * parser->num_vn + 0] = command.nx;
+    attrib->normals[3 * parser->num_vn + 1] = command.ny;
+    attrib->normals[3 * parser->num_vn + 2] = command.nz;
+    parser->num_vn++;
+  } else if (command.type == COMMAND_VT) {
+    if (grow_array((void **)&attrib->texcoords, &parser->vt_capacity,
+                   parser->num_vt + 1, sizeof(float) * 2,
+                   parser->arena) != TINYOBJ_SUCCESS) {
+      return TINYOBJ_ERROR_MEMORY;
+    }
+    attrib->texcoords[2 * parser->num_vt + 0] = command.tx;
+    attrib->texcoords[2 * parser->num_vt + 1] = command.ty;
+    parser->num_vt++;
+  } else if (command.type == COMMAND_F) {
+    size_t k;
+    size_t num_f = command.num_f;
+    size_t num_faces = 1;
+    int num_verts = command.f_num_verts;
+    tinyobj_vertex_index_t *dst;
+    /* face_num_verts and material_ids share faces_capacity. */
+    size_t faces_capacity = parser->faces_capacity;
+
+    if (parser->triangulate && command.num_f >= 3) {
+      num_f = triangulated_num_indices(command.num_f);
+      num_faces = triangulated_num_faces(command.num_f);
+      num_verts = 3;
+    }
+
+    if (grow_array((void **)&attrib->faces, &parser->f_capacity,
+                   parser->num_f + num_f, sizeof(tinyobj_vertex_index_t),
+                   parser->arena) != TINYOBJ_SUCCESS ||
+        grow_array((void **)&attrib->face_num_verts, &faces_capacity,
+                   parser->num_faces + num_faces, sizeof(int),
+                   parser->arena) != TINYOBJ_SUCCESS ||
+        grow_array((void **)&attrib->material_ids, &parser->faces_capacity,
+                   parser->num_faces + num_faces, sizeof(int),
+                   parser->arena) != TINYOBJ_SUCCESS) {
+      return TINYOBJ_ERROR_MEMORY;
+    }
+
+    dst = &attrib->faces[parser->num_f];
+    if (parser->triangulate && command.num_f > 3) {
+      triangulate_fan(command.f, command.num_f, dst);
+    } else {
+      for (k = 0; k < num_f; k++) dst[k] = command.f[k];
+    }
+    for (k = 0; k < num_f; k++) {
+      dst[k].v_idx = fixIndex(dst[k].v_idx, parser->num_v);
+      dst[k].vn_idx = fixIndex(dst[k].vn_idx, parser->num_vn);
+      dst[k].vt_idx = fixIndex(dst[k].vt_idx, parser->num_vt);
+    }
+
+    for (k = 0; k < num_faces; k++) {
+      attrib->material_ids[parser->num_faces + k] = parser->material_id;
+      attrib->face_num_verts[parser->num_faces + k] = num_verts;
+    }
+
+    parser->num_f += num_f;
+    parser->num_faces += num_faces;
+    parser->shape_builder.face_count++;
+  } else if (command.type == COMMAND_USEMTL) {
+    if (command.material_name && command.material_name_len > 0) {
+      parser->material_id = find_material_id(&parser->usemtl_table,
+                                             command.material_name,
+                                             command.material_name_len,
+                                             &parser->usemtl_hit);
+      if (parser->material_id < 0) {
+        parser->material_id = (int)parser->usemtl_table.n;
+        if (hash_table_set(command.material_name, command.material_name_len,
+                           parser->usemtl_table.n, &parser->usemtl_table) !=
+            HASH_TABLE_SUCCESS) {
+          return TINYOBJ_ERROR_MEMORY;
+        }
+      }
+    }
+  } else if (command.type == COMMAND_MTLLIB) {
+    if (parser->file_reader) {
+      /* Materials of earlier files keep their ids. */
+      mtl_loader_add(&parser->mtl_loader, &command);
+      mtl_loader_load(&parser->mtl_loader);
+      return parser->mtl_loader.status;
+    }
+  } else if (command.type == COMMAND_O) {
+    return shape_builder_begin(&parser->shape_builder, command.object_name,
+                               command.object_name_len);
+  } else if (command.type == COMMAND_G) {
+    return shape_builder_begin(&parser->shape_builder, command.group_name,
+                               command.group_name_len);
+  }
+
+  return TINYOBJ_SUCCESS;
+}
+
+static int parser_append_carry(tinyobj_parser_t *parser, const char *p,
+                               size_t len) {
+  if (grow_array((void **)&parser->carry, &parser->carry_capacity,
+                 parser->carry_len + len, 1, NULL) != TINYOBJ_SUCCESS) {
+    return TINYOBJ_ERROR_MEMORY;
+  }
+  memcpy(parser->carry + parser->carry_len, p, len);
+  parser->carry_len += len;
+  return TINYOBJ_SUCCESS;
+}
+
+/* Line endings follow scan_lines: '\n', '\0', or a '\r' which is not
+ * followed by '\n'. */
+static int parser_feed(tinyobj_parser_t *parser, const char *chunk,
+                       size_t len) {
+  LineInfo *line_infos = NULL;
+  size_t num_lines = 0;
+  size_t i;
+  int ret = TINYOBJ_SUCCESS;
+
+  /* Complete the line carried over from the previous chunk. */
+  if (parser->carry_len > 0) {
+    size_t n = 0;
+
+    if (parser->carry[parser->carry_len - 1] == '\r' && chunk[0] != '\n') {
+      /* The carried line ended with a lone '\r'. */
+      ret = parser_process_line(parser, parser->carry, parser->carry_len - 1);
+      parser->carry_len = 0;
+    } else {
+      for (n = 0; n < len; n++) {
+        if (chunk[n] == '\n' || chunk[n] == '\0') break;
+        if (chunk[n] == '\r' && (n + 1) < len && chunk[n + 1] != '\n') break;
+      }
+      ret = parser_append_carry(parser, chunk, n);
+      if (ret != TINYOBJ_SUCCESS || n == len) return ret;
+
+      ret = parser_process_line(parser, parser->carry, parser->carry_len);
+      parser->carry_len = 0;
+      chunk += n + 1;
+      len -= n + 1;
+    }
+    if (ret != TINYOBJ_SUCCESS) return ret;
+  }
+
+  if (len == 0) return TINYOBJ_SUCCESS;
+
+  if (scan_lines(chunk, len, &parser->lines) != 0) {
+    return TINYOBJ_ERROR_MEMORY;
+  }
+  line_infos = parser->lines.infos;
+  num_lines = parser->lines.num_lines;
+
+  /* An unterminated last line is carried over to the next chunk. */
+  if (line_infos[num_lines - 1].pos + line_infos[num_lines - 1].len == len) {
+    num_lines--;
+    ret = parser_append_carry(parser, chunk + line_infos[num_lines].pos,
+                              line_infos[num_lines].len);
+  }
+
+  for (i = 0; i < num_lines && ret == TINYOBJ_SUCCESS; i++) {
+    ret = parser_process_line(parser, &chunk[line_infos[i].pos],
+                              line_infos[i].len);
+  }
+
+  return ret;
+}
+
+int tinyobj_parser_feed(tinyobj_parser_t *parser, const char *chunk,
+                        size_t len) {
+  if (parser == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (parser->error != TINYOBJ_SUCCESS) return parser->error;
+  if (len == 0) return TINYOBJ_SUCCESS;
+  if (chunk == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  parser->error = parser_feed(parser, chunk, len);
+  return parser->error;
+}
+
+/* Replace the `usemtl` indices of material_ids with material ids, now that
+ * every `mtllib` is loaded. */
+static int parser_resolve_materials(tinyobj_parser_t *parser) {
+  hash_table_t *usemtl_table = &parser->usemtl_table;
+  size_t num_names = usemtl_table->n;
+  size_t material_hit = 0;
+  int *ids;
+  size_t i;
+
+  if (num_names == 0) return TINYOBJ_SUCCESS;
+  ids = (int *)tracked_malloc(sizeof(int) * num_names);
+  if (ids == NULL) return TINYOBJ_ERROR_MEMORY;
+
+  for (i = 0; i < num_names; i++) {
+    const hash_table_entry_t *entry = &usemtl_table->entries[i];
+    ids[i] = find_material_id(&parser->material_table,
+                              usemtl_table->keys + entry->key, entry->key_len,
+                              &material_hit);
+  }
+  for (i = 0; i < parser->num_faces; i++) {
+    int name = parser->attrib.material_ids[i];
+    if (name >= 0) parser->attrib.material_ids[i] = ids[name];
+  }
+
+  tracked_free(ids, sizeof(int) * num_names);
+  return TINYOBJ_SUCCESS;
+}
+
+int tinyobj_parser_finish(tinyobj_parser_t *parser, tinyobj_attrib_t *attrib,
+                          tinyobj_shape_t **shapes, size_t *num_shapes,
+                          tinyobj_material_t **materials,
+                          size_t *num_materials) {
+  int ret;
+
+  if (parser == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  ret = parser->error;
+  if (attrib == NULL || shapes == NULL || num_shapes == NULL ||
+      materials == NULL || num_materials == NULL) {
+    ret = TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+
+  /* The last line may have no line ending. */
+  if (ret == TINYOBJ_SUCCESS && parser->carry_len > 0) {
+    ret = parser_process_line(parser, parser->carry, parser->carry_len);
+  }
+  if (ret == TINYOBJ_SUCCESS) {
+    ret = shape_builder_flush(&parser->shape_builder);
+  }
+  if (ret == TINYOBJ_SUCCESS) {
+    ret = parser_resolve_materials(parser);
+  }
+
+  if (ret == TINYOBJ_SUCCESS) {
+    parser->attrib.num_vertices = (unsigned int)parser->num_v;
+    parser->attrib.num_normals = (unsigned int)parser->num_vn;
+    parser->attrib.num_texcoords = (unsigned int)parser->num_vt;
+    parser->attrib.num_faces = (unsigned int)parser->num_f;
+    parser->attrib.num_face_num_verts = (unsigned int)parser->num_faces;
+
+    if (parser->soa) {
+      ret = split_face_indices(&parser->attrib, parser->num_vt > 0,
+                               parser->num_vn > 0, parser->arena);
+    }
+  }
+  if (ret == TINYOBJ_SUCCESS && parser->quantize) {
+    ret = quantize_attrib(&parser->attrib, parser->quantize, parser->arena);
+  }
+  if (ret == TINYOBJ_SUCCESS && parser->string_pool) {
+    ret = string_pool_build(parser->string_pool, parser->shape_builder.shapes,
+                            parser->shape_builder.num_shapes,
+                            parser->mtl_loader.materials,
+                            parser->mtl_loader.num_materials);
+  }
+  if (ret == TINYOBJ_SUCCESS) {
+    if (parser->soa) {
+      tinyobj_free(parser->arena, parser->attrib.faces,
+                   sizeof(tinyobj_vertex_index_t) * parser->f_capacity);
+      parser->attrib.faces = NULL;
+    }
+    if (parser->attrib.quantized_vertices) {
+      tinyobj_free(parser->arena, parser->attrib.vertices,
+                   sizeof(float) * 3 * parser->v_capacity);
+      parser->attrib.vertices = NULL;
+    }
+    if (parser->attrib.quantized_normals) {
+      tinyobj_free(parser->arena, parser->attrib.normals,
+                   sizeof(float) * 3 * parser->vn_capacity);
+      parser->attrib.normals = NULL;
+    }
+    if (parser->attrib.quantized_texcoords) {
+      tinyobj_free(parser->arena, parser->attrib.texcoords,
+                   sizeof(float) * 2 * parser->vt_capacity);
+      parser->attrib.texcoords = NULL;
+    }
+
+    (*attrib) = parser->attrib;
+    (*shapes) = parser->shape_builder.shapes;
+    (*num_shapes) = parser->shape_builder.num_shapes;
+    (*materials) = parser->mtl_loader.materials;
+    (*num_materials) = parser->mtl_loader.num_materials;
+
+    parser->shape_builder.shapes = NULL;
+    parser->shape_builder.num_shapes = 0;
+    parser->mtl_loader.materials = NULL;
+    parser->mtl_loader.num_materials = 0;
+  } else if (parser->arena == NULL) {
+    tinyobj_attrib_free(&parser->attrib);
+  }
+
+  shape_builder_free(&parser->shape_builder);
+  if (parser->arena == NULL) {
+    tinyobj_materials_free(parser->mtl_loader.materials,
+                           parser->mtl_loader.num_materials);
+  }
+  mtl_loader_free(&parser->mtl_loader);
+  destroy_hash_table(&parser->material_table);
+  destroy_hash_table(&parser->usemtl_table);
+  face_buffer_free(&parser->faces);
+  line_scanner_free(&parser->lines);
+  tinyobj_arena_free(&parser->name_arena);
+  if (parser->carry) TINYOBJ_FREE(parser->carry);
+  if (parser->obj_filename) TINYOBJ_FREE(parser->obj_filename);
+  TINYOBJ_FREE(parser);
+
+  return ret;
+}
+
+/* Compressed .obj files are recognized by their magic bytes and
+ * decompressed in chunks into the streaming parser. With
+ * TINYOBJ_FLAG_PARALLEL, a thread decompresses the next chunks while the
+ * current one is parsed. */
+#ifndef TINYOBJ_DECOMPRESS_CHUNK_SIZE
+#define TINYOBJ_DECOMPRESS_CHUNK_SIZE (256 * 1024)
+#endif
+#ifndef TINYOBJ_DECOMPRESS_NUM_CHUNKS
+#define TINYOBJ_DECOMPRESS_NUM_CHUNKS (4)
+#endif
+
+/* Decompresses a file in memory, a chunk at a time. */
+typedef struct {
+  CompressionType type;
+  int finished;
+  const char *src;
+  size_t src_len;
+  size_t src_pos;   /* Bytes passed to the decompressor. */
+  size_t total_out; /* Bytes decompressed so far. */
+#ifdef TINYOBJ_USE_ZLIB
+  z_stream zstream;
+#endif
+#ifdef TINYOBJ_USE_ZSTD
+  ZSTD_DCtx *zstd;
+#endif
+} Decompressor;
+
+/* Returns TINYOBJ_ERROR_FILE_OPERATION when support for `type` is not
+ * compiled in. */
+static int decompressor_init(Decompressor *d, CompressionType type,
+                             const char *src, size_t src_len) {
+  memset(d, 0, sizeof(Decompressor));
+  d->type = type;
+  d->src = src;
+  d->src_len = src_len;
+#ifdef TINYOBJ_USE_ZLIB
+  if (type == COMPRESSION_GZIP) {
+    /* 16: gzip header and trailer instead of zlib. */
+    int z = inflateInit2(&d->zstream, 16 + MAX_WBITS);
+    if (z == Z_OK) return TINYOBJ_SUCCESS;
+    return (z == Z_MEM_ERROR) ? TINYOBJ_ERROR_MEMORY
+                              : TINYOBJ_ERROR_FILE_OPERATION;
+  }
+#endif
+#ifdef TINYOBJ_USE_ZSTD
+  if (type == COMPRESSION_ZSTD) {
+    d->zstd = ZSTD_createDCtx();
+    return d->zstd ? TINYOBJ_SUCCESS : TINYOBJ_ERROR_MEMORY;
+  }
+#endif
+  d->type = COMPRESSION_NONE;
+  return TINYOBJ_ERROR_FILE_OPERATION;
+}
+
+static void decompressor_free(Decompressor *d) {
+#ifdef TINYOBJ_USE_ZLIB
+  if (d->type == COMPRESSION_GZIP) inflateEnd(&d->zstream);
+#endif
+#ifdef TINYOBJ_USE_ZSTD
+  if (d->type == COMPRESSION_ZSTD) ZSTD_freeDCtx(d->zstd);
+#endif
+  d->type = COMPRESSION_NONE;
+}
+
+#ifdef TINYOBJ_USE_ZLIB
+static int gzip_read(Decompressor *d, char *out, size_t capacity,
+                     size_t *out_len) {
+  z_stream *s = &d->zstream;
+
+  s->next_out = (Bytef *)out;
+  s->avail_out = (uInt)capacity;
+  while (s->avail_out > 0 && !d->finished) {
+    int z;
+    if (s->avail_in == 0) {
+      size_t n = d->src_len - d->src_pos;
+      if (n > (uInt)-1) n = (uInt)-1;
+      s->next_in = (Bytef *)(d->src + d->src_pos);
+      s->avail_in = (uInt)n;
+      d->src_pos += n;
+    }
+    z = inflate(s, Z_NO_FLUSH);
+    if (z == Z_STREAM_END) {
+      /* Concatenated members(pigz, cat a.gz b.gz) are one file. Other
+       * trailing bytes are ignored, as gzip does. */
+      d->src_pos = (size_t)((const char *)s->next_in - d->src);
+      s->avail_in = 0;
+      if (detect_compression(d->src + d->src_pos, d->src_len - d->src_pos) ==
+          COMPRESSION_GZIP) {
+        if (inflateReset(s) != Z_OK) return TINYOBJ_ERROR_FILE_OPERATION;
+      } else {
+        d->finished = 1;
+      }
+    } else if (z == Z_MEM_ERROR) {
+      return TINYOBJ_ERROR_MEMORY;
+    } else if (z != Z_OK) {
+      return TINYOBJ_ERROR_FILE_OPERATION; /* Corrupt or truncated. */
+    }
+  }
+  *out_len = capacity - s->avail_out;
+  return TINYOBJ_SUCCESS;
+}
+#endif
+
+#ifdef TINYOBJ_USE_ZSTD
+static int zstd_read(Decompressor *d, char *out, size_t capacity,
+                     size_t *out_len) {
+  ZSTD_inBuffer in;
+  ZSTD_outBuffer dst;
+
+  in.src = d->src;
+  in.size = d->src_len;
+  in.pos = d->src_pos;
+  dst.dst = out;
+  dst.size = capacity;
+  dst.pos = 0;
+  while (dst.pos < dst.size && !d->finished) {
+    size_t in_pos = in.pos;
+    size_t out_pos = dst.pos;
+    /* Frames one after another are decompressed as one file. */
+    size_t r = ZSTD_decompressStream(d->zstd, &dst, &in);
+    if (ZSTD_isError(r)) return TINYOBJ_ERROR_FILE_OPERATION;
+    if (r == 0 && in.pos == in.size) {
+      d->finished = 1;
+    } else if (in.pos == in_pos && dst.pos == out_pos) {
+      return TINYOBJ_ERROR_FILE_OPERATION; /* Truncated. */
+    }
+  }
+  d->src_pos = in.pos;
+  *out_len = dst.pos;
+  return TINYOBJ_SUCCESS;
+}
+#endif
+
+/* Decompress up to `capacity` bytes. `*out_len` is 0 at the end. */
+static int decompressor_read(Decompressor *d, char *out, size_t capacity,
+                             size_t *out_len) {
+  int ret = TINYOBJ_ERROR_FILE_OPERATION;
+
+  *out_len = 0;
+  if (d->finished) return TINYOBJ_SUCCESS;
+#ifdef TINYOBJ_USE_ZLIB
+  if (d->type == COMPRESSION_GZIP) ret = gzip_read(d, out, capacity, out_len);
+#endif
+#ifdef TINYOBJ_USE_ZSTD
+  if (d->type == COMPRESSION_ZSTD) ret = zstd_read(d, out, capacity, out_len);
+#endif
+  (void)out;
+  (void)capacity;
+  d->total_out += *out_len;
+  return ret;
+}
+
+#ifdef TINYOBJ_USE_THREADS
+/* Ring of chunks filled by the decompressor thread and fed to the parser by
+ * the calling thread. Chunk i is in chunks[i % TINYOBJ_DECOMPRESS_NUM_CHUNKS]. */
+typedef struct {
+  Decompressor *decompressor;
+  char *chunks[TINYOBJ_DECOMPRESS_NUM_CHUNKS];
+  size_t lens[TINYOBJ_DECOMPRESS_NUM_CHUNKS];
+  size_t num_written; /* Chunks filled by the decompressor. */
+  size_t num_read;    /* Chunks parsed. */
+  int done;           /* The decompressor has stopped. */
+  int cancel;         /* The parser has stopped. */
+  int error;          /* Of the decompressor. */
+  int pad0;
+  tinyobj_mutex_t mutex;
+  tinyobj_cond_t filled;
+  tinyobj_cond_t consumed;
+} DecompressRing;
+
+static void decompress_task(void *arg, size_t task_id) {
+  DecompressRing *ring = (DecompressRing *)arg;
+  (void)task_id;
+
+  tinyobj_mutex_lock(&ring->mutex);
+  for (;;) {
+    size_t slot;
+    size_t n = 0;
+    int ret;
+
+    while (ring->num_written - ring->num_read == TINYOBJ_DECOMPRESS_NUM_CHUNKS &&
+           !ring->cancel) {
+      tinyobj_cond_wait(&ring->consumed, &ring->mutex);
+    }
+    if (ring->cancel) break;
+    slot = ring->num_written % TINYOBJ_DECOMPRESS_NUM_CHUNKS;
+    tinyobj_mutex_unlock(&ring->mutex);
+
+    ret = decompressor_read(ring->decompressor, ring->chunks[slot],
+                            TINYOBJ_DECOMPRESS_CHUNK_SIZE, &n);
+
+    tinyobj_mutex_lock(&ring->mutex);
+    if (ret != TINYOBJ_SUCCESS || n == 0) {
+      ring->error = ret;
+      break;
+    }
+    ring->lens[slot] = n;
+    ring->num_written++;
+    tinyobj_cond_signal(&ring->filled);
+  }
+  ring->done = 1;
+  tinyobj_cond_signal(&ring->filled);
+  tinyobj_mutex_unlock(&ring->mutex);
+}
+
+/* Feed the chunks of the decompressor thread to `parser`. Returns 1 with
+ * the result in `*ret`, or 0 when the thread can not be started. */
+static int feed_decompressed_on_thread(tinyobj_parser_t *parser,
+                                       Decompressor *decompressor,
+                                       char *chunks, int *ret) {
+  DecompressRing ring;
+  tinyobj_worker_t worker;
+  tinyobj_thread_t thread;
+  size_t i;
+
+  memset(&ring, 0, sizeof(DecompressRing));
+  ring.decompressor = decompressor;
+  for (i = 0; i < TINYOBJ_DECOMPRESS_NUM_CHUNKS; i++) {
+    ring.chunks[i] = chunks + i * TINYOBJ_DECOMPRESS_CHUNK_SIZE;
+  }
+  if (tinyobj_mutex_init(&ring.mutex) != 0) return 0;
+  if (tinyobj_cond_init(&ring.filled) != 0) {
+    tinyobj_mutex_destroy(&ring.mutex);
+    return 0;
+  }
+  if (tinyobj_cond_init(&ring.consumed) != 0) {
+    tinyobj_cond_destroy(&ring.filled);
+    tinyobj_mutex_destroy(&ring.mutex);
+    return 0;
+  }
+
+  worker.func = decompress_task;
+  worker.arg = &ring;
+  worker.num_tasks = 1;
+  worker.num_threads = 1;
+  worker.thread_id = 0;
+  if (tinyobj_thread_create(&thread, &worker) != 0) {
+    tinyobj_cond_destroy(&ring.consumed);
+    tinyobj_cond_destroy(&ring.filled);
+    tinyobj_mutex_destroy(&ring.mutex);
+    return 0;
+  }
+
+  *ret = TINYOBJ_SUCCESS;
+  tinyobj_mutex_lock(&ring.mutex);
+  for (;;) {
+    size_t slot;
+
+    while (ring.num_read == ring.num_written && !ring.done) {
+      tinyobj_cond_wait(&ring.filled, &ring.mutex);
+    }
+    if (ring.num_read == ring.num_written) break;
+    slot = ring.num_read % TINYOBJ_DECOMPRESS_NUM_CHUNKS;
+    tinyobj_mutex_unlock(&ring.mutex);
+
+    *ret = tinyobj_parser_feed(parser, ring.chunks[slot], ring.lens[slot]);
+
+    tinyobj_mutex_lock(&ring.mutex);
+    ring.num_read++;
+    tinyobj_cond_signal(&ring.consumed);
+    if (*ret != TINYOBJ_SUCCESS) {
+      ring.cancel = 1;
+      break;
+    }
+  }
+  tinyobj_mutex_unlock(&ring.mutex);
+  tinyobj_thread_join(thread);
+
+  if (*ret == TINYOBJ_SUCCESS) *ret = ring.error;
+  tinyobj_cond_destroy(&ring.consumed);
+  tinyobj_cond_destroy(&ring.filled);
+  tinyobj_mutex_destroy(&ring.mutex);
+  return 1;
+}
+#endif
+
+/* Parse the compressed .obj in `buf` with the streaming parser. */
+static int parse_compressed_obj(tinyobj_attrib_t *attrib,
+                                tinyobj_shape_t **shapes, size_t *num_shapes,
+                                tinyobj_material_t **materials_out,
+                                size_t *num_materials_out,
+                                const char *obj_filename,
+                                file_reader_callback file_reader, void *ctx,
+                                unsigned int flags,
+                                const tinyobj_parse_option_t *option,
+                                tinyobj_parse_stats_t *stats,
+                                const char *buf, size_t len) {
+  Decompressor decompressor;
+  tinyobj_parser_t *parser = NULL;
+  size_t num_chunks = 1;
+  char *chunks = NULL;
+  int fed = 0;
+  int ret;
+  double phase_start = stats ? tinyobj_time() : 0.0;
+
+  ret = decompressor_init(&decompressor, detect_compression(buf, len), buf, len);
+  if (ret != TINYOBJ_SUCCESS) return ret;
+
+  /* One thread decompresses and one parses. */
+  if (tinyobj_num_threads(flags, option ? option->num_threads : 0, 2, 1) > 1) {
+    num_chunks = TINYOBJ_DECOMPRESS_NUM_CHUNKS;
+  }
+  chunks = (char *)tracked_malloc(num_chunks * TINYOBJ_DECOMPRESS_CHUNK_SIZE);
+  parser = tinyobj_parser_create_ex(obj_filename, file_reader, ctx, flags,
+                                    option);
+  if (chunks == NULL || parser == NULL) {
+    ret = TINYOBJ_ERROR_MEMORY;
+  }
+
+#ifdef TINYOBJ_USE_THREADS
+  if (ret == TINYOBJ_SUCCESS && num_chunks > 1) {
+    fed = feed_decompressed_on_thread(parser, &decompressor, chunks, &ret);
+  }
+#endif
+  /* Decompress and parse one after another. */
+  while (ret == TINYOBJ_SUCCESS && !fed) {
+    size_t n = 0;
+    ret = decompressor_read(&decompressor, chunks,
+                            TINYOBJ_DECOMPRESS_CHUNK_SIZE, &n);
+    if (ret != TINYOBJ_SUCCESS || n == 0) break;
+    ret = tinyobj_parser_feed(parser, chunks, n);
+  }
+  if (stats) stats->num_bytes = decompressor.total_out;
+
+  if (chunks) tracked_free(chunks, num_chunks * TINYOBJ_DECOMPRESS_CHUNK_SIZE);
+  decompressor_free(&decompressor);
+  if (parser) {
+    /* finish frees the parser, and its results on error. */
+    if (parser->error == TINYOBJ_SUCCESS) parser->error = ret;
+    ret = tinyobj_parser_finish(parser, attrib, shapes, num_shapes,
+                                materials_out, num_materials_out);
+  }
+  if (stats) stats->parse_time = tinyobj_lap(&phase_start);
+  return ret;
+}
+
+/* Open addressing table of one shard of the (v, vt, vn) triples. */
+typedef struct {
+  uint32_t *hashes;
+  uint32_t *positions; /* First index using the triple. UINT32_MAX = empty. */
+  size_t capacity;     /* Power of two. */
+  size_t count;
+} WeldShard;
+
+typedef struct {
+  const tinyobj_attrib_t *attrib;
+  tinyobj_indexed_mesh_t *mesh;
+  uint32_t *hashes; /* Per face index. */
+  uint32_t *owners; /* Per face index: first index with the same triple. */
+  uint32_t *order;  /* Face indices grouped by shard, ascending in each. */
+  /* [task * num_tasks + shard]: indices of the task in the shard, then where
+   * the task writes them in `order`. */
+  size_t *shard_counts;
+  size_t num_indices;
+  size_t num_tasks;
+  size_t shard_begin[TINYOBJ_MAX_THREADS + 1]; /* Range of each shard in `order`. */
+  size_t first_counts[TINYOBJ_MAX_THREADS]; /* New vertices per task. */
+  int shard_errors[TINYOBJ_MAX_THREADS];
+} WeldTask;
+
+static uint32_t hash_vertex_index(tinyobj_vertex_index_t vi) {
+  uint32_t h = (uint32_t)vi.v_idx * 0x9E3779B1u;
+  h ^= (uint32_t)vi.vt_idx * 0x85EBCA77u;
+  h ^= (uint32_t)vi.vn_idx * 0xC2B2AE3Du;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  return h;
+}
+
+static int same_vertex_index(tinyobj_vertex_index_t a, tinyobj_vertex_index_t b) {
+  return a.v_idx == b.v_idx && a.vt_idx == b.vt_idx && a.vn_idx == b.vn_idx;
+}
+
+/* Task `t` handles face indices [begin, end). */
+static void weld_task_range(const WeldTask *task, size_t t, size_t *begin,
+                            size_t *end) {
+  *begin = task->num_indices * t / task->num_tasks;
+  *end = task->num_indices * (t + 1) / task->num_tasks;
+}
+
+static size_t weld_shard_of(uint32_t hash, size_t num_shards) {
+  return (size_t)(((uint64_t)hash * num_shards) >> 32);
+}
+
+static void weld_shard_free(WeldShard *shard) {
+  tracked_free(shard->hashes, sizeof(uint32_t) * shard->capacity);
+  tracked_free(shard->positions, sizeof(uint32_t) * shard->capacity);
+}
+
+/* Frees what it allocated on failure. */
+static int weld_shard_alloc(WeldShard *shard, size_t capacity) {
+  shard->hashes = (uint32_t *)tracked_malloc(sizeof(uint32_t) * capacity);
+  shard->positions = (uint32_t *)tracked_malloc(sizeof(uint32_t) * capacity);
+  shard->capacity = capacity;
+  shard->count = 0;
+  if (shard->hashes == NULL || shard->positions == NULL) {
+    weld_shard_free(shard);
+    return -1;
+  }
+  memset(shard->positions, 0xFF, sizeof(uint32_t) * capacity);
+  return 0;
+}
+
+/* Double the capacity when the table is half full. The table is freed on
+ * failure. */
+static int weld_shard_grow(WeldShard *shard) {
+  WeldShard old = *shard;
+  size_t i;
+
+  if (weld_shard_alloc(shard, old.capacity * 2) != 0) {
+    weld_shard_free(&old);
+    return -1;
+  }
+  shard->count = old.count;
+  for (i = 0; i < old.capacity; i++) {
+    size_t slot;
+    if (old.positions[i] == UINT32_MAX) continue;
+    slot = old.hashes[i] & (shard->capacity - 1);
+    while (shard->positions[slot] != UINT32_MAX) {
+      slot = (slot + 1) & (shard->capacity - 1);
+    }
+    shard->hashes[slot] = old.hashes[i];
+    shard->positions[slot] = old.positions[i];
+  }
+  weld_shard_free(&old);
+  return 0;
+}
+
+/* Hash the indices of task `t` and count them per shard. */
+static void weld_hash_task(void *arg, size_t t) {
+  WeldTask *task = (WeldTask *)arg;
+  const tinyobj_vertex_index_t *faces = task->attrib->faces;
+  size_t *counts = &task->shard_counts[t * task->num_tasks];
+  size_t i, begin, end;
+
+  weld_task_range(task, t, &begin, &end);
+  for (i = begin; i < end; i++) {
+    uint32_t hash = hash_vertex_index(faces[i]);
+    task->hashes[i] = hash;
+    counts[weld_shard_of(hash, task->num_tasks)]++;
+  }
+}
+
+/* Write the indices of task `t` to the lists of their shards. Tasks cover
+ * ascending ranges and write after the tasks before them, so each list is in
+ * index order. */
+static void weld_scatter_task(void *arg, size_t t) {
+  WeldTask *task = (WeldTask *)arg;
+  size_t *offsets = &task->shard_counts[t * task->num_tasks];
+  size_t i, begin, end;
+
+  weld_task_range(task, t, &begin, &end);
+  for (i = begin; i < end; i++) {
+    size_t shard = weld_shard_of(task->hashes[i], task->num_tasks);
+    task->order[offsets[shard]++] = (uint32_t)i;
+  }
+}
+
+/* Shard `t` finds the first use of each of its triples, in index order. */
+static void weld_shard_task(void *arg, size_t t) {
+  WeldTask *task = (WeldTask *)arg;
+  const tinyobj_vertex_index_t *faces = task->attrib->faces;
+  size_t begin = task->shard_begin[t];
+  size_t end = task->shard_begin[t + 1];
+  size_t capacity = 64;
+  size_t k;
+  WeldShard shard;
+
+  /* Start at about a quarter of the indices, as most meshes reuse a vertex
+   * several times. */
+  while (capacity < (end - begin) / 2) capacity *= 2;
+  if (weld_shard_alloc(&shard, capacity) != 0) {
+    task->shard_errors[t] = 1;
+    return;
+  }
+
+  for (k = begin; k < end; k++) {
+    uint32_t i = task->order[k];
+    uint32_t hash = task->hashes[i];
+    size_t slot = hash & (shard.capacity - 1);
+
+    for (;;) {
+      uint32_t pos = shard.positions[slot];
+      if (pos == UINT32_MAX) {
+        shard.hashes[slot] = hash;
+        shard.positions[slot] = i;
+        task->owners[i] = i;
+        shard.count++;
+        if (shard.count * 2 > shard.capacity && weld_shard_grow(&shard) != 0) {
+          task->shard_errors[t] = 1;
+          return;
+        }
+        break;
+      }
+      if (shard.hashes[slot] == hash && same_vertex_index(faces[pos], faces[i])) {
+        task->owners[i] = pos;
+        break;
+      }
+      slot = (slot + 1) & (shard.capacity - 1);
+    }
+  }
+  weld_shard_free(&shard);
+}
+
+static void weld_count_task(void *arg, size_t t) {
+  WeldTask *task = (WeldTask *)arg;
+  size_t i, begin, end, count = 0;
+
+  weld_task_range(task, t, &begin, &end);
+  for (i = begin; i < end; i++) {
+    if (task->owners[i] == i) count++;
+  }
+  task->first_counts[t] = count;
+}
+
+static void weld_copy_attribute(float *dst, const float *src, int idx,
+                                unsigned int num, size_t n) {
+  size_t k;
+  if (idx >= 0 && (unsigned int)idx < num) {
+    for (k = 0; k < n; k++) dst[k] = src[(size_t)idx * n + k];
+  } else {
+    for (k = 0; k < n; k++) dst[k] = 0.0f;
+  }
+}
+
+/* Number the first uses of task `t` and fill their vertices.
+ * `first_counts[t]` holds the first vertex id of the task at this point. */
+static void weld_emit_task(void *arg, size_t t) {
+  WeldTask *task = (WeldTask *)arg;
+  const tinyobj_attrib_t *attrib = task->attrib;
+  tinyobj_indexed_mesh_t *mesh = task->mesh;
+  size_t i, begin, end;
+  uint32_t id = (uint32_t)task->first_counts[t];
+
+  weld_task_range(task, t, &begin, &end);
+  for (i = begin; i < end; i++) {
+    tinyobj_vertex_index_t vi = attrib->faces[i];
+    float *dst;
+
+    if (task->owners[i] != i) continue;
+
+    dst = &mesh->vertices[(size_t)id * TINYOBJ_INDEXED_VERTEX_STRIDE];
+    weld_copy_attribute(dst, attrib->vertices, vi.v_idx, attrib->num_vertices, 3);
+    weld_copy_attribute(dst + 3, attrib->normals, vi.vn_idx, attrib->num_normals, 3);
+    weld_copy_attribute(dst + 6, attrib->texcoords, vi.vt_idx, attrib->num_texcoords, 2);
+    mesh->remap[id] = vi;
+    mesh->indices[i] = id++;
+  }
+}
+
+/* Runs after all first uses are numbered. */
+static void weld_resolve_task(void *arg, size_t t) {
+  WeldTask *task = (WeldTask *)arg;
+  size_t i, begin, end;
+
+  weld_task_range(task, t, &begin, &end);
+  for (i = begin; i < end; i++) {
+    if (task->owners[i] != i) {
+      task->mesh->indices[i] = task->mesh->indices[task->owners[i]];
+    }
+  }
+}
+
+int tinyobj_build_indexed_mesh(tinyobj_indexed_mesh_t *mesh,
+                               const tinyobj_attrib_t *attrib,
+                               unsigned int flags,
+                               const tinyobj_parse_option_t *option) {
+  tinyobj_arena_t *arena = option ? option->arena : NULL;
+  WeldTask *task;
+  size_t num_threads;
+  size_t num_vertices = 0;
+  size_t num_listed = 0;
+  size_t s, t;
+  int ret = TINYOBJ_SUCCESS;
+
+  if (mesh == NULL || attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (attrib->num_faces > 0 && attrib->faces == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  /* Quantized attributes are not supported. */
+  if ((attrib->num_vertices > 0 && attrib->vertices == NULL) ||
+      (attrib->num_normals > 0 && attrib->normals == NULL) ||
+      (attrib->num_texcoords > 0 && attrib->texcoords == NULL)) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  memset(mesh, 0, sizeof(*mesh));
+  if (attrib->num_faces == 0) return TINYOBJ_SUCCESS;
+
+  num_threads = tinyobj_num_threads(flags, option ? option->num_threads : 0,
+                                    attrib->num_faces,
+                                    TINYOBJ_MIN_INDICES_PER_THREAD);
+
+  task = (WeldTask *)tracked_calloc(1, sizeof(WeldTask));
+  if (task == NULL) return TINYOBJ_ERROR_MEMORY;
+  task->attrib = attrib;
+  task->mesh = mesh;
+  task->num_indices = attrib->num_faces;
+  task->num_tasks = num_threads;
+  task->hashes = (uint32_t *)tracked_malloc(sizeof(uint32_t) * task->num_indices);
+  task->owners = (uint32_t *)tracked_malloc(sizeof(uint32_t) * task->num_indices);
+  task->order = (uint32_t *)tracked_malloc(sizeof(uint32_t) * task->num_indices);
+  task->shard_counts = (size_t *)tracked_calloc(num_threads * num_threads, sizeof(size_t));
+  if (task->hashes == NULL || task->owners == NULL || task->order == NULL ||
+      task->shard_counts == NULL) {
+    ret = TINYOBJ_ERROR_MEMORY;
+    goto cleanup;
+  }
+
+  /* 1. Find the first use of every triple. Triples are split into shards by
+   * hash, so each shard table is only touched by one thread, and each shard
+   * only walks its own indices. */
+  tinyobj_parallel_for(num_threads, num_threads, weld_hash_task, task);
+  for (s = 0; s < num_threads; s++) {
+    task->shard_begin[s] = num_listed;
+    for (t = 0; t < num_threads; t++) {
+      size_t count = task->shard_counts[t * num_threads + s];
+      task->shard_counts[t * num_threads + s] = num_listed;
+      num_listed += count;
+    }
+  }
+  task->shard_begin[num_threads] = num_listed;
+  tinyobj_parallel_for(num_threads, num_threads, weld_scatter_task, task);
+  tinyobj_parallel_for(num_threads, num_threads, weld_shard_task, task);
+  for (t = 0; t < num_threads; t++) {
+    if (task->shard_errors[t]) {
+      ret = TINYOBJ_ERROR_MEMORY;
+      goto cleanup;
+    }
+  }
+
+  /* 2. Vertex ids are given in index order. */
+  tinyobj_parallel_for(num_threads, num_threads, weld_count_task, task);
+  for (t = 0; t < num_threads; t++) {
+    size_t count = task->first_counts[t];
+    task->first_counts[t] = num_vertices;
+    num_vertices += count;
+  }
+
+  mesh->vertices = (float *)tinyobj_alloc(
+      arena, sizeof(float) * TINYOBJ_INDEXED_VERTEX_STRIDE * num_vertices);
+  mesh->indices = (uint32_t *)tinyobj_alloc(arena, sizeof(uint32_t) * task->num_indices);
+  mesh->remap = (tinyobj_vertex_index_t *)tinyobj_alloc(
+      arena, sizeof(tinyobj_vertex_index_t) * num_vertices);
+  if (mesh->vertices == NULL || mesh->indices == NULL || mesh->remap == NULL) {
+    if (arena == NULL) tinyobj_indexed_mesh_free(mesh);
+    memset(mesh, 0, sizeof(*mesh));
+    ret = TINYOBJ_ERROR_MEMORY;
+    goto cleanup;
+  }
+  mesh->num_vertices = (unsigned int)num_vertices;
+  mesh->num_indices = (unsigned int)task->num_indices;
+
+  tinyobj_parallel_for(num_threads, num_threads, weld_emit_task, task);
+  tinyobj_parallel_for(num_threads, num_threads, weld_resolve_task, task);
+
+cleanup:
+  tracked_free(task->hashes, sizeof(uint32_t) * task->num_indices);
+  tracked_free(task->owners, sizeof(uint32_t) * task->num_indices);
+  tracked_free(task->order, sizeof(uint32_t) * task->num_indices);
+  tracked_free(task->shard_counts, sizeof(size_t) * num_threads * num_threads);
+  tracked_free(task, sizeof(WeldTask));
+  return ret;
+}
+
+int tinyobj_triangulate(tinyobj_triangles_t *triangles,
+                        const tinyobj_attrib_t *attrib, int method,
+                        unsigned int flags,
+                        const tinyobj_parse_option_t *option) {
+  size_t num_threads;
+
+  if (triangles == NULL || attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (method != TINYOBJ_TRIANGULATE_FAN && method != TINYOBJ_TRIANGULATE_EAR_CLIP) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  if ((attrib->num_faces > 0 && attrib->faces == NULL) ||
+      (attrib->num_face_num_verts > 0 && attrib->face_num_verts == NULL)) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  if (method == TINYOBJ_TRIANGULATE_EAR_CLIP && attrib->num_vertices > 0 &&
+      attrib->vertices == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+
+  num_threads = tinyobj_num_threads(flags, option ? option->num_threads : 0,
+                                    attrib->num_face_num_verts,
+                                    TINYOBJ_MIN_FACES_PER_THREAD);
+  return triangulate_faces(triangles, attrib, method, num_threads,
+                           option ? option->arena : NULL);
+}
+
+void tinyobj_triangles_free(tinyobj_triangles_t *triangles) {
+  if (triangles->faces) TINYOBJ_FREE(triangles->faces);
+  if (triangles->face_num_verts) TINYOBJ_FREE(triangles->face_num_verts);
+  if (triangles->material_ids) TINYOBJ_FREE(triangles->material_ids);
+  triangles->faces = NULL;
+  triangles->face_num_verts = NULL;
+  triangles->material_ids = NULL;
+  triangles->num_faces = 0;
+  triangles->num_face_num_verts = 0;
+}
+
+void tinyobj_indexed_mesh_free(tinyobj_indexed_mesh_t *mesh) {
+  if (mesh->vertices) TINYOBJ_FREE(mesh->vertices);
+  if (mesh->indices) TINYOBJ_FREE(mesh->indices);
+  if (mesh->remap) TINYOBJ_FREE(mesh->remap);
+  mesh->vertices = NULL;
+  mesh->indices = NULL;
+  mesh->remap = NULL;
+  mesh->num_vertices = 0;
+  mesh->num_indices = 0;
+}
+
+/* Map a whole file copy-on-write, or read it when mmap is not available.
+ * Returns NULL for an empty or unreadable file. */
+static char *tinyobj_map_file(const char *filename, size_t *size) {
+#ifdef TINYOBJ_HAS_MMAP
+  struct stat st;
+  void *p;
+  int fd = open(filename, O_RDONLY);
+
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return NULL;
+  *size = (size_t)st.st_size;
+  return (char *)p;
+#else
+  char *buf;
+  long len;
+  FILE *fp = fopen(filename, "rb");
+
+  if (fp == NULL) return NULL;
+  if (fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) <= 0) {
+    fclose(fp);
+    return NULL;
+  }
+  rewind(fp);
+  buf = (char *)TINYOBJ_MALLOC((size_t)len);
+  if (buf && fread(buf, 1, (size_t)len, fp) != (size_t)len) {
+    TINYOBJ_FREE(buf);
+    buf = NULL;
+  }
+  fclose(fp);
+  *size = (size_t)len;
+  return buf;
+#endif
+}
+
+static void tinyobj_unmap_file(char *data, size_t size) {
+#ifdef TINYOBJ_HAS_MMAP
+  munmap(data, size);
+#else
+  (void)size;
+  TINYOBJ_FREE(data);
+#endif
+}
+
+#ifdef TINYOBJ_HAS_MMAP
+/* Read `fd` to the end into an anonymous mapping, for files which can not be
+ * mapped, so tinyobj_file_release can unmap every buffer. */
+static char *read_unmappable_file(int fd, size_t *len) {
+  char *buf = NULL;
+  size_t capacity = 0;
+  void *p = NULL;
+
+  *len = 0;
+  for (;;) {
+    ssize_t n;
+    if (*len == capacity) {
+      size_t new_capacity = capacity ? 2 * capacity : 65536;
+      char *q = (char *)tracked_realloc(buf, capacity, new_capacity);
+      if (q == NULL) break;
+      buf = q;
+      capacity = new_capacity;
+    }
+    n = read(fd, buf + *len, capacity - *len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    *len += (size_t)n;
+  }
+
+  if (*len > 0) {
+#ifdef MAP_ANONYMOUS
+    p = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+             -1, 0);
+#else
+    /* Strict ISO C modes hide MAP_ANONYMOUS. */
+    int zero = open("/dev/zero", O_RDWR);
+    p = (zero < 0) ? MAP_FAILED
+                   : mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE, zero, 0);
+    if (zero >= 0) close(zero);
+#endif
+    if (p == MAP_FAILED) {
+      p = NULL;
+    } else {
+      memcpy(p, buf, *len);
+    }
+  }
+  tracked_free(buf, capacity);
+  if (p == NULL) *len = 0;
+  return (char *)p;
+}
+#endif
+
+void tinyobj_file_reader(void *ctx, const char *filename, int is_mtl,
+                         const char *obj_filename, char **buf, size_t *len) {
+  (void)ctx;
+  (void)is_mtl;
+  (void)obj_filename;
+
+  *buf = NULL;
+  *len = 0;
+  if (filename == NULL) return;
+
+#ifdef TINYOBJ_HAS_MMAP
+  {
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) return;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      int flags = MAP_PRIVATE;
+      void *p;
+#ifdef MAP_POPULATE
+      /* The whole file is parsed, so fault it in with one call. */
+      flags |= MAP_POPULATE;
+#endif
+      p = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+      if (p != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+        close(fd);
+        *buf = (char *)p;
+        *len = (size_t)st.st_size;
+        return;
+      }
+    }
+    /* Pipes, /proc files(size 0) and file systems without mmap. */
+    *buf = read_unmappable_file(fd, len);
+    close(fd);
+  }
+#else
+  *buf = tinyobj_map_file(filename, len);
+  if (*buf == NULL) *len = 0;
+#endif
+}
+
+void tinyobj_file_release(void *ctx, char *buf, size_t len) {
+  (void)ctx;
+  if (buf) tinyobj_unmap_file(buf, len);
+}
+
+#define TINYOBJ_CACHE_VERSION (4)
+#define TINYOBJ_CACHE_ALIGN (64)
+#define TINYOBJ_CACHE_ENDIAN_CHECK (0x01020304)
+
+/* Parse flags which change the result. */
+#define TINYOBJ_CACHE_FLAGS                                 \
+  (TINYOBJ_FLAG_TRIANGULATE | TINYOBJ_FLAG_SOA_INDICES | \
+   TINYOBJ_FLAG_QUANTIZE)
+
+enum {
+  CACHE_VERTICES,
+  CACHE_NORMALS,
+  CACHE_TEXCOORDS,
+  CACHE_FACES,
+  CACHE_FACE_NUM_VERTS,
+  CACHE_MATERIAL_IDS,
+  CACHE_V_INDICES,
+  CACHE_VT_INDICES,
+  CACHE_VN_INDICES,
+  CACHE_QUANTIZED_VERTICES,
+  CACHE_QUANTIZED_NORMALS,
+  CACHE_QUANTIZED_TEXCOORDS,
+  CACHE_SHAPES,
+  CACHE_MATERIALS,
+  CACHE_STRINGS,
+  CACHE_MTL_FILES,
+  CACHE_MTL_NAMES,
+  CACHE_NUM_SECTIONS
+};
+
+/* Strings are stored as offsets from the start of the file(0 = NULL) in the
+ * char * members of the shapes and materials, and relocated on load. */
+typedef struct {
+  char magic[8];         /* "TINYOBJC" */
+  uint32_t version;
+  uint32_t endian_check; /* TINYOBJ_CACHE_ENDIAN_CHECK */
+  uint32_t abi;          /* Pointer and struct sizes. */
+  uint32_t flags;        /* TINYOBJ_CACHE_FLAGS of the parse. */
+  uint64_t file_size;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint32_t num_vertices;
+  uint32_t num_normals;
+  uint32_t num_texcoords;
+  uint32_t num_faces;
+  uint32_t num_face_num_verts;
+  float vertex_offset[3];
+  float vertex_scale[3];
+  float texcoord_offset[2];
+  float texcoord_scale[2];
+  uint32_t pad0;
+  uint64_t num_shapes;
+  uint64_t num_materials;
+  uint64_t num_mtl_files;
+  uint64_t offsets[CACHE_NUM_SECTIONS];
+  uint64_t sizes[CACHE_NUM_SECTIONS];
+} CacheHeader;
+
+/* A .mtl file of a `mtllib` line, when the cache was written. */
+typedef struct {
+  uint64_t size;  /* UINT64_MAX = the file did not exist. */
+  int64_t mtime;
+  uint64_t name;  /* Offset of the `mtllib` name in CACHE_MTL_NAMES. */
+} CacheMtlFile;
+
+static uint32_t cache_abi(void) {
+  return (uint32_t)sizeof(void *) | ((uint32_t)sizeof(tinyobj_shape_t) << 8) |
+         ((uint32_t)sizeof(tinyobj_material_t) << 16);
+}
+
+#define TINYOBJ_CACHE_NUM_MATERIAL_STRINGS (8)
+
+static void material_string_fields(tinyobj_material_t *material,
+                                   char **fields[TINYOBJ_CACHE_NUM_MATERIAL_STRINGS]) {
+  fields[0] = &material->name;
+  fields[1] = &material->ambient_texname;
+  fields[2] = &material->diffuse_texname;
+  fields[3] = &material->specular_texname;
+  fields[4] = &material->specular_highlight_texname;
+  fields[5] = &material->bump_texname;
+  fields[6] = &material->displacement_texname;
+  fields[7] = &material->alpha_texname;
+}
+
+/* Size and modification time in nanoseconds. The fraction of a second is 0
+ * where struct stat only has seconds(Windows). `st_mtime` is a macro when
+ * struct stat has a struct timespec. */
+static int source_stat(const char *filename, uint64_t *size, int64_t *mtime) {
+  struct stat st;
+  int64_t nsec = 0;
+  if (filename == NULL || stat(filename, &st) != 0) return -1;
+#if defined(__APPLE__) && defined(st_mtime)
+  nsec = (int64_t)st.st_mtimespec.tv_nsec;
+#elif (defined(__APPLE__) || defined(__GLIBC__)) && !defined(st_mtime)
+  nsec = (int64_t)st.st_mtimensec;
+#elif (defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+       defined(__OpenBSD__)) && defined(st_mtime)
+  nsec = (int64_t)st.st_mtim.tv_nsec;
+#endif
+  *size = (uint64_t)st.st_size;
+  *mtime = (int64_t)st.st_mtime * 1000000000 + nsec;
+  return 0;
+}
+
+/* The names of the `mtllib` lines of `obj_filename`, as they are written,
+ * in `loader->filenames`. Release them with mtl_loader_free. */
+static int cache_mtl_names(const char *obj_filename, MtlLoader *loader) {
+  size_t len = 0;
+  size_t pos = 0;
+  char *buf;
+
+  mtl_loader_init(loader, NULL, NULL, NULL, NULL, NULL);
+  buf = tinyobj_map_file(obj_filename, &len);
+  if (buf == NULL) return TINYOBJ_ERROR_FILE_OPERATION;
+  while (pos < len) {
+    size_t end = line_end(buf, len, pos);
+    const char *p = buf + pos;
+
+    skip_space(&p, buf + end);
+    if (p < buf + end && *p == 'm') {
+      Command command;
+      if (parseLine(&command, buf + pos, end - pos, 0, NULL) > 0 &&
+          command.type == COMMAND_MTLLIB) {
+        mtl_loader_add(loader, &command);
+      }
+    }
+    pos = end + 1;
+  }
+  tinyobj_unmap_file(buf, len);
+  return loader->status;
+}
+
+/* Stamp the .mtl file `name` of a `mtllib` line of `obj_filename`. */
+static int cache_mtl_stamp(const char *obj_filename, const char *name,
+                           CacheMtlFile *file) {
+  size_t name_len = strlen(name);
+  char *path = generate_mtl_filename(obj_filename, strlen(obj_filename) + 1,
+                                     name, name_len + 1);
+
+  if (path == NULL) return -1;
+  if (source_stat(path, &file->size, &file->mtime) != 0) {
+    file->size = UINT64_MAX;
+    file->mtime = 0;
+  }
+  tracked_free(path, strlen(path) + 1);
+  return 0;
+}
+
+/* 0 when every .mtl file of the cache is as it was written. */
+static int cache_check_mtl_files(const char *base, const CacheHeader *header,
+                                 const char *obj_filename) {
+  const char *names = base + header->offsets[CACHE_MTL_NAMES];
+  uint64_t names_size = header->sizes[CACHE_MTL_NAMES];
+  uint64_t i;
+
+  for (i = 0; i < header->num_mtl_files; i++) {
+    CacheMtlFile file, current;
+
+    memcpy(&file, base + header->offsets[CACHE_MTL_FILES] + i * sizeof(CacheMtlFile),
+           sizeof(CacheMtlFile));
+    if (file.name >= names_size ||
+        memchr(names + file.name, '\0', (size_t)(names_size - file.name)) == NULL) {
+      return -1;
+    }
+    if (cache_mtl_stamp(obj_filename, names + file.name, &current) != 0) return -1;
+    if (current.size != file.size || current.mtime != file.mtime) return -1;
+  }
+  return 0;
+}
+
+/* Replace a string with its offset in the string section. */
+static char *cache_string_offset(const char *s, uint64_t *string_pos) {
+  uint64_t pos = *string_pos;
+  if (s == NULL) return NULL;
+  *string_pos += strlen(s) + 1;
+  return (char *)(uintptr_t)pos;
+}
+
+static int cache_write_at(FILE *fp, uint64_t offset, const void *data,
+                          size_t size) {
+  static const char zeros[TINYOBJ_CACHE_ALIGN] = {0};
+  long pos = ftell(fp);
+
+  if (pos < 0 || (uint64_t)pos > offset) return -1;
+  while ((uint64_t)pos < offset) {
+    size_t n = (size_t)(offset - (uint64_t)pos);
+    if (n > sizeof(zeros)) n = sizeof(zeros);
+    if (fwrite(zeros, 1, n, fp) != n) return -1;
+    pos += (long)n;
+  }
+  if (size > 0 && fwrite(data, 1, size, fp) != size) return -1;
+  return 0;
+}
+
+static int cache_write_string(FILE *fp, const char *s) {
+  size_t len;
+  if (s == NULL) return 0;
+  len = strlen(s) + 1;
+  return (fwrite(s, 1, len, fp) == len) ? 0 : -1;
+}
+
+int tinyobj_save_cache(const char *cache_filename, const char *obj_filename,
+                       unsigned int flags, const tinyobj_attrib_t *attrib,
+                       const tinyobj_shape_t *shapes, size_t num_shapes,
+                       const tinyobj_material_t *materials,
+                       size_t num_materials) {
+  CacheHeader header;
+  MtlLoader mtl_files;
+  FILE *fp;
+  uint64_t pos;
+  uint64_t string_pos;
+  size_t i, k;
+  int ret;
+  int err = 0;
+
+  if (cache_filename == NULL || attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_shapes > 0 && shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_materials > 0 && materials == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "TINYOBJC", 8);
+  header.version = TINYOBJ_CACHE_VERSION;
+  header.endian_check = TINYOBJ_CACHE_ENDIAN_CHECK;
+  header.abi = cache_abi();
+  header.flags = flags & TINYOBJ_CACHE_FLAGS;
+  if (source_stat(obj_filename, &header.source_size, &header.source_mtime) != 0) {
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  header.num_vertices = attrib->num_vertices;
+  header.num_normals = attrib->num_normals;
+  header.num_texcoords = attrib->num_texcoords;
+  header.num_faces = attrib->num_faces;
+  header.num_face_num_verts = attrib->num_face_num_verts;
+  memcpy(header.vertex_offset, attrib->vertex_offset, sizeof(header.vertex_offset));
+  memcpy(header.vertex_scale, attrib->vertex_scale, sizeof(header.vertex_scale));
+  memcpy(header.texcoord_offset, attrib->texcoord_offset, sizeof(header.texcoord_offset));
+  memcpy(header.texcoord_scale, attrib->texcoord_scale, sizeof(header.texcoord_scale));
+  header.num_shapes = num_shapes;
+  header.num_materials = num_materials;
+
+  ret = cache_mtl_names(obj_filename, &mtl_files);
+  if (ret != TINYOBJ_SUCCESS) {
+    mtl_loader_free(&mtl_files);
+    return ret;
+  }
+  header.num_mtl_files = mtl_files.num_filenames;
+  header.sizes[CACHE_MTL_FILES] = sizeof(CacheMtlFile) * (uint64_t)mtl_files.num_filenames;
+  for (i = 0; i < mtl_files.num_filenames; i++) {
+    header.sizes[CACHE_MTL_NAMES] += strlen(mtl_files.filenames[i]) + 1;
+  }
+
+  if (attrib->quantized_vertices) {
+    header.sizes[CACHE_QUANTIZED_VERTICES] = sizeof(uint16_t) * 3 * (uint64_t)attrib->num_vertices;
+  } else {
+    header.sizes[CACHE_VERTICES] = sizeof(float) * 3 * (uint64_t)attrib->num_vertices;
+  }
+  if (attrib->quantized_normals) {
+    header.sizes[CACHE_QUANTIZED_NORMALS] = sizeof(int16_t) * 2 * (uint64_t)attrib->num_normals;
+  } else {
+    header.sizes[CACHE_NORMALS] = sizeof(float) * 3 * (uint64_t)attrib->num_normals;
+  }
+  if (attrib->quantized_texcoords) {
+    header.sizes[CACHE_QUANTIZED_TEXCOORDS] = sizeof(uint16_t) * 2 * (uint64_t)attrib->num_texcoords;
+  } else {
+    header.sizes[CACHE_TEXCOORDS] = sizeof(float) * 2 * (uint64_t)attrib->num_texcoords;
+  }
+  if (attrib->faces) {
+    header.sizes[CACHE_FACES] = sizeof(tinyobj_vertex_index_t) * (uint64_t)attrib->num_faces;
+  }
+  header.sizes[CACHE_FACE_NUM_VERTS] = sizeof(int) * (uint64_t)attrib->num_face_num_verts;
+  header.sizes[CACHE_MATERIAL_IDS] = sizeof(int) * (uint64_t)attrib->num_face_num_verts;
+  if (attrib->v_indices) header.sizes[CACHE_V_INDICES] = sizeof(int) * (uint64_t)attrib->num_faces;
+  if (attrib->vt_indices) header.sizes[CACHE_VT_INDICES] = sizeof(int) * (uint64_t)attrib->num_faces;
+  if (attrib->vn_indices) header.sizes[CACHE_VN_INDICES] = sizeof(int) * (uint64_t)attrib->num_faces;
+  header.sizes[CACHE_SHAPES] = sizeof(tinyobj_shape_t) * (uint64_t)num_shapes;
+  header.sizes[CACHE_MATERIALS] = sizeof(tinyobj_material_t) * (uint64_t)num_materials;
+  for (i = 0; i < num_shapes; i++) {
+    if (shapes[i].name) header.sizes[CACHE_STRINGS] += strlen(shapes[i].name) + 1;
+  }
+  for (i = 0; i < num_materials; i++) {
+    char **fields[TINYOBJ_CACHE_NUM_MATERIAL_STRINGS];
+    material_string_fields((tinyobj_material_t *)&materials[i], fields);
+    for (k = 0; k < TINYOBJ_CACHE_NUM_MATERIAL_STRINGS; k++) {
+      if (*fields[k]) header.sizes[CACHE_STRINGS] += strlen(*fields[k]) + 1;
+    }
+  }
+
+  pos = sizeof(CacheHeader);
+  for (i = 0; i < CACHE_NUM_SECTIONS; i++) {
+    pos = (pos + TINYOBJ_CACHE_ALIGN - 1) & ~(uint64_t)(TINYOBJ_CACHE_ALIGN - 1);
+    header.offsets[i] = pos;
+    pos += header.sizes[i];
+  }
+  header.file_size = pos;
+
+  fp = fopen(cache_filename, "wb");
+  if (fp == NULL) {
+    mtl_loader_free(&mtl_files);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+
+  /* The magic is written last, so an incomplete file is never valid. */
+  {
+    CacheHeader placeholder;
+    memset(&placeholder, 0, sizeof(placeholder));
+    err |= cache_write_at(fp, 0, &placeholder, sizeof(placeholder));
+  }
+  err |= cache_write_at(fp, header.offsets[CACHE_VERTICES], attrib->vertices,
+                        (size_t)header.sizes[CACHE_VERTICES]);
+  err |= cache_write_at(fp, header.offsets[CACHE_NORMALS], attrib->normals,
+                        (size_t)header.sizes[CACHE_NORMALS]);
+  err |= cache_write_at(fp, header.offsets[CACHE_TEXCOORDS], attrib->texcoords,
+                        (size_t)header.sizes[CACHE_TEXCOORDS]);
+  err |= cache_write_at(fp, header.offsets[CACHE_FACES], attrib->faces,
+                        (size_t)header.sizes[CACHE_FACES]);
+  err |= cache_write_at(fp, header.offsets[CACHE_FACE_NUM_VERTS],
+                        attrib->face_num_verts,
+                        (size_t)header.sizes[CACHE_FACE_NUM_VERTS]);
+  err |= cache_write_at(fp, header.offsets[CACHE_MATERIAL_IDS],
+                        attrib->material_ids,
+                        (size_t)header.sizes[CACHE_MATERIAL_IDS]);
+  err |= cache_write_at(fp, header.offsets[CACHE_V_INDICES], attrib->v_indices,
+                        (size_t)header.sizes[CACHE_V_INDICES]);
+  err |= cache_write_at(fp, header.offsets[CACHE_VT_INDICES], attrib->vt_indices,
+                        (size_t)header.sizes[CACHE_VT_INDICES]);
+  err |= cache_write_at(fp, header.offsets[CACHE_VN_INDICES], attrib->vn_indices,
+                        (size_t)header.sizes[CACHE_VN_INDICES]);
+  err |= cache_write_at(fp, header.offsets[CACHE_QUANTIZED_VERTICES],
+                        attrib->quantized_vertices,
+                        (size_t)header.sizes[CACHE_QUANTIZED_VERTICES]);
+  err |= cache_write_at(fp, header.offsets[CACHE_QUANTIZED_NORMALS],
+                        attrib->quantized_normals,
+                        (size_t)header.sizes[CACHE_QUANTIZED_NORMALS]);
+  err |= cache_write_at(fp, header.offsets[CACHE_QUANTIZED_TEXCOORDS],
+                        attrib->quantized_texcoords,
+                        (size_t)header.sizes[CACHE_QUANTIZED_TEXCOORDS]);
+
+  /* Strings are laid out in this order: shape names, then material strings. */
+  string_pos = header.offsets[CACHE_STRINGS];
+  err |= cache_write_at(fp, header.offsets[CACHE_SHAPES], NULL, 0);
+  for (i = 0; i < num_shapes && !err; i++) {
+    tinyobj_shape_t shape = shapes[i];
+    shape.name = cache_string_offset(shape.name, &string_pos);
+    if (fwrite(&shape, sizeof(shape), 1, fp) != 1) err = -1;
+  }
+  err |= cache_write_at(fp, header.offsets[CACHE_MATERIALS], NULL, 0);
+  for (i = 0; i < num_materials && !err; i++) {
+    tinyobj_material_t material = materials[i];
+    char **fields[TINYOBJ_CACHE_NUM_MATERIAL_STRINGS];
+    material_string_fields(&material, fields);
+    for (k = 0; k < TINYOBJ_CACHE_NUM_MATERIAL_STRINGS; k++) {
+      *fields[k] = cache_string_offset(*fields[k], &string_pos);
+    }
+    if (fwrite(&material, sizeof(material), 1, fp) != 1) err = -1;
+  }
+
+  err |= cache_write_at(fp, header.offsets[CACHE_STRINGS], NULL, 0);
+  for (i = 0; i < num_shapes && !err; i++) {
+    err |= cache_write_string(fp, shapes[i].name);
+  }
+  for (i = 0; i < num_materials && !err; i++) {
+    char **fields[TINYOBJ_CACHE_NUM_MATERIAL_STRINGS];
+    material_string_fields((tinyobj_material_t *)&materials[i], fields);
+    for (k = 0; k < TINYOBJ_CACHE_NUM_MATERIAL_STRINGS; k++) {
+      err |= cache_write_string(fp, *fields[k]);
+    }
+  }
+
+  err |= cache_write_at(fp, header.offsets[CACHE_MTL_FILES], NULL, 0);
+  string_pos = 0;
+  for (i = 0; i < mtl_files.num_filenames && !err; i++) {
+    CacheMtlFile file;
+    memset(&file, 0, sizeof(file));
+    if (cache_mtl_stamp(obj_filename, mtl_files.filenames[i], &file) != 0) err = -1;
+    file.name = string_pos;
+    string_pos += strlen(mtl_files.filenames[i]) + 1;
+    if (fwrite(&file, sizeof(file), 1, fp) != 1) err = -1;
+  }
+  err |= cache_write_at(fp, header.offsets[CACHE_MTL_NAMES], NULL, 0);
+  for (i = 0; i < mtl_files.num_filenames && !err; i++) {
+    err |= cache_write_string(fp, mtl_files.filenames[i]);
+  }
+  mtl_loader_free(&mtl_files);
+
+  if (!err && fflush(fp) == 0 && fseek(fp, 0, SEEK_SET) == 0) {
+    err |= cache_write_at(fp, 0, &header, sizeof(header));
+  } else {
+    err = -1;
+  }
+  if (fclose(fp) != 0) err = -1;
+
+  if (err) {
+    remove(cache_filename);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  return TINYOBJ_SUCCESS;
+}
+
+/* Replace a string offset with a pointer. `s` must be a NUL terminated
+ * string inside the string section from `begin` to `end`. */
+static int cache_relocate_string(char **s, char *base, uint64_t begin,
+                                 uint64_t end) {
+  uint64_t offset = (uint64_t)(uintptr_t)(*s);
+
+  if (offset == 0) return 0;
+  if (offset < begin || offset >= end) return -1;
+  if (memchr(base + offset, '\0', (size_t)(end - offset)) == NULL) return -1;
+  *s = base + offset;
+  return 0;
+}
+
+/* Negative indices mean the attribute is absent. */
+static int cache_index_in_range(int idx, unsigned int num) {
+  return idx < 0 || (unsigned int)idx < num;
+}
+
+/* Face indices and material ids of a mapped cache must be in range, so a
+ * damaged cache never gives callers indices a parse would not. */
+static int cache_check_indices(const tinyobj_attrib_t *attrib,
+                               size_t num_materials) {
+  size_t i;
+
+  for (i = 0; i < attrib->num_faces; i++) {
+    tinyobj_vertex_index_t vi;
+    if (attrib->faces) {
+      vi = attrib->faces[i];
+    } else {
+      vi.v_idx = attrib->v_indices[i];
+      vi.vt_idx = attrib->vt_indices ? attrib->vt_indices[i] : -1;
+      vi.vn_idx = attrib->vn_indices ? attrib->vn_indices[i] : -1;
+    }
+    if (!cache_index_in_range(vi.v_idx, attrib->num_vertices) ||
+        !cache_index_in_range(vi.vt_idx, attrib->num_texcoords) ||
+        !cache_index_in_range(vi.vn_idx, attrib->num_normals)) {
+      return -1;
+    }
+  }
+  for (i = 0; i < attrib->num_face_num_verts; i++) {
+    int id = attrib->material_ids[i];
+    if (id < -1 || (id >= 0 && (size_t)id >= num_materials)) return -1;
+  }
+  return 0;
+}
+
+/* Validate a mapped cache and point `cache` into it. */
+static int cache_attach(tinyobj_cache_t *cache, char *base, size_t size,
+                        const char *obj_filename, unsigned int flags) {
+  CacheHeader header;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t index_size;
+  uint64_t strings_begin, strings_end;
+  int soa, qv, qn, qt;
+  size_t i, k;
+
+  if (size < sizeof(CacheHeader)) return -1;
+  memcpy(&header, base, sizeof(header));
+  if (memcmp(header.magic, "TINYOBJC", 8) != 0) return -1;
+  if (header.version != TINYOBJ_CACHE_VERSION) return -1;
+  if (header.endian_check != TINYOBJ_CACHE_ENDIAN_CHECK) return -1;
+  if (header.abi != cache_abi()) return -1;
+  if (header.flags != (flags & TINYOBJ_CACHE_FLAGS)) return -1;
+  if (header.file_size != size) return -1;
+  if (source_stat(obj_filename, &source_size, &source_mtime) != 0) return -1;
+  if (header.source_size != source_size || header.source_mtime != source_mtime) {
+    return -1;
+  }
+
+  /* Face indices are either in CACHE_FACES, or in CACHE_V_INDICES and the
+   * optional CACHE_VT_INDICES and CACHE_VN_INDICES. */
+  soa = (header.flags & TINYOBJ_FLAG_SOA_INDICES) ? 1 : 0;
+  index_size = sizeof(int) * (uint64_t)header.num_faces;
+  /* Each attribute is either float or quantized. */
+  qv = (header.flags & TINYOBJ_FLAG_QUANTIZE_POSITIONS) ? 1 : 0;
+  qn = (header.flags & TINYOBJ_FLAG_QUANTIZE_NORMALS) ? 1 : 0;
+  qt = (header.flags & TINYOBJ_FLAG_QUANTIZE_TEXCOORDS) ? 1 : 0;
+  if (header.sizes[CACHE_VERTICES] != (qv ? 0 : sizeof(float) * 3 * (uint64_t)header.num_vertices) ||
+      header.sizes[CACHE_NORMALS] != (qn ? 0 : sizeof(float) * 3 * (uint64_t)header.num_normals) ||
+      header.sizes[CACHE_TEXCOORDS] != (qt ? 0 : sizeof(float) * 2 * (uint64_t)header.num_texcoords) ||
+      header.sizes[CACHE_QUANTIZED_VERTICES] != (qv ? sizeof(uint16_t) * 3 * (uint64_t)header.num_vertices : 0) ||
+      header.sizes[CACHE_QUANTIZED_NORMALS] != (qn ? sizeof(int16_t) * 2 * (uint64_t)header.num_normals : 0) ||
+      header.sizes[CACHE_QUANTIZED_TEXCOORDS] != (qt ? sizeof(uint16_t) * 2 * (uint64_t)header.num_texcoords : 0) ||
+      header.sizes[CACHE_FACES] != (soa ? 0 : sizeof(tinyobj_vertex_index_t) * (uint64_t)header.num_faces) ||
+      header.sizes[CACHE_V_INDICES] != (soa ? index_size : 0) ||
+      (header.sizes[CACHE_VT_INDICES] != 0 && (!soa || header.sizes[CACHE_VT_INDICES] != index_size)) ||
+      (header.sizes[CACHE_VN_INDICES] != 0 && (!soa || header.sizes[CACHE_VN_INDICES] != index_size)) ||
+      header.sizes[CACHE_FACE_NUM_VERTS] != sizeof(int) * (uint64_t)header.num_face_num_verts ||
+      header.sizes[CACHE_MATERIAL_IDS] != sizeof(int) * (uint64_t)header.num_face_num_verts ||
+      header.sizes[CACHE_SHAPES] != sizeof(tinyobj_shape_t) * header.num_shapes ||
+      header.sizes[CACHE_MATERIALS] != sizeof(tinyobj_material_t) * header.num_materials ||
+      header.sizes[CACHE_MTL_FILES] != sizeof(CacheMtlFile) * header.num_mtl_files) {
+    return -1;
+  }
+  for (i = 0; i < CACHE_NUM_SECTIONS; i++) {
+    if (header.offsets[i] % TINYOBJ_CACHE_ALIGN != 0) return -1;
+    if (header.offsets[i] > size || header.sizes[i] > size - header.offsets[i]) {
+      return -1;
+    }
+  }
+  if (cache_check_mtl_files(base, &header, obj_filename) != 0) return -1;
+
+  cache->attrib.vertices = qv ? NULL : (float *)(void *)(base + header.offsets[CACHE_VERTICES]);
+  cache->attrib.num_vertices = header.num_vertices;
+  cache->attrib.normals = qn ? NULL : (float *)(void *)(base + header.offsets[CACHE_NORMALS]);
+  cache->attrib.num_normals = header.num_normals;
+  cache->attrib.texcoords = qt ? NULL : (float *)(void *)(base + header.offsets[CACHE_TEXCOORDS]);
+  cache->attrib.num_texcoords = header.num_texcoords;
+  cache->attrib.quantized_vertices = qv ? (uint16_t *)(void *)(base + header.offsets[CACHE_QUANTIZED_VERTICES]) : NULL;
+  cache->attrib.quantized_normals = qn ? (int16_t *)(void *)(base + header.offsets[CACHE_QUANTIZED_NORMALS]) : NULL;
+  cache->attrib.quantized_texcoords = qt ? (uint16_t *)(void *)(base + header.offsets[CACHE_QUANTIZED_TEXCOORDS]) : NULL;
+  memcpy(cache->attrib.vertex_offset, header.vertex_offset, sizeof(header.vertex_offset));
+  memcpy(cache->attrib.vertex_scale, header.vertex_scale, sizeof(header.vertex_scale));
+  memcpy(cache->attrib.texcoord_offset, header.texcoord_offset, sizeof(header.texcoord_offset));
+  memcpy(cache->attrib.texcoord_scale, header.texcoord_scale, sizeof(header.texcoord_scale));
+  cache->attrib.faces = soa ? NULL : (tinyobj_vertex_index_t *)(void *)(base + header.offsets[CACHE_FACES]);
+  cache->attrib.num_faces = header.num_faces;
+  cache->attrib.v_indices = soa ? (int *)(void *)(base + header.offsets[CACHE_V_INDICES]) : NULL;
+  cache->attrib.vt_indices = header.sizes[CACHE_VT_INDICES] ? (int *)(void *)(base + header.offsets[CACHE_VT_INDICES]) : NULL;
+  cache->attrib.vn_indices = header.sizes[CACHE_VN_INDICES] ? (int *)(void *)(base + header.offsets[CACHE_VN_INDICES]) : NULL;
+  cache->attrib.face_num_verts = (int *)(void *)(base + header.offsets[CACHE_FACE_NUM_VERTS]);
+  cache->attrib.material_ids = (int *)(void *)(base + header.offsets[CACHE_MATERIAL_IDS]);
+  cache->attrib.num_face_num_verts = header.num_face_num_verts;
+  cache->shapes = (tinyobj_shape_t *)(void *)(base + header.offsets[CACHE_SHAPES]);
+  cache->num_shapes = (size_t)header.num_shapes;
+  cache->materials = (tinyobj_material_t *)(void *)(base + header.offsets[CACHE_MATERIALS]);
+  cache->num_materials = (size_t)header.num_materials;
+  if (cache_check_indices(&cache->attrib, cache->num_materials) != 0) return -1;
+
+  /* Only the pages of shapes and materials are written(copied). */
+  strings_begin = header.offsets[CACHE_STRINGS];
+  strings_end = strings_begin + header.sizes[CACHE_STRINGS];
+  for (i = 0; i < cache->num_shapes; i++) {
+    if (cache_relocate_string(&cache->shapes[i].name, base, strings_begin, strings_end) != 0) {
+      return -1;
+    }
+  }
+  for (i = 0; i < cache->num_materials; i++) {
+    char **fields[TINYOBJ_CACHE_NUM_MATERIAL_STRINGS];
+    material_string_fields(&cache->materials[i], fields);
+    for (k = 0; k < TINYOBJ_CACHE_NUM_MATERIAL_STRINGS; k++) {
+      if (cache_relocate_string(fields[k], base, strings_begin, strings_end) != 0) return -1;
+    }
+  }
+  return 0;
+}
+
+int tinyobj_load_cache(tinyobj_cache_t *cache, const char *cache_filename,
+                       const char *obj_filename,
+                       file_reader_callback file_reader, void *ctx,
+                       unsigned int flags) {
+  char *data;
+  size_t size = 0;
+  int ret;
+
+  if (cache == NULL || cache_filename == NULL || obj_filename == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  memset(cache, 0, sizeof(*cache));
+
+  data = tinyobj_map_file(cache_filename, &size);
+  if (data) {
+    if (cache_attach(cache, data, size, obj_filename, flags) == 0) {
+      cache->from_cache = 1;
+      cache->mapping = data;
+      cache->mapping_size = size;
+      return TINYOBJ_SUCCESS;
+    }
+    tinyobj_unmap_file(data, size);
+    memset(cache, 0, sizeof(*cache));
+  }
+
+  if (file_reader == NULL) return TINYOBJ_ERROR_STALE_CACHE;
+
+  ret = tinyobj_parse_obj(&cache->attrib, &cache->shapes, &cache->num_shapes,
+                          &cache->materials, &cache->num_materials,
+                          obj_filename, file_reader, ctx, flags);
+  if (ret != TINYOBJ_SUCCESS) return ret;
+
+  if (tinyobj_save_cache(cache_filename, obj_filename, flags, &cache->attrib,
+                         cache->shapes, cache->num_shapes, cache->materials,
+                         cache->num_materials) != TINYOBJ_SUCCESS) {
+    /* warning. The parse result is still returned. */
+    fprintf(stderr, "TINYOBJ: Failed to write cache file '%s'\n", cache_filename);
+  }
+  return TINYOBJ_SUCCESS;
+}
+
+void tinyobj_cache_free(tinyobj_cache_t *cache) {
+  if (cache->from_cache) {
+    tinyobj_unmap_file((char *)cache->mapping, cache->mapping_size);
+  } else {
+    tinyobj_attrib_free(&cache->attrib);
+    tinyobj_shapes_free(cache->shapes, cache->num_shapes);
+    tinyobj_materials_free(cache->materials, cache->num_materials);
+  }
+  memset(cache, 0, sizeof(*cache));
+}
+
+/* Shape index(tinyobj_build_shape_index) and its file. */
 
-    while (!IS_NEW_LINE(token[0])) {
-      tinyobj_vertex_index_t vi = parseRawTriple(&token);
-      skip_space_and_cr(&token);
+#define TINYOBJ_SHAPE_INDEX_VERSION (2)
+#define TINYOBJ_SHAPE_INDEX_WINDOW (1 << 22) /* Bytes scanned at a time. */
 
-      f[num_f] = vi;
-      num_f++;
-    }
+enum {
+  SHAPE_INDEX_RANGES,
+  SHAPE_INDEX_MTLLIBS,
+  SHAPE_INDEX_STRINGS,
+  SHAPE_INDEX_NUM_SECTIONS
+};
 
-    command->type = COMMAND_F;
+/* Range names are stored as offsets, like the strings of the cache. */
+typedef struct {
+  char magic[8];         /* "TINYOBJI" */
+  uint32_t version;
+  uint32_t endian_check; /* TINYOBJ_CACHE_ENDIAN_CHECK */
+  uint32_t abi;          /* Pointer and struct sizes. */
+  uint32_t pad0;
+  uint64_t file_size;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t num_ranges;
+  uint64_t num_mtllibs;
+  uint64_t offsets[SHAPE_INDEX_NUM_SECTIONS];
+  uint64_t sizes[SHAPE_INDEX_NUM_SECTIONS];
+} ShapeIndexHeader;
+
+static uint32_t shape_index_abi(void) {
+  return (uint32_t)sizeof(void *) |
+         ((uint32_t)sizeof(tinyobj_shape_range_t) << 8);
+}
 
-    if (triangulate) {
-      size_t k;
-      size_t n = 0;
+/* End of the window of about TINYOBJ_SHAPE_INDEX_WINDOW bytes from `pos`.
+ * Windows end after a line ending, so no line is split. */
+static size_t shape_index_window_end(const char *buf, size_t len, size_t pos) {
+  size_t end;
 
-      tinyobj_vertex_index_t i0 = f[0];
-      tinyobj_vertex_index_t i1;
-      tinyobj_vertex_index_t i2 = f[1];
+  if (len - pos <= TINYOBJ_SHAPE_INDEX_WINDOW) return len;
+  end = pos + TINYOBJ_SHAPE_INDEX_WINDOW;
+  while (end < len && buf[end - 1] != '\n' && buf[end - 1] != '\r' &&
+         buf[end - 1] != '\0') {
+    end++;
+  }
+  return end;
+}
 
-      assert(3 * num_f < TINYOBJ_MAX_FACES_PER_F_LINE);
+/* Parse the single line at `offset`. Returns 0 when there is none. */
+static int parse_line_at(Command *command, const char *buf, size_t len,
+                         uint64_t offset) {
+  size_t end;
 
-      for (k = 2; k < num_f; k++) {
-        i1 = i2;
-        i2 = f[k];
-        command->f[3 * n + 0] = i0;
-        command->f[3 * n + 1] = i1;
-        command->f[3 * n + 2] = i2;
+  if (offset >= len) return 0;
+  end = line_end(buf, len, (size_t)offset);
+  return parseLine(command, buf + offset, end - (size_t)offset, 0, NULL);
+}
 
-        command->f_num_verts[n] = 3;
-        n++;
-      }
-      command->num_f = 3 * n;
-      command->num_f_num_verts = n;
+int tinyobj_build_shape_index(tinyobj_shape_index_t *index,
+                              const char *obj_filename) {
+  LineScanner lines;
+  char *buf;
+  size_t len = 0;
+  size_t pos = 0;
+  size_t ranges_capacity = 0;
+  size_t mtllibs_capacity = 0;
+  uint64_t usemtl_offset = UINT64_MAX;
+  unsigned int v_count = 0, vt_count = 0, vn_count = 0;
+  tinyobj_shape_range_t *range;
+  int ret = TINYOBJ_SUCCESS;
+
+  if (index == NULL || obj_filename == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  memset(index, 0, sizeof(*index));
+
+  buf = tinyobj_map_file(obj_filename, &len);
+  if (buf == NULL) return TINYOBJ_ERROR_FILE_OPERATION;
+  index->source_size = len;
+
+  if (grow_array((void **)&index->ranges, &ranges_capacity, 1,
+                 sizeof(tinyobj_shape_range_t), NULL) != TINYOBJ_SUCCESS) {
+    tinyobj_unmap_file(buf, len);
+    return TINYOBJ_ERROR_MEMORY;
+  }
+  range = &index->ranges[0];
+  memset(range, 0, sizeof(*range));
+  range->usemtl_offset = UINT64_MAX;
+  index->num_ranges = 1;
+
+  /* The line table covers one window at a time, so its size does not
+   * depend on the size of the file. */
+  memset(&lines, 0, sizeof(lines));
+  while (pos < len && ret == TINYOBJ_SUCCESS) {
+    size_t end = shape_index_window_end(buf, len, pos);
+    size_t i;
+
+    if (scan_lines(buf + pos, end - pos, &lines) != TINYOBJ_SUCCESS) {
+      ret = TINYOBJ_ERROR_MEMORY;
+      break;
+    }
+    for (i = 0; i < lines.num_lines; i++) {
+      uint64_t offset = (uint64_t)(pos + lines.infos[i].pos);
+      Command command;
 
-    } else {
-      size_t k = 0;
-      assert(num_f < TINYOBJ_MAX_FACES_PER_F_LINE);
-      for (k = 0; k < num_f; k++) {
-        command->f[k] = f[k];
+      if (parseLine(&command, buf + offset, lines.infos[i].len, 0, NULL) <= 0) {
+        continue;
+      }
+      range = &index->ranges[index->num_ranges - 1];
+      if (command.type == COMMAND_V) {
+        range->num_v++;
+        v_count++;
+      } else if (command.type == COMMAND_VT) {
+        range->num_vt++;
+        vt_count++;
+      } else if (command.type == COMMAND_VN) {
+        range->num_vn++;
+        vn_count++;
+      } else if (command.type == COMMAND_F) {
+        range->num_faces++;
+      } else if (command.type == COMMAND_USEMTL) {
+        if (command.material_name && command.material_name_len > 0) {
+          usemtl_offset = offset;
+        }
+      } else if (command.type == COMMAND_MTLLIB) {
+        if (grow_array((void **)&index->mtllib_offsets, &mtllibs_capacity,
+                       index->num_mtllibs + 1, sizeof(uint64_t),
+                       NULL) != TINYOBJ_SUCCESS) {
+          ret = TINYOBJ_ERROR_MEMORY;
+          break;
+        }
+        index->mtllib_offsets[index->num_mtllibs++] = offset;
+      } else if (command.type == COMMAND_O || command.type == COMMAND_G) {
+        const char *name =
+            (command.type == COMMAND_O) ? command.object_name : command.group_name;
+        unsigned int name_len = (command.type == COMMAND_O)
+                                    ? command.object_name_len
+                                    : command.group_name_len;
+
+        if (grow_array((void **)&index->ranges, &ranges_capacity,
+                       index->num_ranges + 1, sizeof(tinyobj_shape_range_t),
+                       NULL) != TINYOBJ_SUCCESS) {
+          ret = TINYOBJ_ERROR_MEMORY;
+          break;
+        }
+        range = &index->ranges[index->num_ranges - 1];
+        range->size = offset - range->offset;
+        range++;
+        index->num_ranges++;
+        memset(range, 0, sizeof(*range));
+        range->name = my_strndup(name, name_len, NULL); /* may be NULL */
+        range->offset = offset;
+        range->usemtl_offset = usemtl_offset;
+        range->v_offset = v_count;
+        range->vt_offset = vt_count;
+        range->vn_offset = vn_count;
       }
-
-      command->num_f = num_f;
-      command->f_num_verts[0] = (int)num_f;
-      command->num_f_num_verts = 1;
     }
-
-    return 1;
+    pos = end;
   }
+  range = &index->ranges[index->num_ranges - 1];
+  range->size = (uint64_t)len - range->offset;
 
-  /* use mtl */
-  if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
-    token += 7;
-
-    skip_space(&token);
-    command->material_name = p + (token - linebuf);
-    command->material_name_len = (unsigned int)length_until_newline(
-                                                                    token, (p_len - (size_t)(token - linebuf)) + 1);
-    command->type = COMMAND_USEMTL;
+  line_scanner_free(&lines);
+  tinyobj_unmap_file(buf, len);
 
-    return 1;
+  if (ret != TINYOBJ_SUCCESS) {
+    for (pos = 0; pos < index->num_ranges; pos++) {
+      tracked_free(index->ranges[pos].name, my_strsize(index->ranges[pos].name));
+    }
+    tracked_free(index->ranges, sizeof(tinyobj_shape_range_t) * ranges_capacity);
+    tracked_free(index->mtllib_offsets, sizeof(uint64_t) * mtllibs_capacity);
+    memset(index, 0, sizeof(*index));
   }
+  return ret;
+}
 
-  /* load mtl */
-  if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
-    /* By specification, `mtllib` should be appear only once in .obj */
-    token += 7;
+int tinyobj_save_shape_index(const char *index_filename,
+                             const char *obj_filename,
+                             const tinyobj_shape_index_t *index) {
+  ShapeIndexHeader header;
+  FILE *fp;
+  uint64_t pos;
+  uint64_t string_pos;
+  size_t i;
+  int err = 0;
 
-    skip_space(&token);
-    command->mtllib_name = p + (token - linebuf);
-    command->mtllib_name_len = (unsigned int)length_until_newline(
-                                                                  token, p_len - (size_t)(token - linebuf)) +
-      1;
-    command->type = COMMAND_MTLLIB;
+  if (index_filename == NULL || index == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
 
-    return 1;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "TINYOBJI", 8);
+  header.version = TINYOBJ_SHAPE_INDEX_VERSION;
+  header.endian_check = TINYOBJ_CACHE_ENDIAN_CHECK;
+  header.abi = shape_index_abi();
+  if (source_stat(obj_filename, &header.source_size, &header.source_mtime) != 0) {
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  if (header.source_size != index->source_size) return TINYOBJ_ERROR_STALE_CACHE;
+  header.num_ranges = index->num_ranges;
+  header.num_mtllibs = index->num_mtllibs;
+
+  header.sizes[SHAPE_INDEX_RANGES] = sizeof(tinyobj_shape_range_t) * (uint64_t)index->num_ranges;
+  header.sizes[SHAPE_INDEX_MTLLIBS] = sizeof(uint64_t) * (uint64_t)index->num_mtllibs;
+  for (i = 0; i < index->num_ranges; i++) {
+    if (index->ranges[i].name) {
+      header.sizes[SHAPE_INDEX_STRINGS] += strlen(index->ranges[i].name) + 1;
+    }
   }
 
-  /* group name */
-  if (token[0] == 'g' && IS_SPACE((token[1]))) {
-    /* @todo { multiple group name. } */
-    token += 2;
+  pos = sizeof(ShapeIndexHeader);
+  for (i = 0; i < SHAPE_INDEX_NUM_SECTIONS; i++) {
+    pos = (pos + TINYOBJ_CACHE_ALIGN - 1) & ~(uint64_t)(TINYOBJ_CACHE_ALIGN - 1);
+    header.offsets[i] = pos;
+    pos += header.sizes[i];
+  }
+  header.file_size = pos;
 
-    command->group_name = p + (token - linebuf);
-    command->group_name_len = (unsigned int)length_until_newline(
-                                                                 token, p_len - (size_t)(token - linebuf)) +
-      1;
-    command->type = COMMAND_G;
+  fp = fopen(index_filename, "wb");
+  if (fp == NULL) return TINYOBJ_ERROR_FILE_OPERATION;
 
-    return 1;
+  /* The magic is written last, so an incomplete file is never valid. */
+  {
+    ShapeIndexHeader placeholder;
+    memset(&placeholder, 0, sizeof(placeholder));
+    err |= cache_write_at(fp, 0, &placeholder, sizeof(placeholder));
+  }
+  string_pos = header.offsets[SHAPE_INDEX_STRINGS];
+  err |= cache_write_at(fp, header.offsets[SHAPE_INDEX_RANGES], NULL, 0);
+  for (i = 0; i < index->num_ranges && !err; i++) {
+    tinyobj_shape_range_t range = index->ranges[i];
+    range.name = cache_string_offset(range.name, &string_pos);
+    if (fwrite(&range, sizeof(range), 1, fp) != 1) err = -1;
+  }
+  err |= cache_write_at(fp, header.offsets[SHAPE_INDEX_MTLLIBS], index->mtllib_offsets,
+                        (size_t)header.sizes[SHAPE_INDEX_MTLLIBS]);
+  err |= cache_write_at(fp, header.offsets[SHAPE_INDEX_STRINGS], NULL, 0);
+  for (i = 0; i < index->num_ranges && !err; i++) {
+    err |= cache_write_string(fp, index->ranges[i].name);
   }
 
-  /* object name */
-  if (token[0] == 'o' && IS_SPACE((token[1]))) {
-    /* @todo { multiple object name? } */
-    token += 2;
+  if (!err && fflush(fp) == 0 && fseek(fp, 0, SEEK_SET) == 0) {
+    err |= cache_write_at(fp, 0, &header, sizeof(header));
+  } else {
+    err = -1;
+  }
+  if (fclose(fp) != 0) err = -1;
 
-    command->object_name = p + (token - linebuf);
-    command->object_name_len = (unsigned int)length_until_newline(
-                                                                  token, p_len - (size_t)(token - linebuf)) +
-      1;
-    command->type = COMMAND_O;
+  if (err) {
+    remove(index_filename);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  return TINYOBJ_SUCCESS;
+}
 
-    return 1;
+/* Validate a mapped index file and point `index` into it. */
+static int shape_index_attach(tinyobj_shape_index_t *index, char *base,
+                              size_t size, const char *obj_filename) {
+  ShapeIndexHeader header;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t strings_begin, strings_end;
+  size_t i;
+
+  if (size < sizeof(ShapeIndexHeader)) return -1;
+  memcpy(&header, base, sizeof(header));
+  if (memcmp(header.magic, "TINYOBJI", 8) != 0) return -1;
+  if (header.version != TINYOBJ_SHAPE_INDEX_VERSION) return -1;
+  if (header.endian_check != TINYOBJ_CACHE_ENDIAN_CHECK) return -1;
+  if (header.abi != shape_index_abi()) return -1;
+  if (header.file_size != size) return -1;
+  if (source_stat(obj_filename, &source_size, &source_mtime) != 0) return -1;
+  if (header.source_size != source_size || header.source_mtime != source_mtime) {
+    return -1;
+  }
+  if (header.num_ranges == 0 ||
+      header.sizes[SHAPE_INDEX_RANGES] != sizeof(tinyobj_shape_range_t) * header.num_ranges ||
+      header.sizes[SHAPE_INDEX_MTLLIBS] != sizeof(uint64_t) * header.num_mtllibs) {
+    return -1;
+  }
+  for (i = 0; i < SHAPE_INDEX_NUM_SECTIONS; i++) {
+    if (header.offsets[i] % TINYOBJ_CACHE_ALIGN != 0) return -1;
+    if (header.offsets[i] > size || header.sizes[i] > size - header.offsets[i]) {
+      return -1;
+    }
   }
 
+  index->ranges = (tinyobj_shape_range_t *)(void *)(base + header.offsets[SHAPE_INDEX_RANGES]);
+  index->num_ranges = (size_t)header.num_ranges;
+  index->mtllib_offsets = (uint64_t *)(void *)(base + header.offsets[SHAPE_INDEX_MTLLIBS]);
+  index->num_mtllibs = (size_t)header.num_mtllibs;
+  index->source_size = header.source_size;
+
+  /* Only the pages of the ranges are written(copied). */
+  strings_begin = header.offsets[SHAPE_INDEX_STRINGS];
+  strings_end = strings_begin + header.sizes[SHAPE_INDEX_STRINGS];
+  for (i = 0; i < index->num_ranges; i++) {
+    if (cache_relocate_string(&index->ranges[i].name, base, strings_begin, strings_end) != 0) {
+      return -1;
+    }
+  }
   return 0;
 }
 
-static size_t basename_len(const char *filename, size_t filename_length) {
-  /* Count includes NUL terminator. */
-  const char *p = &filename[filename_length - 1];
-  size_t count = 1;
+int tinyobj_load_shape_index(tinyobj_shape_index_t *index,
+                             const char *index_filename,
+                             const char *obj_filename) {
+  char *data;
+  size_t size = 0;
+  int ret;
 
-  /* On Windows, the directory delimiter is '\' and both it and '/' is
-   * reserved by the filesystem. On *nix platforms, only the '/' character 
-   * is reserved, so account for the two cases separately. */
-  #if _WIN32
-    while (p[-1] != '/' && p[-1] != '\\') {
-      if (p == filename) {
-        count = filename_length;
-        return count;
-      }
-      count++;
-      p--;
-    }
-    p++;
-    return count;
-  #else
-    while (*(--p) != '/') {
-      if (p == filename) {
-        count = filename_length;
-        return count;
-      }
-      count++;
+  if (index == NULL || index_filename == NULL || obj_filename == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  memset(index, 0, sizeof(*index));
+
+  data = tinyobj_map_file(index_filename, &size);
+  if (data) {
+    if (shape_index_attach(index, data, size, obj_filename) == 0) {
+      index->from_cache = 1;
+      index->mapping = data;
+      index->mapping_size = size;
+      return TINYOBJ_SUCCESS;
     }
-    return count;
-  #endif
-}
+    tinyobj_unmap_file(data, size);
+    memset(index, 0, sizeof(*index));
+  }
 
-static char *generate_mtl_filename(const char *obj_filename,
-                                   size_t obj_filename_length,
-                                   const char *mtllib_name,
-                                   size_t mtllib_name_length) {
-  /* Create a dynamically-allocated material filename. This allows the material
-   * and obj files to be separated, however the mtllib name in the OBJ file
-   * must be a relative path to the material file from the OBJ's directory.
-   * This does not support the matllib name as an absolute address. */
-  char *mtl_filename;
-  char *p;
-  size_t mtl_filename_length;
-  size_t obj_basename_length;
+  ret = tinyobj_build_shape_index(index, obj_filename);
+  if (ret != TINYOBJ_SUCCESS) return ret;
 
-  /* Calculate required size of mtl_filename and allocate */
-  obj_basename_length = basename_len(obj_filename, obj_filename_length);
-  mtl_filename_length = (obj_filename_length - obj_basename_length) + mtllib_name_length;
-  mtl_filename = (char *)TINYOBJ_MALLOC(mtl_filename_length);
+  if (tinyobj_save_shape_index(index_filename, obj_filename, index) != TINYOBJ_SUCCESS) {
+    /* warning. The index is still returned. */
+    fprintf(stderr, "TINYOBJ: Failed to write shape index file '%s'\n", index_filename);
+  }
+  return TINYOBJ_SUCCESS;
+}
 
-  /* Copy over the obj's path */
-  memcpy(mtl_filename, obj_filename, (obj_filename_length - obj_basename_length));
+void tinyobj_shape_index_free(tinyobj_shape_index_t *index) {
+  size_t i;
 
-  /* Overwrite the obj basename with the mtllib name, filling the string */
-  p = &mtl_filename[mtl_filename_length - mtllib_name_length];
-  strcpy(p, mtllib_name);
-  return mtl_filename;
+  if (index->from_cache) {
+    tinyobj_unmap_file((char *)index->mapping, index->mapping_size);
+  } else {
+    for (i = 0; i < index->num_ranges; i++) {
+      if (index->ranges[i].name) TINYOBJ_FREE(index->ranges[i].name);
+    }
+    if (index->ranges) TINYOBJ_FREE(index->ranges);
+    if (index->mtllib_offsets) TINYOBJ_FREE(index->mtllib_offsets);
+  }
+  memset(index, 0, sizeof(*index));
 }
 
-int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
-                      size_t *num_shapes, tinyobj_material_t **materials_out,
-                      size_t *num_materials_out, const char *obj_filename,
-                      file_reader_callback file_reader, void *ctx,
-                      unsigned int flags) {
-  LineInfo *line_infos = NULL;
-  Command *commands = NULL;
-  size_t num_lines = 0;
+/* Sorted and unique indices of one attribute(v, vt or vn) which the faces
+ * of tinyobj_parse_shapes refer to. The attribute arrays hold the values
+ * in this order. */
+typedef struct {
+  int *indices;
+  size_t count;
+  size_t next; /* First one not loaded yet. */
+} VertexRefs;
+
+/* 0 = v, 1 = vt, 2 = vn. */
+static int *vertex_index_member(tinyobj_vertex_index_t *vi, int kind) {
+  return (kind == 0) ? &vi->v_idx : (kind == 1) ? &vi->vt_idx : &vi->vn_idx;
+}
 
-  size_t num_v = 0;
-  size_t num_vn = 0;
-  size_t num_vt = 0;
-  size_t num_f = 0;
-  size_t num_faces = 0;
+static int compare_int(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
 
-  int mtllib_line_index = -1;
+/* Indices out of [0, total) are not referenced vertices. */
+static int vertex_refs_build(VertexRefs *refs, tinyobj_vertex_index_t *faces,
+                             size_t num_f, int kind, size_t total) {
+  size_t i, n = 0;
+
+  refs->indices = (int *)tracked_malloc(sizeof(int) * (num_f ? num_f : 1));
+  refs->count = 0;
+  refs->next = 0;
+  if (refs->indices == NULL) return TINYOBJ_ERROR_MEMORY;
+  for (i = 0; i < num_f; i++) {
+    int idx = *vertex_index_member(&faces[i], kind);
+    if (idx >= 0 && (size_t)idx < total) refs->indices[n++] = idx;
+  }
+  qsort(refs->indices, n, sizeof(int), compare_int);
+  for (i = 0; i < n; i++) {
+    if (refs->count == 0 || refs->indices[refs->count - 1] != refs->indices[i]) {
+      refs->indices[refs->count++] = refs->indices[i];
+    }
+  }
+  return TINYOBJ_SUCCESS;
+}
 
-  tinyobj_material_t *materials = NULL;
-  size_t num_materials = 0;
+static void vertex_refs_remap(const VertexRefs *refs, tinyobj_vertex_index_t *faces,
+                              size_t num_f, int kind, size_t total) {
+  size_t i;
+  for (i = 0; i < num_f; i++) {
+    int *idx = vertex_index_member(&faces[i], kind);
+    if (*idx >= 0 && (size_t)*idx < total) {
+      const int *hit = (const int *)bsearch(idx, refs->indices, refs->count,
+                                            sizeof(int), compare_int);
+      *idx = (int)(hit - refs->indices);
+    }
+  }
+}
 
-  hash_table_t material_table;
+static size_t range_vertex_begin(const tinyobj_shape_range_t *range, int kind) {
+  return (kind == 0) ? range->v_offset : (kind == 1) ? range->vt_offset : range->vn_offset;
+}
 
-  char *buf = NULL;
-  size_t len = 0;
-  file_reader(ctx, obj_filename, /* is_mtl */0, obj_filename, &buf, &len);
+static size_t range_vertex_end(const tinyobj_shape_range_t *range, int kind) {
+  return range_vertex_begin(range, kind) +
+         ((kind == 0) ? range->num_v : (kind == 1) ? range->num_vt : range->num_vn);
+}
 
-  if (len < 1) return TINYOBJ_ERROR_INVALID_PARAMETER;
-  if (attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
-  if (shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
-  if (num_shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
-  if (buf == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
-  if (materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
-  if (num_materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+int tinyobj_parse_shapes(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                         size_t *num_shapes, tinyobj_material_t **materials,
+                         size_t *num_materials,
+                         const tinyobj_shape_index_t *index,
+                         const size_t *range_ids, size_t num_range_ids,
+                         const char *obj_filename,
+                         file_reader_callback file_reader, void *ctx,
+                         unsigned int flags) {
+  char *buf;
+  size_t len = 0;
+  LineScanner lines;
+  FaceBuffer faces;
+  hash_table_t material_table;
+  MtlLoader mtl_loader;
+  ShapeBuilder shape_builder;
+  VertexRefs refs[3];
+  size_t totals[3];
+  unsigned char *needed = NULL; /* Per range: has referenced vertices. */
+  size_t f_capacity = 0, verts_capacity = 0, ids_capacity = 0;
+  size_t num_f = 0, num_faces = 0;
+  size_t i;
+  int kind;
+  int ret = TINYOBJ_SUCCESS;
 
+  if (attrib == NULL || shapes == NULL || num_shapes == NULL ||
+      materials == NULL || num_materials == NULL || index == NULL ||
+      index->num_ranges == 0 || obj_filename == NULL ||
+      (num_range_ids > 0 && range_ids == NULL)) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+  for (i = 0; i < num_range_ids; i++) {
+    if (range_ids[i] >= index->num_ranges) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
   tinyobj_attrib_init(attrib);
-
-  /* 1. create line data */
-  if (get_line_infos(buf, len, &line_infos, &num_lines) != 0) {
-    return TINYOBJ_ERROR_EMPTY;
+  *shapes = NULL;
+  *num_shapes = 0;
+  *materials = NULL;
+  *num_materials = 0;
+
+  buf = tinyobj_map_file(obj_filename, &len);
+  if (buf == NULL) return TINYOBJ_ERROR_FILE_OPERATION;
+  if (len != index->source_size) {
+    tinyobj_unmap_file(buf, len);
+    return TINYOBJ_ERROR_STALE_CACHE;
   }
 
-  commands = (Command *)TINYOBJ_MALLOC(sizeof(Command) * num_lines);
-
+  memset(&lines, 0, sizeof(lines));
+  memset(&faces, 0, sizeof(faces));
+  memset(refs, 0, sizeof(refs));
   create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
+  mtl_loader_init(&mtl_loader, obj_filename, file_reader, ctx, &material_table, NULL);
+  if (shape_builder_init(&shape_builder, num_range_ids + 1, NULL) != TINYOBJ_SUCCESS) {
+    ret = TINYOBJ_ERROR_MEMORY;
+  }
 
-  /* 2. parse each line */
-  {
-    size_t i = 0;
-    for (i = 0; i < num_lines; i++) {
-      int ret = parseLine(&commands[i], &buf[line_infos[i].pos],
-                          line_infos[i].len, flags & TINYOBJ_FLAG_TRIANGULATE);
-      if (ret) {
-        if (commands[i].type == COMMAND_V) {
-          num_v++;
-        } else if (commands[i].type == COMMAND_VN) {
-          num_vn++;
-        } else if (commands[i].type == COMMAND_VT) {
-          num_vt++;
-        } else if (commands[i].type == COMMAND_F) {
-          num_f += commands[i].num_f;
-          num_faces += commands[i].num_f_num_verts;
-        }
-
-        if (commands[i].type == COMMAND_MTLLIB) {
-          mtllib_line_index = (int)i;
-        }
+  /* 1. Materials of every `mtllib` line, as in tinyobj_parse_obj. */
+  if (ret == TINYOBJ_SUCCESS && file_reader) {
+    for (i = 0; i < index->num_mtllibs; i++) {
+      Command command;
+      if (parse_line_at(&command, buf, len, index->mtllib_offsets[i]) > 0 &&
+          command.type == COMMAND_MTLLIB) {
+        mtl_loader_add(&mtl_loader, &command);
       }
     }
+    mtl_loader_load(&mtl_loader);
+    ret = mtl_loader.status;
   }
 
-  /* line_infos are not used anymore. Release memory. */
-  if (line_infos) {
-    TINYOBJ_FREE(line_infos);
-  }
-
-  /* Load material (if it exists) */
-  if (mtllib_line_index >= 0 && commands[mtllib_line_index].mtllib_name &&
-      commands[mtllib_line_index].mtllib_name_len > 0) {
-    /* Maximum length allowed by Linux - higher than Windows and macOS */
-    size_t obj_filename_len = my_strnlen(obj_filename, 4096 + 255) + 1;
-    char *mtl_filename;
-    char *mtllib_name;
-    size_t mtllib_name_len = 0;
-    int ret;
-
-    mtllib_name_len = length_until_line_feed(commands[mtllib_line_index].mtllib_name,
-                                             commands[mtllib_line_index].mtllib_name_len);
-
-    mtllib_name = my_strndup(commands[mtllib_line_index].mtllib_name,
-                             mtllib_name_len);
-
-    /* allow for NUL terminator */
-    mtllib_name_len++;
-    mtl_filename = generate_mtl_filename(obj_filename, obj_filename_len,
-                                         mtllib_name, mtllib_name_len);
-
-    ret = tinyobj_parse_and_index_mtl_file(&materials, &num_materials,
-                                           mtl_filename, obj_filename,
-                                           file_reader, ctx,
-                                           &material_table);
-
-    if (ret != TINYOBJ_SUCCESS) {
-      /* warning. */
-      fprintf(stderr, "TINYOBJ: Failed to parse material file '%s': %d\n", mtl_filename, ret);
+  /* 2. Faces of the selected ranges, with indices into the whole file. */
+  for (i = 0; i < num_range_ids && ret == TINYOBJ_SUCCESS; i++) {
+    const tinyobj_shape_range_t *range = &index->ranges[range_ids[i]];
+    size_t v_count = range->v_offset;
+    size_t vt_count = range->vt_offset;
+    size_t vn_count = range->vn_offset;
+    int material_id = -1;
+    size_t material_hit = 0;
+    Command command;
+    size_t l;
+
+    if (range->offset > len || range->size > len - range->offset) {
+      ret = TINYOBJ_ERROR_STALE_CACHE;
+      break;
+    }
+    if (parse_line_at(&command, buf, len, range->usemtl_offset) > 0 &&
+        command.type == COMMAND_USEMTL) {
+      material_id = find_material_id(&material_table, command.material_name,
+                                     command.material_name_len, &material_hit);
+    }
+    ret = shape_builder_begin(&shape_builder, range->name,
+                              range->name ? (unsigned int)strlen(range->name) : 0);
+    if (ret != TINYOBJ_SUCCESS || range->size == 0) continue;
+    if (scan_lines(buf + range->offset, (size_t)range->size, &lines) != TINYOBJ_SUCCESS) {
+      ret = TINYOBJ_ERROR_MEMORY;
+      break;
     }
-    TINYOBJ_FREE(mtl_filename);
-    TINYOBJ_FREE(mtllib_name);
-  }
 
-  /* Construct attributes */
+    for (l = 0; l < lines.num_lines; l++) {
+      int n = parseLine(&command, buf + range->offset + lines.infos[l].pos,
+                        lines.infos[l].len, PARSE_FACE_DATA, &faces);
+      if (n < 0) {
+        ret = TINYOBJ_ERROR_MEMORY;
+        break;
+      }
+      if (n == 0) continue;
 
-  {
-    size_t v_count = 0;
-    size_t n_count = 0;
-    size_t t_count = 0;
-    size_t f_count = 0;
-    size_t face_count = 0;
-    int material_id = -1; /* -1 = default unknown material. */
-    size_t i = 0;
-
-    attrib->vertices = (float *)TINYOBJ_MALLOC(sizeof(float) * num_v * 3);
-    attrib->num_vertices = (unsigned int)num_v;
-    attrib->normals = (float *)TINYOBJ_MALLOC(sizeof(float) * num_vn * 3);
-    attrib->num_normals = (unsigned int)num_vn;
-    attrib->texcoords = (float *)TINYOBJ_MALLOC(sizeof(float) * num_vt * 2);
-    attrib->num_texcoords = (unsigned int)num_vt;
-    attrib->faces = (tinyobj_vertex_index_t *)TINYOBJ_MALLOC(
-                                                     sizeof(tinyobj_vertex_index_t) * num_f);
-    attrib->num_faces = (unsigned int)num_f;
-    attrib->face_num_verts = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
-    attrib->material_ids = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
-    attrib->num_face_num_verts = (unsigned int)num_faces;
-
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_EMPTY) {
-        continue;
-      } else if (commands[i].type == COMMAND_USEMTL) {
-        /* @todo
-           if (commands[t][i].material_name &&
-           commands[t][i].material_name_len > 0) {
-           std::string material_name(commands[t][i].material_name,
-           commands[t][i].material_name_len);
-
-           if (material_map.find(material_name) != material_map.end()) {
-           material_id = material_map[material_name];
-           } else {
-        // Assign invalid material ID
-        material_id = -1;
-        }
-        }
-        */
-        if (commands[i].material_name &&
-           commands[i].material_name_len >0)
-        {
-          /* Create a null terminated string */
-          char* material_name_null_term = (char*) TINYOBJ_MALLOC(commands[i].material_name_len + 1);
-          memcpy((void*) material_name_null_term, (const void*) commands[i].material_name, commands[i].material_name_len);
-          material_name_null_term[commands[i].material_name_len] = 0;
-
-          if (hash_table_exists(material_name_null_term, &material_table))
-            material_id = (int)hash_table_get(material_name_null_term, &material_table);
-          else
-            material_id = -1;
-
-          TINYOBJ_FREE(material_name_null_term);
-        }
-      } else if (commands[i].type == COMMAND_V) {
-        attrib->vertices[3 * v_count + 0] = commands[i].vx;
-        attrib->vertices[3 * v_count + 1] = commands[i].vy;
-        attrib->vertices[3 * v_count + 2] = commands[i].vz;
+      if (command.type == COMMAND_V) {
         v_count++;
-      } else if (commands[i].type == COMMAND_VN) {
-        attrib->normals[3 * n_count + 0] = commands[i].nx;
-        attrib->normals[3 * n_count + 1] = commands[i].ny;
-        attrib->normals[3 * n_count + 2] = commands[i].nz;
-        n_count++;
-      } else if (commands[i].type == COMMAND_VT) {
-        attrib->texcoords[2 * t_count + 0] = commands[i].tx;
-        attrib->texcoords[2 * t_count + 1] = commands[i].ty;
-        t_count++;
-      } else if (commands[i].type == COMMAND_F) {
-        size_t k = 0;
-        for (k = 0; k < commands[i].num_f; k++) {
-          tinyobj_vertex_index_t vi = commands[i].f[k];
-          int v_idx = fixIndex(vi.v_idx, v_count);
-          int vn_idx = fixIndex(vi.vn_idx, n_count);
-          int vt_idx = fixIndex(vi.vt_idx, t_count);
-          attrib->faces[f_count + k].v_idx = v_idx;
-          attrib->faces[f_count + k].vn_idx = vn_idx;
-          attrib->faces[f_count + k].vt_idx = vt_idx;
+      } else if (command.type == COMMAND_VT) {
+        vt_count++;
+      } else if (command.type == COMMAND_VN) {
+        vn_count++;
+      } else if (command.type == COMMAND_USEMTL) {
+        if (command.material_name && command.material_name_len > 0) {
+          material_id = find_material_id(&material_table, command.material_name,
+                                         command.material_name_len, &material_hit);
         }
-
-        for (k = 0; k < commands[i].num_f_num_verts; k++) {
-          attrib->material_ids[face_count + k] = material_id;
-          attrib->face_num_verts[face_count + k] = commands[i].f_num_verts[k];
+      } else if (command.type == COMMAND_F) {
+        size_t k;
+        if (grow_array((void **)&attrib->faces, &f_capacity, num_f + command.num_f,
+                       sizeof(tinyobj_vertex_index_t), NULL) != TINYOBJ_SUCCESS ||
+            grow_array((void **)&attrib->face_num_verts, &verts_capacity,
+                       num_faces + 1, sizeof(int), NULL) != TINYOBJ_SUCCESS ||
+            grow_array((void **)&attrib->material_ids, &ids_capacity,
+                       num_faces + 1, sizeof(int), NULL) != TINYOBJ_SUCCESS) {
+          ret = TINYOBJ_ERROR_MEMORY;
+          break;
         }
-
-        f_count += commands[i].num_f;
-        face_count += commands[i].num_f_num_verts;
+        for (k = 0; k < command.num_f; k++) {
+          tinyobj_vertex_index_t vi = command.f[k];
+          attrib->faces[num_f + k].v_idx = fixIndex(vi.v_idx, v_count);
+          attrib->faces[num_f + k].vt_idx = fixIndex(vi.vt_idx, vt_count);
+          attrib->faces[num_f + k].vn_idx = fixIndex(vi.vn_idx, vn_count);
+        }
+        attrib->face_num_verts[num_faces] = command.f_num_verts;
+        attrib->material_ids[num_faces] = material_id;
+        num_f += command.num_f;
+        num_faces++;
+        shape_builder.face_count++;
       }
     }
   }
-
-  /* 5. Construct shape information. */
-  {
-    unsigned int face_count = 0;
-    size_t i = 0;
-    size_t n = 0;
-    size_t shape_idx = 0;
-
-    const char *shape_name = NULL;
-    unsigned int shape_name_len = 0;
-    const char *prev_shape_name = NULL;
-    unsigned int prev_shape_name_len = 0;
-    unsigned int prev_shape_face_offset = 0;
-    unsigned int prev_face_offset = 0;
-    tinyobj_shape_t prev_shape = {NULL, 0, 0};
-
-    /* Find the number of shapes in .obj */
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
-        n++;
+  if (ret == TINYOBJ_SUCCESS) ret = shape_builder_flush(&shape_builder);
+
+  /* 3. The referenced vertices, from the ranges which define them. */
+  totals[0] = range_vertex_end(&index->ranges[index->num_ranges - 1], 0);
+  totals[1] = range_vertex_end(&index->ranges[index->num_ranges - 1], 1);
+  totals[2] = range_vertex_end(&index->ranges[index->num_ranges - 1], 2);
+  for (kind = 0; kind < 3 && ret == TINYOBJ_SUCCESS; kind++) {
+    ret = vertex_refs_build(&refs[kind], attrib->faces, num_f, kind, totals[kind]);
+  }
+  if (ret == TINYOBJ_SUCCESS) {
+    needed = (unsigned char *)tracked_calloc(index->num_ranges, 1);
+    attrib->vertices = (float *)tracked_malloc(sizeof(float) * 3 * refs[0].count);
+    attrib->texcoords = (float *)tracked_malloc(sizeof(float) * 2 * refs[1].count);
+    attrib->normals = (float *)tracked_malloc(sizeof(float) * 3 * refs[2].count);
+    if (needed == NULL || (refs[0].count && attrib->vertices == NULL) ||
+        (refs[1].count && attrib->texcoords == NULL) ||
+        (refs[2].count && attrib->normals == NULL)) {
+      ret = TINYOBJ_ERROR_MEMORY;
+    }
+  }
+  for (kind = 0; kind < 3 && ret == TINYOBJ_SUCCESS; kind++) {
+    size_t r = 0;
+    for (i = 0; i < refs[kind].count; i++) {
+      while (r + 1 < index->num_ranges &&
+             (size_t)refs[kind].indices[i] >= range_vertex_end(&index->ranges[r], kind)) {
+        r++;
       }
+      needed[r] = 1;
     }
-
-    /* Allocate array of shapes with maximum possible size(+1 for unnamed
-     * group/object).
-     * Actual # of shapes found in .obj is determined in the later */
-    (*shapes) = (tinyobj_shape_t*)TINYOBJ_MALLOC(sizeof(tinyobj_shape_t) * (n + 1));
-
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
-        if (commands[i].type == COMMAND_O) {
-          shape_name = commands[i].object_name;
-          shape_name_len = commands[i].object_name_len;
-        } else {
-          shape_name = commands[i].group_name;
-          shape_name_len = commands[i].group_name_len;
-        }
-
-        if (face_count == 0) {
-          /* 'o' or 'g' appears before any 'f' */
-          prev_shape_name = shape_name;
-          prev_shape_name_len = shape_name_len;
-          prev_shape_face_offset = face_count;
-          prev_face_offset = face_count;
+  }
+  for (i = 0; i < index->num_ranges && ret == TINYOBJ_SUCCESS; i++) {
+    const tinyobj_shape_range_t *range = &index->ranges[i];
+    size_t counts[3];
+    size_t l;
+
+    if (!needed[i]) continue;
+    if (range->offset > len || range->size > len - range->offset) {
+      ret = TINYOBJ_ERROR_STALE_CACHE;
+      break;
+    }
+    if (scan_lines(buf + range->offset, (size_t)range->size, &lines) != TINYOBJ_SUCCESS) {
+      ret = TINYOBJ_ERROR_MEMORY;
+      break;
+    }
+    for (kind = 0; kind < 3; kind++) counts[kind] = range_vertex_begin(range, kind);
+
+    for (l = 0; l < lines.num_lines; l++) {
+      const char *p = buf + range->offset + lines.infos[l].pos;
+      VertexRefs *ref;
+      Command command;
+
+      /* Only referenced lines are parsed for their values. */
+      if (parseLine(&command, p, lines.infos[l].len, 0, NULL) <= 0) continue;
+      if (command.type == COMMAND_V) {
+        kind = 0;
+      } else if (command.type == COMMAND_VT) {
+        kind = 1;
+      } else if (command.type == COMMAND_VN) {
+        kind = 2;
+      } else {
+        continue;
+      }
+      ref = &refs[kind];
+      if (ref->next < ref->count && (size_t)ref->indices[ref->next] == counts[kind]) {
+        parseLine(&command, p, lines.infos[l].len, PARSE_VERTEX_DATA, NULL);
+        if (kind == 0) {
+          attrib->vertices[3 * ref->next + 0] = command.vx;
+          attrib->vertices[3 * ref->next + 1] = command.vy;
+          attrib->vertices[3 * ref->next + 2] = command.vz;
+        } else if (kind == 1) {
+          attrib->texcoords[2 * ref->next + 0] = command.tx;
+          attrib->texcoords[2 * ref->next + 1] = command.ty;
         } else {
-          if (shape_idx == 0) {
-            /* 'o' or 'g' after some 'v' lines. */
-            (*shapes)[shape_idx].name = my_strndup(
-                                                   prev_shape_name, prev_shape_name_len); /* may be NULL */
-            (*shapes)[shape_idx].face_offset = prev_shape.face_offset;
-            (*shapes)[shape_idx].length = face_count - prev_face_offset;
-            shape_idx++;
-
-            prev_face_offset = face_count;
-
-          } else {
-            if ((face_count - prev_face_offset) > 0) {
-              (*shapes)[shape_idx].name =
-                my_strndup(prev_shape_name, prev_shape_name_len);
-              (*shapes)[shape_idx].face_offset = prev_face_offset;
-              (*shapes)[shape_idx].length = face_count - prev_face_offset;
-              shape_idx++;
-              prev_face_offset = face_count;
-            }
-          }
-
-          /* Record shape info for succeeding 'o' or 'g' command. */
-          prev_shape_name = shape_name;
-          prev_shape_name_len = shape_name_len;
-          prev_shape_face_offset = face_count;
+          attrib->normals[3 * ref->next + 0] = command.nx;
+          attrib->normals[3 * ref->next + 1] = command.ny;
+          attrib->normals[3 * ref->next + 2] = command.nz;
         }
+        ref->next++;
       }
-      if (commands[i].type == COMMAND_F) {
-        face_count++;
-      }
+      counts[kind]++;
     }
+  }
+  for (kind = 0; kind < 3 && ret == TINYOBJ_SUCCESS; kind++) {
+    vertex_refs_remap(&refs[kind], attrib->faces, num_f, kind, totals[kind]);
+  }
 
-    if ((face_count - prev_face_offset) > 0) {
-      size_t length = face_count - prev_shape_face_offset;
-      if (length > 0) {
-        (*shapes)[shape_idx].name =
-          my_strndup(prev_shape_name, prev_shape_name_len);
-        (*shapes)[shape_idx].face_offset = prev_face_offset;
-        (*shapes)[shape_idx].length = face_count - prev_face_offset;
-        shape_idx++;
+  attrib->num_vertices = (unsigned int)refs[0].count;
+  attrib->num_texcoords = (unsigned int)refs[1].count;
+  attrib->num_normals = (unsigned int)refs[2].count;
+  attrib->num_faces = (unsigned int)num_f;
+  attrib->num_face_num_verts = (unsigned int)num_faces;
+
+  /* 4. Output options of tinyobj_parse_obj. */
+  if (ret == TINYOBJ_SUCCESS && (flags & TINYOBJ_FLAG_TRIANGULATE)) {
+    tinyobj_triangles_t triangles;
+
+    ret = triangulate_faces(&triangles, attrib, TINYOBJ_TRIANGULATE_FAN, 1, NULL);
+    if (ret == TINYOBJ_SUCCESS) {
+      tracked_free(attrib->faces, sizeof(tinyobj_vertex_index_t) * f_capacity);
+      tracked_free(attrib->face_num_verts, sizeof(int) * verts_capacity);
+      tracked_free(attrib->material_ids, sizeof(int) * ids_capacity);
+      attrib->faces = triangles.faces;
+      attrib->num_faces = triangles.num_faces;
+      attrib->face_num_verts = triangles.face_num_verts;
+      attrib->material_ids = triangles.material_ids;
+      attrib->num_face_num_verts = triangles.num_face_num_verts;
+      f_capacity = triangles.num_faces;
+    }
+  }
+  if (ret == TINYOBJ_SUCCESS && (flags & TINYOBJ_FLAG_SOA_INDICES)) {
+    ret = split_face_indices(attrib, totals[1] > 0, totals[2] > 0, NULL);
+    if (ret == TINYOBJ_SUCCESS) {
+      tracked_free(attrib->faces, sizeof(tinyobj_vertex_index_t) * f_capacity);
+      attrib->faces = NULL;
+    }
+  }
+  if (ret == TINYOBJ_SUCCESS && (flags & TINYOBJ_FLAG_QUANTIZE)) {
+    ret = quantize_attrib(attrib, flags & TINYOBJ_FLAG_QUANTIZE, NULL);
+    if (ret == TINYOBJ_SUCCESS) {
+      if (attrib->quantized_vertices) {
+        tracked_free(attrib->vertices, sizeof(float) * 3 * refs[0].count);
+        attrib->vertices = NULL;
+      }
+      if (attrib->quantized_texcoords) {
+        tracked_free(attrib->texcoords, sizeof(float) * 2 * refs[1].count);
+        attrib->texcoords = NULL;
+      }
+      if (attrib->quantized_normals) {
+        tracked_free(attrib->normals, sizeof(float) * 3 * refs[2].count);
+        attrib->normals = NULL;
       }
-    } else {
-      /* Guess no 'v' line occurrence after 'o' or 'g', so discards current
-       * shape information. */
     }
-
-    (*num_shapes) = shape_idx;
   }
 
-  if (commands) {
-    TINYOBJ_FREE(commands);
+  if (ret == TINYOBJ_SUCCESS) {
+    *shapes = shape_builder.shapes;
+    *num_shapes = shape_builder.num_shapes;
+    *materials = mtl_loader.materials;
+    *num_materials = mtl_loader.num_materials;
+    shape_builder.shapes = NULL;
+    shape_builder.num_shapes = 0;
+  } else {
+    tinyobj_attrib_free(attrib);
+    tinyobj_attrib_init(attrib);
+    tinyobj_materials_free(mtl_loader.materials, mtl_loader.num_materials);
   }
 
+  for (kind = 0; kind < 3; kind++) {
+    tracked_free(refs[kind].indices, sizeof(int) * (num_f ? num_f : 1));
+  }
+  tracked_free(needed, index->num_ranges);
+  shape_builder_free(&shape_builder);
+  mtl_loader_free(&mtl_loader);
   destroy_hash_table(&material_table);
+  face_buffer_free(&faces);
+  line_scanner_free(&lines);
+  tinyobj_unmap_file(buf, len);
+  return ret;
+}
 
-  (*materials_out) = materials;
-  (*num_materials_out) = num_materials;
-
-  return TINYOBJ_SUCCESS;
+void tinyobj_decode_normal(const int16_t oct[2], float normal[3]) {
+  float u = (float)oct[0] / 32767.0f;
+  float v = (float)oct[1] / 32767.0f;
+  float z, len;
+
+  /* -32768 is never written, but may come from elsewhere. */
+  if (u < -1.0f) u = -1.0f;
+  if (v < -1.0f) v = -1.0f;
+  z = 1.0f - tinyobj_absf(u) - tinyobj_absf(v);
+  if (z < 0.0f) {
+    float unfolded_u = (1.0f - tinyobj_absf(v)) * tinyobj_signf(u);
+    v = (1.0f - tinyobj_absf(u)) * tinyobj_signf(v);
+    u = unfolded_u;
+  }
+  len = tinyobj_sqrtf(u * u + v * v + z * z);
+  normal[0] = u / len;
+  normal[1] = v / len;
+  normal[2] = z / len;
 }
 
 void tinyobj_attrib_init(tinyobj_attrib_t *attrib) {
@@ -1717,6 +7659,16 @@ void tinyobj_attrib_init(tinyobj_attrib_t *attrib) {
   attrib->face_num_verts = NULL;
   attrib->num_face_num_verts = 0;
   attrib->material_ids = NULL;
+  attrib->v_indices = NULL;
+  attrib->vt_indices = NULL;
+  attrib->vn_indices = NULL;
+  attrib->quantized_vertices = NULL;
+  attrib->quantized_normals = NULL;
+  attrib->quantized_texcoords = NULL;
+  memset(attrib->vertex_offset, 0, sizeof(attrib->vertex_offset));
+  memset(attrib->vertex_scale, 0, sizeof(attrib->vertex_scale));
+  memset(attrib->texcoord_offset, 0, sizeof(attrib->texcoord_offset));
+  memset(attrib->texcoord_scale, 0, sizeof(attrib->texcoord_scale));
 }
 
 void tinyobj_attrib_free(tinyobj_attrib_t *attrib) {
@@ -1726,6 +7678,19 @@ void tinyobj_attrib_free(tinyobj_attrib_t *attrib) {
   if (attrib->faces) TINYOBJ_FREE(attrib->faces);
   if (attrib->face_num_verts) TINYOBJ_FREE(attrib->face_num_verts);
   if (attrib->material_ids) TINYOBJ_FREE(attrib->material_ids);
+  if (attrib->v_indices) TINYOBJ_FREE(attrib->v_indices);
+  if (attrib->vt_indices) TINYOBJ_FREE(attrib->vt_indices);
+  if (attrib->vn_indices) TINYOBJ_FREE(attrib->vn_indices);
+  if (attrib->quantized_vertices) TINYOBJ_FREE(attrib->quantized_vertices);
+  if (attrib->quantized_normals) TINYOBJ_FREE(attrib->quantized_normals);
+  if (attrib->quantized_texcoords) TINYOBJ_FREE(attrib->quantized_texcoords);
+}
+
+void tinyobj_string_pool_free(tinyobj_string_pool_t *pool) {
+  if (pool == NULL) return;
+  tracked_free(pool->data, pool->size);
+  pool->data = NULL;
+  pool->size = 0;
 }
 
 void tinyobj_shapes_free(tinyobj_shape_t *shapes, size_t num_shapes) {
@@ -1733,7 +7698,7 @@ void tinyobj_shapes_free(tinyobj_shape_t *shapes, size_t num_shapes) {
   if (shapes == NULL) return;
 
   for (i = 0; i < num_shapes; i++) {
-    if (shapes[i].name) TINYOBJ_FREE(shapes[i].name);
+    if (shapes[i].name && !shapes[i].pooled_name) TINYOBJ_FREE(shapes[i].name);
   }
 
   TINYOBJ_FREE(shapes);
@@ -1745,6 +7710,7 @@ void tinyobj_materials_free(tinyobj_material_t *materials,
   if (materials == NULL) return;
 
   for (i = 0; i < num_materials; i++) {
+    if (materials[i].pooled_names) continue;
     if (materials[i].name) TINYOBJ_FREE(materials[i].name);
     if (materials[i].ambient_texname) TINYOBJ_FREE(materials[i].ambient_texname);
     if (materials[i].diffuse_texname) TINYOBJ_FREE(materials[i].diffuse_texname);